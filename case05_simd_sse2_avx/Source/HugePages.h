@@ -0,0 +1,132 @@
+#pragma once
+#include <Windows.h>
+#include <new>
+#include <type_traits>
+
+/*
+    Page-size backend for the SoA buffers: 4 KB, 2 MB (large) or 1 GB (huge)
+    pages. Same backend as case11 (HugePages.h), plus PageAllocator so the
+    std::vector columns of SoAVertexs can live on large pages.
+
+    - PAGE_KIND_LARGE is VirtualAlloc(MEM_LARGE_PAGES), PAGE_KIND_HUGE is
+      VirtualAlloc2 with MEM_EXTENDED_PARAMETER_NONPAGED_HUGE (Windows 10 1803+,
+      resolved at run time). Both need SeLockMemoryPrivilege granted to the
+      account; it is enabled in the token on first use.
+    - Windows has no transparent huge pages: large pages are locked, never paged
+      out, and must be physically contiguous, so they can fail on a fragmented
+      machine even with the privilege.
+    - AllocPageRegion falls back HUGE -> LARGE -> SMALL and reports the kind it
+      obtained; the size is rounded up to that page size.
+*/
+enum PageKind
+{
+    PAGE_KIND_SMALL,
+    PAGE_KIND_LARGE,
+    PAGE_KIND_HUGE,
+};
+
+struct PageRegion
+{
+    char* pBase;
+    size_t nSize;       //Rounded up to the page size of eKind
+    PageKind eKind;     //What was obtained, may be smaller than requested
+};
+
+bool AllocPageRegion(size_t nSize, PageKind ePreferred, PageRegion* pRegion);
+void FreePageRegion(PageRegion* pRegion);
+
+//0 when the kind is not supported by the machine
+size_t PageKindBytes(PageKind eKind);
+const char* PageKindName(PageKind eKind);
+
+//One region carved into consecutive buffers; the owner frees the region after every buffer is gone
+struct PageArena
+{
+    PageRegion hRegion;
+    size_t nUsed;
+};
+
+/*
+    std::vector allocator over AllocPageRegion. PAGE_KIND_SMALL (the default)
+    keeps operator new, so default-constructed columns behave exactly like
+    std::vector<float>; the other kinds round every buffer up to their page size,
+    so they are meant for a few large buffers, not for many small ones.
+    Built over a PageArena, buffers are cut from that region (64-byte aligned)
+    and never given back individually, so several columns share its pages.
+*/
+template<typename T>
+struct PageAllocator
+{
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+
+    PageKind ePages;
+    PageArena* pArena;
+
+    PageAllocator(PageKind ePagesIn = PAGE_KIND_SMALL) noexcept
+        : ePages(ePagesIn), pArena(nullptr)
+    {
+    }
+
+    explicit PageAllocator(PageArena* pArenaIn) noexcept
+        : ePages(pArenaIn->hRegion.eKind), pArena(pArenaIn)
+    {
+    }
+
+    template<typename U>
+    PageAllocator(const PageAllocator<U>& hOther) noexcept
+        : ePages(hOther.ePages), pArena(hOther.pArena)
+    {
+    }
+
+    T* allocate(size_t nCount)
+    {
+        if (this->pArena)
+        {
+            const size_t nOffset = (this->pArena->nUsed + 63) & ~static_cast<size_t>(63);
+            if (nOffset > this->pArena->hRegion.nSize || nCount > (this->pArena->hRegion.nSize - nOffset) / sizeof(T))
+            {
+                throw std::bad_alloc();
+            }
+
+            this->pArena->nUsed = nOffset + nCount * sizeof(T);
+            return reinterpret_cast<T*>(this->pArena->hRegion.pBase + nOffset);
+        }
+
+        if (this->ePages == PAGE_KIND_SMALL)
+        {
+            return static_cast<T*>(::operator new(nCount * sizeof(T)));
+        }
+
+        PageRegion hRegion = {};
+        if (!AllocPageRegion(nCount * sizeof(T), this->ePages, &hRegion))
+        {
+            throw std::bad_alloc();
+        }
+
+        return reinterpret_cast<T*>(hRegion.pBase);
+    }
+
+    void deallocate(T* pPtr, size_t)
+    {
+        if (this->pArena)
+        {
+            return;
+        }
+
+        if (this->ePages == PAGE_KIND_SMALL)
+        {
+            ::operator delete(pPtr);
+            return;
+        }
+
+        PageRegion hRegion = { reinterpret_cast<char*>(pPtr), 0, this->ePages };
+        FreePageRegion(&hRegion);
+    }
+
+    template<typename U>
+    bool operator==(const PageAllocator<U>& hOther) const noexcept
+    {
+        return this->ePages == hOther.ePages && this->pArena == hOther.pArena;
+    }
+};
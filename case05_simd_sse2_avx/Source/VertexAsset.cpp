@@ -0,0 +1,378 @@
+#include "VertexAsset.h"
+#include <bit>
+#include <vector>
+
+//Same conversion as case04 (HalfFloat.h): truncating, Inf/NaN preserved, subnormals supported
+std::uint16_t FloatToHalf(float fValue)
+{
+    const std::uint32_t dwBits = std::bit_cast<std::uint32_t>(fValue);
+
+    const std::uint32_t dwSign = (dwBits >> 31) & 0x1;
+    const std::int32_t nExp = static_cast<std::int32_t>((dwBits >> 23) & 0xFF) - 127 + 15;
+    std::uint32_t dwMant = dwBits & 0x7FFFFF;
+
+    if (nExp <= 0)
+    {
+        if (nExp < -10)
+        {
+            return static_cast<std::uint16_t>(dwSign << 15);
+        }
+
+        dwMant |= 0x800000;
+        return static_cast<std::uint16_t>((dwSign << 15) | (dwMant >> (14 - nExp)));
+    }
+    else if (nExp >= 31)
+    {
+        //Source exponent 0xFF with a mantissa is NaN: keep a quiet bit so it does not become Inf
+        const bool bNaN = ((dwBits >> 23) & 0xFF) == 0xFF && dwMant != 0;
+        return static_cast<std::uint16_t>((dwSign << 15) | 0x7C00 | (bNaN ? 0x200 : 0));
+    }
+
+    return static_cast<std::uint16_t>((dwSign << 15) | (static_cast<std::uint32_t>(nExp) << 10) | (dwMant >> 13));
+}
+
+float HalfToFloat(std::uint16_t wValue)
+{
+    const std::uint32_t dwSign = (static_cast<std::uint32_t>(wValue) >> 15) & 0x1;
+    std::uint32_t dwExp = (static_cast<std::uint32_t>(wValue) >> 10) & 0x1F;
+    std::uint32_t dwMant = static_cast<std::uint32_t>(wValue) & 0x3FF;
+
+    std::uint32_t dwBits = 0;
+    if (!dwExp)
+    {
+        if (!dwMant)
+        {
+            dwBits = dwSign << 31;
+        }
+        else
+        {
+            //Subnormal: normalize the mantissa
+            std::int32_t nExp = 1;
+            while (!(dwMant & 0x400))
+            {
+                dwMant <<= 1;
+                --nExp;
+            }
+
+            dwMant &= 0x3FF;
+            dwBits = (dwSign << 31) | (static_cast<std::uint32_t>(nExp - 15 + 127) << 23) | (dwMant << 13);
+        }
+    }
+    else if (dwExp == 0x1F)
+    {
+        dwBits = (dwSign << 31) | 0x7F800000 | (dwMant << 13);
+    }
+    else
+    {
+        dwExp = dwExp - 15 + 127;
+        dwBits = (dwSign << 31) | (dwExp << 23) | (dwMant << 13);
+    }
+
+    return std::bit_cast<float>(dwBits);
+}
+
+static std::uint64_t AlignUp(std::uint64_t qwValue, std::uint64_t qwAlignment)
+{
+    return (qwValue + qwAlignment - 1) & ~(qwAlignment - 1);
+}
+
+static std::uint64_t FormatSize(VertexFormat eFormat)
+{
+    return eFormat == VERTEX_FORMAT_FLOAT16 ? sizeof(std::uint16_t) : sizeof(float);
+}
+
+static bool WriteAll(HANDLE hFile, const void* pData, std::uint64_t qwSize)
+{
+    constexpr std::uint64_t WRITE_CHUNK = 16 * 1024 * 1024;
+
+    const std::uint8_t* pBytes = static_cast<const std::uint8_t*>(pData);
+    while (qwSize > 0)
+    {
+        const DWORD dwToWrite = static_cast<DWORD>(min(qwSize, WRITE_CHUNK));
+
+        DWORD dwWritten = 0;
+        if (!WriteFile(hFile, pBytes, dwToWrite, &dwWritten, nullptr) || dwWritten != dwToWrite)
+        {
+            return false;
+        }
+
+        pBytes += dwWritten;
+        qwSize -= dwWritten;
+    }
+
+    return true;
+}
+
+static bool WritePadding(HANDLE hFile, std::uint64_t qwPosition)
+{
+    static const std::uint8_t pZeros[VERTEX_ASSET_ALIGNMENT] = {};
+    return WriteAll(hFile, pZeros, AlignUp(qwPosition, VERTEX_ASSET_ALIGNMENT) - qwPosition);
+}
+
+bool WriteVertexAsset(const char* path, const SoAVertexs& hVertexs, DWORD dwFlags)
+{
+    const size_t nCount = hVertexs.x.size();
+    if (hVertexs.y.size() != nCount || hVertexs.z.size() != nCount || !(dwFlags & (VERTEX_ASSET_WRITE_FLOAT | VERTEX_ASSET_WRITE_HALF)))
+    {
+        return false;
+    }
+
+    const SoAColumn* pSources[VERTEX_SEMANTIC_COUNT] = { &hVertexs.x, &hVertexs.y, &hVertexs.z };
+
+    //Layout: header, directory, then every column on its own 64-byte boundary
+    std::vector<VertexAssetColumn> vDirectory;
+
+    const VertexFormat eFormats[] = { VERTEX_FORMAT_FLOAT32, VERTEX_FORMAT_FLOAT16 };
+    const DWORD dwFormatFlags[] = { VERTEX_ASSET_WRITE_FLOAT, VERTEX_ASSET_WRITE_HALF };
+
+    for (size_t f = 0; f < 2; ++f)
+    {
+        if (!(dwFlags & dwFormatFlags[f]))
+        {
+            continue;
+        }
+
+        for (std::uint32_t s = 0; s < VERTEX_SEMANTIC_COUNT; ++s)
+        {
+            VertexAssetColumn hColumn = {};
+            hColumn.dwSemantic = s;
+            hColumn.dwFormat = eFormats[f];
+            hColumn.qwSize = nCount * FormatSize(eFormats[f]);
+            vDirectory.push_back(hColumn);
+        }
+    }
+
+    std::uint64_t qwPosition = sizeof(VertexAssetHeader) + vDirectory.size() * sizeof(VertexAssetColumn);
+    for (VertexAssetColumn& hColumn : vDirectory)
+    {
+        hColumn.qwOffset = AlignUp(qwPosition, VERTEX_ASSET_ALIGNMENT);
+        qwPosition = hColumn.qwOffset + hColumn.qwSize;
+    }
+
+    VertexAssetHeader hHeader = {};
+    hHeader.dwMagic = VERTEX_ASSET_MAGIC;
+    hHeader.wVersionMajor = VERTEX_ASSET_VERSION_MAJOR;
+    hHeader.wVersionMinor = VERTEX_ASSET_VERSION_MINOR;
+    hHeader.dwHeaderSize = sizeof(VertexAssetHeader);
+    hHeader.dwColumnCount = static_cast<std::uint32_t>(vDirectory.size());
+    hHeader.qwVertexCount = nCount;
+    hHeader.qwDirectoryOffset = sizeof(VertexAssetHeader);
+    hHeader.qwFileSize = qwPosition;
+
+    HANDLE hFile = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    bool bResult = WriteAll(hFile, &hHeader, sizeof(hHeader)) && WriteAll(hFile, vDirectory.data(), vDirectory.size() * sizeof(VertexAssetColumn));
+
+    qwPosition = sizeof(VertexAssetHeader) + vDirectory.size() * sizeof(VertexAssetColumn);
+
+    constexpr size_t HALF_CHUNK = 64 * 1024;
+    std::vector<std::uint16_t> vHalf;
+
+    for (const VertexAssetColumn& hColumn : vDirectory)
+    {
+        if (!bResult)
+        {
+            break;
+        }
+
+        bResult = WritePadding(hFile, qwPosition);
+
+        const SoAColumn& vSource = *pSources[hColumn.dwSemantic];
+        if (hColumn.dwFormat == VERTEX_FORMAT_FLOAT32)
+        {
+            bResult = bResult && WriteAll(hFile, vSource.data(), hColumn.qwSize);
+        }
+        else
+        {
+            vHalf.resize(HALF_CHUNK);
+            for (size_t i = 0; i < nCount && bResult; i += HALF_CHUNK)
+            {
+                const size_t nChunk = min(HALF_CHUNK, nCount - i);
+                for (size_t j = 0; j < nChunk; ++j)
+                {
+                    vHalf[j] = FloatToHalf(vSource[i + j]);
+                }
+
+                bResult = WriteAll(hFile, vHalf.data(), nChunk * sizeof(std::uint16_t));
+            }
+        }
+
+        qwPosition = hColumn.qwOffset + hColumn.qwSize;
+    }
+
+    CloseHandle(hFile);
+
+    if (!bResult)
+    {
+        DeleteFileA(path);
+    }
+
+    return bResult;
+}
+
+VertexAsset::VertexAsset()
+{
+    this->hFile = INVALID_HANDLE_VALUE;
+    this->hMap = nullptr;
+    this->pView = nullptr;
+    this->nFileSize = 0;
+    this->nVertexCount = 0;
+    this->pDirectory = nullptr;
+    this->nColumnCount = 0;
+}
+
+VertexAsset::~VertexAsset()
+{
+    this->Close();
+}
+
+bool VertexAsset::Open(const char* path)
+{
+    this->Close();
+
+    this->hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (this->hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER liSize = {};
+    if (!GetFileSizeEx(this->hFile, &liSize) || static_cast<std::uint64_t>(liSize.QuadPart) < sizeof(VertexAssetHeader))
+    {
+        this->Close();
+        return false;
+    }
+
+    this->nFileSize = static_cast<size_t>(liSize.QuadPart);
+
+    this->hMap = CreateFileMappingA(this->hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!this->hMap)
+    {
+        this->Close();
+        return false;
+    }
+
+    //Views start on the allocation granularity (64 KB), so every 64-byte aligned file offset stays 64-byte aligned in memory
+    this->pView = static_cast<const std::uint8_t*>(MapViewOfFile(this->hMap, FILE_MAP_READ, 0, 0, 0));
+    if (!this->pView)
+    {
+        this->Close();
+        return false;
+    }
+
+    //Validate everything the spans will point at: a bad file fails here, never inside a loop
+    const VertexAssetHeader* pHeader = reinterpret_cast<const VertexAssetHeader*>(this->pView);
+    if (pHeader->dwMagic != VERTEX_ASSET_MAGIC || pHeader->wVersionMajor != VERTEX_ASSET_VERSION_MAJOR ||
+        pHeader->dwHeaderSize < sizeof(VertexAssetHeader) || pHeader->qwFileSize > this->nFileSize ||
+        pHeader->qwVertexCount > this->nFileSize)
+    {
+        this->Close();
+        return false;
+    }
+
+    const std::uint64_t qwDirectorySize = static_cast<std::uint64_t>(pHeader->dwColumnCount) * sizeof(VertexAssetColumn);
+    if (pHeader->qwDirectoryOffset < pHeader->dwHeaderSize || pHeader->qwDirectoryOffset > this->nFileSize ||
+        qwDirectorySize > this->nFileSize - pHeader->qwDirectoryOffset || (pHeader->qwDirectoryOffset % alignof(VertexAssetColumn)) != 0)
+    {
+        this->Close();
+        return false;
+    }
+
+    const VertexAssetColumn* pColumns = reinterpret_cast<const VertexAssetColumn*>(this->pView + pHeader->qwDirectoryOffset);
+    for (std::uint32_t i = 0; i < pHeader->dwColumnCount; ++i)
+    {
+        const VertexAssetColumn& hColumn = pColumns[i];
+
+        //Unknown semantics/formats come from newer minor versions and are skipped by FindColumn, but still bounds-checked
+        const bool bKnownFormat = hColumn.dwFormat == VERTEX_FORMAT_FLOAT32 || hColumn.dwFormat == VERTEX_FORMAT_FLOAT16;
+        const bool bSizeOk = !bKnownFormat || hColumn.qwSize == pHeader->qwVertexCount * FormatSize(static_cast<VertexFormat>(hColumn.dwFormat));
+
+        if ((hColumn.qwOffset % VERTEX_ASSET_ALIGNMENT) != 0 || hColumn.qwOffset > this->nFileSize ||
+            hColumn.qwSize > this->nFileSize - hColumn.qwOffset || !bSizeOk)
+        {
+            this->Close();
+            return false;
+        }
+    }
+
+    this->nVertexCount = static_cast<size_t>(pHeader->qwVertexCount);
+    this->pDirectory = pColumns;
+    this->nColumnCount = pHeader->dwColumnCount;
+
+    return true;
+}
+
+void VertexAsset::Close()
+{
+    if (this->pView)
+    {
+        UnmapViewOfFile(this->pView);
+        this->pView = nullptr;
+    }
+
+    if (this->hMap)
+    {
+        CloseHandle(this->hMap);
+        this->hMap = nullptr;
+    }
+
+    if (this->hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(this->hFile);
+        this->hFile = INVALID_HANDLE_VALUE;
+    }
+
+    this->nFileSize = 0;
+    this->nVertexCount = 0;
+    this->pDirectory = nullptr;
+    this->nColumnCount = 0;
+}
+
+const VertexAssetColumn* VertexAsset::FindColumn(VertexSemantic eSemantic, VertexFormat eFormat) const
+{
+    for (size_t i = 0; i < this->nColumnCount; ++i)
+    {
+        if (this->pDirectory[i].dwSemantic == eSemantic && this->pDirectory[i].dwFormat == eFormat)
+        {
+            return &this->pDirectory[i];
+        }
+    }
+
+    return nullptr;
+}
+
+std::span<const float> VertexAsset::GetFloatColumn(VertexSemantic eSemantic) const
+{
+    const VertexAssetColumn* pColumn = this->FindColumn(eSemantic, VERTEX_FORMAT_FLOAT32);
+    if (!pColumn)
+    {
+        return {};
+    }
+
+    return std::span<const float>(reinterpret_cast<const float*>(this->pView + pColumn->qwOffset), this->nVertexCount);
+}
+
+std::span<const std::uint16_t> VertexAsset::GetHalfColumn(VertexSemantic eSemantic) const
+{
+    const VertexAssetColumn* pColumn = this->FindColumn(eSemantic, VERTEX_FORMAT_FLOAT16);
+    if (!pColumn)
+    {
+        return {};
+    }
+
+    return std::span<const std::uint16_t>(reinterpret_cast<const std::uint16_t*>(this->pView + pColumn->qwOffset), this->nVertexCount);
+}
+
+SoAVertexSpans VertexAsset::GetSoA() const
+{
+    return { this->GetFloatColumn(VERTEX_SEMANTIC_X), this->GetFloatColumn(VERTEX_SEMANTIC_Y), this->GetFloatColumn(VERTEX_SEMANTIC_Z) };
+}
+
+SoAHalfVertexSpans VertexAsset::GetHalfSoA() const
+{
+    return { this->GetHalfColumn(VERTEX_SEMANTIC_X), this->GetHalfColumn(VERTEX_SEMANTIC_Y), this->GetHalfColumn(VERTEX_SEMANTIC_Z) };
+}
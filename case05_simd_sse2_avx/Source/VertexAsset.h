@@ -0,0 +1,127 @@
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include <span>
+#include "VertexStruct.h"
+
+/*
+    Memory-mappable vertex asset (.vxa), little-endian.
+
+    [VertexAssetHeader   64 bytes]
+    [VertexAssetColumn * dwColumnCount]   <- directory
+    [column 0]  64-byte aligned, tightly packed values
+    [column 1]  64-byte aligned
+    ...
+
+    Every column holds one component (x, y or z) of every vertex in one
+    format, so the file already has the SoAVertexs layout: the loader maps it
+    and returns pointers into the view, with no copy and no parse. Half
+    precision columns are optional and can live next to the float ones.
+
+    A reader accepts any file with the same major version; minor versions may
+    only append columns or use reserved fields.
+*/
+constexpr std::uint32_t VERTEX_ASSET_MAGIC = 0x53415856; //"VXAS"
+constexpr std::uint16_t VERTEX_ASSET_VERSION_MAJOR = 1;
+constexpr std::uint16_t VERTEX_ASSET_VERSION_MINOR = 0;
+constexpr std::uint64_t VERTEX_ASSET_ALIGNMENT = 64;
+
+enum VertexSemantic : std::uint32_t
+{
+    VERTEX_SEMANTIC_X,
+    VERTEX_SEMANTIC_Y,
+    VERTEX_SEMANTIC_Z,
+    VERTEX_SEMANTIC_COUNT,
+};
+
+enum VertexFormat : std::uint32_t
+{
+    VERTEX_FORMAT_FLOAT32,
+    VERTEX_FORMAT_FLOAT16,
+};
+
+//Which column formats WriteVertexAsset stores
+enum VertexAssetWriteFlags : DWORD
+{
+    VERTEX_ASSET_WRITE_FLOAT = 1 << 0,
+    VERTEX_ASSET_WRITE_HALF = 1 << 1,
+};
+
+struct VertexAssetHeader
+{
+    std::uint32_t dwMagic;
+    std::uint16_t wVersionMajor;
+    std::uint16_t wVersionMinor;
+    std::uint32_t dwHeaderSize;
+    std::uint32_t dwColumnCount;
+    std::uint64_t qwVertexCount;
+    std::uint64_t qwDirectoryOffset;
+    std::uint64_t qwFileSize;
+    std::uint8_t pReserved[24];
+};
+
+struct VertexAssetColumn
+{
+    std::uint32_t dwSemantic;
+    std::uint32_t dwFormat;
+    std::uint64_t qwOffset;     //From the start of the file, multiple of VERTEX_ASSET_ALIGNMENT
+    std::uint64_t qwSize;       //Bytes, qwVertexCount * format size
+    std::uint64_t qwReserved;
+};
+
+static_assert(sizeof(VertexAssetHeader) == 64, "The header is part of the file format");
+static_assert(sizeof(VertexAssetColumn) == 32, "The directory entries are part of the file format");
+
+//Same member names as SoAVertexs, so code written against .x/.y/.z with data()/size() works on both
+struct SoAVertexSpans
+{
+    std::span<const float> x;
+    std::span<const float> y;
+    std::span<const float> z;
+};
+
+struct SoAHalfVertexSpans
+{
+    std::span<const std::uint16_t> x;
+    std::span<const std::uint16_t> y;
+    std::span<const std::uint16_t> z;
+};
+
+bool WriteVertexAsset(const char* path, const SoAVertexs& hVertexs, DWORD dwFlags);
+
+std::uint16_t FloatToHalf(float fValue);
+float HalfToFloat(std::uint16_t wValue);
+
+class VertexAsset
+{
+public:
+    VertexAsset();
+    ~VertexAsset();
+
+    VertexAsset(const VertexAsset&) = delete;
+    VertexAsset& operator=(const VertexAsset&) = delete;
+
+    //Maps the file and validates the header and directory. Nothing is read beyond that.
+    bool Open(const char* path);
+    void Close();
+
+    size_t GetVertexCount() const { return this->nVertexCount; }
+
+    //Empty span when the column is not in the file
+    std::span<const float> GetFloatColumn(VertexSemantic eSemantic) const;
+    std::span<const std::uint16_t> GetHalfColumn(VertexSemantic eSemantic) const;
+
+    SoAVertexSpans GetSoA() const;
+    SoAHalfVertexSpans GetHalfSoA() const;
+
+private:
+    const VertexAssetColumn* FindColumn(VertexSemantic eSemantic, VertexFormat eFormat) const;
+
+    HANDLE hFile;
+    HANDLE hMap;
+    const std::uint8_t* pView;
+    size_t nFileSize;
+    size_t nVertexCount;
+    const VertexAssetColumn* pDirectory;
+    size_t nColumnCount;
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include "HugePages.h"
 
 //AoS
 struct alignas(16) AoSVertex
@@ -7,10 +8,12 @@ struct alignas(16) AoSVertex
     float x, y, z, w;
 };
 
-//SoA
+//SoA; the columns use 4 KB pages unless built with PageAllocator<float>(PAGE_KIND_LARGE / PAGE_KIND_HUGE)
+typedef std::vector<float, PageAllocator<float>> SoAColumn;
+
 struct SoAVertexs
 {
-    std::vector<float> x;
-    std::vector<float> y;
-    std::vector<float> z;
+    SoAColumn x;
+    SoAColumn y;
+    SoAColumn z;
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <vector>
 #include "VertexStruct.h"
 #include "Simd/simd_dispatch.h"
+#include "VertexAsset.h"
 #include <iostream>
 
 //CPUID SSE2 and AVX
@@ -73,6 +74,302 @@ double BenchmarkQPC(CallBack&& Function, T* pIn, T* pOut, size_t nCount, float f
     practically negligible.
 */
 
+/*
+    Asset load: the classic path reads a serialized mesh (vertex count followed
+    by interleaved x, y, z) and deserializes it into a SoAVertexs; the .vxa path
+    maps the file and hands out spans. Mapping is lazy, so the .vxa numbers are
+    given for the open alone and for open + one pass over every component (the
+    page faults are paid there). Files are read right after being written, so
+    both paths are measured with a warm file cache.
+*/
+static double ElapsedMilliseconds(const LARGE_INTEGER& liStart)
+{
+    LARGE_INTEGER liFrequency;
+    LARGE_INTEGER liEnd;
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liEnd);
+
+    return static_cast<double>(liEnd.QuadPart - liStart.QuadPart) * 1000.0 / static_cast<double>(liFrequency.QuadPart);
+}
+
+static bool WriteSerializedMesh(const char* path, const SoAVertexs& hVertexs)
+{
+    HANDLE hFile = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    constexpr size_t CHUNK_VERTEX = 64 * 1024;
+    std::vector<float> vInterleaved(CHUNK_VERTEX * 3);
+
+    const std::uint64_t qwCount = hVertexs.x.size();
+
+    DWORD dwWritten = 0;
+    bool bResult = WriteFile(hFile, &qwCount, sizeof(qwCount), &dwWritten, nullptr) != FALSE;
+
+    for (size_t i = 0; i < hVertexs.x.size() && bResult; i += CHUNK_VERTEX)
+    {
+        const size_t nChunk = min(CHUNK_VERTEX, hVertexs.x.size() - i);
+        for (size_t j = 0; j < nChunk; ++j)
+        {
+            vInterleaved[j * 3 + 0] = hVertexs.x[i + j];
+            vInterleaved[j * 3 + 1] = hVertexs.y[i + j];
+            vInterleaved[j * 3 + 2] = hVertexs.z[i + j];
+        }
+
+        bResult = WriteFile(hFile, vInterleaved.data(), static_cast<DWORD>(nChunk * 3 * sizeof(float)), &dwWritten, nullptr) != FALSE;
+    }
+
+    CloseHandle(hFile);
+    return bResult;
+}
+
+[[clang::noinline]]
+static bool LoadSerializedMesh(const char* path, SoAVertexs* pOut)
+{
+    HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    std::uint64_t qwCount = 0;
+    DWORD dwRead = 0;
+    if (!ReadFile(hFile, &qwCount, sizeof(qwCount), &dwRead, nullptr) || dwRead != sizeof(qwCount))
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    const size_t nCount = static_cast<size_t>(qwCount);
+    pOut->x.resize(nCount);
+    pOut->y.resize(nCount);
+    pOut->z.resize(nCount);
+
+    constexpr size_t CHUNK_VERTEX = 64 * 1024;
+    std::vector<float> vInterleaved(CHUNK_VERTEX * 3);
+
+    bool bResult = true;
+    for (size_t i = 0; i < nCount && bResult; i += CHUNK_VERTEX)
+    {
+        const size_t nChunk = min(CHUNK_VERTEX, nCount - i);
+        const DWORD dwToRead = static_cast<DWORD>(nChunk * 3 * sizeof(float));
+
+        bResult = ReadFile(hFile, vInterleaved.data(), dwToRead, &dwRead, nullptr) && dwRead == dwToRead;
+
+        //Deserialize: AoS stream -> SoA
+        for (size_t j = 0; j < nChunk && bResult; ++j)
+        {
+            pOut->x[i + j] = vInterleaved[j * 3 + 0];
+            pOut->y[i + j] = vInterleaved[j * 3 + 1];
+            pOut->z[i + j] = vInterleaved[j * 3 + 2];
+        }
+    }
+
+    CloseHandle(hFile);
+    return bResult;
+}
+
+template<typename Columns>
+[[clang::noinline]]
+static float SumColumns(const Columns& hColumns)
+{
+    float fSum = 0.0f;
+    for (size_t i = 0; i < hColumns.x.size(); ++i)
+    {
+        fSum += hColumns.x[i] + hColumns.y[i] + hColumns.z[i];
+    }
+
+    return fSum;
+}
+
+[[clang::noinline]]
+static float SumHalfColumns(const SoAHalfVertexSpans& hColumns)
+{
+    float fSum = 0.0f;
+    for (size_t i = 0; i < hColumns.x.size(); ++i)
+    {
+        fSum += HalfToFloat(hColumns.x[i]) + HalfToFloat(hColumns.y[i]) + HalfToFloat(hColumns.z[i]);
+    }
+
+    return fSum;
+}
+
+static void Bench_VertexAssetLoad()
+{
+    static const char* pSerializedPath = "mesh_serialized.bin";
+    static const char* pAssetPath = "mesh.vxa";
+
+    const size_t nCounts[] = { 1'000'000, 10'000'000, 100'000'000 };
+
+    volatile float fSink = 0.0f;
+
+    for (const size_t nCount : nCounts)
+    {
+        {
+            SoAVertexs hSource = {};
+            hSource.x.resize(nCount);
+            hSource.y.resize(nCount);
+            hSource.z.resize(nCount);
+
+            for (size_t i = 0; i < nCount; ++i)
+            {
+                hSource.x[i] = static_cast<float>(i % 1024) * 0.25f;
+                hSource.y[i] = static_cast<float>(i % 512) * 0.5f;
+                hSource.z[i] = static_cast<float>(i % 256);
+            }
+
+            if (!WriteSerializedMesh(pSerializedPath, hSource) || !WriteVertexAsset(pAssetPath, hSource, VERTEX_ASSET_WRITE_FLOAT | VERTEX_ASSET_WRITE_HALF))
+            {
+                std::cout << "Cannot write the mesh files" << std::endl;
+                break;
+            }
+        }
+
+        LARGE_INTEGER liStart;
+
+        //read + deserialize, then the same pass as the mapped path
+        QueryPerformanceCounter(&liStart);
+        SoAVertexs hLoaded = {};
+        const bool bLoaded = LoadSerializedMesh(pSerializedPath, &hLoaded);
+        const double dDeserialize = ElapsedMilliseconds(liStart);
+        fSink = fSink + SumColumns(hLoaded);
+        const double dDeserializePass = ElapsedMilliseconds(liStart);
+
+        hLoaded = {};
+
+        //mmap: open (header + directory validation) and spans
+        QueryPerformanceCounter(&liStart);
+        VertexAsset hAsset;
+        const bool bMapped = hAsset.Open(pAssetPath);
+        const SoAVertexSpans hSpans = hAsset.GetSoA();
+        const double dOpen = ElapsedMilliseconds(liStart);
+        fSink = fSink + SumColumns(hSpans);
+        const double dOpenPass = ElapsedMilliseconds(liStart);
+
+        //Half columns: half the bytes to fault in, conversion in the loop
+        QueryPerformanceCounter(&liStart);
+        fSink = fSink + SumHalfColumns(hAsset.GetHalfSoA());
+        const double dHalfPass = ElapsedMilliseconds(liStart);
+
+        hAsset.Close();
+
+        if (!bLoaded || !bMapped)
+        {
+            std::cout << "Load failed" << std::endl;
+            break;
+        }
+
+        std::cout << nCount / 1'000'000 << "M vertices"
+            << " | read+deserialize: " << dDeserialize << "ms (+pass " << dDeserializePass << "ms)"
+            << " | vxa map: " << dOpen << "ms (+pass " << dOpenPass << "ms)"
+            << " | vxa half pass: " << dHalfPass << "ms" << std::endl;
+    }
+
+    DeleteFileA(pSerializedPath);
+    DeleteFileA(pAssetPath);
+}
+
+/*
+    SoA buffers on 4 KB, 2 MB and 1 GB pages: the six columns are cut from one
+    region of each kind, so they all sit on the pages that region obtained.
+    The transform streams through them; the gather reads the three components
+    of random vertices, with every index depending on the previous load, so
+    each TLB miss (and its page walk) is paid in full. The 1 GB case runs only
+    when the columns fill at least one such page.
+    Windows exposes no dTLB miss counter to user mode; the gather time per
+    vertex is the proxy here, the counters themselves need a PMC profiler
+    (WPR/xperf with DTLB_LOAD_MISSES, or VTune).
+*/
+[[clang::noinline]]
+static float GatherRandom(const SoAVertexs& hColumns, size_t nCount, size_t nReads)
+{
+    ULONGLONG qwState = 0x9E3779B97F4A7C15ull;
+    float fSum = 0.0f;
+
+    for (size_t i = 0; i < nReads; ++i)
+    {
+        qwState ^= qwState << 13;
+        qwState ^= qwState >> 7;
+        qwState ^= qwState << 17;
+
+        const size_t nIndex = static_cast<size_t>(qwState % nCount);
+        const float fValue = hColumns.x[nIndex] + hColumns.y[nIndex] + hColumns.z[nIndex];
+
+        fSum += fValue;
+        qwState += static_cast<ULONGLONG>(fValue);
+    }
+
+    return fSum;
+}
+
+static void Bench_SoAPageSizes(decltype(&Transform_Scalar_SoA) pTransform)
+{
+    constexpr size_t nCount = 32 * 1024 * 1024;
+    constexpr size_t nReads = 16 * 1024 * 1024;
+    //Six columns in one region, each padded to the arena's 64-byte alignment
+    constexpr size_t nRegionSize = 6 * ((nCount * sizeof(float) + 63) & ~static_cast<size_t>(63));
+
+    volatile float fSink = 0.0f;
+
+    const PageKind eKinds[] = { PAGE_KIND_SMALL, PAGE_KIND_LARGE, PAGE_KIND_HUGE };
+    for (const PageKind eWanted : eKinds)
+    {
+        //A 1 GB page for less than 1 GB of columns would only lock memory the test never touches
+        if (PageKindBytes(eWanted) > nRegionSize)
+        {
+            std::cout << PageKindName(eWanted) << " pages skipped: the columns take "
+                << nRegionSize / (1024 * 1024) << " MB, less than one page" << std::endl;
+            continue;
+        }
+
+        LARGE_INTEGER liStart;
+        QueryPerformanceCounter(&liStart);
+
+        PageArena hArena = {};
+        if (!AllocPageRegion(nRegionSize, eWanted, &hArena.hRegion))
+        {
+            std::cout << PageKindName(eWanted) << " pages: allocation failed" << std::endl;
+            continue;
+        }
+
+        //The fallback is silent in AllocPageRegion: report the kind the columns actually live on
+        const PageKind eObtained = hArena.hRegion.eKind;
+
+        {
+            const PageAllocator<float> hAllocator(&hArena);
+
+            SoAVertexs hIn = { SoAColumn(nCount, hAllocator), SoAColumn(nCount, hAllocator), SoAColumn(nCount, hAllocator) };
+            SoAVertexs hOut = { SoAColumn(nCount, hAllocator), SoAColumn(nCount, hAllocator), SoAColumn(nCount, hAllocator) };
+            const double dAllocate = ElapsedMilliseconds(liStart);
+
+            for (size_t i = 0; i < nCount; ++i)
+            {
+                hIn.x[i] = static_cast<float>(i % 1024) * 0.25f;
+                hIn.y[i] = static_cast<float>(i % 512) * 0.5f;
+                hIn.z[i] = static_cast<float>(i % 256);
+            }
+
+            QueryPerformanceCounter(&liStart);
+            pTransform(&hIn, &hOut, nCount, 2.34f);
+            const double dTransform = ElapsedMilliseconds(liStart);
+
+            QueryPerformanceCounter(&liStart);
+            fSink = fSink + GatherRandom(hIn, nCount, nReads);
+            const double dGather = ElapsedMilliseconds(liStart);
+
+            std::cout << PageKindName(eWanted) << " pages (" << PageKindName(eObtained) << " obtained)"
+                << " | allocate+zero: " << dAllocate << "ms"
+                << " | transform: " << dTransform << "ms"
+                << " | random gather: " << dGather << "ms (" << dGather * 1'000'000.0 / nReads << " ns/vertex)" << std::endl;
+        }
+
+        FreePageRegion(&hArena.hRegion);
+    }
+}
+
 int main()
 {
     constexpr int nMaxVertex = 32 * 1024 * 1024;//% 8 == 0
@@ -120,4 +417,16 @@ int main()
 
     std::cout << "Time of AoS: " << dTimeOfAOS << "ms" << std::endl;
     std::cout << "Time of SoA: " << dTimeOfSOA << "ms" << std::endl;
+
+    //Release the transform buffers before loading the large meshes
+    vAOS = {};
+    vSOA = {};
+    vAOS_Save = {};
+    vSOA_Save = {};
+
+    std::cout << std::endl << "--- Vertex asset load ---" << std::endl;
+    Bench_VertexAssetLoad();
+
+    std::cout << std::endl << "--- SoA buffers by page size ---" << std::endl;
+    Bench_SoAPageSizes(hSelectedSoa);
 }
\ No newline at end of file
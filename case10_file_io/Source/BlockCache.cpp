@@ -0,0 +1,560 @@
+#include "BlockCache.h"
+#include "MappedFile.h"
+
+/*
+    ARC bookkeeping of one shard. Entries live in a fixed array (2 * capacity:
+    up to c resident + c ghosts), lists are intrusive and doubly linked by index,
+    and the block id -> entry lookup is an open-addressing table with linear
+    probing, so the hot path never allocates.
+*/
+enum ArcList : BYTE
+{
+    ARC_NONE,
+    ARC_T1,
+    ARC_T2,
+    ARC_B1,
+    ARC_B2,
+};
+
+constexpr UINT32 ARC_NIL = 0xFFFFFFFF;
+constexpr ULONGLONG ARC_EMPTY_KEY = ~0ull;
+
+struct ArcEntry
+{
+    ULONGLONG qwBlock;
+    UINT32 nPrev;
+    UINT32 nNext;
+    UINT32 nFrame;
+    ArcList eList;
+};
+
+struct ArcQueue
+{
+    UINT32 nMru;
+    UINT32 nLru;
+    size_t nCount;
+};
+
+static ULONGLONG MixBlockId(ULONGLONG qwValue)
+{
+    //splitmix64 finalizer
+    qwValue ^= qwValue >> 30;
+    qwValue *= 0xBF58476D1CE4E5B9ull;
+    qwValue ^= qwValue >> 27;
+    qwValue *= 0x94D049BB133111EBull;
+    qwValue ^= qwValue >> 31;
+    return qwValue;
+}
+
+struct BlockCache::Shard
+{
+    SRWLOCK hLock;
+    size_t nCapacity;
+    size_t nTarget;
+    char* pFrames;
+
+    ArcQueue hT1;
+    ArcQueue hT2;
+    ArcQueue hB1;
+    ArcQueue hB2;
+
+    std::vector<ArcEntry> vEntries;
+    std::vector<UINT32> vFreeEntries;
+    std::vector<UINT32> vFreeFrames;
+
+    std::vector<ULONGLONG> vKeys;
+    std::vector<UINT32> vValues;
+    size_t nMask;
+
+    ULONGLONG qwHits;
+    ULONGLONG qwMisses;
+
+    Shard(char* pFramesIn, size_t nCapacityIn)
+    {
+        InitializeSRWLock(&this->hLock);
+        this->nCapacity = nCapacityIn;
+        this->nTarget = 0;
+        this->pFrames = pFramesIn;
+        this->hT1 = { ARC_NIL, ARC_NIL, 0 };
+        this->hT2 = { ARC_NIL, ARC_NIL, 0 };
+        this->hB1 = { ARC_NIL, ARC_NIL, 0 };
+        this->hB2 = { ARC_NIL, ARC_NIL, 0 };
+        this->qwHits = 0;
+        this->qwMisses = 0;
+
+        this->vEntries.resize(2 * nCapacityIn);
+        this->vFreeEntries.reserve(2 * nCapacityIn);
+        for (size_t i = this->vEntries.size(); i > 0; --i)
+        {
+            this->vFreeEntries.push_back(static_cast<UINT32>(i - 1));
+        }
+
+        this->vFreeFrames.reserve(nCapacityIn);
+        for (size_t i = nCapacityIn; i > 0; --i)
+        {
+            this->vFreeFrames.push_back(static_cast<UINT32>(i - 1));
+        }
+
+        //Load factor <= 50% with 2c keys
+        size_t nTableSize = 16;
+        while (nTableSize < 4 * nCapacityIn)
+        {
+            nTableSize *= 2;
+        }
+
+        this->vKeys.assign(nTableSize, ARC_EMPTY_KEY);
+        this->vValues.assign(nTableSize, ARC_NIL);
+        this->nMask = nTableSize - 1;
+    }
+
+    ArcQueue& Queue(ArcList eList)
+    {
+        switch (eList)
+        {
+        case ARC_T1:
+            return this->hT1;
+        case ARC_T2:
+            return this->hT2;
+        case ARC_B1:
+            return this->hB1;
+        default:
+            return this->hB2;
+        }
+    }
+
+    //--- Lookup table ---
+
+    UINT32 Find(ULONGLONG qwBlock) const
+    {
+        for (size_t nSlot = MixBlockId(qwBlock) & this->nMask;; nSlot = (nSlot + 1) & this->nMask)
+        {
+            if (this->vKeys[nSlot] == qwBlock)
+            {
+                return this->vValues[nSlot];
+            }
+
+            if (this->vKeys[nSlot] == ARC_EMPTY_KEY)
+            {
+                return ARC_NIL;
+            }
+        }
+    }
+
+    void Insert(ULONGLONG qwBlock, UINT32 nEntry)
+    {
+        size_t nSlot = MixBlockId(qwBlock) & this->nMask;
+        while (this->vKeys[nSlot] != ARC_EMPTY_KEY)
+        {
+            nSlot = (nSlot + 1) & this->nMask;
+        }
+
+        this->vKeys[nSlot] = qwBlock;
+        this->vValues[nSlot] = nEntry;
+    }
+
+    //Backward-shift deletion: no tombstones, probe chains stay short
+    void Erase(ULONGLONG qwBlock)
+    {
+        size_t nSlot = MixBlockId(qwBlock) & this->nMask;
+        while (this->vKeys[nSlot] != qwBlock)
+        {
+            if (this->vKeys[nSlot] == ARC_EMPTY_KEY)
+            {
+                return;
+            }
+
+            nSlot = (nSlot + 1) & this->nMask;
+        }
+
+        size_t nNext = (nSlot + 1) & this->nMask;
+        while (this->vKeys[nNext] != ARC_EMPTY_KEY)
+        {
+            const size_t nHome = MixBlockId(this->vKeys[nNext]) & this->nMask;
+
+            //Move the entry back if its home slot is not inside (nSlot, nNext]
+            const bool bMovable = (nSlot <= nNext) ? (nHome <= nSlot || nHome > nNext) : (nHome <= nSlot && nHome > nNext);
+            if (bMovable)
+            {
+                this->vKeys[nSlot] = this->vKeys[nNext];
+                this->vValues[nSlot] = this->vValues[nNext];
+                nSlot = nNext;
+            }
+
+            nNext = (nNext + 1) & this->nMask;
+        }
+
+        this->vKeys[nSlot] = ARC_EMPTY_KEY;
+        this->vValues[nSlot] = ARC_NIL;
+    }
+
+    //--- Intrusive lists (nMru = head, nLru = tail) ---
+
+    void PushMru(ArcList eList, UINT32 nEntry)
+    {
+        ArcQueue& hQueue = this->Queue(eList);
+        ArcEntry& hEntry = this->vEntries[nEntry];
+
+        hEntry.eList = eList;
+        hEntry.nPrev = ARC_NIL;
+        hEntry.nNext = hQueue.nMru;
+
+        if (hQueue.nMru != ARC_NIL)
+        {
+            this->vEntries[hQueue.nMru].nPrev = nEntry;
+        }
+
+        hQueue.nMru = nEntry;
+        if (hQueue.nLru == ARC_NIL)
+        {
+            hQueue.nLru = nEntry;
+        }
+
+        ++hQueue.nCount;
+    }
+
+    void Unlink(UINT32 nEntry)
+    {
+        ArcEntry& hEntry = this->vEntries[nEntry];
+        ArcQueue& hQueue = this->Queue(hEntry.eList);
+
+        if (hEntry.nPrev != ARC_NIL)
+        {
+            this->vEntries[hEntry.nPrev].nNext = hEntry.nNext;
+        }
+        else
+        {
+            hQueue.nMru = hEntry.nNext;
+        }
+
+        if (hEntry.nNext != ARC_NIL)
+        {
+            this->vEntries[hEntry.nNext].nPrev = hEntry.nPrev;
+        }
+        else
+        {
+            hQueue.nLru = hEntry.nPrev;
+        }
+
+        hEntry.eList = ARC_NONE;
+        --hQueue.nCount;
+    }
+
+    UINT32 PopLru(ArcList eList)
+    {
+        const UINT32 nEntry = this->Queue(eList).nLru;
+        this->Unlink(nEntry);
+        return nEntry;
+    }
+
+    //Drops a ghost entry completely
+    void Forget(UINT32 nEntry)
+    {
+        this->Erase(this->vEntries[nEntry].qwBlock);
+        this->vFreeEntries.push_back(nEntry);
+    }
+
+    //Evicts the LRU of T1 or T2 into its ghost list, releasing the frame
+    void Replace(bool bHitInB2)
+    {
+        if (!this->vFreeFrames.empty())
+        {
+            return;
+        }
+
+        const bool bPreferT1 = (bHitInB2 && this->hT1.nCount == this->nTarget) || this->hT1.nCount > this->nTarget;
+        const bool bFromT1 = this->hT1.nCount > 0 && (bPreferT1 || !this->hT2.nCount);
+
+        const UINT32 nVictim = this->PopLru(bFromT1 ? ARC_T1 : ARC_T2);
+        ArcEntry& hVictim = this->vEntries[nVictim];
+
+        this->vFreeFrames.push_back(hVictim.nFrame);
+        hVictim.nFrame = ARC_NIL;
+
+        this->PushMru(bFromT1 ? ARC_B1 : ARC_B2, nVictim);
+    }
+};
+
+struct ThreadEvent
+{
+    HANDLE hEvent;
+
+    ThreadEvent()
+    {
+        this->hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    }
+
+    ~ThreadEvent()
+    {
+        CloseHandle(this->hEvent);
+    }
+};
+
+static thread_local ThreadEvent tlsReadEvent;
+
+BlockCache::BlockCache()
+{
+    this->hFile = INVALID_HANDLE_VALUE;
+    this->qwFileSize = 0;
+    this->nBlockSize = 0;
+    this->pArena = nullptr;
+    this->nArenaSize = 0;
+    this->bLargePages = false;
+}
+
+BlockCache::~BlockCache()
+{
+    this->Close();
+}
+
+bool BlockCache::Open(const char* path, size_t nCapacityBytes, size_t nBlockSizeIn, size_t nShards)
+{
+    this->Close();
+
+    //Unbuffered I/O: block size and frame addresses must be sector multiples
+    if (!nBlockSizeIn || (nBlockSizeIn % 4096) != 0 || !nShards)
+    {
+        return false;
+    }
+
+    this->hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_RANDOM_ACCESS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (this->hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER liSize = {};
+    GetFileSizeEx(this->hFile, &liSize);
+    this->qwFileSize = static_cast<ULONGLONG>(liSize.QuadPart);
+    this->nBlockSize = nBlockSizeIn;
+
+    const size_t nBlocksPerShard = max(nCapacityBytes / nBlockSizeIn / nShards, static_cast<size_t>(1));
+    const size_t nBytes = nBlocksPerShard * nShards * nBlockSizeIn;
+
+    const SIZE_T nLargePage = GetLargePageMinimum();
+    if (nLargePage && EnableLockMemoryPrivilege())
+    {
+        this->nArenaSize = (nBytes + nLargePage - 1) / nLargePage * nLargePage;
+        this->pArena = reinterpret_cast<char*>(VirtualAlloc(nullptr, this->nArenaSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+        this->bLargePages = this->pArena != nullptr;
+    }
+
+    if (!this->pArena)
+    {
+        this->nArenaSize = nBytes;
+        this->pArena = reinterpret_cast<char*>(VirtualAlloc(nullptr, this->nArenaSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    }
+
+    if (!this->pArena)
+    {
+        this->Close();
+        return false;
+    }
+
+    this->vShards.reserve(nShards);
+    for (size_t i = 0; i < nShards; ++i)
+    {
+        this->vShards.push_back(new Shard(this->pArena + i * nBlocksPerShard * nBlockSizeIn, nBlocksPerShard));
+    }
+
+    return true;
+}
+
+void BlockCache::Close()
+{
+    for (Shard* pShard : this->vShards)
+    {
+        delete pShard;
+    }
+
+    this->vShards.clear();
+
+    if (this->pArena)
+    {
+        VirtualFree(this->pArena, 0, MEM_RELEASE);
+        this->pArena = nullptr;
+    }
+
+    if (this->hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(this->hFile);
+        this->hFile = INVALID_HANDLE_VALUE;
+    }
+
+    this->nArenaSize = 0;
+    this->bLargePages = false;
+}
+
+bool BlockCache::FetchBlock(ULONGLONG qwBlock, char* pFrame)
+{
+    const ULONGLONG qwOffset = qwBlock * this->nBlockSize;
+
+    OVERLAPPED hOverlapped = {};
+    hOverlapped.Offset = static_cast<DWORD>(qwOffset);
+    hOverlapped.OffsetHigh = static_cast<DWORD>(qwOffset >> 32);
+    hOverlapped.hEvent = tlsReadEvent.hEvent;
+
+    DWORD dwRead = 0;
+    if (!ReadFile(this->hFile, pFrame, static_cast<DWORD>(this->nBlockSize), &dwRead, &hOverlapped))
+    {
+        if (GetLastError() != ERROR_IO_PENDING || !GetOverlappedResult(this->hFile, &hOverlapped, &dwRead, TRUE))
+        {
+            return false;
+        }
+    }
+
+    //Last block of the file comes back short
+    if (dwRead < this->nBlockSize)
+    {
+        memset(pFrame + dwRead, 0, this->nBlockSize - dwRead);
+    }
+
+    return dwRead > 0;
+}
+
+bool BlockCache::ReadBlock(Shard& hShard, ULONGLONG qwBlock, size_t nInBlock, char* pOut, size_t nSize)
+{
+    AcquireSRWLockExclusive(&hShard.hLock);
+
+    UINT32 nEntry = hShard.Find(qwBlock);
+    const ArcList eList = nEntry != ARC_NIL ? hShard.vEntries[nEntry].eList : ARC_NONE;
+
+    //Case I: hit in T1 or T2 -> MRU of T2
+    if (eList == ARC_T1 || eList == ARC_T2)
+    {
+        ++hShard.qwHits;
+
+        hShard.Unlink(nEntry);
+        hShard.PushMru(ARC_T2, nEntry);
+
+        memcpy(pOut, hShard.pFrames + static_cast<size_t>(hShard.vEntries[nEntry].nFrame) * this->nBlockSize + nInBlock, nSize);
+
+        ReleaseSRWLockExclusive(&hShard.hLock);
+        return true;
+    }
+
+    ++hShard.qwMisses;
+
+    const size_t nT1 = hShard.hT1.nCount;
+    const size_t nT2 = hShard.hT2.nCount;
+    const size_t nB1 = hShard.hB1.nCount;
+    const size_t nB2 = hShard.hB2.nCount;
+    const size_t nCapacity = hShard.nCapacity;
+
+    ArcList eTarget = ARC_T2;
+
+    if (eList == ARC_B1)
+    {
+        //Case II: ghost hit in B1 -> favor recency (grow the T1 target)
+        const size_t nDelta = max(nB2 / nB1, static_cast<size_t>(1));
+        hShard.nTarget = min(nCapacity, hShard.nTarget + nDelta);
+        hShard.Replace(false);
+        hShard.Unlink(nEntry);
+    }
+    else if (eList == ARC_B2)
+    {
+        //Case III: ghost hit in B2 -> favor frequency (shrink the T1 target)
+        const size_t nDelta = max(nB1 / nB2, static_cast<size_t>(1));
+        hShard.nTarget = hShard.nTarget > nDelta ? hShard.nTarget - nDelta : 0;
+        hShard.Replace(true);
+        hShard.Unlink(nEntry);
+    }
+    else
+    {
+        //Case IV: never seen (or already forgotten)
+        if (nT1 + nB1 == nCapacity)
+        {
+            if (nT1 < nCapacity)
+            {
+                hShard.Forget(hShard.PopLru(ARC_B1));
+                hShard.Replace(false);
+            }
+            else
+            {
+                const UINT32 nVictim = hShard.PopLru(ARC_T1);
+                hShard.vFreeFrames.push_back(hShard.vEntries[nVictim].nFrame);
+                hShard.Forget(nVictim);
+            }
+        }
+        else if (nT1 + nT2 + nB1 + nB2 >= nCapacity)
+        {
+            if (nT1 + nT2 + nB1 + nB2 == 2 * nCapacity)
+            {
+                hShard.Forget(hShard.PopLru(ARC_B2));
+            }
+
+            hShard.Replace(false);
+        }
+
+        nEntry = hShard.vFreeEntries.back();
+        hShard.vFreeEntries.pop_back();
+        hShard.vEntries[nEntry].qwBlock = qwBlock;
+        hShard.Insert(qwBlock, nEntry);
+
+        eTarget = ARC_T1;
+    }
+
+    ArcEntry& hEntry = hShard.vEntries[nEntry];
+    hEntry.nFrame = hShard.vFreeFrames.back();
+    hShard.vFreeFrames.pop_back();
+
+    char* pFrame = hShard.pFrames + static_cast<size_t>(hEntry.nFrame) * this->nBlockSize;
+
+    //Read-through under the shard lock: other shards keep serving hits meanwhile
+    if (!this->FetchBlock(qwBlock, pFrame))
+    {
+        hShard.vFreeFrames.push_back(hEntry.nFrame);
+        hEntry.nFrame = ARC_NIL;
+        hShard.Forget(nEntry);
+
+        ReleaseSRWLockExclusive(&hShard.hLock);
+        return false;
+    }
+
+    hShard.PushMru(eTarget, nEntry);
+    memcpy(pOut, pFrame + nInBlock, nSize);
+
+    ReleaseSRWLockExclusive(&hShard.hLock);
+    return true;
+}
+
+bool BlockCache::Read(ULONGLONG qwOffset, void* pOut, size_t nSize)
+{
+    if (this->vShards.empty() || qwOffset + nSize > this->qwFileSize)
+    {
+        return false;
+    }
+
+    char* pDest = reinterpret_cast<char*>(pOut);
+    while (nSize > 0)
+    {
+        const ULONGLONG qwBlock = qwOffset / this->nBlockSize;
+        const size_t nInBlock = static_cast<size_t>(qwOffset % this->nBlockSize);
+        const size_t nPart = min(nSize, this->nBlockSize - nInBlock);
+
+        Shard& hShard = *this->vShards[static_cast<size_t>((MixBlockId(qwBlock) >> 40) % this->vShards.size())];
+        if (!this->ReadBlock(hShard, qwBlock, nInBlock, pDest, nPart))
+        {
+            return false;
+        }
+
+        qwOffset += nPart;
+        pDest += nPart;
+        nSize -= nPart;
+    }
+
+    return true;
+}
+
+BlockCache::Stats BlockCache::GetStats() const
+{
+    Stats hStats = {};
+    for (Shard* pShard : this->vShards)
+    {
+        AcquireSRWLockShared(&pShard->hLock);
+        hStats.qwHits += pShard->qwHits;
+        hStats.qwMisses += pShard->qwMisses;
+        ReleaseSRWLockShared(&pShard->hLock);
+    }
+
+    return hStats;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <Windows.h>
+#include <vector>
+
+/*
+    Userspace block cache for unbuffered (FILE_FLAG_NO_BUFFERING, O_DIRECT) reads.
+
+    - Fixed-size blocks (multiple of the sector size) carved out of one arena,
+      backed by large pages when SeLockMemoryPrivilege is available.
+    - The block table is split into shards (lock striping): block N lives in
+      shard hash(N) % nShards, each shard has its own SRWLOCK, its own slice of
+      the arena and its own ARC state, so threads only contend when they hit
+      the same shard.
+    - ARC eviction (Megiddo & Modha): T1 (seen once) and T2 (seen twice or more)
+      hold the cached blocks; B1/B2 remember recently evicted block ids and move
+      the T1/T2 target split towards whichever ghost list gets hits.
+    - Misses are read through from the file with an aligned unbuffered ReadFile
+      while the shard lock is held.
+
+    The cache size is fixed at Open and never grows, so the memory of a tenant
+    is exactly nCapacityBytes.
+*/
+class BlockCache
+{
+public:
+    struct Stats
+    {
+        ULONGLONG qwHits;
+        ULONGLONG qwMisses;
+
+        double HitRate() const
+        {
+            const ULONGLONG qwTotal = this->qwHits + this->qwMisses;
+            return qwTotal ? static_cast<double>(this->qwHits) / static_cast<double>(qwTotal) : 0.0;
+        }
+    };
+
+    BlockCache();
+    ~BlockCache();
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    bool Open(const char* path, size_t nCapacityBytes, size_t nBlockSize, size_t nShards);
+    void Close();
+
+    //Copies nSize bytes at qwOffset into pOut, crossing block boundaries if needed
+    bool Read(ULONGLONG qwOffset, void* pOut, size_t nSize);
+
+    Stats GetStats() const;
+    bool UsesLargePages() const { return this->bLargePages; }
+
+private:
+    struct Shard;
+
+    bool ReadBlock(Shard& hShard, ULONGLONG qwBlock, size_t nInBlock, char* pOut, size_t nSize);
+    bool FetchBlock(ULONGLONG qwBlock, char* pFrame);
+
+    HANDLE hFile;
+    ULONGLONG qwFileSize;
+    size_t nBlockSize;
+    char* pArena;
+    size_t nArenaSize;
+    bool bLargePages;
+    std::vector<Shard*> vShards;
+};
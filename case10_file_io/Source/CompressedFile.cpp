@@ -0,0 +1,376 @@
+#include "CompressedFile.h"
+#include "LzBlock.h"
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+constexpr UINT32 COMPRESSED_MAGIC = 0x31425A4C; //"LZB1"
+constexpr UINT32 COMPRESSED_VERSION = 1;
+
+static_assert(sizeof(CompressedFileHeader) <= COMPRESSED_ALIGNMENT, "The header must fit in the first sector");
+
+static size_t AlignUp(size_t nValue)
+{
+    return (nValue + COMPRESSED_ALIGNMENT - 1) & ~(COMPRESSED_ALIGNMENT - 1);
+}
+
+static bool WriteAll(HANDLE hFile, const char* pData, size_t nSize)
+{
+    DWORD dwWritten = 0;
+    return WriteFile(hFile, pData, static_cast<DWORD>(nSize), &dwWritten, nullptr) && dwWritten == nSize;
+}
+
+//Reads until nSize bytes or the end of the file, returns the bytes read
+static size_t ReadFull(HANDLE hFile, char* pData, size_t nSize)
+{
+    size_t nTotal = 0;
+    while (nTotal < nSize)
+    {
+        DWORD dwRead = 0;
+        if (!ReadFile(hFile, pData + nTotal, static_cast<DWORD>(nSize - nTotal), &dwRead, nullptr) || !dwRead)
+        {
+            break;
+        }
+
+        nTotal += dwRead;
+    }
+
+    return nTotal;
+}
+
+//Positional read (pread): offset and size must be aligned when the handle is unbuffered
+static bool ReadAt(HANDLE hFile, ULONGLONG qwOffset, char* pData, size_t nSize)
+{
+    OVERLAPPED hOverlapped = {};
+    hOverlapped.Offset = static_cast<DWORD>(qwOffset);
+    hOverlapped.OffsetHigh = static_cast<DWORD>(qwOffset >> 32);
+
+    DWORD dwRead = 0;
+    return ReadFile(hFile, pData, static_cast<DWORD>(nSize), &dwRead, &hOverlapped) && dwRead == nSize;
+}
+
+bool CompressFile(const char* pSourcePath, const char* pDestPath, size_t nBlockSize)
+{
+    if (!nBlockSize || nBlockSize > 0x7FFFFFFF)
+    {
+        return false;
+    }
+
+    HANDLE hSource = CreateFileA(pSourcePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hSource == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    HANDLE hDest = CreateFileA(pDestPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hDest == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hSource);
+        return false;
+    }
+
+    LzCompressState* pState = new LzCompressState;
+
+    std::vector<char> vRaw(nBlockSize);
+    std::vector<char> vStored(AlignUp(LzCompressBound(nBlockSize)));
+    std::vector<CompressedBlockEntry> vIndex;
+
+    CompressedFileHeader hHeader = {};
+    hHeader.dwMagic = COMPRESSED_MAGIC;
+    hHeader.dwVersion = COMPRESSED_VERSION;
+    hHeader.dwBlockSize = static_cast<UINT32>(nBlockSize);
+
+    //Header sector placeholder, rewritten at the end
+    std::vector<char> vHeader(COMPRESSED_ALIGNMENT, 0);
+    bool bResult = WriteAll(hDest, vHeader.data(), vHeader.size());
+
+    ULONGLONG qwOffset = COMPRESSED_ALIGNMENT;
+    while (bResult)
+    {
+        const size_t nRaw = ReadFull(hSource, vRaw.data(), nBlockSize);
+        if (!nRaw)
+        {
+            break;
+        }
+
+        size_t nStored = LzCompress(pState, vRaw.data(), nRaw, vStored.data(), vStored.size());
+        if (!nStored || nStored >= nRaw)
+        {
+            //Incompressible: store it, the reader hands the bytes out directly
+            memcpy(vStored.data(), vRaw.data(), nRaw);
+            nStored = nRaw;
+        }
+
+        const size_t nPadded = AlignUp(nStored);
+        memset(vStored.data() + nStored, 0, nPadded - nStored);
+
+        bResult = WriteAll(hDest, vStored.data(), nPadded);
+
+        vIndex.push_back({ qwOffset, static_cast<UINT32>(nStored), static_cast<UINT32>(nRaw) });
+        qwOffset += nPadded;
+        hHeader.qwRawSize += nRaw;
+    }
+
+    if (bResult)
+    {
+        const size_t nIndexSize = vIndex.size() * sizeof(CompressedBlockEntry);
+        std::vector<char> vIndexBytes(AlignUp(max(nIndexSize, static_cast<size_t>(1))), 0);
+        memcpy(vIndexBytes.data(), vIndex.data(), nIndexSize);
+
+        hHeader.dwBlockCount = static_cast<UINT32>(vIndex.size());
+        hHeader.qwIndexOffset = qwOffset;
+
+        memcpy(vHeader.data(), &hHeader, sizeof(hHeader));
+
+        LARGE_INTEGER liZero = {};
+        bResult = WriteAll(hDest, vIndexBytes.data(), vIndexBytes.size()) &&
+            SetFilePointerEx(hDest, liZero, nullptr, FILE_BEGIN) &&
+            WriteAll(hDest, vHeader.data(), vHeader.size());
+    }
+
+    delete pState;
+
+    CloseHandle(hDest);
+    CloseHandle(hSource);
+
+    if (!bResult)
+    {
+        DeleteFileA(pDestPath);
+    }
+
+    return bResult;
+}
+
+/*
+    Bounded pipeline: a slot is either free (the reader may fill it), ready
+    (read, waiting for a worker) or owned by a worker. The reader blocks when
+    every slot is in use, which caps the memory and the read-ahead at
+    nQueueDepth blocks.
+*/
+struct DecompressPipeline
+{
+    SRWLOCK hLock;
+    CONDITION_VARIABLE cvReady;
+    CONDITION_VARIABLE cvFree;
+
+    std::deque<size_t> vReady;
+    std::vector<size_t> vFree;
+    bool bDone;
+
+    std::atomic<bool> bFailed;
+};
+
+struct DecompressSlot
+{
+    char* pStored;
+    char* pRaw;
+    size_t nBlock;
+};
+
+bool ReadCompressedFile(const char* path, const CompressedReadConfig& hConfig, CompressedBlockCallback Callback, void* pContext, CompressedReadStats* pStats)
+{
+    LARGE_INTEGER liFrequency;
+    LARGE_INTEGER liStart;
+    LARGE_INTEGER liEnd;
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liStart);
+
+    const DWORD dwFlags = hConfig.bUnbuffered ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN;
+    HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, dwFlags, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    //Sector-aligned scratch for the header and the index
+    char* pHeaderSector = reinterpret_cast<char*>(VirtualAlloc(nullptr, COMPRESSED_ALIGNMENT, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+    CompressedFileHeader hHeader = {};
+    if (!pHeaderSector || !ReadAt(hFile, 0, pHeaderSector, COMPRESSED_ALIGNMENT))
+    {
+        VirtualFree(pHeaderSector, 0, MEM_RELEASE);
+        CloseHandle(hFile);
+        return false;
+    }
+
+    memcpy(&hHeader, pHeaderSector, sizeof(hHeader));
+    VirtualFree(pHeaderSector, 0, MEM_RELEASE);
+
+    if (hHeader.dwMagic != COMPRESSED_MAGIC || hHeader.dwVersion != COMPRESSED_VERSION || !hHeader.dwBlockSize ||
+        (hHeader.qwIndexOffset % COMPRESSED_ALIGNMENT) != 0)
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    const size_t nBlockSize = hHeader.dwBlockSize;
+    const size_t nBlocks = hHeader.dwBlockCount;
+    const size_t nIndexSize = AlignUp(max(nBlocks * sizeof(CompressedBlockEntry), static_cast<size_t>(1)));
+    const size_t nStoredCapacity = AlignUp(LzCompressBound(nBlockSize));
+    const size_t nRawCapacity = AlignUp(nBlockSize);
+
+    CompressedBlockEntry* pIndex = reinterpret_cast<CompressedBlockEntry*>(VirtualAlloc(nullptr, nIndexSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!pIndex || !ReadAt(hFile, hHeader.qwIndexOffset, reinterpret_cast<char*>(pIndex), nIndexSize))
+    {
+        VirtualFree(pIndex, 0, MEM_RELEASE);
+        CloseHandle(hFile);
+        return false;
+    }
+
+    ULONGLONG qwStored = 0;
+    for (size_t i = 0; i < nBlocks; ++i)
+    {
+        const CompressedBlockEntry& hEntry = pIndex[i];
+        if ((hEntry.qwOffset % COMPRESSED_ALIGNMENT) != 0 || hEntry.dwRawSize > nBlockSize || hEntry.dwStoredSize > nStoredCapacity ||
+            hEntry.qwOffset + AlignUp(hEntry.dwStoredSize) > hHeader.qwIndexOffset)
+        {
+            VirtualFree(pIndex, 0, MEM_RELEASE);
+            CloseHandle(hFile);
+            return false;
+        }
+
+        qwStored += hEntry.dwStoredSize;
+    }
+
+    const size_t nThreads = max(hConfig.nThreads, static_cast<size_t>(1));
+    const size_t nSlots = max(hConfig.nQueueDepth, nThreads);
+
+    char* pSlotMemory = reinterpret_cast<char*>(VirtualAlloc(nullptr, nSlots * (nStoredCapacity + nRawCapacity), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!pSlotMemory)
+    {
+        VirtualFree(pIndex, 0, MEM_RELEASE);
+        CloseHandle(hFile);
+        return false;
+    }
+
+    std::vector<DecompressSlot> vSlots(nSlots);
+
+    DecompressPipeline hPipeline;
+    InitializeSRWLock(&hPipeline.hLock);
+    InitializeConditionVariable(&hPipeline.cvReady);
+    InitializeConditionVariable(&hPipeline.cvFree);
+    hPipeline.bDone = false;
+    hPipeline.bFailed = false;
+
+    for (size_t i = 0; i < nSlots; ++i)
+    {
+        vSlots[i].pStored = pSlotMemory + i * (nStoredCapacity + nRawCapacity);
+        vSlots[i].pRaw = vSlots[i].pStored + nStoredCapacity;
+        hPipeline.vFree.push_back(i);
+    }
+
+    auto Worker = [&] ()
+    {
+        while (true)
+        {
+            AcquireSRWLockExclusive(&hPipeline.hLock);
+            while (hPipeline.vReady.empty() && !hPipeline.bDone)
+            {
+                SleepConditionVariableSRW(&hPipeline.cvReady, &hPipeline.hLock, INFINITE, 0);
+            }
+
+            if (hPipeline.vReady.empty())
+            {
+                ReleaseSRWLockExclusive(&hPipeline.hLock);
+                return;
+            }
+
+            const size_t nSlot = hPipeline.vReady.front();
+            hPipeline.vReady.pop_front();
+            ReleaseSRWLockExclusive(&hPipeline.hLock);
+
+            DecompressSlot& hSlot = vSlots[nSlot];
+            const CompressedBlockEntry& hEntry = pIndex[hSlot.nBlock];
+
+            if (!hPipeline.bFailed)
+            {
+                const char* pData = hSlot.pStored;
+                if (hEntry.dwStoredSize != hEntry.dwRawSize)
+                {
+                    pData = hSlot.pRaw;
+                    if (!LzDecompress(hSlot.pStored, hEntry.dwStoredSize, hSlot.pRaw, hEntry.dwRawSize))
+                    {
+                        hPipeline.bFailed = true;
+                        pData = nullptr;
+                    }
+                }
+
+                if (pData)
+                {
+                    Callback(pContext, hSlot.nBlock, pData, hEntry.dwRawSize);
+                }
+            }
+
+            AcquireSRWLockExclusive(&hPipeline.hLock);
+            hPipeline.vFree.push_back(nSlot);
+            ReleaseSRWLockExclusive(&hPipeline.hLock);
+            WakeConditionVariable(&hPipeline.cvFree);
+        }
+    };
+
+    std::vector<std::thread> vWorkers;
+    for (size_t i = 0; i < nThreads; ++i)
+    {
+        vWorkers.emplace_back(Worker);
+    }
+
+    //Reader: blocks go out in file order, one aligned read each
+    for (size_t nBlock = 0; nBlock < nBlocks && !hPipeline.bFailed; ++nBlock)
+    {
+        AcquireSRWLockExclusive(&hPipeline.hLock);
+        while (hPipeline.vFree.empty())
+        {
+            SleepConditionVariableSRW(&hPipeline.cvFree, &hPipeline.hLock, INFINITE, 0);
+        }
+
+        const size_t nSlot = hPipeline.vFree.back();
+        hPipeline.vFree.pop_back();
+        ReleaseSRWLockExclusive(&hPipeline.hLock);
+
+        const CompressedBlockEntry& hEntry = pIndex[nBlock];
+        vSlots[nSlot].nBlock = nBlock;
+
+        if (!ReadAt(hFile, hEntry.qwOffset, vSlots[nSlot].pStored, AlignUp(hEntry.dwStoredSize)))
+        {
+            hPipeline.bFailed = true;
+
+            AcquireSRWLockExclusive(&hPipeline.hLock);
+            hPipeline.vFree.push_back(nSlot);
+            ReleaseSRWLockExclusive(&hPipeline.hLock);
+            break;
+        }
+
+        AcquireSRWLockExclusive(&hPipeline.hLock);
+        hPipeline.vReady.push_back(nSlot);
+        ReleaseSRWLockExclusive(&hPipeline.hLock);
+        WakeConditionVariable(&hPipeline.cvReady);
+    }
+
+    AcquireSRWLockExclusive(&hPipeline.hLock);
+    hPipeline.bDone = true;
+    ReleaseSRWLockExclusive(&hPipeline.hLock);
+    WakeAllConditionVariable(&hPipeline.cvReady);
+
+    for (std::thread& hWorker : vWorkers)
+    {
+        hWorker.join();
+    }
+
+    QueryPerformanceCounter(&liEnd);
+
+    VirtualFree(pSlotMemory, 0, MEM_RELEASE);
+    VirtualFree(pIndex, 0, MEM_RELEASE);
+    CloseHandle(hFile);
+
+    if (pStats)
+    {
+        pStats->qwStoredBytes = qwStored;
+        pStats->qwRawBytes = hHeader.qwRawSize;
+        pStats->dMilliseconds = static_cast<double>(liEnd.QuadPart - liStart.QuadPart) * 1000.0 / static_cast<double>(liFrequency.QuadPart);
+    }
+
+    return !hPipeline.bFailed;
+}
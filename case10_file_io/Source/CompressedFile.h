@@ -0,0 +1,69 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Block-compressed file (.lzb).
+
+    [header, padded to COMPRESSED_ALIGNMENT]
+    [block 0, padded] [block 1, padded] ...
+    [block index, padded]
+
+    Every block holds nBlockSize raw bytes (the last one may be shorter)
+    compressed with LzBlock, or stored raw when compression does not help.
+    Blocks start on a sector/page boundary so the reader can fetch each one
+    with a single unbuffered (FILE_FLAG_NO_BUFFERING / O_DIRECT) read.
+
+    ReadCompressedFile streams the blocks in file order from the calling
+    thread and decompresses them on a pool of nThreads workers while the next
+    reads are in flight. The callback runs on the workers, so blocks arrive out
+    of order; nBlock tells where each one belongs.
+*/
+constexpr size_t COMPRESSED_ALIGNMENT = 4096;
+
+struct CompressedFileHeader
+{
+    UINT32 dwMagic;
+    UINT32 dwVersion;
+    UINT32 dwBlockSize;
+    UINT32 dwBlockCount;
+    ULONGLONG qwRawSize;
+    ULONGLONG qwIndexOffset;
+};
+
+struct CompressedBlockEntry
+{
+    ULONGLONG qwOffset;
+    UINT32 dwStoredSize;    //== dwRawSize: stored uncompressed
+    UINT32 dwRawSize;
+};
+
+struct CompressedReadConfig
+{
+    size_t nThreads;        //Decompression workers
+    size_t nQueueDepth;     //Blocks read ahead of the workers
+    bool bUnbuffered;
+};
+
+struct CompressedReadStats
+{
+    ULONGLONG qwStoredBytes;    //Bytes read from the file
+    ULONGLONG qwRawBytes;       //Bytes delivered to the callback
+    double dMilliseconds;
+
+    //Uncompressed bytes per second: what the consumer sees
+    double EffectiveGigabytesPerSecond() const
+    {
+        return this->dMilliseconds > 0.0 ? static_cast<double>(this->qwRawBytes) / (this->dMilliseconds * 1'000'000.0) : 0.0;
+    }
+
+    double Ratio() const
+    {
+        return this->qwStoredBytes ? static_cast<double>(this->qwRawBytes) / static_cast<double>(this->qwStoredBytes) : 0.0;
+    }
+};
+
+typedef void (*CompressedBlockCallback)(void* pContext, size_t nBlock, const char* pData, size_t nSize);
+
+bool CompressFile(const char* pSourcePath, const char* pDestPath, size_t nBlockSize);
+
+bool ReadCompressedFile(const char* path, const CompressedReadConfig& hConfig, CompressedBlockCallback Callback, void* pContext, CompressedReadStats* pStats);
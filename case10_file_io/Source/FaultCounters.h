@@ -0,0 +1,95 @@
+#pragma once
+#include <Windows.h>
+#include <winternl.h>
+#include <psapi.h>
+#include <vector>
+
+#pragma comment(lib, "ntdll.lib")
+
+/*
+    Page fault accounting for the current process.
+
+    GetProcessMemoryInfo only exposes PageFaultCount, which mixes soft faults
+    (page already in RAM: standby list, file cache, demand-zero) with hard faults
+    (page read from disk). The hard fault count per process is only published by
+    NtQuerySystemInformation(SystemProcessInformation), inside the bytes that
+    winternl.h hides as Reserved1:
+
+        +0x00 NextEntryOffset
+        +0x04 NumberOfThreads
+        +0x08 WorkingSetPrivateSize   (Reserved1[0..7])
+        +0x10 HardFaultCount          (Reserved1[8..11])
+
+    This is the same field that Process Explorer / Resource Monitor show as
+    "Hard Faults". Soft faults are derived as Total - Hard.
+*/
+struct FaultSnapshot
+{
+    ULONGLONG qwTotal;
+    ULONGLONG qwHard;
+};
+
+static ULONG QueryHardFaultCount()
+{
+    constexpr NTSTATUS STATUS_INFO_LENGTH_MISMATCH_VALUE = static_cast<NTSTATUS>(0xC0000004L);
+    constexpr size_t HARD_FAULT_COUNT_OFFSET = 8;
+
+    static std::vector<BYTE> vBuffer(256 * 1024);
+
+    ULONG ulNeeded = 0;
+    NTSTATUS nStatus = NtQuerySystemInformation(SystemProcessInformation, vBuffer.data(), static_cast<ULONG>(vBuffer.size()), &ulNeeded);
+    while (nStatus == STATUS_INFO_LENGTH_MISMATCH_VALUE)
+    {
+        //Processes may appear between both calls, leave some headroom
+        vBuffer.resize(static_cast<size_t>(ulNeeded) + 64 * 1024);
+        nStatus = NtQuerySystemInformation(SystemProcessInformation, vBuffer.data(), static_cast<ULONG>(vBuffer.size()), &ulNeeded);
+    }
+
+    if (!NT_SUCCESS(nStatus))
+    {
+        return 0;
+    }
+
+    const HANDLE hSelf = reinterpret_cast<HANDLE>(static_cast<ULONG_PTR>(GetCurrentProcessId()));
+
+    const BYTE* pEntry = vBuffer.data();
+    while (true)
+    {
+        const SYSTEM_PROCESS_INFORMATION* pInfo = reinterpret_cast<const SYSTEM_PROCESS_INFORMATION*>(pEntry);
+        if (pInfo->UniqueProcessId == hSelf)
+        {
+            ULONG ulHardFaults = 0;
+            memcpy(&ulHardFaults, pInfo->Reserved1 + HARD_FAULT_COUNT_OFFSET, sizeof(ulHardFaults));
+            return ulHardFaults;
+        }
+
+        if (!pInfo->NextEntryOffset)
+        {
+            break;
+        }
+
+        pEntry += pInfo->NextEntryOffset;
+    }
+
+    return 0;
+}
+
+static FaultSnapshot CaptureFaults()
+{
+    PROCESS_MEMORY_COUNTERS hCounters = {};
+    hCounters.cb = sizeof(hCounters);
+    GetProcessMemoryInfo(GetCurrentProcess(), &hCounters, sizeof(hCounters));
+
+    FaultSnapshot hSnapshot = {};
+    hSnapshot.qwTotal = hCounters.PageFaultCount;
+    hSnapshot.qwHard = QueryHardFaultCount();
+    return hSnapshot;
+}
+
+static FaultSnapshot FaultDelta(const FaultSnapshot& hBefore, const FaultSnapshot& hAfter)
+{
+    FaultSnapshot hDelta = {};
+    hDelta.qwTotal = hAfter.qwTotal - hBefore.qwTotal;
+    hDelta.qwHard = hAfter.qwHard - hBefore.qwHard;
+    return hDelta;
+}
@@ -0,0 +1,96 @@
+#include <intrin.h>
+#include <immintrin.h>
+#include <algorithm>
+#include "Gather.h"
+
+bool IsAvx2Supported()
+{
+    int info[4]{};
+
+    __cpuid(info, 1);
+
+    //OSXSAVE + AVX
+    const bool bOsXSave = (info[2] & (1 << 27)) != 0;
+    const bool bAvx = (info[2] & (1 << 28)) != 0;
+    if (!bOsXSave || !bAvx)
+    {
+        return false;
+    }
+
+    //XCR0: the OS must save XMM and YMM state, otherwise any AVX instruction faults
+    if ((_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+[[clang::noinline]]
+void Gather_Naive(const char* __restrict pData, const std::uint32_t* __restrict pOffsets, int* __restrict pOut, size_t nCount)
+{
+    for (size_t i = 0; i < nCount; ++i)
+    {
+        pOut[i] = *reinterpret_cast<const int*>(pData + pOffsets[i]);
+    }
+}
+
+static void PrefetchBlock(const char* pData, const std::uint32_t* pOffsets, size_t nCount)
+{
+    for (size_t i = 0; i < nCount; ++i)
+    {
+        //PREFETCHT0: never faults, dropped if the page is not present
+        _mm_prefetch(pData + pOffsets[i], _MM_HINT_T0);
+    }
+}
+
+[[clang::noinline]]
+void Gather_Prefetch(const char* __restrict pData, const std::uint32_t* __restrict pOffsets, int* __restrict pOut, size_t nCount, size_t nBatch, bool bSortBatch)
+{
+    nBatch = std::clamp(nBatch, GATHER_MIN_BATCH, GATHER_MAX_BATCH);
+
+    /*
+        Sorted mode keeps (offset << 8 | slot) in a 64-bit key, so sorting the
+        keys also carries the slot where the value has to be written back.
+    */
+    std::uint64_t qwKeys[GATHER_MAX_BATCH];
+
+    PrefetchBlock(pData, pOffsets, std::min(nBatch, nCount));
+
+    for (size_t nBase = 0; nBase < nCount; nBase += nBatch)
+    {
+        const size_t nBlock = std::min(nBatch, nCount - nBase);
+        const size_t nNext = nBase + nBlock;
+
+        //Issue the next block while the current one is being consumed
+        if (nNext < nCount)
+        {
+            PrefetchBlock(pData, pOffsets + nNext, std::min(nBatch, nCount - nNext));
+        }
+
+        if (!bSortBatch)
+        {
+            for (size_t i = 0; i < nBlock; ++i)
+            {
+                pOut[nBase + i] = *reinterpret_cast<const int*>(pData + pOffsets[nBase + i]);
+            }
+
+            continue;
+        }
+
+        for (size_t i = 0; i < nBlock; ++i)
+        {
+            qwKeys[i] = (static_cast<std::uint64_t>(pOffsets[nBase + i]) << 8) | i;
+        }
+
+        std::sort(qwKeys, qwKeys + nBlock);
+
+        for (size_t i = 0; i < nBlock; ++i)
+        {
+            const size_t nOffset = static_cast<size_t>(qwKeys[i] >> 8);
+            const size_t nSlot = static_cast<size_t>(qwKeys[i] & 0xFF);
+            pOut[nBase + nSlot] = *reinterpret_cast<const int*>(pData + nOffset);
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Batched gather of 4-byte values from a mapped file.
+
+    pOut[i] = *(int*)(pData + pOffsets[i])  for i in [0, nCount)
+
+    The offsets are 32-bit because that is what VPGATHERDD takes as indices; a
+    view larger than 4 GB has to be split into 4 GB windows by the caller.
+*/
+constexpr size_t GATHER_MIN_BATCH = 32;
+constexpr size_t GATHER_MAX_BATCH = 256;
+
+//One load at a time, as in Test_Mapping_Rand
+void Gather_Naive(const char* __restrict pData, const std::uint32_t* __restrict pOffsets, int* __restrict pOut, size_t nCount);
+
+/*
+    Processes the offsets in blocks of nBatch (GATHER_MIN_BATCH..GATHER_MAX_BATCH):
+    the whole next block is prefetched before the current one is read, so up to
+    nBatch cache/TLB misses are in flight instead of one.
+
+    With bSortBatch every block is visited in address order, so lookups that
+    land in the same page (or cache line) are issued back to back.
+*/
+void Gather_Prefetch(const char* __restrict pData, const std::uint32_t* __restrict pOffsets, int* __restrict pOut, size_t nCount, size_t nBatch, bool bSortBatch);
+
+//VPGATHERDD, 8 lanes per instruction (requires AVX2)
+void Gather_AVX2(const char* __restrict pData, const std::uint32_t* __restrict pOffsets, int* __restrict pOut, size_t nCount);
+
+bool IsAvx2Supported();
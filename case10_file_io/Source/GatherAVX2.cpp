@@ -0,0 +1,28 @@
+#include <immintrin.h>
+#include "Gather.h"
+
+[[clang::noinline]]
+void Gather_AVX2(const char* __restrict pData, const std::uint32_t* __restrict pOffsets, int* __restrict pOut, size_t nCount)
+{
+    const int* pBase = reinterpret_cast<const int*>(pData);
+
+    size_t i = 0;
+    for (; i + 8 <= nCount; i += 8)
+    {
+        //VMOVDQU
+        const __m256i vIndex = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pOffsets + i));
+
+        //VPGATHERDD with scale 1: the indices are byte offsets
+        //(signed 32-bit, so the view must be < 2 GB per window)
+        const __m256i vValue = _mm256_i32gather_epi32(pBase, vIndex, 1);
+
+        //VMOVDQU
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pOut + i), vValue);
+    }
+
+    //Scalar tail
+    for (; i < nCount; ++i)
+    {
+        pOut[i] = *reinterpret_cast<const int*>(pData + pOffsets[i]);
+    }
+}
@@ -0,0 +1,173 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+LatencyHistogram::LatencyHistogram()
+{
+    this->vCounts.assign(LATENCY_COUNTERS, 0);
+    this->qwCount = 0;
+    this->qwMin = ~0ull;
+    this->qwMax = 0;
+    this->dSum = 0.0;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& hOther)
+{
+    for (size_t i = 0; i < LATENCY_COUNTERS; ++i)
+    {
+        this->vCounts[i] += hOther.vCounts[i];
+    }
+
+    this->qwCount += hOther.qwCount;
+    this->dSum += hOther.dSum;
+    this->qwMin = min(this->qwMin, hOther.qwMin);
+    this->qwMax = max(this->qwMax, hOther.qwMax);
+}
+
+void LatencyHistogram::Reset()
+{
+    std::fill(this->vCounts.begin(), this->vCounts.end(), 0ull);
+    this->qwCount = 0;
+    this->qwMin = ~0ull;
+    this->qwMax = 0;
+    this->dSum = 0.0;
+}
+
+ULONGLONG LatencyHistogram::HighestEquivalentValue(size_t nIndex)
+{
+    if (nIndex < LATENCY_SUB_BUCKETS)
+    {
+        return nIndex;
+    }
+
+    const size_t nOffset = nIndex - LATENCY_SUB_BUCKETS;
+    const UINT32 nShift = static_cast<UINT32>(nOffset / LATENCY_HALF_BUCKETS) + 1;
+    const ULONGLONG qwLowest = static_cast<ULONGLONG>(nOffset % LATENCY_HALF_BUCKETS + LATENCY_HALF_BUCKETS) << nShift;
+
+    return qwLowest + ((1ull << nShift) - 1);
+}
+
+ULONGLONG LatencyHistogram::ValueAtPercentile(double dPercentile) const
+{
+    if (!this->qwCount)
+    {
+        return 0;
+    }
+
+    //Rank of the value: at least the first one, at most the last one
+    const double dRank = std::ceil(min(max(dPercentile, 0.0), 100.0) / 100.0 * static_cast<double>(this->qwCount));
+    const ULONGLONG qwTarget = max(static_cast<ULONGLONG>(dRank), 1ull);
+
+    ULONGLONG qwSeen = 0;
+    for (size_t i = 0; i < LATENCY_COUNTERS; ++i)
+    {
+        qwSeen += this->vCounts[i];
+        if (qwSeen >= qwTarget)
+        {
+            return min(HighestEquivalentValue(i), this->qwMax);
+        }
+    }
+
+    return this->qwMax;
+}
+
+bool LatencyHistogram::WritePercentiles(const char* path) const
+{
+    FILE* pFile = fopen(path, "w");
+    if (!pFile)
+    {
+        return false;
+    }
+
+    constexpr double NS_PER_US = 1000.0;
+    constexpr int TICKS_PER_HALF_DISTANCE = 5;
+
+    fprintf(pFile, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+    /*
+        Percentiles 0, 10, 20 ... 50, 55, 60 ... 75, 77.5 ... stepping 5 times
+        per halving of the distance to 100%, until the step is finer than one
+        value. The counters are walked once since the percentiles only grow.
+    */
+    size_t nIndex = 0;
+    ULONGLONG qwSeen = this->qwCount ? this->vCounts[0] : 0;
+
+    for (int nHalving = 0; this->qwCount; ++nHalving)
+    {
+        const double dLow = 100.0 * (1.0 - std::ldexp(1.0, -nHalving));
+        const double dHigh = 100.0 * (1.0 - std::ldexp(1.0, -(nHalving + 1)));
+
+        if (std::ldexp(1.0, nHalving) > static_cast<double>(this->qwCount))
+        {
+            break;
+        }
+
+        for (int nTick = 0; nTick < TICKS_PER_HALF_DISTANCE; ++nTick)
+        {
+            const double dPercentile = dLow + (dHigh - dLow) * nTick / TICKS_PER_HALF_DISTANCE;
+            const ULONGLONG qwTarget = max(static_cast<ULONGLONG>(std::ceil(dPercentile / 100.0 * static_cast<double>(this->qwCount))), 1ull);
+
+            while (qwSeen < qwTarget && nIndex + 1 < LATENCY_COUNTERS)
+            {
+                qwSeen += this->vCounts[++nIndex];
+            }
+
+            const ULONGLONG qwValue = min(HighestEquivalentValue(nIndex), this->qwMax);
+            fprintf(pFile, "%12.3f %2.12f %10llu %14.2f\n", static_cast<double>(qwValue) / NS_PER_US, dPercentile / 100.0, qwSeen, 1.0 / (1.0 - dPercentile / 100.0));
+        }
+    }
+
+    //The 100% line closes the distribution (1/(1-p) is infinite and left out, as HdrHistogram does)
+    fprintf(pFile, "%12.3f %2.12f %10llu\n", static_cast<double>(this->qwMax) / NS_PER_US, 1.0, this->qwCount);
+
+    //Standard deviation from the bucket values
+    double dVariance = 0.0;
+    const double dMean = this->GetMean();
+    for (size_t i = 0; i < LATENCY_COUNTERS; ++i)
+    {
+        if (this->vCounts[i])
+        {
+            const double dDelta = static_cast<double>(min(HighestEquivalentValue(i), this->qwMax)) - dMean;
+            dVariance += dDelta * dDelta * static_cast<double>(this->vCounts[i]);
+        }
+    }
+
+    dVariance = this->qwCount ? dVariance / static_cast<double>(this->qwCount) : 0.0;
+
+    fprintf(pFile, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", dMean / NS_PER_US, std::sqrt(dVariance) / NS_PER_US);
+    fprintf(pFile, "#[Max     = %12.3f, Total count    = %12llu]\n", static_cast<double>(this->qwMax) / NS_PER_US, this->qwCount);
+    fprintf(pFile, "#[Buckets = %12zu, SubBuckets     = %12zu]\n", static_cast<size_t>(64 - LATENCY_SUB_BUCKET_BITS + 1), LATENCY_SUB_BUCKETS);
+
+    fclose(pFile);
+    return true;
+}
+
+double LatencyClock::NanosecondsPerTick()
+{
+    //Calibrated on first use: ~20 ms of TSC against QPC
+    static const double dNanosecondsPerTick = [] ()
+    {
+        LARGE_INTEGER liFrequency;
+        LARGE_INTEGER liStart;
+        LARGE_INTEGER liNow;
+
+        QueryPerformanceFrequency(&liFrequency);
+        QueryPerformanceCounter(&liStart);
+        const ULONGLONG qwTscStart = __rdtsc();
+
+        const LONGLONG llTarget = liFrequency.QuadPart / 50;
+        do
+        {
+            QueryPerformanceCounter(&liNow);
+        }
+        while (liNow.QuadPart - liStart.QuadPart < llTarget);
+
+        const ULONGLONG qwTscEnd = __rdtsc();
+
+        const double dNanoseconds = static_cast<double>(liNow.QuadPart - liStart.QuadPart) * 1'000'000'000.0 / static_cast<double>(liFrequency.QuadPart);
+        return dNanoseconds / static_cast<double>(qwTscEnd - qwTscStart);
+    }();
+
+    return dNanosecondsPerTick;
+}
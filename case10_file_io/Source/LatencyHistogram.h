@@ -0,0 +1,105 @@
+#pragma once
+#include <Windows.h>
+#include <intrin.h>
+#include <bit>
+#include <vector>
+
+/*
+    HdrHistogram-style latency recorder.
+
+    Values (nanoseconds) are counted in log-linear buckets: every power of two
+    range is split into LATENCY_SUB_BUCKETS / 2 linear sub-buckets, so the
+    relative error is below 1 / (LATENCY_SUB_BUCKETS / 2) (< 0.8%) from 1 ns up
+    to 2^64 ns, with a fixed table of ~7400 counters.
+
+    - Record is constant time: one bit scan, a shift and an increment.
+    - No locks: every thread records into its own histogram, and Merge adds
+      the counters afterwards (the result is exactly the histogram of all the
+      values together).
+    - Percentiles report the highest value equivalent to the bucket, like
+      HdrHistogram; min and max are kept exactly.
+*/
+constexpr UINT32 LATENCY_SUB_BUCKET_BITS = 8;
+constexpr size_t LATENCY_SUB_BUCKETS = size_t(1) << LATENCY_SUB_BUCKET_BITS;
+constexpr size_t LATENCY_HALF_BUCKETS = LATENCY_SUB_BUCKETS / 2;
+constexpr size_t LATENCY_COUNTERS = LATENCY_SUB_BUCKETS + (64 - LATENCY_SUB_BUCKET_BITS) * LATENCY_HALF_BUCKETS;
+
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void Record(ULONGLONG qwValue)
+    {
+        ++this->vCounts[IndexOf(qwValue)];
+        ++this->qwCount;
+        this->dSum += static_cast<double>(qwValue);
+        this->qwMin = min(this->qwMin, qwValue);
+        this->qwMax = max(this->qwMax, qwValue);
+    }
+
+    void Merge(const LatencyHistogram& hOther);
+    void Reset();
+
+    ULONGLONG ValueAtPercentile(double dPercentile) const;
+
+    ULONGLONG GetCount() const { return this->qwCount; }
+    ULONGLONG GetMin() const { return this->qwCount ? this->qwMin : 0; }
+    ULONGLONG GetMax() const { return this->qwMax; }
+    double GetMean() const { return this->qwCount ? this->dSum / static_cast<double>(this->qwCount) : 0.0; }
+
+    /*
+        Percentile distribution in the HdrHistogram .hgrm text format (values in
+        microseconds), readable by the HdrHistogram plotter. Percentiles are
+        reported 5 times per halving of the remaining distance to 100%.
+    */
+    bool WritePercentiles(const char* path) const;
+
+    static size_t IndexOf(ULONGLONG qwValue)
+    {
+        if (qwValue < LATENCY_SUB_BUCKETS)
+        {
+            return static_cast<size_t>(qwValue);
+        }
+
+        //Keep the top LATENCY_SUB_BUCKET_BITS bits: the top one selects the range, the rest the sub-bucket
+        const UINT32 nShift = static_cast<UINT32>(std::bit_width(qwValue)) - LATENCY_SUB_BUCKET_BITS;
+        const size_t nSub = static_cast<size_t>(qwValue >> nShift) - LATENCY_HALF_BUCKETS;
+
+        return LATENCY_SUB_BUCKETS + (nShift - 1) * LATENCY_HALF_BUCKETS + nSub;
+    }
+
+    //Largest value that maps to the same counter as nIndex
+    static ULONGLONG HighestEquivalentValue(size_t nIndex);
+
+private:
+    std::vector<ULONGLONG> vCounts;
+    ULONGLONG qwCount;
+    ULONGLONG qwMin;
+    ULONGLONG qwMax;
+    double dSum;
+};
+
+/*
+    Timestamps for per-operation timing. QueryPerformanceCounter ticks at
+    10 MHz on most machines (100 ns resolution), too coarse for a mapped load
+    or a cached ReadFile, so the invariant TSC is read directly and converted
+    with a rate calibrated once against QPC. LFENCE keeps RDTSC from running
+    ahead of the loads being timed (it waits for every earlier instruction).
+*/
+class LatencyClock
+{
+public:
+    static ULONGLONG Now()
+    {
+        _mm_lfence();
+        return __rdtsc();
+    }
+
+    static ULONGLONG ToNanoseconds(ULONGLONG qwTicks)
+    {
+        return static_cast<ULONGLONG>(static_cast<double>(qwTicks) * NanosecondsPerTick());
+    }
+
+    static double NanosecondsPerTick();
+};
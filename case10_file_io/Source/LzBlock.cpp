@@ -0,0 +1,257 @@
+#include "LzBlock.h"
+#include <emmintrin.h>
+#include <cstring>
+
+constexpr size_t LZ_MIN_MATCH = 4;
+constexpr size_t LZ_LAST_LITERALS = 5;
+constexpr size_t LZ_MF_LIMIT = 12;
+constexpr size_t LZ_MAX_DISTANCE = 65535;
+constexpr size_t LZ_WILD_COPY = 16;
+
+static UINT32 Read32(const char* pData)
+{
+    UINT32 dwValue;
+    memcpy(&dwValue, pData, sizeof(dwValue));
+    return dwValue;
+}
+
+static UINT32 HashSequence(UINT32 dwSequence)
+{
+    //Knuth multiplicative hash of the next 4 bytes
+    return (dwSequence * 2654435761u) >> (32 - LZ_HASH_LOG);
+}
+
+static char* WriteLength(char* pOut, size_t nLength)
+{
+    while (nLength >= 255)
+    {
+        *pOut++ = static_cast<char>(255);
+        nLength -= 255;
+    }
+
+    *pOut++ = static_cast<char>(nLength);
+    return pOut;
+}
+
+size_t LzCompress(LzCompressState* pState, const char* pSource, size_t nSize, char* pDest, size_t nCapacity)
+{
+    if (nCapacity < LzCompressBound(nSize))
+    {
+        return 0;
+    }
+
+    memset(pState->pTable, 0, sizeof(pState->pTable));
+
+    const char* ip = pSource;
+    const char* pAnchor = pSource;
+    const char* const pEnd = pSource + nSize;
+    const char* const pMatchLimit = pEnd - LZ_LAST_LITERALS;
+
+    char* op = pDest;
+
+    if (nSize > LZ_MF_LIMIT)
+    {
+        const char* const pMfLimit = pEnd - LZ_MF_LIMIT;
+
+        //Position 0 has nothing behind it to match, the search starts at 1
+        ++ip;
+
+        size_t nMisses = 0;
+        while (ip <= pMfLimit)
+        {
+            const UINT32 dwSequence = Read32(ip);
+            const UINT32 nHash = HashSequence(dwSequence);
+            const char* pRef = pSource + pState->pTable[nHash];
+            pState->pTable[nHash] = static_cast<UINT32>(ip - pSource);
+
+            if (pRef >= ip || static_cast<size_t>(ip - pRef) > LZ_MAX_DISTANCE || Read32(pRef) != dwSequence)
+            {
+                //Skip faster through incompressible regions (LZ4 acceleration)
+                ip += 1 + (nMisses++ >> 6);
+                continue;
+            }
+
+            nMisses = 0;
+
+            //Extend backwards over literals that also match
+            while (ip > pAnchor && pRef > pSource && ip[-1] == pRef[-1])
+            {
+                --ip;
+                --pRef;
+            }
+
+            size_t nMatch = LZ_MIN_MATCH;
+            while (ip + nMatch < pMatchLimit && ip[nMatch] == pRef[nMatch])
+            {
+                ++nMatch;
+            }
+
+            const size_t nLiterals = static_cast<size_t>(ip - pAnchor);
+            const size_t nMatchCode = nMatch - LZ_MIN_MATCH;
+
+            *op++ = static_cast<char>((min(nLiterals, static_cast<size_t>(15)) << 4) | min(nMatchCode, static_cast<size_t>(15)));
+            if (nLiterals >= 15)
+            {
+                op = WriteLength(op, nLiterals - 15);
+            }
+
+            memcpy(op, pAnchor, nLiterals);
+            op += nLiterals;
+
+            const size_t nDistance = static_cast<size_t>(ip - pRef);
+            *op++ = static_cast<char>(nDistance & 0xFF);
+            *op++ = static_cast<char>(nDistance >> 8);
+
+            if (nMatchCode >= 15)
+            {
+                op = WriteLength(op, nMatchCode - 15);
+            }
+
+            ip += nMatch;
+            pAnchor = ip;
+
+            //Index a position inside the match so the next search has a recent candidate
+            if (ip - 2 > pSource && ip <= pMfLimit)
+            {
+                pState->pTable[HashSequence(Read32(ip - 2))] = static_cast<UINT32>(ip - 2 - pSource);
+            }
+        }
+    }
+
+    //Last literals
+    const size_t nLiterals = static_cast<size_t>(pEnd - pAnchor);
+    *op++ = static_cast<char>(min(nLiterals, static_cast<size_t>(15)) << 4);
+    if (nLiterals >= 15)
+    {
+        op = WriteLength(op, nLiterals - 15);
+    }
+
+    memcpy(op, pAnchor, nLiterals);
+    op += nLiterals;
+
+    return static_cast<size_t>(op - pDest);
+}
+
+static bool ReadLength(const char*& ip, const char* pEnd, size_t* pLength)
+{
+    unsigned char bValue = 0;
+    do
+    {
+        if (ip >= pEnd)
+        {
+            return false;
+        }
+
+        bValue = static_cast<unsigned char>(*ip++);
+        *pLength += bValue;
+    }
+    while (bValue == 255);
+
+    return true;
+}
+
+//16 bytes per step, may write up to 15 bytes past pDest + nSize (callers check the room)
+static void WildCopy16(char* pDest, const char* pSource, size_t nSize)
+{
+    char* const pEnd = pDest + nSize;
+    do
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource)));
+        pDest += 16;
+        pSource += 16;
+    }
+    while (pDest < pEnd);
+}
+
+bool LzDecompress(const char* pSource, size_t nSize, char* pDest, size_t nRawSize)
+{
+    const char* ip = pSource;
+    const char* const pEnd = pSource + nSize;
+
+    char* op = pDest;
+    char* const pOutEnd = pDest + nRawSize;
+
+    while (ip < pEnd)
+    {
+        const unsigned char bToken = static_cast<unsigned char>(*ip++);
+
+        size_t nLiterals = bToken >> 4;
+        if (nLiterals == 15 && !ReadLength(ip, pEnd, &nLiterals))
+        {
+            return false;
+        }
+
+        if (nLiterals > static_cast<size_t>(pEnd - ip) || nLiterals > static_cast<size_t>(pOutEnd - op))
+        {
+            return false;
+        }
+
+        if (static_cast<size_t>(pEnd - ip) >= nLiterals + LZ_WILD_COPY && static_cast<size_t>(pOutEnd - op) >= nLiterals + LZ_WILD_COPY)
+        {
+            WildCopy16(op, ip, nLiterals);
+        }
+        else
+        {
+            memcpy(op, ip, nLiterals);
+        }
+
+        ip += nLiterals;
+        op += nLiterals;
+
+        //The last sequence has no match
+        if (ip == pEnd)
+        {
+            break;
+        }
+
+        if (pEnd - ip < 2)
+        {
+            return false;
+        }
+
+        const size_t nDistance = static_cast<size_t>(static_cast<unsigned char>(ip[0])) | (static_cast<size_t>(static_cast<unsigned char>(ip[1])) << 8);
+        ip += 2;
+
+        if (!nDistance || nDistance > static_cast<size_t>(op - pDest))
+        {
+            return false;
+        }
+
+        size_t nMatch = bToken & 15;
+        if (nMatch == 15 && !ReadLength(ip, pEnd, &nMatch))
+        {
+            return false;
+        }
+
+        nMatch += LZ_MIN_MATCH;
+        if (nMatch > static_cast<size_t>(pOutEnd - op))
+        {
+            return false;
+        }
+
+        const char* pMatch = op - nDistance;
+
+        if (nDistance >= LZ_WILD_COPY && static_cast<size_t>(pOutEnd - op) >= nMatch + LZ_WILD_COPY)
+        {
+            //Each 16-byte step reads bytes that are already written: the distance is at least 16
+            WildCopy16(op, pMatch, nMatch);
+        }
+        else if (nDistance == 1)
+        {
+            //Run of one byte (RLE)
+            memset(op, *pMatch, nMatch);
+        }
+        else
+        {
+            //Short distances overlap the bytes being written, copy in order
+            for (size_t i = 0; i < nMatch; ++i)
+            {
+                op[i] = pMatch[i];
+            }
+        }
+
+        op += nMatch;
+    }
+
+    return op == pOutEnd;
+}
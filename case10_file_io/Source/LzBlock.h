@@ -0,0 +1,35 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    LZ4-style block codec (same sequence layout as the LZ4 block format).
+
+    A block is a list of sequences:
+        token       [literal length:4][match length - 4:4], 15 means "more bytes follow"
+        literals    literal length bytes, copied as-is
+        offset      2 bytes little-endian, distance back into the output (1..65535)
+        extra       255, 255, ..., n: added to the 15 of a saturated nibble
+
+    The last sequence only has literals and ends the block. Matches are at
+    least 4 bytes, the last 5 bytes are always literals and the last match
+    starts at least 12 bytes before the end, so the decoder can copy 16 bytes
+    at a time without reading past the sequence it is working on.
+*/
+constexpr size_t LZ_HASH_LOG = 14;
+
+struct LzCompressState
+{
+    UINT32 pTable[1 << LZ_HASH_LOG];
+};
+
+//Worst case output size for nSize input bytes (incompressible data grows slightly)
+constexpr size_t LzCompressBound(size_t nSize)
+{
+    return nSize + nSize / 255 + 16;
+}
+
+//Returns the compressed size, 0 if it does not fit in nCapacity
+size_t LzCompress(LzCompressState* pState, const char* pSource, size_t nSize, char* pDest, size_t nCapacity);
+
+//Decodes exactly nRawSize bytes; false on malformed input, never reads or writes out of bounds
+bool LzDecompress(const char* pSource, size_t nSize, char* pDest, size_t nRawSize);
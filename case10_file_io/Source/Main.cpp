@@ -1,10 +1,25 @@
 #include <windows.h>
+#include <intrin.h>
 #include <iostream>
 #include <vector>
 #include <chrono>
 #include <random>
 #include <cstdio>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <string>
 #include "Benchmark.h"
+#include "FaultCounters.h"
+#include "MappedFile.h"
+#include "Gather.h"
+#include "RangeScanner.h"
+#include "BlockCache.h"
+#include "WriteBenchmark.h"
+#include "CompressedFile.h"
+#include "LatencyHistogram.h"
+#include "WriteAheadLog.h"
+#include "SmallFiles.h"
 
 constexpr size_t FILE_SIZE = 100 * 1024 * 1024; // 100 MB
 constexpr size_t BUFFER_SIZE = 64 * 1024;
@@ -30,19 +45,27 @@ static void GenerateFile(const char* path)
     CloseHandle(hFile);
 }
 
-static void Test_fread(const char* path)
+//pLatency (optional) receives the latency of every read call, in nanoseconds
+static void Test_fread(const char* path, LatencyHistogram* pLatency = nullptr)
 {
     FILE* pFile = fopen(path, "rb");
 
     char hBuffer[BUFFER_SIZE];
     while (true)
     {
+        const ULONGLONG qwStart = pLatency ? LatencyClock::Now() : 0;
+
         const size_t nReadBytes = fread(hBuffer, 1, BUFFER_SIZE, pFile);
         if (!nReadBytes)
         {
             break;
         }
 
+        if (pLatency)
+        {
+            pLatency->Record(LatencyClock::ToNanoseconds(LatencyClock::Now() - qwStart));
+        }
+
         for (size_t i = 0; i < nReadBytes; ++i)
         {
             gqwSink += static_cast<unsigned>(hBuffer[i]);
@@ -52,15 +75,27 @@ static void Test_fread(const char* path)
     fclose(pFile);
 }
 
-static void Test_ReadFile_Seq(const char* path)
+static void Test_ReadFile_Seq(const char* path, LatencyHistogram* pLatency = nullptr)
 {
     HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
 
     char hBuffer[BUFFER_SIZE];
     
     DWORD dwRead;
-    while (ReadFile(hFile, hBuffer, BUFFER_SIZE, &dwRead, nullptr) && dwRead > 0)
+    while (true)
     {
+        const ULONGLONG qwStart = pLatency ? LatencyClock::Now() : 0;
+
+        if (!ReadFile(hFile, hBuffer, BUFFER_SIZE, &dwRead, nullptr) || !dwRead)
+        {
+            break;
+        }
+
+        if (pLatency)
+        {
+            pLatency->Record(LatencyClock::ToNanoseconds(LatencyClock::Now() - qwStart));
+        }
+
         for (DWORD i = 0; i < dwRead; ++i)
         {
             gqwSink += static_cast<unsigned>(hBuffer[i]);
@@ -70,35 +105,55 @@ static void Test_ReadFile_Seq(const char* path)
     CloseHandle(hFile);
 }
 
-static void Test_ReadFile_Rand(const char* path)
+//nSeed picks the offset sequence; concurrent callers pass different seeds so they do not read the same blocks
+static void Test_ReadFile_Rand(const char* path, LatencyHistogram* pLatency = nullptr, unsigned nSeed = 1234)
 {
     HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
 
-    std::mt19937 hRng(1234);
+    std::mt19937 hRng(nSeed);
     std::uniform_int_distribution<size_t> hDist(0, FILE_SIZE - sizeof(int));
 
     DWORD dwRead = 0;
     int nValue = 0;
+    unsigned long long qwLocal = 0;
 
     for (size_t i = 0; i < RANDOM_READS; ++i)
     {
         const size_t nOffset = hDist(hRng);
 
+        const ULONGLONG qwStart = pLatency ? LatencyClock::Now() : 0;
+
         SetFilePointer(hFile, static_cast<LONG>(nOffset), nullptr, FILE_BEGIN);
         ReadFile(hFile, &nValue, sizeof(nValue), &dwRead, nullptr);
 
-        gqwSink += static_cast<unsigned>(nValue);
+        if (pLatency)
+        {
+            pLatency->Record(LatencyClock::ToNanoseconds(LatencyClock::Now() - qwStart));
+        }
+
+        qwLocal += static_cast<unsigned>(nValue);
     }
 
+    gqwSink += qwLocal;
+
     CloseHandle(hFile);
 }
 
-static void Test_Mapping_Rand(const char* path)
+static void Test_Mapping_Rand(const char* path, DWORD dwHints, LatencyHistogram* pLatency = nullptr)
 {
-    HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    HANDLE hMap = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    MappedFile hMapped;
+    if (!hMapped.Open(path, dwHints))
+    {
+        std::cout << "Mapping failed: " << GetLastError() << "\n";
+        return;
+    }
+
+    if ((dwHints & MAP_HINT_LARGE_PAGES) && !hMapped.bLargePages)
+    {
+        std::cout << "(large pages unavailable, using 4 KB pages) ";
+    }
 
-    char* pData = reinterpret_cast<char*>(MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0));
+    const char* pData = hMapped.pData;
 
     std::mt19937 hRng(1234);
     std::uniform_int_distribution<size_t> hDist(0, FILE_SIZE - sizeof(int));
@@ -107,22 +162,757 @@ static void Test_Mapping_Rand(const char* path)
     {
         const size_t nOffset = hDist(hRng);
 
-        const int nValue = *reinterpret_cast<int*>(pData + nOffset);
+        const ULONGLONG qwStart = pLatency ? LatencyClock::Now() : 0;
+
+        const int nValue = *reinterpret_cast<const int*>(pData + nOffset);
 
         gqwSink += static_cast<unsigned>(nValue);
+
+        if (pLatency)
+        {
+            pLatency->Record(LatencyClock::ToNanoseconds(LatencyClock::Now() - qwStart));
+        }
+    }
+}
+
+struct MapHintCase
+{
+    const char* pName;
+    DWORD dwHints;
+};
+
+static const MapHintCase hMapHintCases[] =
+{
+    { "default",              MAP_HINT_DEFAULT },
+    { "random",               MAP_HINT_RANDOM },
+    { "sequential",           MAP_HINT_SEQUENTIAL },
+    { "willneed",             MAP_HINT_WILLNEED },
+    { "random + willneed",    MAP_HINT_RANDOM | MAP_HINT_WILLNEED },
+    { "populate",             MAP_HINT_POPULATE },
+    { "large pages",          MAP_HINT_LARGE_PAGES },
+    { "large pages+populate", MAP_HINT_LARGE_PAGES | MAP_HINT_POPULATE },
+};
+
+/*
+    The view is opened with MAP_HINT_POPULATE so that no page fault happens in the
+    measured loops: what is left are cache and TLB misses. A software prefetch is
+    dropped when the page is not present, so on a cold mapping the faults would
+    dominate every variant equally.
+
+    Hardware miss counters (LLC / dTLB) are not readable from user mode on
+    Windows without a PMU tracing session (wpr/xperf PMC profiles, VTune, uProf),
+    so the miss cost is reported as cycles per lookup, and the gain against the
+    naive loop approximates how many misses are overlapped (memory-level
+    parallelism).
+*/
+static void Bench_Gather(const char* path)
+{
+    MappedFile hMapped;
+    if (!hMapped.Open(path, MAP_HINT_POPULATE))
+    {
+        std::cout << "Mapping failed: " << GetLastError() << "\n";
+        return;
+    }
+
+    std::mt19937 hRng(1234);
+    std::uniform_int_distribution<std::uint32_t> hDist(0, static_cast<std::uint32_t>(FILE_SIZE - sizeof(int)));
+
+    std::vector<std::uint32_t> vOffsets(RANDOM_READS);
+    for (std::uint32_t& dwOffset : vOffsets)
+    {
+        dwOffset = hDist(hRng);
+    }
+
+    std::vector<int> vValues(RANDOM_READS);
+
+    double dNaiveCycles = 0.0;
+
+    auto RunGather = [&] (const char* pName, auto&& Function)
+    {
+        const FaultSnapshot hBefore = CaptureFaults();
+        const unsigned long long qwStart = __rdtsc();
+        const double dTime = BenchmarkQPC(Function);
+        const unsigned long long qwCycles = __rdtsc() - qwStart;
+        const FaultSnapshot hFaults = FaultDelta(hBefore, CaptureFaults());
+
+        for (const int nValue : vValues)
+        {
+            gqwSink += static_cast<unsigned>(nValue);
+        }
+
+        const double dLookups = static_cast<double>(RANDOM_READS);
+        const double dCyclesPerLookup = static_cast<double>(qwCycles) / dLookups;
+        if (dNaiveCycles == 0.0)
+        {
+            dNaiveCycles = dCyclesPerLookup;
+        }
+
+        std::cout << pName << ": " << dTime << " ms"
+            << " | " << dTime * 1'000'000.0 / dLookups << " ns/lookup"
+            << " | " << dCyclesPerLookup << " cycles/lookup"
+            << " | x" << dNaiveCycles / dCyclesPerLookup << " vs naive"
+            << " | faults/lookup: " << static_cast<double>(hFaults.qwTotal) / dLookups << "\n";
+    };
+
+    const char* pData = hMapped.pData;
+    const std::uint32_t* pOffsets = vOffsets.data();
+    int* pOut = vValues.data();
+
+    RunGather("Naive loop", [&] ()
+    {
+        Gather_Naive(pData, pOffsets, pOut, RANDOM_READS);
+    });
+
+    for (size_t nBatch = GATHER_MIN_BATCH; nBatch <= GATHER_MAX_BATCH; nBatch *= 2)
+    {
+        const std::string sName = "Prefetch batch " + std::to_string(nBatch);
+        RunGather(sName.c_str(), [&] ()
+        {
+            Gather_Prefetch(pData, pOffsets, pOut, RANDOM_READS, nBatch, false);
+        });
+
+        const std::string sSortedName = sName + " (sorted)";
+        RunGather(sSortedName.c_str(), [&] ()
+        {
+            Gather_Prefetch(pData, pOffsets, pOut, RANDOM_READS, nBatch, true);
+        });
+    }
+
+    if (IsAvx2Supported())
+    {
+        RunGather("AVX2 vpgatherdd", [&] ()
+        {
+            Gather_AVX2(pData, pOffsets, pOut, RANDOM_READS);
+        });
+    }
+    else
+    {
+        std::cout << "AVX2 vpgatherdd: not supported by this CPU\n";
+    }
+}
+
+/*
+    Thread count is doubled until the throughput stops improving by at least 5%:
+    at that point the device (or, for a cached file, the memory bandwidth) is
+    the ceiling and more threads only add contention.
+*/
+static void Bench_ParallelScan(const char* path)
+{
+    constexpr size_t SCAN_CHUNK_SIZE = 1024 * 1024;
+    constexpr double SCALING_THRESHOLD = 1.05;
+
+    auto ReduceSum = [] (unsigned long long& qwSum, const char* pData, size_t nSize)
+    {
+        unsigned long long qwLocal = 0;
+        for (size_t i = 0; i < nSize; ++i)
+        {
+            qwLocal += static_cast<unsigned>(pData[i]);
+        }
+
+        qwSum += qwLocal;
+    };
+
+    auto MergeSum = [] (unsigned long long& qwTotal, const unsigned long long& qwRange)
+    {
+        qwTotal += qwRange;
+    };
+
+    const size_t nMaxThreads = max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+
+    const ScanBackend eBackends[] = { SCAN_BACKEND_READFILE, SCAN_BACKEND_MAPPING, SCAN_BACKEND_NO_BUFFERING };
+    const size_t nRangeSizes[] = { 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024 };
+
+    for (const ScanBackend eBackend : eBackends)
+    {
+        for (const size_t nRangeSize : nRangeSizes)
+        {
+            double dBest = 0.0;
+
+            for (size_t nThreads = 1; nThreads <= nMaxThreads; nThreads *= 2)
+            {
+                const ScanConfig hConfig = { eBackend, nThreads, nRangeSize, SCAN_CHUNK_SIZE };
+
+                ScanStats hStats = {};
+                gqwSink += ParallelScan(path, hConfig, 0ull, ReduceSum, MergeSum, &hStats);
+
+                const double dThroughput = hStats.GigabytesPerSecond();
+
+                std::cout << ScanBackendName(eBackend)
+                    << " | range " << nRangeSize / (1024 * 1024) << " MB"
+                    << " | threads " << nThreads
+                    << ": " << hStats.dMilliseconds << " ms"
+                    << " | " << dThroughput << " GB/s\n";
+
+                if (dBest > 0.0 && dThroughput < dBest * SCALING_THRESHOLD)
+                {
+                    std::cout << "  -> bandwidth ceiling reached at ~" << max(dBest, dThroughput) << " GB/s\n";
+                    break;
+                }
+
+                dBest = max(dBest, dThroughput);
+            }
+        }
+    }
+}
+
+/*
+    Same workload as Test_ReadFile_Rand (RANDOM_READS 4-byte reads, same seed),
+    served by a BlockCache sized as a fraction of the file. With a uniform
+    distribution the hit rate can only match the ratio; the hot-set run sends
+    90% of the reads to 10% of the file, which is where ARC earns its keep.
+*/
+static void Bench_BlockCache(const char* path)
+{
+    constexpr size_t CACHE_BLOCK_SIZE = 4096;
+    constexpr size_t CACHE_SHARDS = 64;
+
+    auto RunWorkload = [&] (const char* pName, size_t nCacheBytes, size_t nThreads, bool bHotSet)
+    {
+        BlockCache hCache;
+        if (!hCache.Open(path, nCacheBytes, CACHE_BLOCK_SIZE, CACHE_SHARDS))
+        {
+            std::cout << "BlockCache open failed: " << GetLastError() << "\n";
+            return;
+        }
+
+        const size_t nReadsPerThread = RANDOM_READS / nThreads;
+
+        auto Worker = [&] (size_t nThread)
+        {
+            std::mt19937 hRng(static_cast<unsigned>(1234 + nThread));
+            std::uniform_int_distribution<size_t> hDist(0, FILE_SIZE - sizeof(int));
+            std::uniform_int_distribution<size_t> hHotDist(0, FILE_SIZE / 10 - sizeof(int));
+
+            int nValue = 0;
+            unsigned long long qwLocal = 0;
+            for (size_t i = 0; i < nReadsPerThread; ++i)
+            {
+                const size_t nOffset = (bHotSet && (i % 10) != 0) ? hHotDist(hRng) : hDist(hRng);
+                hCache.Read(nOffset, &nValue, sizeof(nValue));
+                qwLocal += static_cast<unsigned>(nValue);
+            }
+
+            gqwSink += qwLocal;
+        };
+
+        auto RunThreads = [&] ()
+        {
+            std::vector<std::thread> vThreads;
+            for (size_t i = 1; i < nThreads; ++i)
+            {
+                vThreads.emplace_back(Worker, i);
+            }
+
+            Worker(0);
+
+            for (std::thread& hThread : vThreads)
+            {
+                hThread.join();
+            }
+        };
+
+        const double dTime = BenchmarkQPC(RunThreads);
+        const BlockCache::Stats hStats = hCache.GetStats();
+
+        std::cout << pName << " | cache " << nCacheBytes / (1024 * 1024) << " MB"
+            << (hCache.UsesLargePages() ? " (large pages)" : "")
+            << " | threads " << nThreads
+            << ": " << dTime << " ms"
+            << " | hit rate " << hStats.HitRate() * 100.0 << "%"
+            << " | " << dTime * 1'000'000.0 / static_cast<double>(nReadsPerThread) << " ns/read per thread\n";
+    };
+
+    const size_t nRatios[] = { 16, 8, 4, 2, 1 };
+    for (const size_t nRatio : nRatios)
+    {
+        const std::string sName = "Uniform 1/" + std::to_string(nRatio);
+        RunWorkload(sName.c_str(), FILE_SIZE / nRatio, 1, false);
+    }
+
+    RunWorkload("Hot set 90/10, 1/8", FILE_SIZE / 8, 1, true);
+
+    const size_t nThreads = max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+    RunWorkload("Uniform 1/4", FILE_SIZE / 4, nThreads, false);
+}
+
+/*
+    Write path strategies. Every run creates a fresh file of FILE_SIZE bytes and
+    ends with a FlushFileBuffers, so the time always covers getting the data to
+    the device and the strategies are compared on durability, not on how much of
+    the file is still dirty in the cache. The buffered runs are repeated with a
+    periodic flush to show the throughput cost of a tighter durability window.
+*/
+static void Bench_WriteStrategies(const char* path)
+{
+    constexpr size_t QUEUE_DEPTH = 16;
+    constexpr size_t MB = 1024 * 1024;
+
+    struct WriteCase
+    {
+        WriteStrategy eStrategy;
+        size_t nFlushInterval;
+    };
+
+    const WriteCase hCases[] =
+    {
+        { WRITE_BUFFERED, 0 },
+        { WRITE_BUFFERED, 32 * MB },
+        { WRITE_BUFFERED, 8 * MB },
+        { WRITE_BUFFERED, 1 * MB },
+        { WRITE_PREALLOCATED, 0 },
+        { WRITE_UNBUFFERED, 0 },
+        { WRITE_GATHER, 0 },
+        { WRITE_ASYNC_QUEUE, 0 },
+        { WRITE_ASYNC_QUEUE, 8 * MB },
+        { WRITE_THROUGH, 0 },
+    };
+
+    for (const WriteCase& hCase : hCases)
+    {
+        WriteConfig hConfig = {};
+        hConfig.eStrategy = hCase.eStrategy;
+        hConfig.nFileSize = FILE_SIZE;
+        hConfig.nWriteSize = BUFFER_SIZE;
+        hConfig.nFlushInterval = hCase.nFlushInterval;
+        hConfig.nQueueDepth = QUEUE_DEPTH;
+
+        WriteResult hResult = {};
+        const bool bOk = RunWriteStrategy(path, hConfig, &hResult);
+
+        std::cout << WriteStrategyName(hCase.eStrategy);
+        if (hCase.nFlushInterval)
+        {
+            std::cout << " + flush every " << hCase.nFlushInterval / MB << " MB";
+        }
+
+        if (!bOk)
+        {
+            std::cout << ": failed (" << GetLastError() << ")\n";
+            continue;
+        }
+
+        std::cout << ": " << hResult.dMilliseconds << " ms"
+            << " | " << hResult.MegabytesPerSecond(FILE_SIZE) << " MB/s"
+            << " | latency us p50 " << hResult.dP50
+            << " p99 " << hResult.dP99
+            << " p99.9 " << hResult.dP999
+            << " max " << hResult.dMax << "\n";
+    }
+
+    DeleteFileA(path);
+}
+
+/*
+    Durable appends of WAL_RECORD_SIZE-byte records from 1..64 threads. Every
+    thread appends and waits for its own record (one Commit per record), so
+    with per-record flushing the commit rate is bounded by the flush latency
+    of the device, whatever the thread count. Group commit lets one flush
+    cover every record appended while the previous flush was in flight; the
+    1 ms interval trades latency for larger batches at low thread counts.
+
+    The log is replayed after each run to check that every record made it.
+*/
+static void Bench_WriteAheadLog(const char* path)
+{
+    constexpr size_t WAL_RECORDS = 4096;
+    constexpr size_t WAL_RECORD_SIZE = 128;
+    constexpr size_t MB = 1024 * 1024;
+
+    struct WalCase
+    {
+        const char* pName;
+        WalCommitMode eMode;
+        DWORD dwFlushIntervalMs;
+    };
+
+    const WalCase hCases[] =
+    {
+        { "Per-record flush",          WAL_COMMIT_PER_RECORD, 0 },
+        { "Group commit",              WAL_COMMIT_GROUP,      0 },
+        { "Group commit (1 ms delay)", WAL_COMMIT_GROUP,      1 },
+    };
+
+    const size_t nThreadCounts[] = { 1, 4, 16, 64 };
+
+    for (const WalCase& hCase : hCases)
+    {
+        for (const size_t nThreads : nThreadCounts)
+        {
+            WalConfig hConfig = {};
+            hConfig.eMode = hCase.eMode;
+            hConfig.nBufferSize = 1 * MB;
+            hConfig.nFlushBytes = 64 * 1024;
+            hConfig.dwFlushIntervalMs = hCase.dwFlushIntervalMs;
+            hConfig.nPreallocate = 4 * MB;
+
+            WriteAheadLog hLog;
+            if (!hLog.Open(path, hConfig))
+            {
+                std::cout << "WAL open failed: " << GetLastError() << "\n";
+                return;
+            }
+
+            const size_t nRecordsPerThread = WAL_RECORDS / nThreads;
+            std::vector<LatencyHistogram> vLatency(nThreads);
+            std::atomic<bool> bFailed = false;
+
+            auto Worker = [&] (size_t nThread)
+            {
+                char pRecord[WAL_RECORD_SIZE];
+                memset(pRecord, static_cast<int>('a' + nThread % 26), sizeof(pRecord));
+
+                for (size_t i = 0; i < nRecordsPerThread; ++i)
+                {
+                    memcpy(pRecord, &i, sizeof(i));
+
+                    const ULONGLONG qwStart = LatencyClock::Now();
+                    if (!hLog.AppendDurable(pRecord, sizeof(pRecord)))
+                    {
+                        bFailed = true;
+                        return;
+                    }
+
+                    vLatency[nThread].Record(LatencyClock::ToNanoseconds(LatencyClock::Now() - qwStart));
+                }
+            };
+
+            auto RunThreads = [&] ()
+            {
+                std::vector<std::thread> vThreads;
+                for (size_t i = 1; i < nThreads; ++i)
+                {
+                    vThreads.emplace_back(Worker, i);
+                }
+
+                Worker(0);
+
+                for (std::thread& hThread : vThreads)
+                {
+                    hThread.join();
+                }
+            };
+
+            const double dTime = BenchmarkQPC(RunThreads);
+            const WalStats hStats = hLog.GetStats();
+            hLog.Close();
+
+            LatencyHistogram hMerged;
+            for (const LatencyHistogram& hLatency : vLatency)
+            {
+                hMerged.Merge(hLatency);
+            }
+
+            WalReplayStats hReplay = {};
+            const bool bReplayed = ReplayWriteAheadLog(path, nullptr, nullptr, &hReplay);
+
+            std::cout << hCase.pName << " | threads " << nThreads;
+            if (bFailed)
+            {
+                std::cout << ": append failed\n";
+                continue;
+            }
+
+            std::cout << ": " << static_cast<double>(hStats.qwRecords) * 1000.0 / dTime << " commits/s"
+                << " | " << hStats.RecordsPerFlush() << " records/flush"
+                << " | latency us p50 " << static_cast<double>(hMerged.ValueAtPercentile(50.0)) / 1000.0
+                << " p99 " << static_cast<double>(hMerged.ValueAtPercentile(99.0)) / 1000.0
+                << " p99.9 " << static_cast<double>(hMerged.ValueAtPercentile(99.9)) / 1000.0
+                << ((bReplayed && hReplay.qwRecords == hStats.qwRecords && !hReplay.bTornTail) ? "" : " | REPLAY MISMATCH") << "\n";
+        }
+    }
+
+    DeleteFileA(path);
+}
+
+/*
+    Log-like records: repeated keys and a small vocabulary with varying numbers,
+    which is what LZ-class codecs see on real datasets (~3x with this codec).
+    The read test file is all ones and would compress ~250x, which says nothing.
+*/
+static bool GenerateCompressibleFile(const char* path)
+{
+    static const char* pLevels[] = { "INFO", "INFO", "INFO", "WARN", "DEBUG", "ERROR" };
+    static const char* pRoutes[] = { "/api/v1/items", "/api/v1/users", "/api/v2/orders", "/health", "/static/app.js" };
+
+    HANDLE hFile = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    std::mt19937 hRng(42);
+    std::string sBuffer;
+    sBuffer.reserve(BUFFER_SIZE + 256);
+
+    char pLine[256];
+    size_t nWritten = 0;
+    unsigned int nTimestamp = 1'700'000'000;
+
+    while (nWritten < FILE_SIZE)
+    {
+        nTimestamp += static_cast<unsigned int>(hRng() % 3);
+        const int nLength = snprintf(pLine, sizeof(pLine), "ts=%u level=%s route=%s status=%u latency_us=%u user=%05u\n",
+            nTimestamp, pLevels[hRng() % 6], pRoutes[hRng() % 5], (hRng() % 20) ? 200u : 500u, static_cast<unsigned int>(hRng() % 5000), static_cast<unsigned int>(hRng() % 20000));
+
+        sBuffer.append(pLine, static_cast<size_t>(nLength));
+
+        if (sBuffer.size() >= BUFFER_SIZE || nWritten + sBuffer.size() >= FILE_SIZE)
+        {
+            const DWORD dwToWrite = static_cast<DWORD>(min(sBuffer.size(), FILE_SIZE - nWritten));
+
+            DWORD dwWritten = 0;
+            WriteFile(hFile, sBuffer.data(), dwToWrite, &dwWritten, nullptr);
+            nWritten += dwToWrite;
+            sBuffer.clear();
+        }
     }
 
-    UnmapViewOfFile(pData);
-    CloseHandle(hMap);
     CloseHandle(hFile);
+    return true;
+}
+
+/*
+    Raw unbuffered reads of the uncompressed file against the same data read
+    compressed and decompressed on a pool. Both sides go through
+    FILE_FLAG_NO_BUFFERING so the device is measured, not the file cache; the
+    compressed side wins whenever the device is the bottleneck and there are
+    enough cores to decompress at ratio x device bandwidth.
+*/
+static void Bench_CompressedRead(const char* pRawPath, const char* pCompressedPath)
+{
+    constexpr size_t COMPRESSED_BLOCK_SIZE = 1024 * 1024;
+
+    if (!GenerateCompressibleFile(pRawPath))
+    {
+        std::cout << "Cannot create " << pRawPath << "\n";
+        return;
+    }
+
+    auto Compress = [&] ()
+    {
+        CompressFile(pRawPath, pCompressedPath, COMPRESSED_BLOCK_SIZE);
+    };
+
+    std::cout << "Compress (" << COMPRESSED_BLOCK_SIZE / 1024 << " KB blocks): " << BenchmarkQPC(Compress) << " ms\n";
+
+    auto ReduceSum = [] (unsigned long long& qwSum, const char* pData, size_t nSize)
+    {
+        unsigned long long qwLocal = 0;
+        for (size_t i = 0; i < nSize; ++i)
+        {
+            qwLocal += static_cast<unsigned>(pData[i]);
+        }
+
+        qwSum += qwLocal;
+    };
+
+    auto MergeSum = [] (unsigned long long& qwTotal, const unsigned long long& qwRange)
+    {
+        qwTotal += qwRange;
+    };
+
+    const size_t nMaxThreads = max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+
+    //Baseline: the same consumer on raw bytes, one sequential stream and the multi-threaded ceiling
+    unsigned long long qwExpected = 0;
+    const size_t nRawThreads[] = { 1, nMaxThreads };
+    for (const size_t nThreads : nRawThreads)
+    {
+        const ScanConfig hConfig = { SCAN_BACKEND_NO_BUFFERING, nThreads, 4 * COMPRESSED_BLOCK_SIZE, COMPRESSED_BLOCK_SIZE };
+
+        ScanStats hStats = {};
+        qwExpected = ParallelScan(pRawPath, hConfig, 0ull, ReduceSum, MergeSum, &hStats);
+
+        std::cout << "Raw (NoBuffering) | threads " << nThreads
+            << ": " << hStats.dMilliseconds << " ms"
+            << " | " << hStats.GigabytesPerSecond() << " GB/s\n";
+    }
+
+    struct SumContext
+    {
+        std::atomic<unsigned long long> qwSum;
+    };
+
+    for (size_t nThreads = 1; nThreads <= nMaxThreads; nThreads *= 2)
+    {
+        SumContext hContext;
+        hContext.qwSum = 0;
+
+        auto OnBlock = [] (void* pContext, size_t, const char* pData, size_t nSize)
+        {
+            unsigned long long qwLocal = 0;
+            for (size_t i = 0; i < nSize; ++i)
+            {
+                qwLocal += static_cast<unsigned>(pData[i]);
+            }
+
+            reinterpret_cast<SumContext*>(pContext)->qwSum += qwLocal;
+        };
+
+        const CompressedReadConfig hConfig = { nThreads, nThreads * 2, true };
+
+        CompressedReadStats hStats = {};
+        const bool bOk = ReadCompressedFile(pCompressedPath, hConfig, OnBlock, &hContext, &hStats);
+
+        std::cout << "Compressed (NoBuffering) | ratio " << hStats.Ratio()
+            << " | threads " << nThreads
+            << ": " << hStats.dMilliseconds << " ms"
+            << " | effective " << hStats.EffectiveGigabytesPerSecond() << " GB/s"
+            << " | device " << hStats.EffectiveGigabytesPerSecond() / max(hStats.Ratio(), 1.0) << " GB/s"
+            << ((bOk && hContext.qwSum == qwExpected) ? "" : " | MISMATCH") << "\n";
+    }
+
+    DeleteFileA(pRawPath);
+    DeleteFileA(pCompressedPath);
+}
+
+/*
+    SMALL_DIRECTORIES x SMALL_FILES_PER_DIRECTORY files of SMALL_FILE_SIZE
+    bytes. Every scan strategy runs with 1 thread and with every hardware
+    thread. The tree was just written, so directories and file data are in
+    the cache: this measures the per-file system call and file system cost,
+    which is what dominates with many small files even on a fast device.
+*/
+static void Bench_SmallFiles(const char* pRoot)
+{
+    constexpr size_t SMALL_DIRECTORIES = 64;
+    constexpr size_t SMALL_FILES_PER_DIRECTORY = 1024;
+    constexpr size_t SMALL_FILE_SIZE = 4096;
+    constexpr size_t SMALL_BATCH = 32;
+
+    const size_t nMaxThreads = max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+
+    auto PrintStats = [] (const char* pName, size_t nThreads, bool bOk, const SmallFilesStats& hStats)
+    {
+        std::cout << pName << " | threads " << nThreads;
+        if (!bOk)
+        {
+            std::cout << ": failed (" << GetLastError() << ")\n";
+            return;
+        }
+
+        std::cout << ": " << hStats.dMilliseconds << " ms"
+            << " | " << hStats.qwFiles << " files"
+            << " | " << hStats.FilesPerSecond() << " files/s\n";
+    };
+
+    SmallFilesStats hCreate = {};
+    const bool bCreated = CreateSmallFileTree(pRoot, SMALL_DIRECTORIES, SMALL_FILES_PER_DIRECTORY, SMALL_FILE_SIZE, nMaxThreads, &hCreate);
+    PrintStats("Create", nMaxThreads, bCreated, hCreate);
+
+    if (bCreated)
+    {
+        const SmallFilesStrategy eStrategies[] = { SMALL_FILES_STAT_OPEN, SMALL_FILES_STAT_ENUM, SMALL_FILES_READ, SMALL_FILES_READ_BATCHED };
+        const size_t nThreadCounts[] = { 1, nMaxThreads };
+
+        for (const SmallFilesStrategy eStrategy : eStrategies)
+        {
+            for (const size_t nThreads : nThreadCounts)
+            {
+                const SmallFilesConfig hConfig = { eStrategy, nThreads, SMALL_BATCH };
+
+                SmallFilesStats hStats = {};
+                const bool bOk = ScanSmallFileTree(pRoot, hConfig, &hStats);
+                PrintStats(SmallFilesStrategyName(eStrategy), nThreads, bOk, hStats);
+            }
+        }
+    }
+
+    SmallFilesStats hDelete = {};
+    const bool bDeleted = DeleteSmallFileTree(pRoot, nMaxThreads, &hDelete);
+    PrintStats("Delete", nMaxThreads, bDeleted, hDelete);
+}
+
+static void PrintLatency(const char* pName, const char* pOutPath, const LatencyHistogram& hLatency)
+{
+    constexpr double NS_PER_US = 1000.0;
+
+    std::cout << pName
+        << " | p50 " << static_cast<double>(hLatency.ValueAtPercentile(50.0)) / NS_PER_US << " us"
+        << " | p99 " << static_cast<double>(hLatency.ValueAtPercentile(99.0)) / NS_PER_US << " us"
+        << " | p99.9 " << static_cast<double>(hLatency.ValueAtPercentile(99.9)) / NS_PER_US << " us"
+        << " | max " << static_cast<double>(hLatency.GetMax()) / NS_PER_US << " us"
+        << " | " << hLatency.GetCount() << " ops"
+        << (hLatency.WritePercentiles(pOutPath) ? " -> " : " (write failed) ") << pOutPath << "\n";
+}
+
+/*
+    Per-call latency of the read loops above. The averages from BenchmarkQPC
+    hide the tail: a random ReadFile is mostly a cached copy, with rare calls
+    stalling on a page fault or the file system lock. Every histogram is also
+    written as .hgrm for the HdrHistogram plotter.
+
+    The multi-threaded run records into one histogram per thread, without any
+    shared state on the hot path, and merges them once the threads are done.
+*/
+static void Bench_OperationLatency(const char* path)
+{
+    {
+        LatencyHistogram hLatency;
+        Test_fread(path, &hLatency);
+        PrintLatency("fread", "latency_fread.hgrm", hLatency);
+    }
+
+    {
+        LatencyHistogram hLatency;
+        Test_ReadFile_Seq(path, &hLatency);
+        PrintLatency("ReadFile (sequential)", "latency_readfile_seq.hgrm", hLatency);
+    }
+
+    {
+        LatencyHistogram hLatency;
+        Test_ReadFile_Rand(path, &hLatency);
+        PrintLatency("ReadFile (Random)", "latency_readfile_rand.hgrm", hLatency);
+    }
+
+    {
+        LatencyHistogram hLatency;
+        Test_Mapping_Rand(path, MAP_HINT_DEFAULT, &hLatency);
+        PrintLatency("Memory Mapping (default)", "latency_mapping_default.hgrm", hLatency);
+    }
+
+    {
+        LatencyHistogram hLatency;
+        Test_Mapping_Rand(path, MAP_HINT_POPULATE, &hLatency);
+        PrintLatency("Memory Mapping (populate)", "latency_mapping_populate.hgrm", hLatency);
+    }
+
+    const size_t nThreads = max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+
+    std::vector<LatencyHistogram> vLatency(nThreads);
+    std::vector<std::thread> vThreads;
+    for (size_t i = 0; i < nThreads; ++i)
+    {
+        vThreads.emplace_back([&vLatency, i, path] ()
+        {
+            Test_ReadFile_Rand(path, &vLatency[i], static_cast<unsigned>(1234 + i));
+        });
+    }
+
+    LatencyHistogram hMerged;
+    for (size_t i = 0; i < nThreads; ++i)
+    {
+        vThreads[i].join();
+        hMerged.Merge(vLatency[i]);
+    }
+
+    const std::string sName = "ReadFile (Random, " + std::to_string(nThreads) + " threads merged)";
+    PrintLatency(sName.c_str(), "latency_readfile_rand_mt.hgrm", hMerged);
 }
 
 int main()
 {
     static const char* path = "test_file.bin";
 
+    static const char* write_path = "test_write.bin";
+
     std::cout << "Generating file...\n";
-    GenerateFile(path);
+    auto BenchMark_Generate = [] ()
+    {
+        GenerateFile(path);
+    };
+
+    std::cout << "GenerateFile (buffered, no flush): " << BenchmarkQPC(BenchMark_Generate) << " ms\n";
 
     std::cout << "\n--- Sequential Read ---\n";
 
@@ -141,18 +931,59 @@ int main()
         Test_ReadFile_Rand(path);
     };
 
-    auto BenchMark_MemMapping = [] ()
-    {
-        Test_Mapping_Rand(path);
-    };
-
     std::cout << "fread: " << BenchmarkQPC(BenchMark_fread) << " ms\n";
     std::cout << "ReadFile (sequential): " << BenchmarkQPC(BenchMark_ReadFileSeq) << " ms\n";
 
     std::cout << "\n--- Random Access ---\n";
 
     std::cout << "ReadFile (Random): " << BenchmarkQPC(BenchMark_ReadFileRand) << " ms\n";
-    std::cout << "Memory Mapping (random): " << BenchmarkQPC(BenchMark_MemMapping) << " ms\n";
+
+    /*
+        Page faults are counted around the whole run (open + map + hints + loop).
+        Right after GenerateFile the data sits in the file cache, so almost every
+        fault is soft; hard faults only show up with a cold standby list.
+    */
+    std::cout << "\n--- Memory Mapping (random) access hints ---\n";
+    for (const MapHintCase& hCase : hMapHintCases)
+    {
+        auto BenchMark_MemMapping = [&hCase] ()
+        {
+            Test_Mapping_Rand(path, hCase.dwHints);
+        };
+
+        const FaultSnapshot hBefore = CaptureFaults();
+        const double dTime = BenchmarkQPC(BenchMark_MemMapping);
+        const FaultSnapshot hFaults = FaultDelta(hBefore, CaptureFaults());
+
+        std::cout << "Memory Mapping (" << hCase.pName << "): " << dTime << " ms"
+            << " | faults: " << hFaults.qwTotal
+            << " (soft " << hFaults.qwTotal - hFaults.qwHard
+            << ", hard " << hFaults.qwHard << ")\n";
+    }
+
+    std::cout << "\n--- Per-operation latency ---\n";
+    Bench_OperationLatency(path);
+
+    std::cout << "\n--- Batched Gather (populated mapping) ---\n";
+    Bench_Gather(path);
+
+    std::cout << "\n--- Parallel Range Scan ---\n";
+    Bench_ParallelScan(path);
+
+    std::cout << "\n--- Userspace Block Cache (unbuffered read-through) ---\n";
+    Bench_BlockCache(path);
+
+    std::cout << "\n--- Compressed Read Pipeline ---\n";
+    Bench_CompressedRead("test_logs.bin", "test_logs.lzb");
+
+    std::cout << "\n--- Write Path Strategies ---\n";
+    Bench_WriteStrategies(write_path);
+
+    std::cout << "\n--- Write-Ahead Log (group commit) ---\n";
+    Bench_WriteAheadLog("test_wal.log");
+
+    std::cout << "\n--- Many Small Files (metadata) ---\n";
+    Bench_SmallFiles("test_small_files");
 
     std::cout << "\n--- Cleaning Test File --- \n";
     DeleteFileA(path);
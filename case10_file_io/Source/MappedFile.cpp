@@ -0,0 +1,204 @@
+#include "MappedFile.h"
+
+static volatile unsigned char gbPopulateSink = 0;
+
+/*
+    SEC_LARGE_PAGES / MEM_LARGE_PAGES require SeLockMemoryPrivilege to be granted
+    to the account (secpol.msc -> Local Policies -> User Rights Assignment ->
+    "Lock pages in memory") AND enabled in the process token. Granting it is an
+    administrative decision; enabling it is done here.
+*/
+bool EnableLockMemoryPrivilege()
+{
+    HANDLE hToken = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken))
+    {
+        return false;
+    }
+
+    TOKEN_PRIVILEGES hPrivileges = {};
+    hPrivileges.PrivilegeCount = 1;
+    hPrivileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+    if (!LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &hPrivileges.Privileges[0].Luid))
+    {
+        CloseHandle(hToken);
+        return false;
+    }
+
+    //AdjustTokenPrivileges returns TRUE even if the privilege is not held, check the last error
+    const BOOL bAdjusted = AdjustTokenPrivileges(hToken, FALSE, &hPrivileges, 0, nullptr, nullptr);
+    const bool bEnabled = bAdjusted && GetLastError() == ERROR_SUCCESS;
+
+    CloseHandle(hToken);
+    return bEnabled;
+}
+
+MappedFile::MappedFile()
+{
+    this->hFile = INVALID_HANDLE_VALUE;
+    this->hMap = nullptr;
+    this->pData = nullptr;
+    this->nSize = 0;
+    this->bLargePages = false;
+}
+
+MappedFile::~MappedFile()
+{
+    this->Close();
+}
+
+/*
+    A file-backed section cannot use large pages, only pagefile-backed ones can.
+    This is the Windows counterpart of "put the index on tmpfs/hugetlbfs": the
+    file is copied once into anonymous large-page memory and then served from it.
+*/
+static char* MapLargePageCopy(HANDLE hFile, size_t nFileSize, HANDLE* phMap)
+{
+    const SIZE_T nLargePage = GetLargePageMinimum();
+    if (!nLargePage || !EnableLockMemoryPrivilege())
+    {
+        return nullptr;
+    }
+
+    const ULONGLONG qwSectionSize = (static_cast<ULONGLONG>(nFileSize) + nLargePage - 1) & ~static_cast<ULONGLONG>(nLargePage - 1);
+
+    HANDLE hMap = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES, static_cast<DWORD>(qwSectionSize >> 32), static_cast<DWORD>(qwSectionSize), nullptr);
+    if (!hMap)
+    {
+        return nullptr;
+    }
+
+    char* pView = reinterpret_cast<char*>(MapViewOfFile(hMap, FILE_MAP_READ | FILE_MAP_WRITE | FILE_MAP_LARGE_PAGES, 0, 0, 0));
+    if (!pView)
+    {
+        CloseHandle(hMap);
+        return nullptr;
+    }
+
+    constexpr DWORD COPY_CHUNK = 1024 * 1024;
+
+    size_t nCopied = 0;
+    DWORD dwRead = 0;
+    while (nCopied < nFileSize)
+    {
+        const DWORD dwToRead = static_cast<DWORD>(min(nFileSize - nCopied, static_cast<size_t>(COPY_CHUNK)));
+        if (!ReadFile(hFile, pView + nCopied, dwToRead, &dwRead, nullptr) || !dwRead)
+        {
+            UnmapViewOfFile(pView);
+            CloseHandle(hMap);
+            return nullptr;
+        }
+
+        nCopied += dwRead;
+    }
+
+    *phMap = hMap;
+    return pView;
+}
+
+bool MappedFile::Open(const char* path, DWORD dwHints)
+{
+    this->Close();
+
+    DWORD dwFlags = FILE_ATTRIBUTE_NORMAL;
+    if (dwHints & MAP_HINT_RANDOM)
+    {
+        dwFlags |= FILE_FLAG_RANDOM_ACCESS;
+    }
+    else if (dwHints & MAP_HINT_SEQUENTIAL)
+    {
+        dwFlags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+
+    this->hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, dwFlags, nullptr);
+    if (this->hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER liSize = {};
+    if (!GetFileSizeEx(this->hFile, &liSize) || !liSize.QuadPart)
+    {
+        this->Close();
+        return false;
+    }
+
+    this->nSize = static_cast<size_t>(liSize.QuadPart);
+
+    if (dwHints & MAP_HINT_LARGE_PAGES)
+    {
+        this->pData = MapLargePageCopy(this->hFile, this->nSize, &this->hMap);
+        this->bLargePages = this->pData != nullptr;
+    }
+
+    //Regular file-backed view (also the fallback when large pages are not available)
+    if (!this->pData)
+    {
+        this->hMap = CreateFileMappingA(this->hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!this->hMap)
+        {
+            this->Close();
+            return false;
+        }
+
+        this->pData = reinterpret_cast<char*>(MapViewOfFile(this->hMap, FILE_MAP_READ, 0, 0, 0));
+        if (!this->pData)
+        {
+            this->Close();
+            return false;
+        }
+    }
+
+    if (dwHints & (MAP_HINT_WILLNEED | MAP_HINT_POPULATE))
+    {
+        //Asynchronous read-ahead of the whole range in large I/Os, no PTEs are built yet
+        WIN32_MEMORY_RANGE_ENTRY hRange = {};
+        hRange.VirtualAddress = this->pData;
+        hRange.NumberOfBytes = this->nSize;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &hRange, 0);
+    }
+
+    if (dwHints & MAP_HINT_POPULATE)
+    {
+        //Take every fault now so the measured loop runs with a fully built page table
+        SYSTEM_INFO hSysInfo = {};
+        GetSystemInfo(&hSysInfo);
+
+        const size_t nStride = this->bLargePages ? GetLargePageMinimum() : hSysInfo.dwPageSize;
+
+        unsigned char bAccumulator = 0;
+        for (size_t nOffset = 0; nOffset < this->nSize; nOffset += nStride)
+        {
+            bAccumulator ^= static_cast<unsigned char>(this->pData[nOffset]);
+        }
+
+        gbPopulateSink = bAccumulator;
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (this->pData)
+    {
+        UnmapViewOfFile(this->pData);
+        this->pData = nullptr;
+    }
+
+    if (this->hMap)
+    {
+        CloseHandle(this->hMap);
+        this->hMap = nullptr;
+    }
+
+    if (this->hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(this->hFile);
+        this->hFile = INVALID_HANDLE_VALUE;
+    }
+
+    this->nSize = 0;
+    this->bLargePages = false;
+}
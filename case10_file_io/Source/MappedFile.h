@@ -0,0 +1,46 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Access hints for a read-only file mapping. They can be combined.
+
+    The names follow the Linux vocabulary (madvise / mmap flags / posix_fadvise)
+    since that is how these policies are usually discussed; each one is mapped
+    to its nearest Win32 equivalent:
+
+    MAP_HINT_RANDOM      -> FILE_FLAG_RANDOM_ACCESS   (MADV_RANDOM, POSIX_FADV_RANDOM)
+    MAP_HINT_SEQUENTIAL  -> FILE_FLAG_SEQUENTIAL_SCAN (MADV_SEQUENTIAL, POSIX_FADV_SEQUENTIAL)
+    MAP_HINT_WILLNEED    -> PrefetchVirtualMemory     (MADV_WILLNEED)
+    MAP_HINT_POPULATE    -> WILLNEED + touch of every page before returning (MAP_POPULATE)
+    MAP_HINT_LARGE_PAGES -> file copied into a pagefile-backed SEC_LARGE_PAGES section
+                            (MADV_HUGEPAGE on a tmpfs/THP-backed file)
+*/
+enum MapAccessHint : DWORD
+{
+    MAP_HINT_DEFAULT = 0,
+    MAP_HINT_RANDOM = 1 << 0,
+    MAP_HINT_SEQUENTIAL = 1 << 1,
+    MAP_HINT_WILLNEED = 1 << 2,
+    MAP_HINT_POPULATE = 1 << 3,
+    MAP_HINT_LARGE_PAGES = 1 << 4,
+};
+
+struct MappedFile
+{
+    HANDLE hFile;
+    HANDLE hMap;
+    char* pData;
+    size_t nSize;
+    bool bLargePages;
+
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* path, DWORD dwHints);
+    void Close();
+};
+
+bool EnableLockMemoryPrivilege();
@@ -0,0 +1,240 @@
+#include "RangeScanner.h"
+#include "Benchmark.h"
+#include <atomic>
+#include <thread>
+
+const char* ScanBackendName(ScanBackend eBackend)
+{
+    switch (eBackend)
+    {
+    case SCAN_BACKEND_READFILE:
+        return "ReadFile";
+    case SCAN_BACKEND_MAPPING:
+        return "Mapping";
+    case SCAN_BACKEND_NO_BUFFERING:
+        return "NoBuffering";
+    }
+
+    return "Unknown";
+}
+
+static size_t AlignUp(size_t nValue, size_t nAlignment)
+{
+    return (nValue + nAlignment - 1) / nAlignment * nAlignment;
+}
+
+static bool QueryFileSize(const char* path, ULONGLONG* pqwSize)
+{
+    HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER liSize = {};
+    const BOOL bResult = GetFileSizeEx(hFile, &liSize);
+    CloseHandle(hFile);
+
+    *pqwSize = static_cast<ULONGLONG>(liSize.QuadPart);
+    return bResult && liSize.QuadPart > 0;
+}
+
+/*
+    SCAN_ALIGNMENT (64 KB) is a multiple of every sector size in use and of the
+    allocation granularity, so ranges can be used as-is by the unbuffered
+    backend and as view offsets by the mapping backend.
+*/
+size_t CountScanRanges(const char* path, const ScanConfig& hConfig)
+{
+    ULONGLONG qwSize = 0;
+    if (!QueryFileSize(path, &qwSize))
+    {
+        return 0;
+    }
+
+    const size_t nRangeSize = AlignUp(max(hConfig.nRangeSize, SCAN_ALIGNMENT), SCAN_ALIGNMENT);
+    return static_cast<size_t>((qwSize + nRangeSize - 1) / nRangeSize);
+}
+
+struct ScanJob
+{
+    const char* path;
+    ScanConfig hConfig;
+    ScanChunkCallback Callback;
+    void* pContext;
+    ULONGLONG qwFileSize;
+    size_t nRangeSize;
+    size_t nRanges;
+    const char* pView;                  //Mapping backend only
+    std::atomic<size_t> nNextRange;
+    std::atomic<bool> bFailed;
+};
+
+static void ScanWorkerMapping(ScanJob* pJob)
+{
+    while (true)
+    {
+        const size_t nRange = pJob->nNextRange.fetch_add(1, std::memory_order_relaxed);
+        if (nRange >= pJob->nRanges)
+        {
+            break;
+        }
+
+        const ULONGLONG qwOffset = static_cast<ULONGLONG>(nRange) * pJob->nRangeSize;
+        const size_t nSize = static_cast<size_t>(min(static_cast<ULONGLONG>(pJob->nRangeSize), pJob->qwFileSize - qwOffset));
+
+        pJob->Callback(pJob->pContext, nRange, pJob->pView + qwOffset, nSize);
+    }
+}
+
+static void ScanWorkerRead(ScanJob* pJob)
+{
+    const bool bUnbuffered = pJob->hConfig.eBackend == SCAN_BACKEND_NO_BUFFERING;
+
+    /*
+        One handle per worker: I/O on a synchronous handle is serialized on its
+        file object, so a shared handle would turn the workers into a queue.
+    */
+    const DWORD dwFlags = bUnbuffered ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN;
+    HANDLE hFile = CreateFileA(pJob->path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, dwFlags, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        pJob->bFailed.store(true, std::memory_order_relaxed);
+        return;
+    }
+
+    //VirtualAlloc is page aligned, which satisfies any sector alignment
+    const size_t nChunkSize = AlignUp(max(pJob->hConfig.nChunkSize, static_cast<size_t>(4096)), 4096);
+    char* pBuffer = reinterpret_cast<char*>(VirtualAlloc(nullptr, nChunkSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!pBuffer)
+    {
+        CloseHandle(hFile);
+        pJob->bFailed.store(true, std::memory_order_relaxed);
+        return;
+    }
+
+    while (!pJob->bFailed.load(std::memory_order_relaxed))
+    {
+        const size_t nRange = pJob->nNextRange.fetch_add(1, std::memory_order_relaxed);
+        if (nRange >= pJob->nRanges)
+        {
+            break;
+        }
+
+        const ULONGLONG qwBegin = static_cast<ULONGLONG>(nRange) * pJob->nRangeSize;
+        const ULONGLONG qwEnd = min(qwBegin + pJob->nRangeSize, pJob->qwFileSize);
+
+        for (ULONGLONG qwOffset = qwBegin; qwOffset < qwEnd;)
+        {
+            //Unbuffered reads must be whole sectors; the tail of the file comes back short
+            const size_t nWanted = static_cast<size_t>(min(static_cast<ULONGLONG>(nChunkSize), qwEnd - qwOffset));
+            const DWORD dwToRead = static_cast<DWORD>(bUnbuffered ? AlignUp(nWanted, 4096) : nWanted);
+
+            OVERLAPPED hOverlapped = {};
+            hOverlapped.Offset = static_cast<DWORD>(qwOffset);
+            hOverlapped.OffsetHigh = static_cast<DWORD>(qwOffset >> 32);
+
+            DWORD dwRead = 0;
+            if (!ReadFile(hFile, pBuffer, dwToRead, &dwRead, &hOverlapped) || !dwRead)
+            {
+                pJob->bFailed.store(true, std::memory_order_relaxed);
+                break;
+            }
+
+            const size_t nUsable = min(static_cast<size_t>(dwRead), nWanted);
+            pJob->Callback(pJob->pContext, nRange, pBuffer, nUsable);
+            qwOffset += nUsable;
+        }
+    }
+
+    VirtualFree(pBuffer, 0, MEM_RELEASE);
+    CloseHandle(hFile);
+}
+
+bool ScanFileRanges(const char* path, const ScanConfig& hConfig, ScanChunkCallback Callback, void* pContext, ScanStats* pStats)
+{
+    ScanJob hJob;
+    hJob.path = path;
+    hJob.hConfig = hConfig;
+    hJob.Callback = Callback;
+    hJob.pContext = pContext;
+    hJob.qwFileSize = 0;
+    hJob.nRangeSize = AlignUp(max(hConfig.nRangeSize, SCAN_ALIGNMENT), SCAN_ALIGNMENT);
+    hJob.pView = nullptr;
+    hJob.nNextRange.store(0);
+    hJob.bFailed.store(false);
+
+    if (!QueryFileSize(path, &hJob.qwFileSize))
+    {
+        return false;
+    }
+
+    hJob.nRanges = static_cast<size_t>((hJob.qwFileSize + hJob.nRangeSize - 1) / hJob.nRangeSize);
+
+    HANDLE hFile = INVALID_HANDLE_VALUE;
+    HANDLE hMap = nullptr;
+    if (hConfig.eBackend == SCAN_BACKEND_MAPPING)
+    {
+        hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        hMap = hFile != INVALID_HANDLE_VALUE ? CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        hJob.pView = hMap ? reinterpret_cast<const char*>(MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+
+        if (!hJob.pView)
+        {
+            if (hMap)
+            {
+                CloseHandle(hMap);
+            }
+
+            if (hFile != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(hFile);
+            }
+
+            return false;
+        }
+    }
+
+    const size_t nThreads = min(max(hConfig.nThreads, static_cast<size_t>(1)), hJob.nRanges);
+
+    auto RunWorkers = [&] ()
+    {
+        std::vector<std::thread> vWorkers;
+        vWorkers.reserve(nThreads);
+
+        for (size_t i = 0; i < nThreads; ++i)
+        {
+            if (hConfig.eBackend == SCAN_BACKEND_MAPPING)
+            {
+                vWorkers.emplace_back(ScanWorkerMapping, &hJob);
+            }
+            else
+            {
+                vWorkers.emplace_back(ScanWorkerRead, &hJob);
+            }
+        }
+
+        for (std::thread& hWorker : vWorkers)
+        {
+            hWorker.join();
+        }
+    };
+
+    const double dMilliseconds = BenchmarkQPC(RunWorkers);
+
+    if (hJob.pView)
+    {
+        UnmapViewOfFile(hJob.pView);
+        CloseHandle(hMap);
+        CloseHandle(hFile);
+    }
+
+    if (pStats)
+    {
+        pStats->qwBytes = hJob.qwFileSize;
+        pStats->nRanges = hJob.nRanges;
+        pStats->dMilliseconds = dMilliseconds;
+    }
+
+    return !hJob.bFailed.load();
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <Windows.h>
+#include <type_traits>
+#include <vector>
+
+/*
+    Parallel range scanner.
+
+    The file is split into nRangeSize ranges (rounded up to the sector/page
+    alignment). nThreads workers pull range indexes from a shared counter, read
+    each range chunk by chunk through the selected backend and hand the chunks to
+    a user reducer. Results are kept per range and merged in range order, so a
+    non-commutative merge gives the same result as a single-threaded scan.
+*/
+enum ScanBackend
+{
+    SCAN_BACKEND_READFILE,      //ReadFile with an explicit offset (pread), one handle per worker
+    SCAN_BACKEND_MAPPING,       //One shared read-only view, the reducer gets the range in place
+    SCAN_BACKEND_NO_BUFFERING,  //FILE_FLAG_NO_BUFFERING (O_DIRECT), sector-aligned buffers and offsets
+};
+
+constexpr size_t SCAN_ALIGNMENT = 64 * 1024;
+
+struct ScanConfig
+{
+    ScanBackend eBackend;
+    size_t nThreads;
+    size_t nRangeSize;
+    size_t nChunkSize;  //Bytes per ReadFile call (ignored by the mapping backend)
+};
+
+struct ScanStats
+{
+    ULONGLONG qwBytes;
+    size_t nRanges;
+    double dMilliseconds;
+
+    double GigabytesPerSecond() const
+    {
+        return this->dMilliseconds > 0.0 ? static_cast<double>(this->qwBytes) / (this->dMilliseconds * 1'000'000.0) : 0.0;
+    }
+};
+
+//Called for every chunk of a range, in file order within that range
+typedef void (*ScanChunkCallback)(void* pContext, size_t nRange, const char* pData, size_t nSize);
+
+//Number of ranges the file is split into, 0 if it cannot be opened
+size_t CountScanRanges(const char* path, const ScanConfig& hConfig);
+
+bool ScanFileRanges(const char* path, const ScanConfig& hConfig, ScanChunkCallback Callback, void* pContext, ScanStats* pStats);
+
+const char* ScanBackendName(ScanBackend eBackend);
+
+/*
+    Reduce(Result& hAccumulator, const char* pData, size_t nSize)
+    Merge(Result& hTotal, const Result& hRange)
+*/
+template<typename Result, typename Reducer, typename Merger>
+Result ParallelScan(const char* path, const ScanConfig& hConfig, const Result& hInitial, Reducer&& Reduce, Merger&& Merge, ScanStats* pStats)
+{
+    struct Context
+    {
+        std::vector<Result>* pvResults;
+        std::remove_reference_t<Reducer>* pReduce;
+    };
+
+    auto OnChunk = [] (void* pContext, size_t nRange, const char* pData, size_t nSize)
+    {
+        Context* pCtx = reinterpret_cast<Context*>(pContext);
+        (*pCtx->pReduce)((*pCtx->pvResults)[nRange], pData, nSize);
+    };
+
+    //One slot per range, each one is only touched by the worker that owns the range
+    std::vector<Result> vResults(CountScanRanges(path, hConfig), hInitial);
+    if (vResults.empty())
+    {
+        return hInitial;
+    }
+
+    Context hContext = { &vResults, &Reduce };
+    if (!ScanFileRanges(path, hConfig, OnChunk, &hContext, pStats))
+    {
+        return hInitial;
+    }
+
+    Result hTotal = hInitial;
+    for (const Result& hRange : vResults)
+    {
+        Merge(hTotal, hRange);
+    }
+
+    return hTotal;
+}
@@ -0,0 +1,659 @@
+#include "SmallFiles.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr size_t SMALL_FILES_ENUM_BUFFER = 64 * 1024;
+constexpr size_t SMALL_FILES_READ_LIMIT = 64 * 1024;     //Larger files are only read up to this size
+
+const char* SmallFilesStrategyName(SmallFilesStrategy eStrategy)
+{
+    switch (eStrategy)
+    {
+    case SMALL_FILES_STAT_OPEN:
+        return "Stat (open per file)";
+    case SMALL_FILES_STAT_ENUM:
+        return "Stat (directory info)";
+    case SMALL_FILES_READ:
+        return "Read (open/read/close)";
+    case SMALL_FILES_READ_BATCHED:
+        return "Read (batched, IOCP)";
+    }
+
+    return "Unknown";
+}
+
+static double NowMilliseconds()
+{
+    LARGE_INTEGER liFrequency;
+    LARGE_INTEGER liNow;
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liNow);
+
+    return static_cast<double>(liNow.QuadPart) * 1000.0 / static_cast<double>(liFrequency.QuadPart);
+}
+
+template<typename Worker>
+static void RunWorkers(size_t nThreads, Worker&& Run)
+{
+    std::vector<std::thread> vThreads;
+    for (size_t i = 1; i < nThreads; ++i)
+    {
+        vThreads.emplace_back(Run, i);
+    }
+
+    Run(static_cast<size_t>(0));
+
+    for (std::thread& hThread : vThreads)
+    {
+        hThread.join();
+    }
+}
+
+static bool IsDotEntry(const char* pName)
+{
+    return pName[0] == '.' && (pName[1] == '\0' || (pName[1] == '.' && pName[2] == '\0'));
+}
+
+bool CreateSmallFileTree(const char* pRoot, size_t nDirectories, size_t nFilesPerDirectory, size_t nFileSize, size_t nThreads, SmallFilesStats* pStats)
+{
+    if (!CreateDirectoryA(pRoot, nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+    {
+        return false;
+    }
+
+    std::vector<char> vContent(max(nFileSize, static_cast<size_t>(1)));
+    for (size_t i = 0; i < vContent.size(); ++i)
+    {
+        vContent[i] = static_cast<char>('a' + i % 26);
+    }
+
+    std::atomic<size_t> nNextDirectory = 0;
+    std::atomic<ULONGLONG> qwFiles = 0;
+    std::atomic<bool> bFailed = false;
+
+    const double dStart = NowMilliseconds();
+
+    RunWorkers(max(nThreads, static_cast<size_t>(1)), [&] (size_t)
+    {
+        char pPath[MAX_PATH];
+
+        for (size_t nDirectory = nNextDirectory++; nDirectory < nDirectories && !bFailed; nDirectory = nNextDirectory++)
+        {
+            snprintf(pPath, sizeof(pPath), "%s\\d%04zu", pRoot, nDirectory);
+            if (!CreateDirectoryA(pPath, nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+            {
+                bFailed = true;
+                return;
+            }
+
+            for (size_t nFile = 0; nFile < nFilesPerDirectory; ++nFile)
+            {
+                snprintf(pPath, sizeof(pPath), "%s\\d%04zu\\f%05zu.bin", pRoot, nDirectory, nFile);
+
+                HANDLE hFile = CreateFileA(pPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (hFile == INVALID_HANDLE_VALUE)
+                {
+                    bFailed = true;
+                    return;
+                }
+
+                DWORD dwWritten = 0;
+                const bool bWritten = !nFileSize || (WriteFile(hFile, vContent.data(), static_cast<DWORD>(nFileSize), &dwWritten, nullptr) && dwWritten == nFileSize);
+                CloseHandle(hFile);
+
+                if (!bWritten)
+                {
+                    bFailed = true;
+                    return;
+                }
+            }
+
+            qwFiles += nFilesPerDirectory;
+        }
+    });
+
+    if (pStats)
+    {
+        pStats->qwFiles = qwFiles;
+        pStats->qwDirectories = min(static_cast<ULONGLONG>(nNextDirectory), static_cast<ULONGLONG>(nDirectories));
+        pStats->qwBytes = qwFiles * nFileSize;
+        pStats->dMilliseconds = NowMilliseconds() - dStart;
+    }
+
+    return !bFailed;
+}
+
+//Depth-first, single thread: files first, then the directory itself
+static bool DeleteDirectory(const std::string& sPath, ULONGLONG* pqwFiles)
+{
+    WIN32_FIND_DATAA hData;
+    HANDLE hFind = FindFirstFileExA((sPath + "\\*").c_str(), FindExInfoBasic, &hData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    bool bResult = true;
+    do
+    {
+        if (IsDotEntry(hData.cFileName))
+        {
+            continue;
+        }
+
+        const std::string sChild = sPath + "\\" + hData.cFileName;
+        if (hData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            bResult = DeleteDirectory(sChild, pqwFiles) && bResult;
+        }
+        else if (DeleteFileA(sChild.c_str()))
+        {
+            ++*pqwFiles;
+        }
+        else
+        {
+            bResult = false;
+        }
+    }
+    while (FindNextFileA(hFind, &hData));
+
+    FindClose(hFind);
+
+    return RemoveDirectoryA(sPath.c_str()) && bResult;
+}
+
+bool DeleteSmallFileTree(const char* pRoot, size_t nThreads, SmallFilesStats* pStats)
+{
+    const double dStart = NowMilliseconds();
+
+    //The top-level directories are split between the workers, each one deletes its subtrees
+    std::vector<std::string> vDirectories;
+    ULONGLONG qwRootFiles = 0;
+    bool bResult = true;
+
+    WIN32_FIND_DATAA hData;
+    HANDLE hFind = FindFirstFileExA((std::string(pRoot) + "\\*").c_str(), FindExInfoBasic, &hData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    do
+    {
+        if (IsDotEntry(hData.cFileName))
+        {
+            continue;
+        }
+
+        const std::string sChild = std::string(pRoot) + "\\" + hData.cFileName;
+        if (hData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            vDirectories.push_back(sChild);
+        }
+        else if (DeleteFileA(sChild.c_str()))
+        {
+            ++qwRootFiles;
+        }
+        else
+        {
+            bResult = false;
+        }
+    }
+    while (FindNextFileA(hFind, &hData));
+
+    FindClose(hFind);
+
+    std::atomic<size_t> nNextDirectory = 0;
+    std::atomic<ULONGLONG> qwFiles = qwRootFiles;
+    std::atomic<bool> bFailed = !bResult;
+
+    RunWorkers(max(nThreads, static_cast<size_t>(1)), [&] (size_t)
+    {
+        ULONGLONG qwLocal = 0;
+        for (size_t i = nNextDirectory++; i < vDirectories.size(); i = nNextDirectory++)
+        {
+            if (!DeleteDirectory(vDirectories[i], &qwLocal))
+            {
+                bFailed = true;
+            }
+        }
+
+        qwFiles += qwLocal;
+    });
+
+    if (!RemoveDirectoryA(pRoot))
+    {
+        bFailed = true;
+    }
+
+    if (pStats)
+    {
+        pStats->qwFiles = qwFiles;
+        pStats->qwDirectories = vDirectories.size() + 1;
+        pStats->qwBytes = 0;
+        pStats->dMilliseconds = NowMilliseconds() - dStart;
+    }
+
+    return !bFailed;
+}
+
+struct SmallFileEntry
+{
+    std::string sPath;
+    ULONGLONG qwSize;
+};
+
+/*
+    Directories waiting to be scanned. nBusy counts the workers that are still
+    enumerating a directory (and may push more), so an empty stack only ends
+    the walk once nBusy is 0 as well.
+*/
+struct WalkQueue
+{
+    SRWLOCK hLock;
+    CONDITION_VARIABLE cvPending;
+    std::vector<std::string> vPending;
+    size_t nBusy;
+
+    void Push(std::string sPath)
+    {
+        AcquireSRWLockExclusive(&this->hLock);
+        this->vPending.push_back(std::move(sPath));
+        ReleaseSRWLockExclusive(&this->hLock);
+
+        WakeConditionVariable(&this->cvPending);
+    }
+
+    //false once the whole tree has been handed out and every worker is idle
+    bool Pop(std::string* pPath)
+    {
+        AcquireSRWLockExclusive(&this->hLock);
+
+        while (this->vPending.empty() && this->nBusy)
+        {
+            SleepConditionVariableSRW(&this->cvPending, &this->hLock, INFINITE, 0);
+        }
+
+        if (this->vPending.empty())
+        {
+            ReleaseSRWLockExclusive(&this->hLock);
+            WakeAllConditionVariable(&this->cvPending);
+            return false;
+        }
+
+        *pPath = std::move(this->vPending.back());
+        this->vPending.pop_back();
+        ++this->nBusy;
+
+        ReleaseSRWLockExclusive(&this->hLock);
+        return true;
+    }
+
+    void Done()
+    {
+        AcquireSRWLockExclusive(&this->hLock);
+        const bool bLast = --this->nBusy == 0 && this->vPending.empty();
+        ReleaseSRWLockExclusive(&this->hLock);
+
+        if (bLast)
+        {
+            WakeAllConditionVariable(&this->cvPending);
+        }
+    }
+};
+
+struct ScanWorker
+{
+    const SmallFilesConfig* pConfig;
+    WalkQueue* pQueue;
+
+    std::vector<ULONGLONG> vEnumBuffer;     //8-byte aligned FILE_FULL_DIR_INFO entries
+    std::vector<SmallFileEntry> vFiles;
+    char* pReadBuffers;                     //nBatch slots of SMALL_FILES_READ_LIMIT bytes
+    HANDLE hPort;
+
+    ULONGLONG qwFiles;
+    ULONGLONG qwDirectories;
+    ULONGLONG qwBytes;
+    bool bFailed;
+};
+
+//FindFirstFileEx for the names, then one open per file for the metadata
+static void StatByOpen(ScanWorker& hWorker, const std::string& sDirectory)
+{
+    WIN32_FIND_DATAA hData;
+    HANDLE hFind = FindFirstFileExA((sDirectory + "\\*").c_str(), FindExInfoBasic, &hData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        hWorker.bFailed = true;
+        return;
+    }
+
+    do
+    {
+        if (IsDotEntry(hData.cFileName))
+        {
+            continue;
+        }
+
+        const std::string sChild = sDirectory + "\\" + hData.cFileName;
+        if (hData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            hWorker.pQueue->Push(sChild);
+            continue;
+        }
+
+        HANDLE hFile = CreateFileA(sChild.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            hWorker.bFailed = true;
+            continue;
+        }
+
+        BY_HANDLE_FILE_INFORMATION hInfo;
+        if (GetFileInformationByHandle(hFile, &hInfo))
+        {
+            hWorker.qwBytes += (static_cast<ULONGLONG>(hInfo.nFileSizeHigh) << 32) | hInfo.nFileSizeLow;
+            ++hWorker.qwFiles;
+        }
+        else
+        {
+            hWorker.bFailed = true;
+        }
+
+        CloseHandle(hFile);
+    }
+    while (FindNextFileA(hFind, &hData));
+
+    FindClose(hFind);
+}
+
+//Names, sizes and times of a whole directory, SMALL_FILES_ENUM_BUFFER bytes of entries per call
+static void EnumerateDirectory(ScanWorker& hWorker, const std::string& sDirectory, bool bKeepFiles)
+{
+    HANDLE hDirectory = CreateFileA(sDirectory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (hDirectory == INVALID_HANDLE_VALUE)
+    {
+        hWorker.bFailed = true;
+        return;
+    }
+
+    char pName[MAX_PATH * 4];
+    const DWORD dwBufferSize = static_cast<DWORD>(hWorker.vEnumBuffer.size() * sizeof(ULONGLONG));
+
+    for (FILE_INFO_BY_HANDLE_CLASS eClass = FileFullDirectoryRestartInfo;
+        GetFileInformationByHandleEx(hDirectory, eClass, hWorker.vEnumBuffer.data(), dwBufferSize);
+        eClass = FileFullDirectoryInfo)
+    {
+        const char* pEntry = reinterpret_cast<const char*>(hWorker.vEnumBuffer.data());
+        while (true)
+        {
+            const FILE_FULL_DIR_INFO* pInfo = reinterpret_cast<const FILE_FULL_DIR_INFO*>(pEntry);
+
+            const int nName = WideCharToMultiByte(CP_ACP, 0, pInfo->FileName, static_cast<int>(pInfo->FileNameLength / sizeof(WCHAR)), pName, sizeof(pName) - 1, nullptr, nullptr);
+            pName[nName] = '\0';
+
+            if (!IsDotEntry(pName))
+            {
+                if (pInfo->FileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                {
+                    hWorker.pQueue->Push(sDirectory + "\\" + pName);
+                }
+                else if (bKeepFiles)
+                {
+                    hWorker.vFiles.push_back({ sDirectory + "\\" + pName, static_cast<ULONGLONG>(pInfo->EndOfFile.QuadPart) });
+                }
+                else
+                {
+                    hWorker.qwBytes += static_cast<ULONGLONG>(pInfo->EndOfFile.QuadPart);
+                    ++hWorker.qwFiles;
+                }
+            }
+
+            if (!pInfo->NextEntryOffset)
+            {
+                break;
+            }
+
+            pEntry += pInfo->NextEntryOffset;
+        }
+    }
+
+    if (GetLastError() != ERROR_NO_MORE_FILES)
+    {
+        hWorker.bFailed = true;
+    }
+
+    CloseHandle(hDirectory);
+}
+
+static void ReadFiles(ScanWorker& hWorker)
+{
+    for (const SmallFileEntry& hEntry : hWorker.vFiles)
+    {
+        HANDLE hFile = CreateFileA(hEntry.sPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            hWorker.bFailed = true;
+            continue;
+        }
+
+        DWORD dwRead = 0;
+        const DWORD dwSize = static_cast<DWORD>(min(hEntry.qwSize, static_cast<ULONGLONG>(SMALL_FILES_READ_LIMIT)));
+        if (!dwSize || ReadFile(hFile, hWorker.pReadBuffers, dwSize, &dwRead, nullptr))
+        {
+            hWorker.qwBytes += dwRead;
+            ++hWorker.qwFiles;
+        }
+        else
+        {
+            hWorker.bFailed = true;
+        }
+
+        CloseHandle(hFile);
+    }
+}
+
+/*
+    nBatch files at a time: every read is in flight before the first
+    completion is reaped, so the device sees the whole batch at once instead
+    of one request per open/read/close round trip.
+*/
+static void ReadFilesBatched(ScanWorker& hWorker)
+{
+    const size_t nBatch = max(hWorker.pConfig->nBatch, static_cast<size_t>(1));
+
+    std::vector<HANDLE> vHandles(nBatch);
+    std::vector<OVERLAPPED> vOverlapped(nBatch);
+    std::vector<OVERLAPPED_ENTRY> vEntries(nBatch);
+
+    for (size_t nFirst = 0; nFirst < hWorker.vFiles.size(); nFirst += nBatch)
+    {
+        const size_t nCount = min(nBatch, hWorker.vFiles.size() - nFirst);
+        ULONG nIssued = 0;
+
+        for (size_t i = 0; i < nCount; ++i)
+        {
+            const SmallFileEntry& hEntry = hWorker.vFiles[nFirst + i];
+
+            vHandles[i] = CreateFileA(hEntry.sPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (vHandles[i] == INVALID_HANDLE_VALUE)
+            {
+                hWorker.bFailed = true;
+                continue;
+            }
+
+            const DWORD dwSize = static_cast<DWORD>(min(hEntry.qwSize, static_cast<ULONGLONG>(SMALL_FILES_READ_LIMIT)));
+            if (!dwSize)
+            {
+                ++hWorker.qwFiles;
+                continue;
+            }
+
+            if (!CreateIoCompletionPort(vHandles[i], hWorker.hPort, i, 0))
+            {
+                hWorker.bFailed = true;
+                continue;
+            }
+
+            //A read that completes synchronously still queues its completion packet
+            vOverlapped[i] = {};
+            if (ReadFile(vHandles[i], hWorker.pReadBuffers + i * SMALL_FILES_READ_LIMIT, dwSize, nullptr, &vOverlapped[i]) || GetLastError() == ERROR_IO_PENDING)
+            {
+                ++nIssued;
+            }
+            else
+            {
+                hWorker.bFailed = true;
+            }
+        }
+
+        while (nIssued)
+        {
+            ULONG nRemoved = 0;
+            if (!GetQueuedCompletionStatusEx(hWorker.hPort, vEntries.data(), nIssued, &nRemoved, INFINITE, FALSE))
+            {
+                hWorker.bFailed = true;
+                break;
+            }
+
+            for (ULONG i = 0; i < nRemoved; ++i)
+            {
+                DWORD dwRead = 0;
+                if (GetOverlappedResult(vHandles[vEntries[i].lpCompletionKey], vEntries[i].lpOverlapped, &dwRead, FALSE))
+                {
+                    hWorker.qwBytes += dwRead;
+                    ++hWorker.qwFiles;
+                }
+                else
+                {
+                    hWorker.bFailed = true;
+                }
+            }
+
+            nIssued -= nRemoved;
+        }
+
+        for (size_t i = 0; i < nCount; ++i)
+        {
+            if (vHandles[i] != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(vHandles[i]);
+            }
+        }
+    }
+}
+
+bool ScanSmallFileTree(const char* pRoot, const SmallFilesConfig& hConfig, SmallFilesStats* pStats)
+{
+    const size_t nThreads = max(hConfig.nThreads, static_cast<size_t>(1));
+    const size_t nBatch = max(hConfig.nBatch, static_cast<size_t>(1));
+
+    WalkQueue hQueue;
+    InitializeSRWLock(&hQueue.hLock);
+    InitializeConditionVariable(&hQueue.cvPending);
+    hQueue.vPending.push_back(pRoot);
+    hQueue.nBusy = 0;
+
+    std::vector<ScanWorker> vWorkers(nThreads);
+    for (ScanWorker& hWorker : vWorkers)
+    {
+        hWorker.pConfig = &hConfig;
+        hWorker.pQueue = &hQueue;
+        hWorker.vEnumBuffer.resize(SMALL_FILES_ENUM_BUFFER / sizeof(ULONGLONG));
+        hWorker.pReadBuffers = nullptr;
+        hWorker.hPort = nullptr;
+        hWorker.qwFiles = 0;
+        hWorker.qwDirectories = 0;
+        hWorker.qwBytes = 0;
+        hWorker.bFailed = false;
+
+        if (hConfig.eStrategy == SMALL_FILES_READ || hConfig.eStrategy == SMALL_FILES_READ_BATCHED)
+        {
+            const size_t nSlots = hConfig.eStrategy == SMALL_FILES_READ_BATCHED ? nBatch : 1;
+            hWorker.pReadBuffers = static_cast<char*>(VirtualAlloc(nullptr, nSlots * SMALL_FILES_READ_LIMIT, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+            hWorker.bFailed = !hWorker.pReadBuffers;
+        }
+
+        if (hConfig.eStrategy == SMALL_FILES_READ_BATCHED)
+        {
+            hWorker.hPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+            hWorker.bFailed = hWorker.bFailed || !hWorker.hPort;
+        }
+    }
+
+    const double dStart = NowMilliseconds();
+
+    RunWorkers(nThreads, [&] (size_t nThread)
+    {
+        ScanWorker& hWorker = vWorkers[nThread];
+        if (hWorker.bFailed)
+        {
+            return;
+        }
+
+        std::string sDirectory;
+        while (hQueue.Pop(&sDirectory))
+        {
+            ++hWorker.qwDirectories;
+
+            switch (hConfig.eStrategy)
+            {
+            case SMALL_FILES_STAT_OPEN:
+                StatByOpen(hWorker, sDirectory);
+                break;
+            case SMALL_FILES_STAT_ENUM:
+                EnumerateDirectory(hWorker, sDirectory, false);
+                break;
+            case SMALL_FILES_READ:
+                hWorker.vFiles.clear();
+                EnumerateDirectory(hWorker, sDirectory, true);
+                ReadFiles(hWorker);
+                break;
+            case SMALL_FILES_READ_BATCHED:
+                hWorker.vFiles.clear();
+                EnumerateDirectory(hWorker, sDirectory, true);
+                ReadFilesBatched(hWorker);
+                break;
+            }
+
+            hQueue.Done();
+        }
+    });
+
+    const double dElapsed = NowMilliseconds() - dStart;
+
+    SmallFilesStats hTotal = {};
+    bool bResult = true;
+
+    for (ScanWorker& hWorker : vWorkers)
+    {
+        hTotal.qwFiles += hWorker.qwFiles;
+        hTotal.qwDirectories += hWorker.qwDirectories;
+        hTotal.qwBytes += hWorker.qwBytes;
+        bResult = bResult && !hWorker.bFailed;
+
+        if (hWorker.pReadBuffers)
+        {
+            VirtualFree(hWorker.pReadBuffers, 0, MEM_RELEASE);
+        }
+
+        if (hWorker.hPort)
+        {
+            CloseHandle(hWorker.hPort);
+        }
+    }
+
+    hTotal.dMilliseconds = dElapsed;
+
+    if (pStats)
+    {
+        *pStats = hTotal;
+    }
+
+    return bResult;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Metadata-heavy workloads: trees of many small files.
+
+    Tree layout: pRoot\dNNNN\fNNNNN.bin, nDirectories x nFilesPerDirectory
+    files of nFileSize bytes.
+
+    Scans walk the tree with nThreads workers sharing a stack of directories:
+    a worker pops a directory, enumerates it, pushes its subdirectories and
+    handles its files. The Linux calls each strategy stands for are in
+    parentheses:
+
+    SMALL_FILES_STAT_OPEN       FindFirstFileEx names, then open + GetFileInformationByHandle
+                                + close for every file (getdents64, then openat + fstat + close)
+    SMALL_FILES_STAT_ENUM       GetFileInformationByHandleEx(FileFullDirectoryInfo): size and
+                                times come back with the names, 64 KB of entries per call,
+                                no file is opened (getdents64 + batched statx)
+    SMALL_FILES_READ            STAT_ENUM enumeration, then open + ReadFile + close per file
+    SMALL_FILES_READ_BATCHED    STAT_ENUM enumeration, then for nBatch files at a time: open
+                                them all overlapped, queue every read on one completion port,
+                                reap the completions in bulk, close them all (io_uring
+                                batched openat/read/close; the opens and closes stay
+                                synchronous on Windows, only the reads are batched)
+*/
+enum SmallFilesStrategy
+{
+    SMALL_FILES_STAT_OPEN,
+    SMALL_FILES_STAT_ENUM,
+    SMALL_FILES_READ,
+    SMALL_FILES_READ_BATCHED,
+};
+
+struct SmallFilesConfig
+{
+    SmallFilesStrategy eStrategy;
+    size_t nThreads;
+    size_t nBatch;      //SMALL_FILES_READ_BATCHED only
+};
+
+struct SmallFilesStats
+{
+    ULONGLONG qwFiles;
+    ULONGLONG qwDirectories;
+    ULONGLONG qwBytes;      //File sizes for the stat strategies, bytes read for the others
+    double dMilliseconds;
+
+    double FilesPerSecond() const
+    {
+        return this->dMilliseconds > 0.0 ? static_cast<double>(this->qwFiles) * 1000.0 / this->dMilliseconds : 0.0;
+    }
+};
+
+//Directories are split between nThreads workers
+bool CreateSmallFileTree(const char* pRoot, size_t nDirectories, size_t nFilesPerDirectory, size_t nFileSize, size_t nThreads, SmallFilesStats* pStats);
+
+bool ScanSmallFileTree(const char* pRoot, const SmallFilesConfig& hConfig, SmallFilesStats* pStats);
+
+bool DeleteSmallFileTree(const char* pRoot, size_t nThreads, SmallFilesStats* pStats);
+
+const char* SmallFilesStrategyName(SmallFilesStrategy eStrategy);
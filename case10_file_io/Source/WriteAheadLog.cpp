@@ -0,0 +1,483 @@
+#include "WriteAheadLog.h"
+#include <cstring>
+#include <vector>
+
+struct WalRecordHeader
+{
+    UINT32 dwSize;
+    UINT32 dwCrc;
+    ULONGLONG qwSequence;
+};
+
+static_assert(sizeof(WalRecordHeader) == 16, "The frame header is part of the file format");
+
+constexpr size_t WAL_RECORD_ALIGNMENT = 8;
+constexpr size_t WAL_REPLAY_WINDOW = 1024 * 1024;
+
+static size_t FrameSize(size_t nPayload)
+{
+    return sizeof(WalRecordHeader) + ((nPayload + WAL_RECORD_ALIGNMENT - 1) & ~(WAL_RECORD_ALIGNMENT - 1));
+}
+
+//CRC32C (Castagnoli, reflected 0x82F63B78), one table lookup per byte
+UINT32 Crc32c(UINT32 dwCrc, const void* pData, size_t nSize)
+{
+    static const struct Table
+    {
+        UINT32 pValues[256];
+
+        Table()
+        {
+            for (UINT32 i = 0; i < 256; ++i)
+            {
+                UINT32 dwValue = i;
+                for (int nBit = 0; nBit < 8; ++nBit)
+                {
+                    dwValue = (dwValue & 1) ? (dwValue >> 1) ^ 0x82F63B78u : dwValue >> 1;
+                }
+
+                this->pValues[i] = dwValue;
+            }
+        }
+    } hTable;
+
+    const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+
+    dwCrc = ~dwCrc;
+    for (size_t i = 0; i < nSize; ++i)
+    {
+        dwCrc = hTable.pValues[(dwCrc ^ pBytes[i]) & 0xFF] ^ (dwCrc >> 8);
+    }
+
+    return ~dwCrc;
+}
+
+static UINT32 RecordCrc(const WalRecordHeader& hHeader, const void* pPayload)
+{
+    UINT32 dwCrc = Crc32c(0, &hHeader.dwSize, sizeof(hHeader.dwSize));
+    dwCrc = Crc32c(dwCrc, &hHeader.qwSequence, sizeof(hHeader.qwSequence));
+    return Crc32c(dwCrc, pPayload, hHeader.dwSize);
+}
+
+static bool WriteAll(HANDLE hFile, const char* pData, size_t nSize)
+{
+    DWORD dwWritten = 0;
+    return WriteFile(hFile, pData, static_cast<DWORD>(nSize), &dwWritten, nullptr) && dwWritten == nSize;
+}
+
+static double NowMilliseconds()
+{
+    LARGE_INTEGER liFrequency;
+    LARGE_INTEGER liNow;
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liNow);
+
+    return static_cast<double>(liNow.QuadPart) * 1000.0 / static_cast<double>(liFrequency.QuadPart);
+}
+
+WriteAheadLog::WriteAheadLog()
+{
+    this->hFile = INVALID_HANDLE_VALUE;
+    this->hConfig = {};
+
+    InitializeSRWLock(&this->srwLock);
+    InitializeConditionVariable(&this->cvDurable);
+    InitializeConditionVariable(&this->cvBatch);
+
+    this->pActive = nullptr;
+    this->pSpare = nullptr;
+    this->nActiveBytes = 0;
+
+    this->qwNextSequence = 1;
+    this->qwAppendedLsn = 0;
+    this->qwDurableLsn = 0;
+    this->bFlushing = false;
+    this->bRoomWanted = false;
+    this->dwError = 0;
+
+    this->hStats = {};
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    this->Close();
+}
+
+bool WriteAheadLog::Open(const char* path, const WalConfig& hWalConfig)
+{
+    if (this->hFile != INVALID_HANDLE_VALUE || hWalConfig.nBufferSize < FrameSize(0) || hWalConfig.nBufferSize > 0x7FFFFFFF)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+
+    this->hFile = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (this->hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    if (hWalConfig.nPreallocate)
+    {
+        //Reserves the clusters without moving the end of file: replay still sees exactly the written bytes
+        FILE_ALLOCATION_INFO hAllocation = {};
+        hAllocation.AllocationSize.QuadPart = static_cast<LONGLONG>(hWalConfig.nPreallocate);
+        SetFileInformationByHandle(this->hFile, FileAllocationInfo, &hAllocation, sizeof(hAllocation));
+    }
+
+    this->pActive = static_cast<char*>(VirtualAlloc(nullptr, hWalConfig.nBufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    this->pSpare = static_cast<char*>(VirtualAlloc(nullptr, hWalConfig.nBufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (!this->pActive || !this->pSpare)
+    {
+        const DWORD dwLastError = GetLastError();
+        this->Close();
+        SetLastError(dwLastError);
+        return false;
+    }
+
+    this->hConfig = hWalConfig;
+    this->hConfig.nFlushBytes = min(max(hWalConfig.nFlushBytes, static_cast<size_t>(1)), hWalConfig.nBufferSize);
+
+    this->nActiveBytes = 0;
+    this->qwNextSequence = 1;
+    this->qwAppendedLsn = 0;
+    this->qwDurableLsn = 0;
+    this->bFlushing = false;
+    this->bRoomWanted = false;
+    this->dwError = 0;
+    this->hStats = {};
+
+    return true;
+}
+
+bool WriteAheadLog::Close()
+{
+    bool bResult = true;
+
+    if (this->hFile != INVALID_HANDLE_VALUE)
+    {
+        if (this->pActive && this->pSpare)
+        {
+            AcquireSRWLockShared(&this->srwLock);
+            const ULONGLONG qwLsn = this->qwAppendedLsn;
+            ReleaseSRWLockShared(&this->srwLock);
+
+            bResult = this->Commit(qwLsn);
+        }
+
+        CloseHandle(this->hFile);
+        this->hFile = INVALID_HANDLE_VALUE;
+    }
+
+    if (this->pActive)
+    {
+        VirtualFree(this->pActive, 0, MEM_RELEASE);
+        this->pActive = nullptr;
+    }
+
+    if (this->pSpare)
+    {
+        VirtualFree(this->pSpare, 0, MEM_RELEASE);
+        this->pSpare = nullptr;
+    }
+
+    return bResult;
+}
+
+/*
+    Called with the lock held and bFlushing claimed by the caller. The batch
+    buffer is swapped out before the lock is dropped, so appends continue into
+    the spare while the write and the flush are in flight.
+*/
+bool WriteAheadLog::FlushLocked()
+{
+    char* pBatch = this->pActive;
+    const size_t nBatch = this->nActiveBytes;
+    const ULONGLONG qwBatchLsn = this->qwAppendedLsn;
+
+    this->pActive = this->pSpare;
+    this->pSpare = pBatch;
+    this->nActiveBytes = 0;
+    this->bRoomWanted = false;
+
+    //Appenders that ran out of room can fill the new buffer now
+    WakeAllConditionVariable(&this->cvDurable);
+
+    ReleaseSRWLockExclusive(&this->srwLock);
+
+    const bool bOk = WriteAll(this->hFile, pBatch, nBatch) && FlushFileBuffers(this->hFile);
+    const DWORD dwLastError = bOk ? 0 : GetLastError();
+
+    AcquireSRWLockExclusive(&this->srwLock);
+
+    if (bOk)
+    {
+        this->qwDurableLsn = qwBatchLsn;
+        this->hStats.qwFlushes++;
+        this->hStats.qwBytes += nBatch;
+    }
+    else if (!this->dwError)
+    {
+        this->dwError = dwLastError;
+    }
+
+    this->bFlushing = false;
+    WakeAllConditionVariable(&this->cvDurable);
+
+    return bOk;
+}
+
+void WriteAheadLog::ReserveRoomLocked(size_t nFrame)
+{
+    while (this->nActiveBytes + nFrame > this->hConfig.nBufferSize && !this->dwError)
+    {
+        if (!this->bFlushing)
+        {
+            //Nobody is flushing: flush the full buffer without waiting for the interval
+            this->bFlushing = true;
+            this->FlushLocked();
+            continue;
+        }
+
+        //Cut the leader's batch wait short, then wait for the swap
+        this->bRoomWanted = true;
+        WakeAllConditionVariable(&this->cvBatch);
+        SleepConditionVariableSRW(&this->cvDurable, &this->srwLock, INFINITE, 0);
+    }
+}
+
+bool WriteAheadLog::Append(const void* pData, size_t nSize, ULONGLONG* pLsn)
+{
+    const size_t nFrame = FrameSize(nSize);
+    if (this->hFile == INVALID_HANDLE_VALUE || nFrame > this->hConfig.nBufferSize)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return false;
+    }
+
+    AcquireSRWLockExclusive(&this->srwLock);
+
+    this->ReserveRoomLocked(nFrame);
+
+    if (this->dwError)
+    {
+        const DWORD dwLastError = this->dwError;
+        ReleaseSRWLockExclusive(&this->srwLock);
+        SetLastError(dwLastError);
+        return false;
+    }
+
+    WalRecordHeader hHeader = {};
+    hHeader.dwSize = static_cast<UINT32>(nSize);
+    hHeader.qwSequence = this->qwNextSequence++;
+    hHeader.dwCrc = RecordCrc(hHeader, pData);
+
+    char* pFrame = this->pActive + this->nActiveBytes;
+    memcpy(pFrame, &hHeader, sizeof(hHeader));
+    memcpy(pFrame + sizeof(hHeader), pData, nSize);
+    memset(pFrame + sizeof(hHeader) + nSize, 0, nFrame - sizeof(hHeader) - nSize);
+
+    this->nActiveBytes += nFrame;
+    this->qwAppendedLsn += nFrame;
+    this->hStats.qwRecords++;
+
+    *pLsn = this->qwAppendedLsn;
+
+    bool bResult = true;
+    if (this->hConfig.eMode == WAL_COMMIT_PER_RECORD)
+    {
+        //Baseline: write + flush this record alone, with the lock held so records stay in order
+        bResult = WriteAll(this->hFile, this->pActive, this->nActiveBytes) && FlushFileBuffers(this->hFile);
+        if (bResult)
+        {
+            this->qwDurableLsn = this->qwAppendedLsn;
+            this->hStats.qwFlushes++;
+            this->hStats.qwBytes += this->nActiveBytes;
+        }
+        else
+        {
+            this->dwError = GetLastError();
+        }
+
+        this->nActiveBytes = 0;
+    }
+    else if (this->nActiveBytes >= this->hConfig.nFlushBytes)
+    {
+        WakeConditionVariable(&this->cvBatch);
+    }
+
+    ReleaseSRWLockExclusive(&this->srwLock);
+    return bResult;
+}
+
+bool WriteAheadLog::Commit(ULONGLONG qwLsn)
+{
+    AcquireSRWLockExclusive(&this->srwLock);
+
+    while (this->qwDurableLsn < qwLsn && !this->dwError)
+    {
+        if (this->bFlushing)
+        {
+            //Follower: the running flush may already cover qwLsn, otherwise the next leader takes it
+            SleepConditionVariableSRW(&this->cvDurable, &this->srwLock, INFINITE, 0);
+            continue;
+        }
+
+        //Leader: give the other committers the flush interval to join the batch
+        this->bFlushing = true;
+
+        if (this->hConfig.dwFlushIntervalMs)
+        {
+            //Sleeps are rounded up to the timer resolution (~15.6 ms unless raised with timeBeginPeriod)
+            const double dDeadline = NowMilliseconds() + static_cast<double>(this->hConfig.dwFlushIntervalMs);
+            while (this->nActiveBytes < this->hConfig.nFlushBytes && !this->bRoomWanted)
+            {
+                const double dRemaining = dDeadline - NowMilliseconds();
+                if (dRemaining <= 0.0)
+                {
+                    break;
+                }
+
+                SleepConditionVariableSRW(&this->cvBatch, &this->srwLock, static_cast<DWORD>(dRemaining) + 1, 0);
+            }
+        }
+
+        this->FlushLocked();
+    }
+
+    const bool bResult = this->qwDurableLsn >= qwLsn;
+    const DWORD dwLastError = this->dwError;
+
+    ReleaseSRWLockExclusive(&this->srwLock);
+
+    if (!bResult)
+    {
+        SetLastError(dwLastError);
+    }
+
+    return bResult;
+}
+
+WalStats WriteAheadLog::GetStats() const
+{
+    AcquireSRWLockShared(&this->srwLock);
+    const WalStats hResult = this->hStats;
+    ReleaseSRWLockShared(&this->srwLock);
+
+    return hResult;
+}
+
+bool ReplayWriteAheadLog(const char* path, WalRecordCallback Callback, void* pContext, WalReplayStats* pStats)
+{
+    HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER liSize = {};
+    if (!GetFileSizeEx(hFile, &liSize))
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    const ULONGLONG qwFileSize = static_cast<ULONGLONG>(liSize.QuadPart);
+
+    std::vector<char> vWindow(WAL_REPLAY_WINDOW);
+    size_t nBegin = 0;
+    size_t nEnd = 0;
+    ULONGLONG qwOffset = 0;         //File offset of vWindow[nBegin]
+    bool bResult = true;
+
+    //Makes nNeeded bytes available from nBegin, moving the tail to the front and growing the window if needed
+    auto Fill = [&] (size_t nNeeded) -> bool
+    {
+        if (nEnd - nBegin >= nNeeded)
+        {
+            return true;
+        }
+
+        if (qwOffset + nNeeded > qwFileSize)
+        {
+            return false;
+        }
+
+        memmove(vWindow.data(), vWindow.data() + nBegin, nEnd - nBegin);
+        nEnd -= nBegin;
+        nBegin = 0;
+
+        if (vWindow.size() < nNeeded)
+        {
+            vWindow.resize(nNeeded);
+        }
+
+        while (nEnd < nNeeded)
+        {
+            DWORD dwRead = 0;
+            if (!ReadFile(hFile, vWindow.data() + nEnd, static_cast<DWORD>(vWindow.size() - nEnd), &dwRead, nullptr))
+            {
+                bResult = false;
+                return false;
+            }
+
+            if (!dwRead)
+            {
+                return false;
+            }
+
+            nEnd += dwRead;
+        }
+
+        return true;
+    };
+
+    ULONGLONG qwRecords = 0;
+    ULONGLONG qwExpected = 1;
+
+    while (Fill(sizeof(WalRecordHeader)))
+    {
+        WalRecordHeader hHeader;
+        memcpy(&hHeader, vWindow.data() + nBegin, sizeof(hHeader));
+
+        if (hHeader.qwSequence != qwExpected)
+        {
+            break;
+        }
+
+        const size_t nFrame = FrameSize(hHeader.dwSize);
+        if (!Fill(nFrame))
+        {
+            break;
+        }
+
+        const char* pPayload = vWindow.data() + nBegin + sizeof(hHeader);
+        if (RecordCrc(hHeader, pPayload) != hHeader.dwCrc)
+        {
+            break;
+        }
+
+        if (Callback)
+        {
+            Callback(pContext, hHeader.qwSequence, pPayload, hHeader.dwSize);
+        }
+
+        nBegin += nFrame;
+        qwOffset += nFrame;
+        ++qwExpected;
+        ++qwRecords;
+    }
+
+    CloseHandle(hFile);
+
+    if (pStats)
+    {
+        pStats->qwRecords = qwRecords;
+        pStats->qwValidBytes = qwOffset;
+        pStats->qwFileSize = qwFileSize;
+        pStats->bTornTail = qwOffset < qwFileSize;
+    }
+
+    return bResult;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Append-only write-ahead log with group commit.
+
+    Record frame (8-byte aligned):
+    [UINT32 size][UINT32 crc][ULONGLONG sequence][payload][padding]
+
+    The CRC32C covers size, sequence and payload. Sequences start at 1 and
+    grow by one, so replay stops at the first frame that is torn (short or
+    bad CRC) or stale (sequence out of order), which is where a crash cut the log.
+
+    Append copies the frame into the shared active buffer and returns its LSN
+    (the log offset right after it). Commit(LSN) waits until the LSN is
+    durable. A committer that finds no flush in progress becomes the leader:
+    it waits up to dwFlushIntervalMs for the batch to reach nFlushBytes, swaps
+    the active buffer with the spare, then issues one WriteFile + FlushFileBuffers
+    (write + fdatasync) for the whole batch outside the lock, while appends
+    keep filling the other buffer. Waiters whose LSN the batch covered are
+    woken together.
+
+    WAL_COMMIT_PER_RECORD is the baseline: every Append writes and flushes its
+    own record under the lock, one flush per record.
+*/
+enum WalCommitMode
+{
+    WAL_COMMIT_GROUP,
+    WAL_COMMIT_PER_RECORD,
+};
+
+struct WalConfig
+{
+    WalCommitMode eMode;
+    size_t nBufferSize;         //Bytes per buffer (two are allocated), bounds the largest record
+    size_t nFlushBytes;         //The leader flushes as soon as the batch reaches this size...
+    DWORD dwFlushIntervalMs;    //...or after waiting this long for it (0: flush right away)
+    size_t nPreallocate;        //FileAllocationInfo at open (fallocate), 0 for none
+};
+
+struct WalStats
+{
+    ULONGLONG qwRecords;
+    ULONGLONG qwFlushes;
+    ULONGLONG qwBytes;
+
+    double RecordsPerFlush() const
+    {
+        return this->qwFlushes ? static_cast<double>(this->qwRecords) / static_cast<double>(this->qwFlushes) : 0.0;
+    }
+};
+
+class WriteAheadLog
+{
+public:
+    WriteAheadLog();
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    //Creates (or truncates) the log at path
+    bool Open(const char* path, const WalConfig& hWalConfig);
+
+    //Commits whatever is still buffered, then closes the file
+    bool Close();
+
+    bool Append(const void* pData, size_t nSize, ULONGLONG* pLsn);
+    bool Commit(ULONGLONG qwLsn);
+
+    bool AppendDurable(const void* pData, size_t nSize)
+    {
+        ULONGLONG qwLsn = 0;
+        return this->Append(pData, nSize, &qwLsn) && this->Commit(qwLsn);
+    }
+
+    WalStats GetStats() const;
+
+private:
+    bool FlushLocked();
+    void ReserveRoomLocked(size_t nFrame);
+
+    HANDLE hFile;
+    WalConfig hConfig;
+
+    mutable SRWLOCK srwLock;
+    CONDITION_VARIABLE cvDurable;   //A flush finished (or a buffer was freed)
+    CONDITION_VARIABLE cvBatch;     //The batch reached nFlushBytes or an appender ran out of room
+
+    char* pActive;
+    char* pSpare;
+    size_t nActiveBytes;
+
+    ULONGLONG qwNextSequence;
+    ULONGLONG qwAppendedLsn;
+    ULONGLONG qwDurableLsn;
+    bool bFlushing;
+    bool bRoomWanted;               //An appender waits for the swap, the leader stops waiting for the batch
+    DWORD dwError;                  //First write/flush error; the log refuses further work after it
+
+    WalStats hStats;
+};
+
+struct WalReplayStats
+{
+    ULONGLONG qwRecords;
+    ULONGLONG qwValidBytes;     //Offset of the end of the last valid record
+    ULONGLONG qwFileSize;
+    bool bTornTail;             //Bytes follow the last valid record (a write cut short by a crash)
+};
+
+typedef void (*WalRecordCallback)(void* pContext, ULONGLONG qwSequence, const char* pData, size_t nSize);
+
+//Calls Callback for every valid record in order, stops at the first torn or stale frame
+bool ReplayWriteAheadLog(const char* path, WalRecordCallback Callback, void* pContext, WalReplayStats* pStats);
+
+UINT32 Crc32c(UINT32 dwCrc, const void* pData, size_t nSize);
@@ -0,0 +1,371 @@
+#include "WriteBenchmark.h"
+#include "LatencyHistogram.h"
+#include <vector>
+
+const char* WriteStrategyName(WriteStrategy eStrategy)
+{
+    switch (eStrategy)
+    {
+    case WRITE_BUFFERED:
+        return "Buffered";
+    case WRITE_PREALLOCATED:
+        return "Preallocated";
+    case WRITE_UNBUFFERED:
+        return "NoBuffering";
+    case WRITE_GATHER:
+        return "WriteFileGather";
+    case WRITE_ASYNC_QUEUE:
+        return "Async queue (IOCP)";
+    case WRITE_THROUGH:
+        return "WriteThrough";
+    }
+
+    return "Unknown";
+}
+
+constexpr size_t WRITE_PAGE_SIZE = 4096;
+
+//Per-call write latency, recorded into a LatencyHistogram (fixed memory, no sort)
+struct LatencyLog
+{
+    LatencyHistogram hHistogram;
+
+    LONGLONG Now() const
+    {
+        return static_cast<LONGLONG>(LatencyClock::Now());
+    }
+
+    void Record(LONGLONG llStart)
+    {
+        this->hHistogram.Record(LatencyClock::ToNanoseconds(static_cast<ULONGLONG>(this->Now() - llStart)));
+    }
+
+    double Percentile(double dPercentile) const
+    {
+        return static_cast<double>(this->hHistogram.ValueAtPercentile(dPercentile)) / 1000.0;
+    }
+};
+
+static DWORD CreationFlags(WriteStrategy eStrategy)
+{
+    switch (eStrategy)
+    {
+    case WRITE_UNBUFFERED:
+        return FILE_FLAG_NO_BUFFERING;
+    case WRITE_GATHER:
+    case WRITE_ASYNC_QUEUE:
+        //WriteFileGather requires both; the queue needs unbuffered I/O to stay asynchronous
+        return FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED;
+    case WRITE_THROUGH:
+        return FILE_FLAG_WRITE_THROUGH;
+    default:
+        return FILE_ATTRIBUTE_NORMAL;
+    }
+}
+
+/*
+    NTFS completes writes that extend the valid data length synchronously, even
+    on an overlapped handle. Setting the end of file first (and, with
+    SeManageVolumePrivilege, the valid data length) keeps the queue asynchronous.
+*/
+static bool ExtendFile(HANDLE hFile, size_t nFileSize, bool bValidData)
+{
+    LARGE_INTEGER liSize = {};
+    liSize.QuadPart = static_cast<LONGLONG>(nFileSize);
+
+    if (!SetFilePointerEx(hFile, liSize, nullptr, FILE_BEGIN) || !SetEndOfFile(hFile))
+    {
+        return false;
+    }
+
+    if (bValidData)
+    {
+        //Fails without SeManageVolumePrivilege: the first pass then zero-fills behind the writes
+        SetFileValidData(hFile, liSize.QuadPart);
+    }
+
+    liSize.QuadPart = 0;
+    return SetFilePointerEx(hFile, liSize, nullptr, FILE_BEGIN) != FALSE;
+}
+
+static bool WriteSequential(HANDLE hFile, const WriteConfig& hConfig, const char* pBuffer, LatencyLog& hLog)
+{
+    size_t nWritten = 0;
+    size_t nSinceFlush = 0;
+
+    while (nWritten < hConfig.nFileSize)
+    {
+        const DWORD dwToWrite = static_cast<DWORD>(min(hConfig.nWriteSize, hConfig.nFileSize - nWritten));
+
+        const LONGLONG llStart = hLog.Now();
+
+        DWORD dwWritten = 0;
+        if (!WriteFile(hFile, pBuffer, dwToWrite, &dwWritten, nullptr) || dwWritten != dwToWrite)
+        {
+            return false;
+        }
+
+        nWritten += dwWritten;
+        nSinceFlush += dwWritten;
+
+        if (hConfig.nFlushInterval && nSinceFlush >= hConfig.nFlushInterval)
+        {
+            FlushFileBuffers(hFile);
+            nSinceFlush = 0;
+        }
+
+        hLog.Record(llStart);
+    }
+
+    return true;
+}
+
+static bool WriteGathered(HANDLE hFile, const WriteConfig& hConfig, char* pPages, size_t nPages, LatencyLog& hLog)
+{
+    //One segment per page, terminated by a null element
+    std::vector<FILE_SEGMENT_ELEMENT> vSegments(nPages + 1);
+
+    //The pages are taken in reverse order so the gather really has to collect them
+    for (size_t i = 0; i < nPages; ++i)
+    {
+        vSegments[i].Buffer = pPages + (nPages - 1 - i) * WRITE_PAGE_SIZE;
+    }
+
+    vSegments[nPages].Buffer = nullptr;
+
+    HANDLE hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    size_t nWritten = 0;
+    size_t nSinceFlush = 0;
+    bool bResult = true;
+
+    while (nWritten < hConfig.nFileSize)
+    {
+        const DWORD dwToWrite = static_cast<DWORD>(min(nPages * WRITE_PAGE_SIZE, hConfig.nFileSize - nWritten));
+
+        OVERLAPPED hOverlapped = {};
+        hOverlapped.Offset = static_cast<DWORD>(nWritten);
+        hOverlapped.OffsetHigh = static_cast<DWORD>(static_cast<ULONGLONG>(nWritten) >> 32);
+        hOverlapped.hEvent = hEvent;
+
+        const LONGLONG llStart = hLog.Now();
+
+        DWORD dwWritten = 0;
+        if (!WriteFileGather(hFile, vSegments.data(), dwToWrite, nullptr, &hOverlapped) && GetLastError() != ERROR_IO_PENDING)
+        {
+            bResult = false;
+            break;
+        }
+
+        if (!GetOverlappedResult(hFile, &hOverlapped, &dwWritten, TRUE) || dwWritten != dwToWrite)
+        {
+            bResult = false;
+            break;
+        }
+
+        nWritten += dwWritten;
+        nSinceFlush += dwWritten;
+
+        if (hConfig.nFlushInterval && nSinceFlush >= hConfig.nFlushInterval)
+        {
+            FlushFileBuffers(hFile);
+            nSinceFlush = 0;
+        }
+
+        hLog.Record(llStart);
+    }
+
+    CloseHandle(hEvent);
+    return bResult;
+}
+
+struct AsyncWriteSlot
+{
+    OVERLAPPED hOverlapped;
+    LONGLONG llSubmitted;
+    DWORD dwSize;
+};
+
+static bool WriteQueued(HANDLE hFile, const WriteConfig& hConfig, const char* pBuffer, LatencyLog& hLog)
+{
+    HANDLE hPort = CreateIoCompletionPort(hFile, nullptr, 0, 1);
+    if (!hPort)
+    {
+        return false;
+    }
+
+    const size_t nQueueDepth = max(hConfig.nQueueDepth, static_cast<size_t>(1));
+    std::vector<AsyncWriteSlot> vSlots(nQueueDepth);
+
+    size_t nNextOffset = 0;
+    size_t nInFlight = 0;
+    size_t nCompleted = 0;
+    size_t nSinceFlush = 0;
+    bool bResult = true;
+
+    //All slots write the same source buffer: the content does not matter, the queue depth does
+    auto Submit = [&] (AsyncWriteSlot& hSlot) -> bool
+    {
+        hSlot.dwSize = static_cast<DWORD>(min(hConfig.nWriteSize, hConfig.nFileSize - nNextOffset));
+        hSlot.hOverlapped = {};
+        hSlot.hOverlapped.Offset = static_cast<DWORD>(nNextOffset);
+        hSlot.hOverlapped.OffsetHigh = static_cast<DWORD>(static_cast<ULONGLONG>(nNextOffset) >> 32);
+        hSlot.llSubmitted = hLog.Now();
+
+        nNextOffset += hSlot.dwSize;
+
+        if (!WriteFile(hFile, pBuffer, hSlot.dwSize, nullptr, &hSlot.hOverlapped) && GetLastError() != ERROR_IO_PENDING)
+        {
+            return false;
+        }
+
+        ++nInFlight;
+        return true;
+    };
+
+    for (AsyncWriteSlot& hSlot : vSlots)
+    {
+        if (nNextOffset >= hConfig.nFileSize || !Submit(hSlot))
+        {
+            break;
+        }
+    }
+
+    while (nInFlight > 0)
+    {
+        DWORD dwTransferred = 0;
+        ULONG_PTR pKey = 0;
+        LPOVERLAPPED pOverlapped = nullptr;
+
+        const BOOL bOk = GetQueuedCompletionStatus(hPort, &dwTransferred, &pKey, &pOverlapped, INFINITE);
+
+        //A failed write still dequeues its packet; only a null OVERLAPPED means nothing came out
+        if (pOverlapped)
+        {
+            --nInFlight;
+        }
+
+        if (!bOk || !pOverlapped)
+        {
+            bResult = false;
+            break;
+        }
+
+        //OVERLAPPED is the first member of the slot
+        AsyncWriteSlot* pSlot = reinterpret_cast<AsyncWriteSlot*>(pOverlapped);
+        hLog.Record(pSlot->llSubmitted);
+
+        nCompleted += dwTransferred;
+        nSinceFlush += dwTransferred;
+
+        if (hConfig.nFlushInterval && nSinceFlush >= hConfig.nFlushInterval)
+        {
+            FlushFileBuffers(hFile);
+            nSinceFlush = 0;
+        }
+
+        if (nNextOffset < hConfig.nFileSize && !Submit(*pSlot))
+        {
+            bResult = false;
+            break;
+        }
+    }
+
+    //Drain whatever is still in flight after an error before the slots go away
+    while (nInFlight > 0)
+    {
+        DWORD dwTransferred = 0;
+        ULONG_PTR pKey = 0;
+        LPOVERLAPPED pOverlapped = nullptr;
+        GetQueuedCompletionStatus(hPort, &dwTransferred, &pKey, &pOverlapped, INFINITE);
+        if (!pOverlapped)
+        {
+            break;
+        }
+
+        --nInFlight;
+    }
+
+    CloseHandle(hPort);
+    return bResult && nCompleted == hConfig.nFileSize;
+}
+
+bool RunWriteStrategy(const char* path, const WriteConfig& hConfig, WriteResult* pResult)
+{
+    const bool bUnbuffered = hConfig.eStrategy == WRITE_UNBUFFERED || hConfig.eStrategy == WRITE_GATHER || hConfig.eStrategy == WRITE_ASYNC_QUEUE;
+    if (bUnbuffered && ((hConfig.nWriteSize % WRITE_PAGE_SIZE) != 0 || (hConfig.nFileSize % WRITE_PAGE_SIZE) != 0))
+    {
+        return false;
+    }
+
+    //Page-aligned source buffer, valid for every strategy
+    const size_t nPages = (hConfig.nWriteSize + WRITE_PAGE_SIZE - 1) / WRITE_PAGE_SIZE;
+    char* pBuffer = reinterpret_cast<char*>(VirtualAlloc(nullptr, nPages * WRITE_PAGE_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!pBuffer)
+    {
+        return false;
+    }
+
+    memset(pBuffer, 1, nPages * WRITE_PAGE_SIZE);
+
+    LatencyLog hLog;
+
+    bool bResult = false;
+
+    auto Run = [&] ()
+    {
+        HANDLE hFile = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, CreationFlags(hConfig.eStrategy), nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        switch (hConfig.eStrategy)
+        {
+        case WRITE_PREALLOCATED:
+        {
+            FILE_ALLOCATION_INFO hAllocation = {};
+            hAllocation.AllocationSize.QuadPart = static_cast<LONGLONG>(hConfig.nFileSize);
+            SetFileInformationByHandle(hFile, FileAllocationInfo, &hAllocation, sizeof(hAllocation));
+
+            bResult = WriteSequential(hFile, hConfig, pBuffer, hLog);
+            break;
+        }
+        case WRITE_GATHER:
+            bResult = ExtendFile(hFile, hConfig.nFileSize, true) && WriteGathered(hFile, hConfig, pBuffer, nPages, hLog);
+            break;
+        case WRITE_ASYNC_QUEUE:
+            bResult = ExtendFile(hFile, hConfig.nFileSize, true) && WriteQueued(hFile, hConfig, pBuffer, hLog);
+            break;
+        default:
+            bResult = WriteSequential(hFile, hConfig, pBuffer, hLog);
+            break;
+        }
+
+        //Durability point for every strategy: the file is only "written" once it is on the device
+        FlushFileBuffers(hFile);
+        CloseHandle(hFile);
+    };
+
+    LARGE_INTEGER liFrequency;
+    LARGE_INTEGER liStart;
+    LARGE_INTEGER liEnd;
+
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liStart);
+
+    Run();
+
+    QueryPerformanceCounter(&liEnd);
+
+    VirtualFree(pBuffer, 0, MEM_RELEASE);
+
+    pResult->dMilliseconds = static_cast<double>(liEnd.QuadPart - liStart.QuadPart) * 1000.0 / static_cast<double>(liFrequency.QuadPart);
+    pResult->nOperations = static_cast<size_t>(hLog.hHistogram.GetCount());
+    pResult->dP50 = hLog.Percentile(50.0);
+    pResult->dP99 = hLog.Percentile(99.0);
+    pResult->dP999 = hLog.Percentile(99.9);
+    pResult->dMax = static_cast<double>(hLog.hHistogram.GetMax()) / 1000.0;
+
+    return bResult;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Timed write strategies for a file of nFileSize bytes.
+
+    The Linux vocabulary is kept in the comments since that is how the
+    strategies are usually named; each one uses its Win32 counterpart:
+
+    WRITE_BUFFERED      WriteFile through the system cache (write)
+    WRITE_PREALLOCATED  FileAllocationInfo before writing (fallocate)
+    WRITE_UNBUFFERED    FILE_FLAG_NO_BUFFERING, page-aligned buffers (O_DIRECT)
+    WRITE_GATHER        WriteFileGather, one page per segment (pwritev)
+    WRITE_ASYNC_QUEUE   overlapped writes with a fixed queue depth reaped from an
+                        I/O completion port (io_uring submission/completion)
+    WRITE_THROUGH       FILE_FLAG_WRITE_THROUGH, every write is durable (O_DSYNC)
+
+    nFlushInterval adds a FlushFileBuffers (fdatasync / sync_file_range+wait)
+    every nFlushInterval bytes; 0 only flushes when the file is complete.
+*/
+enum WriteStrategy
+{
+    WRITE_BUFFERED,
+    WRITE_PREALLOCATED,
+    WRITE_UNBUFFERED,
+    WRITE_GATHER,
+    WRITE_ASYNC_QUEUE,
+    WRITE_THROUGH,
+};
+
+struct WriteConfig
+{
+    WriteStrategy eStrategy;
+    size_t nFileSize;
+    size_t nWriteSize;      //Bytes per write call (multiple of 4 KB for the unbuffered strategies)
+    size_t nFlushInterval;
+    size_t nQueueDepth;     //WRITE_ASYNC_QUEUE only
+};
+
+//Per-operation latency in microseconds (an operation is one write call, plus the flush it triggers)
+struct WriteResult
+{
+    double dMilliseconds;
+    size_t nOperations;
+    double dP50;
+    double dP99;
+    double dP999;
+    double dMax;
+
+    double MegabytesPerSecond(size_t nFileSize) const
+    {
+        return this->dMilliseconds > 0.0 ? static_cast<double>(nFileSize) / (1024.0 * 1024.0) / (this->dMilliseconds / 1000.0) : 0.0;
+    }
+};
+
+bool RunWriteStrategy(const char* path, const WriteConfig& hConfig, WriteResult* pResult);
+
+const char* WriteStrategyName(WriteStrategy eStrategy);
@@ -0,0 +1,572 @@
+#include "AllocProfiler.h"
+#include "AllocTrace.h"
+
+#if ALLOC_PROFILER
+
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <malloc.h>
+
+constexpr UINT32 ALLOC_PROFILER_MAX_REGIONS = 64;
+constexpr size_t ALLOC_PROFILER_HEADER_SIZE = 32;          //Keeps the 16-byte alignment of operator new
+constexpr size_t ALLOC_PROFILER_BUCKETS = 48;
+constexpr size_t ALLOC_PROFILER_STACK_DEPTH = 12;
+constexpr size_t ALLOC_PROFILER_MAX_STACKS = 256;           //Distinct sampled stacks per region
+constexpr UINT32 ALLOC_PROFILER_MAGIC = 0xA110CA7E;
+
+struct AllocHeader
+{
+	size_t nSize;
+	LONGLONG llTimestamp;       //QPC ticks
+	ULONGLONG qwTraceId;        //0 if allocated while no trace was recording
+	UINT32 nRegion;
+	UINT32 nMagic;
+};
+
+static_assert(sizeof(AllocHeader) <= ALLOC_PROFILER_HEADER_SIZE, "AllocHeader does not fit its slot");
+
+struct SampledStack
+{
+	ULONG dwHash;
+	USHORT nFrames;
+	void* pFrames[ALLOC_PROFILER_STACK_DEPTH];
+	ULONGLONG qwCount;
+	ULONGLONG qwBytes;
+};
+
+struct RegionStats
+{
+	const char* pName;
+	std::atomic<ULONGLONG> qwAllocs;
+	std::atomic<ULONGLONG> qwFrees;
+	std::atomic<ULONGLONG> qwBytesAllocated;
+	std::atomic<ULONGLONG> qwBytesFreed;
+	std::atomic<LONGLONG> llLiveBytes;
+	std::atomic<LONGLONG> llPeakLiveBytes;
+	std::atomic<ULONGLONG> pSizes[ALLOC_PROFILER_BUCKETS];          //[k]: sizes in (2^(k-1), 2^k]
+	std::atomic<ULONGLONG> pLifetimes[ALLOC_PROFILER_BUCKETS];      //[k]: lifetimes in (2^(k-1), 2^k] ns
+
+	SRWLOCK hStacksLock;
+	SampledStack pStacks[ALLOC_PROFILER_MAX_STACKS];
+	size_t nStacks;
+	ULONGLONG qwDroppedSamples;     //Samples whose stack did not fit the table
+};
+
+//Zero-initialized before any constructor runs, so allocations made during static initialization are recorded too
+static RegionStats gpRegions[ALLOC_PROFILER_MAX_REGIONS];
+static std::atomic<UINT32> gnRegionCount = 1;                   //Region 0 collects everything outside regions
+static std::atomic<UINT32> gnCurrentRegion = 0;
+static SRWLOCK ghRegionsLock = SRWLOCK_INIT;
+
+static std::atomic<bool> gbTracing = false;
+static AllocTraceEvent* gpTraceEvents = nullptr;
+static size_t gnTraceCapacity = 0;
+static std::atomic<size_t> gnTraceEvents = 0;
+static std::atomic<ULONGLONG> gqwTraceIds = 0;
+
+static size_t Bucket(ULONGLONG qwValue)
+{
+	return min(static_cast<size_t>(std::bit_width(qwValue ? qwValue - 1 : 0)), ALLOC_PROFILER_BUCKETS - 1);
+}
+
+static LONGLONG Now()
+{
+	LARGE_INTEGER liNow;
+	QueryPerformanceCounter(&liNow);
+	return liNow.QuadPart;
+}
+
+static ULONGLONG TicksToNanoseconds(LONGLONG llTicks)
+{
+	static const double dNanosecondsPerTick = []
+	{
+		LARGE_INTEGER liFrequency;
+		QueryPerformanceFrequency(&liFrequency);
+		return 1e9 / static_cast<double>(liFrequency.QuadPart);
+	}();
+
+	return static_cast<ULONGLONG>(static_cast<double>(llTicks) * dNanosecondsPerTick);
+}
+
+//------------------------------------------------------------
+// Recording
+//------------------------------------------------------------
+static void AppendTraceEvent(ULONGLONG qwId, size_t nSize, size_t nAlignment, LONGLONG llTimestamp, AllocTraceKind eKind)
+{
+	const size_t nEvent = gnTraceEvents.fetch_add(1, std::memory_order_relaxed);
+	if (nEvent >= gnTraceCapacity)
+	{
+		return;
+	}
+
+	AllocTraceEvent& hEvent = gpTraceEvents[nEvent];
+	hEvent.qwId = qwId;
+	hEvent.qwSize = nSize;
+	hEvent.llTimestamp = llTimestamp;
+	hEvent.nThread = static_cast<UINT32>(GetCurrentThreadId());
+	hEvent.nAlignmentLog2 = static_cast<UINT16>(std::countr_zero(nAlignment));
+	hEvent.eKind = static_cast<UINT16>(eKind);
+}
+
+static void RecordStack(RegionStats& hRegion, size_t nSize)
+{
+	void* pFrames[ALLOC_PROFILER_STACK_DEPTH];
+	ULONG dwHash = 0;
+
+	//Skips only this frame: how many profiler frames follow depends on what the optimizer inlined
+	const USHORT nFrames = CaptureStackBackTrace(1, ALLOC_PROFILER_STACK_DEPTH, pFrames, &dwHash);
+
+	AcquireSRWLockExclusive(&hRegion.hStacksLock);
+
+	size_t i = 0;
+	for (; i < hRegion.nStacks; i++)
+	{
+		SampledStack& hStack = hRegion.pStacks[i];
+		if (hStack.dwHash == dwHash && hStack.nFrames == nFrames && memcmp(hStack.pFrames, pFrames, nFrames * sizeof(void*)) == 0)
+		{
+			break;
+		}
+	}
+
+	if (i == hRegion.nStacks)
+	{
+		if (i == ALLOC_PROFILER_MAX_STACKS)
+		{
+			hRegion.qwDroppedSamples++;
+			ReleaseSRWLockExclusive(&hRegion.hStacksLock);
+			return;
+		}
+
+		SampledStack& hStack = hRegion.pStacks[hRegion.nStacks++];
+		hStack.dwHash = dwHash;
+		hStack.nFrames = nFrames;
+		memcpy(hStack.pFrames, pFrames, nFrames * sizeof(void*));
+	}
+
+	hRegion.pStacks[i].qwCount++;
+	hRegion.pStacks[i].qwBytes += nSize;
+
+	ReleaseSRWLockExclusive(&hRegion.hStacksLock);
+}
+
+static void RecordAlloc(AllocHeader* pHeader, size_t nSize, size_t nAlignment)
+{
+	const UINT32 nRegion = gnCurrentRegion.load(std::memory_order_relaxed);
+	RegionStats& hRegion = gpRegions[nRegion];
+
+	pHeader->nSize = nSize;
+	pHeader->llTimestamp = Now();
+	pHeader->nRegion = nRegion;
+	pHeader->nMagic = ALLOC_PROFILER_MAGIC;
+	pHeader->qwTraceId = 0;
+
+	if (gbTracing.load(std::memory_order_acquire))
+	{
+		pHeader->qwTraceId = gqwTraceIds.fetch_add(1, std::memory_order_relaxed) + 1;
+		AppendTraceEvent(pHeader->qwTraceId, nSize, nAlignment, pHeader->llTimestamp, ALLOC_TRACE_ALLOC);
+	}
+
+	const ULONGLONG qwIndex = hRegion.qwAllocs.fetch_add(1, std::memory_order_relaxed);
+	hRegion.qwBytesAllocated.fetch_add(nSize, std::memory_order_relaxed);
+	hRegion.pSizes[Bucket(nSize)].fetch_add(1, std::memory_order_relaxed);
+
+	const LONGLONG llLive = hRegion.llLiveBytes.fetch_add(static_cast<LONGLONG>(nSize), std::memory_order_relaxed) + static_cast<LONGLONG>(nSize);
+	LONGLONG llPeak = hRegion.llPeakLiveBytes.load(std::memory_order_relaxed);
+	while (llLive > llPeak && !hRegion.llPeakLiveBytes.compare_exchange_weak(llPeak, llLive, std::memory_order_relaxed))
+	{
+	}
+
+	if (qwIndex % ALLOC_PROFILER_SAMPLE_EVERY == 0)
+	{
+		RecordStack(hRegion, nSize);
+	}
+}
+
+//Frees are charged to the region of the allocation, wherever they happen
+static void RecordFree(AllocHeader* pHeader)
+{
+	RegionStats& hRegion = gpRegions[pHeader->nRegion];
+	const LONGLONG llNow = Now();
+
+	if (pHeader->qwTraceId && gbTracing.load(std::memory_order_acquire))
+	{
+		AppendTraceEvent(pHeader->qwTraceId, 0, 1, llNow, ALLOC_TRACE_FREE);
+	}
+
+	hRegion.qwFrees.fetch_add(1, std::memory_order_relaxed);
+	hRegion.qwBytesFreed.fetch_add(pHeader->nSize, std::memory_order_relaxed);
+	hRegion.llLiveBytes.fetch_sub(static_cast<LONGLONG>(pHeader->nSize), std::memory_order_relaxed);
+	hRegion.pLifetimes[Bucket(TicksToNanoseconds(llNow - pHeader->llTimestamp))].fetch_add(1, std::memory_order_relaxed);
+
+	pHeader->nMagic = 0;
+}
+
+//------------------------------------------------------------
+// Interposed allocation
+//------------------------------------------------------------
+//The header sits right before the block; over-aligned blocks put it at the end of an nAlignment-sized prefix
+static size_t PrefixFor(size_t nAlignment)
+{
+	return max(nAlignment, ALLOC_PROFILER_HEADER_SIZE);
+}
+
+static void* ProfiledAlloc(size_t nSize, size_t nAlignment)
+{
+	char* pRaw = nAlignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__
+		? reinterpret_cast<char*>(malloc(ALLOC_PROFILER_HEADER_SIZE + nSize))
+		: reinterpret_cast<char*>(_aligned_malloc(PrefixFor(nAlignment) + nSize, nAlignment));
+
+	if (!pRaw)
+	{
+		return nullptr;
+	}
+
+	char* pBlock = pRaw + (nAlignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? ALLOC_PROFILER_HEADER_SIZE : PrefixFor(nAlignment));
+	RecordAlloc(reinterpret_cast<AllocHeader*>(pBlock - ALLOC_PROFILER_HEADER_SIZE), nSize, max(nAlignment, static_cast<size_t>(__STDCPP_DEFAULT_NEW_ALIGNMENT__)));
+	return pBlock;
+}
+
+static void ProfiledFree(void* pPtr, size_t nAlignment)
+{
+	if (!pPtr)
+	{
+		return;
+	}
+
+	char* pBlock = reinterpret_cast<char*>(pPtr);
+	AllocHeader* pHeader = reinterpret_cast<AllocHeader*>(pBlock - ALLOC_PROFILER_HEADER_SIZE);
+	if (pHeader->nMagic == ALLOC_PROFILER_MAGIC)
+	{
+		RecordFree(pHeader);
+	}
+
+	if (nAlignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+	{
+		free(pBlock - ALLOC_PROFILER_HEADER_SIZE);
+	}
+	else
+	{
+		_aligned_free(pBlock - PrefixFor(nAlignment));
+	}
+}
+
+static void* ProfiledNew(size_t nSize, size_t nAlignment)
+{
+	void* pPtr = ProfiledAlloc(nSize, nAlignment);
+	if (!pPtr)
+	{
+		throw std::bad_alloc();
+	}
+
+	return pPtr;
+}
+
+void* operator new(size_t nSize)
+{
+	return ProfiledNew(nSize, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](size_t nSize)
+{
+	return ProfiledNew(nSize, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t nSize, const std::nothrow_t&) noexcept
+{
+	return ProfiledAlloc(nSize, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](size_t nSize, const std::nothrow_t&) noexcept
+{
+	return ProfiledAlloc(nSize, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t nSize, std::align_val_t eAlignment)
+{
+	return ProfiledNew(nSize, static_cast<size_t>(eAlignment));
+}
+
+void* operator new[](size_t nSize, std::align_val_t eAlignment)
+{
+	return ProfiledNew(nSize, static_cast<size_t>(eAlignment));
+}
+
+void* operator new(size_t nSize, std::align_val_t eAlignment, const std::nothrow_t&) noexcept
+{
+	return ProfiledAlloc(nSize, static_cast<size_t>(eAlignment));
+}
+
+void* operator new[](size_t nSize, std::align_val_t eAlignment, const std::nothrow_t&) noexcept
+{
+	return ProfiledAlloc(nSize, static_cast<size_t>(eAlignment));
+}
+
+void operator delete(void* pPtr) noexcept
+{
+	ProfiledFree(pPtr, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete[](void* pPtr) noexcept
+{
+	ProfiledFree(pPtr, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* pPtr, const std::nothrow_t&) noexcept
+{
+	ProfiledFree(pPtr, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete[](void* pPtr, const std::nothrow_t&) noexcept
+{
+	ProfiledFree(pPtr, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* pPtr, size_t) noexcept
+{
+	ProfiledFree(pPtr, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete[](void* pPtr, size_t) noexcept
+{
+	ProfiledFree(pPtr, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* pPtr, std::align_val_t eAlignment) noexcept
+{
+	ProfiledFree(pPtr, static_cast<size_t>(eAlignment));
+}
+
+void operator delete[](void* pPtr, std::align_val_t eAlignment) noexcept
+{
+	ProfiledFree(pPtr, static_cast<size_t>(eAlignment));
+}
+
+void operator delete(void* pPtr, std::align_val_t eAlignment, const std::nothrow_t&) noexcept
+{
+	ProfiledFree(pPtr, static_cast<size_t>(eAlignment));
+}
+
+void operator delete[](void* pPtr, std::align_val_t eAlignment, const std::nothrow_t&) noexcept
+{
+	ProfiledFree(pPtr, static_cast<size_t>(eAlignment));
+}
+
+void operator delete(void* pPtr, size_t, std::align_val_t eAlignment) noexcept
+{
+	ProfiledFree(pPtr, static_cast<size_t>(eAlignment));
+}
+
+void operator delete[](void* pPtr, size_t, std::align_val_t eAlignment) noexcept
+{
+	ProfiledFree(pPtr, static_cast<size_t>(eAlignment));
+}
+
+//------------------------------------------------------------
+// Regions and report
+//------------------------------------------------------------
+UINT32 AllocProfilerBeginRegion(const char* pName)
+{
+	UINT32 nRegion = 0;
+
+	//Same name, same region: a benchmark run twice accumulates
+	AcquireSRWLockExclusive(&ghRegionsLock);
+
+	const UINT32 nCount = gnRegionCount.load(std::memory_order_relaxed);
+	for (nRegion = 1; nRegion < nCount; nRegion++)
+	{
+		if (strcmp(gpRegions[nRegion].pName, pName) == 0)
+		{
+			break;
+		}
+	}
+
+	if (nRegion == nCount)
+	{
+		if (nCount < ALLOC_PROFILER_MAX_REGIONS)
+		{
+			gpRegions[nRegion].pName = pName;
+			gnRegionCount.store(nCount + 1, std::memory_order_relaxed);
+		}
+		else
+		{
+			nRegion = 0;
+		}
+	}
+
+	ReleaseSRWLockExclusive(&ghRegionsLock);
+
+	return gnCurrentRegion.exchange(nRegion, std::memory_order_relaxed);
+}
+
+void AllocProfilerEndRegion(UINT32 nPrevious)
+{
+	gnCurrentRegion.store(nPrevious, std::memory_order_relaxed);
+}
+
+static void WriteFrame(FILE* pFile, void* pFrame)
+{
+	HMODULE hModule = nullptr;
+	char szPath[MAX_PATH] = "?";
+
+	if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, reinterpret_cast<LPCSTR>(pFrame), &hModule))
+	{
+		GetModuleFileNameA(hModule, szPath, MAX_PATH);
+	}
+
+	const char* pName = strrchr(szPath, '\\');
+	pName = pName ? pName + 1 : szPath;
+
+	fprintf(pFile, " %s+0x%llx", pName, static_cast<ULONGLONG>(reinterpret_cast<ULONG_PTR>(pFrame) - reinterpret_cast<ULONG_PTR>(hModule)));
+}
+
+static void WriteHistogram(FILE* pFile, const char* pLabel, const std::atomic<ULONGLONG>* pBuckets)
+{
+	for (size_t k = 0; k < ALLOC_PROFILER_BUCKETS; k++)
+	{
+		const ULONGLONG qwCount = pBuckets[k].load(std::memory_order_relaxed);
+		if (qwCount)
+		{
+			fprintf(pFile, "  %s <=%llu %llu\n", pLabel, 1ull << k, qwCount);
+		}
+	}
+}
+
+//Uses the CRT FILE functions, which allocate with malloc, not with operator new: the report does not profile itself
+bool AllocProfilerWriteReport(const char* pPath)
+{
+	FILE* pFile = nullptr;
+	if (fopen_s(&pFile, pPath, "w") != 0 || !pFile)
+	{
+		return false;
+	}
+
+	fprintf(pFile, "# allocation profile v1: operator new/delete, stacks sampled every %llu allocations\n", static_cast<ULONGLONG>(ALLOC_PROFILER_SAMPLE_EVERY));
+
+	const UINT32 nCount = gnRegionCount.load(std::memory_order_relaxed);
+	for (UINT32 nRegion = 0; nRegion < nCount; nRegion++)
+	{
+		RegionStats& hRegion = gpRegions[nRegion];
+
+		fprintf(pFile, "\nregion %s\n", nRegion ? hRegion.pName : "(outside regions)");
+		fprintf(pFile, "  allocs %llu\n", hRegion.qwAllocs.load());
+		fprintf(pFile, "  frees %llu\n", hRegion.qwFrees.load());
+		fprintf(pFile, "  bytes_allocated %llu\n", hRegion.qwBytesAllocated.load());
+		fprintf(pFile, "  bytes_freed %llu\n", hRegion.qwBytesFreed.load());
+		fprintf(pFile, "  live_bytes %lld\n", hRegion.llLiveBytes.load());
+		fprintf(pFile, "  peak_live_bytes %lld\n", hRegion.llPeakLiveBytes.load());
+		WriteHistogram(pFile, "size_bytes", hRegion.pSizes);
+		WriteHistogram(pFile, "lifetime_ns", hRegion.pLifetimes);
+
+		//Heaviest stacks first; ties by first frame, so the order does not depend on which thread sampled first
+		AcquireSRWLockShared(&hRegion.hStacksLock);
+
+		size_t pOrder[ALLOC_PROFILER_MAX_STACKS];
+		for (size_t i = 0; i < hRegion.nStacks; i++)
+		{
+			pOrder[i] = i;
+		}
+
+		for (size_t i = 1; i < hRegion.nStacks; i++)
+		{
+			for (size_t j = i; j > 0; j--)
+			{
+				const SampledStack& hA = hRegion.pStacks[pOrder[j - 1]];
+				const SampledStack& hB = hRegion.pStacks[pOrder[j]];
+				if (hA.qwCount > hB.qwCount || (hA.qwCount == hB.qwCount && hA.dwHash <= hB.dwHash))
+				{
+					break;
+				}
+
+				const size_t nSwap = pOrder[j];
+				pOrder[j] = pOrder[j - 1];
+				pOrder[j - 1] = nSwap;
+			}
+		}
+
+		for (size_t i = 0; i < hRegion.nStacks; i++)
+		{
+			const SampledStack& hStack = hRegion.pStacks[pOrder[i]];
+
+			fprintf(pFile, "  stack samples %llu bytes %llu:", hStack.qwCount, hStack.qwBytes);
+			for (USHORT f = 0; f < hStack.nFrames; f++)
+			{
+				WriteFrame(pFile, hStack.pFrames[f]);
+			}
+
+			fprintf(pFile, "\n");
+		}
+
+		if (hRegion.qwDroppedSamples)
+		{
+			fprintf(pFile, "  stack_samples_dropped %llu\n", hRegion.qwDroppedSamples);
+		}
+
+		ReleaseSRWLockShared(&hRegion.hStacksLock);
+	}
+
+	fclose(pFile);
+	return true;
+}
+
+//------------------------------------------------------------
+// Traces
+//------------------------------------------------------------
+bool AllocTraceStart(size_t nMaxEvents)
+{
+	if (gbTracing.load(std::memory_order_relaxed) || nMaxEvents == 0)
+	{
+		return false;
+	}
+
+	//Committed up front, but pages only become resident as events fill them
+	gpTraceEvents = reinterpret_cast<AllocTraceEvent*>(VirtualAlloc(nullptr, nMaxEvents * sizeof(AllocTraceEvent), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+	if (!gpTraceEvents)
+	{
+		return false;
+	}
+
+	gnTraceCapacity = nMaxEvents;
+	gnTraceEvents.store(0, std::memory_order_relaxed);
+	gbTracing.store(true, std::memory_order_release);
+	return true;
+}
+
+bool AllocTraceStop(const char* pPath)
+{
+	if (!gbTracing.exchange(false, std::memory_order_acq_rel))
+	{
+		return false;
+	}
+
+	const size_t nEvents = gnTraceEvents.load(std::memory_order_relaxed);
+
+	LARGE_INTEGER liFrequency;
+	QueryPerformanceFrequency(&liFrequency);
+
+	AllocTraceFileHeader hHeader = {};
+	hHeader.nMagic = ALLOC_TRACE_MAGIC;
+	hHeader.nVersion = ALLOC_TRACE_VERSION;
+	hHeader.qwEvents = min(nEvents, gnTraceCapacity);
+	hHeader.qwDropped = nEvents - hHeader.qwEvents;
+	hHeader.llFrequency = liFrequency.QuadPart;
+
+	FILE* pFile = nullptr;
+	bool bWritten = fopen_s(&pFile, pPath, "wb") == 0 && pFile;
+	if (bWritten)
+	{
+		bWritten = fwrite(&hHeader, sizeof(hHeader), 1, pFile) == 1
+			&& fwrite(gpTraceEvents, sizeof(AllocTraceEvent), static_cast<size_t>(hHeader.qwEvents), pFile) == hHeader.qwEvents;
+		fclose(pFile);
+	}
+
+	VirtualFree(gpTraceEvents, 0, MEM_RELEASE);
+	gpTraceEvents = nullptr;
+	gnTraceCapacity = 0;
+	return bWritten;
+}
+
+#endif
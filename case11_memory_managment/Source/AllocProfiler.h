@@ -0,0 +1,98 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Allocation profiler for the benchmarks.
+
+    Windows has no LD_PRELOAD: the interposition is done at link time by
+    replacing the global operator new/delete (every form, aligned and nothrow
+    included). Everything that goes through them is recorded: std containers,
+    std::string, std::pmr::new_delete_resource. Direct malloc/HeapAlloc/
+    VirtualAlloc calls are not seen, they are what the custom allocators
+    measure against anyway.
+
+    Off by default, since the replacement adds a 32-byte header and atomics to
+    every allocation. Build with ALLOC_PROFILER=1 (C/C++ -> Preprocessor) to
+    turn it on; with 0 the API below compiles to nothing.
+
+    Allocations are attributed to the region active when they are made, from
+    any thread. Per region the report has:
+    - counts and bytes allocated/freed, live and peak live bytes
+    - a size histogram and a lifetime histogram (power-of-two buckets)
+    - call stacks of every ALLOC_PROFILER_SAMPLE_EVERY-th allocation, as
+      module+offset so they stay comparable across runs despite ASLR
+
+    The report is plain text, one metric per line in a fixed order, so two
+    runs can be compared with any diff tool. Counts, bytes and sizes are
+    deterministic for single-threaded regions; lifetimes are timings.
+
+    The same hooks record allocation traces for the replay engine: see
+    AllocTrace.h for the file format.
+*/
+#ifndef ALLOC_PROFILER
+#define ALLOC_PROFILER 0
+#endif
+
+constexpr size_t ALLOC_PROFILER_SAMPLE_EVERY = 64;
+
+#if ALLOC_PROFILER
+
+//Returns the region that was active, to be passed back to AllocProfilerEndRegion
+UINT32 AllocProfilerBeginRegion(const char* pName);
+void AllocProfilerEndRegion(UINT32 nPrevious);
+bool AllocProfilerWriteReport(const char* pPath);
+
+//Records every operator new/delete until Stop, up to nMaxEvents (the rest are counted as dropped).
+//Stop writes the trace file; call it when no other thread is allocating
+bool AllocTraceStart(size_t nMaxEvents);
+bool AllocTraceStop(const char* pPath);
+
+#else
+
+inline UINT32 AllocProfilerBeginRegion(const char*)
+{
+	return 0;
+}
+
+inline void AllocProfilerEndRegion(UINT32)
+{
+}
+
+inline bool AllocProfilerWriteReport(const char*)
+{
+	return true;
+}
+
+//Nothing is recorded without the profiler: Stop writes no file and returns false
+inline bool AllocTraceStart(size_t)
+{
+	return false;
+}
+
+inline bool AllocTraceStop(const char*)
+{
+	return false;
+}
+
+#endif
+
+//Regions nest: the scope restores the region it replaced
+class AllocProfilerScope
+{
+public:
+	explicit AllocProfilerScope(const char* pName)
+		: nPrevious(AllocProfilerBeginRegion(pName))
+	{
+	}
+
+	~AllocProfilerScope()
+	{
+		AllocProfilerEndRegion(this->nPrevious);
+	}
+
+	AllocProfilerScope(const AllocProfilerScope&) = delete;
+	AllocProfilerScope& operator=(const AllocProfilerScope&) = delete;
+
+private:
+	UINT32 nPrevious;
+};
@@ -0,0 +1,165 @@
+#include "AllocTrace.h"
+#include <cstdio>
+#include <queue>
+#include <random>
+#include <unordered_map>
+
+//Slot ids for the replay: the most recently released first, which keeps the slot array small and warm
+struct SlotAllocator
+{
+	std::vector<UINT32> vFree;
+	size_t nSlots = 0;
+
+	UINT32 Take()
+	{
+		if (this->vFree.empty())
+		{
+			return static_cast<UINT32>(this->nSlots++);
+		}
+
+		const UINT32 nSlot = this->vFree.back();
+		this->vFree.pop_back();
+		return nSlot;
+	}
+
+	void Release(UINT32 nSlot)
+	{
+		this->vFree.push_back(nSlot);
+	}
+};
+
+static void FinishTrace(AllocReplayTrace* pTrace, const SlotAllocator& hSlots)
+{
+	pTrace->nSlots = hSlots.nSlots;
+	pTrace->qwTotalBytes = 0;
+
+	for (const ReplayOp& hOp : pTrace->vOps)
+	{
+		if (hOp.eKind == ALLOC_TRACE_ALLOC)
+		{
+			pTrace->qwTotalBytes += hOp.nSize;
+		}
+	}
+}
+
+bool LoadAllocTrace(const char* pPath, AllocReplayTrace* pTrace)
+{
+	FILE* pFile = nullptr;
+	if (fopen_s(&pFile, pPath, "rb") != 0 || !pFile)
+	{
+		return false;
+	}
+
+	AllocTraceFileHeader hHeader = {};
+	if (fread(&hHeader, sizeof(hHeader), 1, pFile) != 1 || hHeader.nMagic != ALLOC_TRACE_MAGIC || hHeader.nVersion != ALLOC_TRACE_VERSION)
+	{
+		fclose(pFile);
+		return false;
+	}
+
+	std::vector<AllocTraceEvent> vEvents(static_cast<size_t>(hHeader.qwEvents));
+	const size_t nRead = fread(vEvents.data(), sizeof(AllocTraceEvent), vEvents.size(), pFile);
+	fclose(pFile);
+
+	if (nRead != vEvents.size())
+	{
+		return false;
+	}
+
+	SlotAllocator hSlots;
+	std::unordered_map<ULONGLONG, ReplayOp> hLive;     //Id -> its allocation
+	std::unordered_map<UINT32, bool> hThreads;
+
+	pTrace->vOps.clear();
+	pTrace->vOps.reserve(vEvents.size());
+	pTrace->qwSkippedFrees = 0;
+
+	for (const AllocTraceEvent& hEvent : vEvents)
+	{
+		hThreads[hEvent.nThread] = true;
+
+		if (hEvent.eKind == ALLOC_TRACE_ALLOC)
+		{
+			//The replay sizes are 32-bit: larger blocks are clamped, which no sane trace hits
+			const UINT32 nSize = static_cast<UINT32>(min(hEvent.qwSize, static_cast<ULONGLONG>(0xFFFFFFFF)));
+			const ReplayOp hOp = { hSlots.Take(), nSize, hEvent.nAlignmentLog2, ALLOC_TRACE_ALLOC };
+
+			hLive[hEvent.qwId] = hOp;
+			pTrace->vOps.push_back(hOp);
+			continue;
+		}
+
+		auto hFound = hLive.find(hEvent.qwId);
+		if (hFound == hLive.end())
+		{
+			pTrace->qwSkippedFrees++;
+			continue;
+		}
+
+		ReplayOp hOp = hFound->second;
+		hOp.eKind = ALLOC_TRACE_FREE;
+
+		pTrace->vOps.push_back(hOp);
+		hSlots.Release(hOp.nSlot);
+		hLive.erase(hFound);
+	}
+
+	pTrace->nThreads = hThreads.size();
+	pTrace->dRecordedMs = vEvents.empty() || hHeader.llFrequency == 0 ? 0.0
+		: static_cast<double>(vEvents.back().llTimestamp - vEvents.front().llTimestamp) * 1000.0 / static_cast<double>(hHeader.llFrequency);
+
+	FinishTrace(pTrace, hSlots);
+	return true;
+}
+
+void MakeSyntheticTrace(size_t nAllocs, UINT32 nSeed, AllocReplayTrace* pTrace)
+{
+	typedef std::pair<size_t, UINT32> PendingFree;     //Op index it is due at, slot
+
+	std::mt19937 hRandom(nSeed);
+	std::priority_queue<PendingFree, std::vector<PendingFree>, std::greater<PendingFree>> qPending;
+	std::vector<UINT32> vSlotSizes;
+	SlotAllocator hSlots;
+
+	pTrace->vOps.clear();
+	pTrace->vOps.reserve(nAllocs * 2);
+
+	for (size_t i = 0; i < nAllocs; i++)
+	{
+		while (!qPending.empty() && qPending.top().first <= i)
+		{
+			const UINT32 nSlot = qPending.top().second;
+			qPending.pop();
+
+			pTrace->vOps.push_back({ nSlot, vSlotSizes[nSlot], 4, ALLOC_TRACE_FREE });
+			hSlots.Release(nSlot);
+		}
+
+		//60% 16-64 B, 30% up to 512 B, 9% up to 4 KB, 1% up to 64 KB
+		const UINT32 nClass = static_cast<UINT32>(hRandom() % 100);
+		const UINT32 nSize = static_cast<UINT32>(nClass < 60 ? 16 + hRandom() % 49
+			: nClass < 90 ? 65 + hRandom() % 448
+			: nClass < 99 ? 513 + hRandom() % 3584
+			: 4097 + hRandom() % 61440);
+
+		//85% die within 64 allocations, the rest live up to a quarter of the trace
+		const size_t nLifetime = hRandom() % 100 < 85 ? 1 + hRandom() % 64 : 1 + hRandom() % max(nAllocs / 4, static_cast<size_t>(1));
+
+		const UINT32 nSlot = hSlots.Take();
+		if (nSlot >= vSlotSizes.size())
+		{
+			vSlotSizes.resize(nSlot + 1);
+		}
+
+		vSlotSizes[nSlot] = nSize;
+		pTrace->vOps.push_back({ nSlot, nSize, 4, ALLOC_TRACE_ALLOC });     //16-byte alignment, like operator new
+		qPending.push({ i + nLifetime, nSlot });
+	}
+
+	//The tail is left live, as a recording stopped mid-run would be
+	pTrace->nThreads = 1;
+	pTrace->qwSkippedFrees = 0;
+	pTrace->dRecordedMs = 0.0;
+
+	FinishTrace(pTrace, hSlots);
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <Windows.h>
+#include <vector>
+#include <cstring>
+#include "MemoryCounters.h"
+
+/*
+    Allocation traces: recording format and replay engine.
+
+    Recording is done by the allocation profiler (AllocProfiler.h, build with
+    ALLOC_PROFILER=1): between AllocTraceStart() and AllocTraceStop() every
+    operator new/delete of the process is appended to a buffer, which Stop
+    writes to a file:
+
+        AllocTraceFileHeader, then nEvents x AllocTraceEvent
+
+    Each allocation gets an id, and its free carries the same id, so the two
+    can be matched. Frees of blocks allocated before the trace started are not
+    recorded; blocks still live when it stops have no free.
+
+    Replay drives any allocator with the trace:
+
+        AllocReplayTrace hTrace;
+        LoadAllocTrace("alloc_trace.bin", &hTrace);
+        ReplayAllocTrace(hTrace, Alloc, Free, &hResult);
+
+    Alloc(nSize, nAlignment) returns void*, Free(pPtr, nSize, nAlignment)
+    releases it (size and alignment let an allocator that forwards some
+    requests elsewhere route the block back). The loader maps ids
+    to a small set of reusable slots, so the replay loop is an array index per
+    op and no hashing. Every allocated block is written once in full, like the
+    recorded program would.
+
+    Events are replayed on one thread in recorded order; the thread ids are
+    kept in the file, and a trace from N threads becomes one serialized stream.
+    This measures placement and fragmentation faithfully, but not contention.
+*/
+constexpr UINT32 ALLOC_TRACE_MAGIC = 0x43525441;       //"ATRC"
+constexpr UINT32 ALLOC_TRACE_VERSION = 1;
+
+enum AllocTraceKind : UINT16
+{
+	ALLOC_TRACE_ALLOC = 0,
+	ALLOC_TRACE_FREE = 1,
+};
+
+struct AllocTraceFileHeader
+{
+	UINT32 nMagic;
+	UINT32 nVersion;
+	ULONGLONG qwEvents;
+	ULONGLONG qwDropped;        //Events past the buffer given to AllocTraceStart
+	LONGLONG llFrequency;       //QPC ticks per second of the timestamps
+};
+
+struct AllocTraceEvent
+{
+	ULONGLONG qwId;
+	ULONGLONG qwSize;           //0 for frees
+	LONGLONG llTimestamp;       //QPC ticks
+	UINT32 nThread;
+	UINT16 nAlignmentLog2;
+	UINT16 eKind;               //AllocTraceKind
+};
+
+static_assert(sizeof(AllocTraceEvent) == 32, "AllocTraceEvent is part of the file format");
+
+//------------------------------------------------------------
+// Replay
+//------------------------------------------------------------
+struct ReplayOp
+{
+	UINT32 nSlot;
+	UINT32 nSize;               //Size and alignment of the allocation, also on its free
+	UINT16 nAlignmentLog2;
+	UINT16 eKind;
+};
+
+struct AllocReplayTrace
+{
+	std::vector<ReplayOp> vOps;
+	size_t nSlots;              //Most blocks live at once
+	size_t nThreads;            //Distinct threads in the recording
+	ULONGLONG qwTotalBytes;     //Sum of all allocation sizes
+	ULONGLONG qwSkippedFrees;   //Frees without a recorded allocation
+	double dRecordedMs;         //First to last timestamp
+};
+
+struct AllocReplayResult
+{
+	double dMilliseconds;
+	size_t nPeakLiveBytes;      //Largest sum of requested sizes alive at once
+	size_t nPeakWorkingSet;     //Above the working set before the replay
+	size_t nPeakPrivate;        //Above the private (committed) bytes before the replay
+	size_t nFailed;             //Allocations that returned nullptr
+	double dFragmentation;      //1 - peak live / peak private: share of the commit that held no live data
+};
+
+//false if the file is missing or is not a version 1 trace
+bool LoadAllocTrace(const char* pPath, AllocReplayTrace* pTrace);
+
+//Request-handler-like mix when no recording is at hand: mostly small, mostly short-lived, a long-lived tail
+void MakeSyntheticTrace(size_t nAllocs, UINT32 nSeed, AllocReplayTrace* pTrace);
+
+constexpr size_t ALLOC_REPLAY_SAMPLE_EVERY = 16 * 1024;
+
+inline size_t AlignmentOf(const ReplayOp& hOp)
+{
+	return static_cast<size_t>(1) << hOp.nAlignmentLog2;
+}
+
+//Live blocks at the end of the trace are freed after the clock stops
+template<typename AllocFunction, typename FreeFunction>
+void ReplayAllocTrace(const AllocReplayTrace& hTrace, AllocFunction&& Alloc, FreeFunction&& Free, AllocReplayResult* pResult)
+{
+	std::vector<void*> vSlots(hTrace.nSlots, nullptr);
+	std::vector<ReplayOp> vAllocs(hTrace.nSlots);
+
+	size_t nBaseWorkingSet = 0;
+	size_t nBasePrivate = 0;
+	SampleWorkingSet(&nBaseWorkingSet, &nBasePrivate);
+
+	size_t nPeakWorkingSet = nBaseWorkingSet;
+	size_t nPeakPrivate = nBasePrivate;
+	size_t nLiveBytes = 0;
+	size_t nPeakLiveBytes = 0;
+	size_t nFailed = 0;
+
+	LARGE_INTEGER liFrequency;
+	LARGE_INTEGER liStart;
+	LARGE_INTEGER liEnd;
+	QueryPerformanceFrequency(&liFrequency);
+	QueryPerformanceCounter(&liStart);
+
+	const size_t nOps = hTrace.vOps.size();
+	for (size_t i = 0; i < nOps; i++)
+	{
+		const ReplayOp& hOp = hTrace.vOps[i];
+
+		if (hOp.eKind == ALLOC_TRACE_ALLOC)
+		{
+			void* pPtr = Alloc(static_cast<size_t>(hOp.nSize), AlignmentOf(hOp));
+			if (pPtr)
+			{
+				memset(pPtr, static_cast<int>(i), hOp.nSize);
+				nLiveBytes += hOp.nSize;
+				nPeakLiveBytes = max(nPeakLiveBytes, nLiveBytes);
+			}
+			else
+			{
+				nFailed++;
+			}
+
+			vSlots[hOp.nSlot] = pPtr;
+			vAllocs[hOp.nSlot] = hOp;
+		}
+		else if (vSlots[hOp.nSlot])
+		{
+			Free(vSlots[hOp.nSlot], static_cast<size_t>(hOp.nSize), AlignmentOf(hOp));
+			vSlots[hOp.nSlot] = nullptr;
+			nLiveBytes -= hOp.nSize;
+		}
+
+		//Sampling is part of the timed loop, equally for every allocator
+		if (i % ALLOC_REPLAY_SAMPLE_EVERY == 0)
+		{
+			size_t nWorkingSet = 0;
+			size_t nPrivate = 0;
+			SampleWorkingSet(&nWorkingSet, &nPrivate);
+			nPeakWorkingSet = max(nPeakWorkingSet, nWorkingSet);
+			nPeakPrivate = max(nPeakPrivate, nPrivate);
+		}
+	}
+
+	QueryPerformanceCounter(&liEnd);
+
+	size_t nWorkingSet = 0;
+	size_t nPrivate = 0;
+	SampleWorkingSet(&nWorkingSet, &nPrivate);
+	nPeakWorkingSet = max(nPeakWorkingSet, nWorkingSet);
+	nPeakPrivate = max(nPeakPrivate, nPrivate);
+
+	for (size_t nSlot = 0; nSlot < hTrace.nSlots; nSlot++)
+	{
+		if (vSlots[nSlot])
+		{
+			Free(vSlots[nSlot], static_cast<size_t>(vAllocs[nSlot].nSize), AlignmentOf(vAllocs[nSlot]));
+		}
+	}
+
+	pResult->dMilliseconds = static_cast<double>(liEnd.QuadPart - liStart.QuadPart) * 1000.0 / static_cast<double>(liFrequency.QuadPart);
+	pResult->nPeakLiveBytes = nPeakLiveBytes;
+	pResult->nPeakWorkingSet = nPeakWorkingSet - nBaseWorkingSet;
+	pResult->nPeakPrivate = nPeakPrivate - nBasePrivate;
+	pResult->nFailed = nFailed;
+	pResult->dFragmentation = pResult->nPeakPrivate > nPeakLiveBytes ? 1.0 - static_cast<double>(nPeakLiveBytes) / static_cast<double>(pResult->nPeakPrivate) : 0.0;
+}
@@ -0,0 +1,200 @@
+#include "Arena.h"
+
+struct ArenaBlock
+{
+	ArenaBlock* pPrev;          //Block chained before this one
+	size_t nSize;               //Header included
+	size_t nUsed;               //Bytes in use when the block was left for the next one
+};
+
+//Keeps the first allocation of every block on its own cache line
+constexpr size_t ARENA_HEADER_SIZE = 64;
+constexpr size_t ARENA_PAGE_SIZE = 4096;
+static_assert(sizeof(ArenaBlock) <= ARENA_HEADER_SIZE, "ArenaBlock does not fit its cache line");
+
+static char* BlockBegin(ArenaBlock* pBlock)
+{
+	return reinterpret_cast<char*>(pBlock) + ARENA_HEADER_SIZE;
+}
+
+static char* BlockEnd(ArenaBlock* pBlock)
+{
+	return reinterpret_cast<char*>(pBlock) + pBlock->nSize;
+}
+
+Arena::Arena(size_t nInitialBlockSize, size_t nMaxBlockSizeIn, DWORD nNodeIn)
+{
+	this->pCurrent = nullptr;
+	this->pCursor = nullptr;
+	this->pEnd = nullptr;
+	this->pSpare = nullptr;
+	this->nNextBlockSize = nInitialBlockSize;
+	this->nMaxBlockSize = max(nMaxBlockSizeIn, nInitialBlockSize);
+	this->nBlocks = 0;
+	this->nNode = nNodeIn;
+	this->qwBytesReserved = 0;
+}
+
+Arena::~Arena()
+{
+	while (this->pCurrent)
+	{
+		this->PopBlock();
+	}
+
+	if (this->pSpare)
+	{
+		VirtualFree(this->pSpare, 0, MEM_RELEASE);
+		this->pSpare = nullptr;
+	}
+}
+
+//------------------------------------------------------------
+// Blocks
+//------------------------------------------------------------
+bool Arena::PushBlock(size_t nMinSize)
+{
+	ArenaBlock* pBlock = nullptr;
+
+	if (this->pSpare && this->pSpare->nSize >= nMinSize)
+	{
+		pBlock = this->pSpare;
+		this->pSpare = nullptr;
+	}
+	else
+	{
+		//Oversized requests get an exact block and do not advance the growth
+		size_t nSize = this->nNextBlockSize;
+		if (nMinSize > nSize)
+		{
+			nSize = (nMinSize + ARENA_PAGE_SIZE - 1) & ~(ARENA_PAGE_SIZE - 1);
+		}
+		else
+		{
+			this->nNextBlockSize = min(this->nNextBlockSize * 2, this->nMaxBlockSize);
+		}
+
+		if (this->nNode == NUMA_NO_PREFERRED_NODE)
+		{
+			pBlock = reinterpret_cast<ArenaBlock*>(VirtualAlloc(nullptr, nSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		}
+		else
+		{
+			pBlock = reinterpret_cast<ArenaBlock*>(VirtualAllocExNuma(GetCurrentProcess(), nullptr, nSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, this->nNode));
+		}
+		if (!pBlock)
+		{
+			return false;
+		}
+
+		pBlock->nSize = nSize;
+	}
+
+	if (this->pCurrent)
+	{
+		this->pCurrent->nUsed = static_cast<size_t>(this->pCursor - BlockBegin(this->pCurrent));
+	}
+
+	pBlock->pPrev = this->pCurrent;
+	pBlock->nUsed = 0;
+
+	this->pCurrent = pBlock;
+	this->pCursor = BlockBegin(pBlock);
+	this->pEnd = BlockEnd(pBlock);
+	this->nBlocks++;
+	this->qwBytesReserved += pBlock->nSize;
+
+	return true;
+}
+
+//Unchains the current block: the largest one released becomes the spare
+void Arena::PopBlock()
+{
+	ArenaBlock* pBlock = this->pCurrent;
+
+	this->pCurrent = pBlock->pPrev;
+	this->nBlocks--;
+	this->qwBytesReserved -= pBlock->nSize;
+
+	if (this->pCurrent)
+	{
+		this->pCursor = BlockBegin(this->pCurrent) + this->pCurrent->nUsed;
+		this->pEnd = BlockEnd(this->pCurrent);
+	}
+	else
+	{
+		this->pCursor = nullptr;
+		this->pEnd = nullptr;
+	}
+
+	if (!this->pSpare || this->pSpare->nSize < pBlock->nSize)
+	{
+		if (this->pSpare)
+		{
+			VirtualFree(this->pSpare, 0, MEM_RELEASE);
+		}
+
+		this->pSpare = pBlock;
+		return;
+	}
+
+	VirtualFree(pBlock, 0, MEM_RELEASE);
+}
+
+void* Arena::AllocSlow(size_t nSize, size_t nAlignment)
+{
+	//Block starts are 64-byte aligned; larger alignments may need the padding
+	const size_t nPadding = nAlignment > ARENA_HEADER_SIZE ? nAlignment : 0;
+
+	if (!this->PushBlock(ARENA_HEADER_SIZE + nPadding + nSize))
+	{
+		return nullptr;
+	}
+
+	return this->alloc(nSize, nAlignment);
+}
+
+//------------------------------------------------------------
+// Markers
+//------------------------------------------------------------
+ArenaMarker Arena::save() const
+{
+	ArenaMarker hMarker;
+	hMarker.pBlock = this->pCurrent;
+	hMarker.nOffset = this->pCurrent ? static_cast<size_t>(this->pCursor - BlockBegin(this->pCurrent)) : 0;
+	return hMarker;
+}
+
+void Arena::restore(const ArenaMarker& hMarker)
+{
+	while (this->pCurrent != hMarker.pBlock)
+	{
+		this->PopBlock();
+	}
+
+	if (this->pCurrent)
+	{
+		this->pCursor = BlockBegin(this->pCurrent) + hMarker.nOffset;
+	}
+}
+
+void Arena::reset()
+{
+	this->restore(ArenaMarker{ nullptr, 0 });
+}
+
+ULONGLONG Arena::bytes_used() const
+{
+	if (!this->pCurrent)
+	{
+		return 0;
+	}
+
+	ULONGLONG qwUsed = static_cast<ULONGLONG>(this->pCursor - BlockBegin(this->pCurrent));
+	for (const ArenaBlock* pBlock = this->pCurrent->pPrev; pBlock; pBlock = pBlock->pPrev)
+	{
+		qwUsed += pBlock->nUsed;
+	}
+
+	return qwUsed;
+}
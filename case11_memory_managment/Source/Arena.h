@@ -0,0 +1,118 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Chained bump arena (the Pool of Main.cpp, growable and with rollback).
+
+    - Memory comes in blocks from VirtualAlloc. When the current block is full
+      a new one is chained in front of it, twice as large as the previous one
+      (up to nMaxBlockSize); requests larger than that get a block of their own.
+    - alloc() is a pointer bump with alignment, there is no per-allocation free.
+    - save() returns a marker, restore() rolls the arena back to it and
+      releases the blocks chained after it. ArenaScope does both in a scope,
+      which is the per-request pattern: everything a request allocates goes
+      away at once when it ends.
+    - The largest released block is kept as a spare, so a loop that crosses a
+      block boundary and rolls back does not call VirtualAlloc every time.
+    - Given a NUMA node (a Windows node number, see Numa.h), blocks come from
+      VirtualAllocExNuma and live on that node whichever thread touches them.
+
+    Not thread-safe, like Pool: one arena per thread or per request.
+*/
+constexpr size_t ARENA_DEFAULT_BLOCK_SIZE = 64 * 1024;
+constexpr size_t ARENA_DEFAULT_MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+constexpr size_t ARENA_DEFAULT_ALIGNMENT = 16;
+
+struct ArenaBlock;
+
+struct ArenaMarker
+{
+	ArenaBlock* pBlock;
+	size_t nOffset;
+};
+
+class Arena
+{
+public:
+	Arena(size_t nInitialBlockSize = ARENA_DEFAULT_BLOCK_SIZE, size_t nMaxBlockSizeIn = ARENA_DEFAULT_MAX_BLOCK_SIZE, DWORD nNodeIn = NUMA_NO_PREFERRED_NODE);
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	//nAlignment must be a power of two; nullptr only if VirtualAlloc fails
+	void* alloc(size_t nSize, size_t nAlignment = ARENA_DEFAULT_ALIGNMENT)
+	{
+		if (this->pCurrent)
+		{
+			const ULONG_PTR nAddress = (reinterpret_cast<ULONG_PTR>(this->pCursor) + (nAlignment - 1)) & ~static_cast<ULONG_PTR>(nAlignment - 1);
+			if (nAddress + nSize <= reinterpret_cast<ULONG_PTR>(this->pEnd))
+			{
+				this->pCursor = reinterpret_cast<char*>(nAddress + nSize);
+				return reinterpret_cast<void*>(nAddress);
+			}
+		}
+
+		return this->AllocSlow(nSize, nAlignment);
+	}
+
+	ArenaMarker save() const;
+	void restore(const ArenaMarker& hMarker);
+
+	//Rolls back everything; keeps one block (the spare) for the next use
+	void reset();
+
+	ULONGLONG bytes_reserved() const
+	{
+		return this->qwBytesReserved;
+	}
+
+	ULONGLONG bytes_used() const;
+
+	size_t block_count() const
+	{
+		return this->nBlocks;
+	}
+
+	DWORD node() const
+	{
+		return this->nNode;
+	}
+
+private:
+	void* AllocSlow(size_t nSize, size_t nAlignment);
+	bool PushBlock(size_t nMinSize);
+	void PopBlock();
+
+	ArenaBlock* pCurrent;
+	char* pCursor;
+	char* pEnd;
+	ArenaBlock* pSpare;
+	size_t nNextBlockSize;
+	size_t nMaxBlockSize;
+	size_t nBlocks;
+	DWORD nNode;                    //NUMA_NO_PREFERRED_NODE: wherever the first touch puts the pages
+	ULONGLONG qwBytesReserved;      //Chained blocks, the spare excluded
+};
+
+//Restores the marker taken at construction when the scope ends
+class ArenaScope
+{
+public:
+	explicit ArenaScope(Arena& hArenaIn)
+		: hArena(hArenaIn), hMarker(hArenaIn.save())
+	{
+	}
+
+	~ArenaScope()
+	{
+		this->hArena.restore(this->hMarker);
+	}
+
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+	Arena& hArena;
+	ArenaMarker hMarker;
+};
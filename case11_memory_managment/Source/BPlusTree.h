@@ -0,0 +1,608 @@
+#pragma once
+#include <Windows.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "SlabCache.h"
+
+/*
+    Cache-conscious B+tree: an ordered map from ULONGLONG keys to V.
+
+    std::map is a red-black tree with one heap node per element, so a lookup
+    in a large map is ~log2(n) dependent cache misses (27 for 100M keys). A
+    B+tree stores many keys per node and is only log_F(n) levels deep:
+
+        BPlusTree<ULONGLONG> hTree;
+        hTree.insert(42, 4200);
+        ULONGLONG* pValue = hTree.find(42);
+        for (auto hCursor = hTree.lower_bound(40); hCursor.valid(); hCursor.next()) { ... }
+
+    - Every node is NodeBytes (a multiple of the 64-byte cache line), laid out
+      as a 16-byte header, the keys, then the values or children. Nodes come
+      from a SlabCache with a single size class, whose blocks are cache-line
+      aligned when the class is a multiple of 64.
+    - The keys of a node are searched with SIMD compares, branch-free: every
+      key slot is compared and the "key < target" lanes are counted. Unused
+      slots hold BTREE_EMPTY_KEY, which is never below anything, so the count
+      is the lower bound without looking at the node's count. SSE4.2 (two keys
+      per compare) by default, AVX2 (four) when built with /arch:AVX2.
+    - Values live only in the leaves, and the leaves are linked in key order:
+      a range scan is lower_bound() followed by walking leaves sequentially.
+    - bulk_load() builds the tree bottom-up from sorted keys, leaves packed to
+      the fill given, in O(n) with no splits.
+    - A leaf that receives a key past its last one while being the last leaf
+      splits unevenly (everything stays left), so ascending inserts also
+      produce full leaves.
+
+    There is no erase, and values are moved with memmove (V must be
+    trivially copyable). Pointers to values and cursors are invalidated by
+    any insert. Not thread-safe, like SlabCache.
+*/
+constexpr size_t BTREE_DEFAULT_NODE_BYTES = 256;
+constexpr size_t BTREE_MAX_DEPTH = 32;
+constexpr ULONGLONG BTREE_EMPTY_KEY = ~0ull;
+
+//Keys below qwKey among nPadded (a multiple of 4) slots; with the padding at BTREE_EMPTY_KEY this is the lower bound
+template<size_t nPadded>
+inline UINT32 BTreeCountLess(const ULONGLONG* pKeys, ULONGLONG qwKey)
+{
+	static_assert(nPadded % 4 == 0, "key slots are compared four at a time");
+
+	//The compares are signed: flipping the sign bit of both sides orders unsigned keys correctly
+	UINT32 nLess = 0;
+
+#if defined(__AVX2__)
+	const __m256i vSign = _mm256_set1_epi64x(static_cast<LONGLONG>(0x8000000000000000ull));
+	const __m256i vKey = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<LONGLONG>(qwKey)), vSign);
+
+	for (size_t i = 0; i < nPadded; i += 4)
+	{
+		const __m256i vNode = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pKeys + i)), vSign);
+		nLess += static_cast<UINT32>(std::popcount(static_cast<UINT32>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(vKey, vNode))))));
+	}
+#else
+	const __m128i vSign = _mm_set1_epi64x(static_cast<LONGLONG>(0x8000000000000000ull));
+	const __m128i vKey = _mm_xor_si128(_mm_set1_epi64x(static_cast<LONGLONG>(qwKey)), vSign);
+
+	for (size_t i = 0; i < nPadded; i += 2)
+	{
+		const __m128i vNode = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pKeys + i)), vSign);
+		nLess += static_cast<UINT32>(std::popcount(static_cast<UINT32>(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(vKey, vNode))))));
+	}
+#endif
+
+	return nLess;
+}
+
+template<typename V, size_t NodeBytes = BTREE_DEFAULT_NODE_BYTES>
+class BPlusTree
+{
+	static_assert(std::is_trivially_copyable_v<V>, "values are moved with memmove");
+	static_assert(alignof(V) <= 8, "values follow the 8-byte keys");
+	static_assert(NodeBytes % 64 == 0 && NodeBytes >= 128 && NodeBytes <= SLAB_CACHE_MAX_BLOCK, "NodeBytes must be 128 B or more, a multiple of the cache line and fit a SlabCache class");
+
+	static constexpr size_t HEADER_BYTES = 16;
+
+	static constexpr size_t RoundUp4(size_t nCount)
+	{
+		return (nCount + 3) & ~static_cast<size_t>(3);
+	}
+
+	static constexpr size_t LeafCapacity()
+	{
+		size_t nKeys = (NodeBytes - HEADER_BYTES) / (sizeof(ULONGLONG) + sizeof(V));
+		while (HEADER_BYTES + sizeof(ULONGLONG) * RoundUp4(nKeys) + sizeof(V) * nKeys > NodeBytes)
+		{
+			nKeys--;
+		}
+
+		return nKeys;
+	}
+
+	static constexpr size_t InnerCapacity()
+	{
+		size_t nKeys = (NodeBytes - HEADER_BYTES) / (2 * sizeof(ULONGLONG));
+		while (HEADER_BYTES + sizeof(ULONGLONG) * RoundUp4(nKeys) + sizeof(void*) * (nKeys + 1) > NodeBytes)
+		{
+			nKeys--;
+		}
+
+		return nKeys;
+	}
+
+public:
+	static constexpr size_t LEAF_KEYS = LeafCapacity();
+	static constexpr size_t INNER_KEYS = InnerCapacity();
+
+private:
+	static constexpr size_t LEAF_SLOTS = RoundUp4(LEAF_KEYS);
+	static constexpr size_t INNER_SLOTS = RoundUp4(INNER_KEYS);
+
+	struct Node
+	{
+		UINT32 nCount;
+		UINT32 bLeaf;
+		Node* pNext;            //Leaves: the next leaf in key order
+	};
+
+	struct Leaf : Node
+	{
+		ULONGLONG pKeys[LEAF_SLOTS];
+		V pValues[LEAF_KEYS];
+	};
+
+	//Child i holds the keys in [pKeys[i - 1], pKeys[i])
+	struct Inner : Node
+	{
+		ULONGLONG pKeys[INNER_SLOTS];
+		Node* pChildren[INNER_KEYS + 1];
+	};
+
+	static_assert(sizeof(Leaf) <= NodeBytes && sizeof(Inner) <= NodeBytes, "node layout exceeds NodeBytes");
+
+	static constexpr size_t NODE_CLASS[1] = { NodeBytes };
+
+public:
+	class Cursor
+	{
+	public:
+		bool valid() const
+		{
+			return this->pLeaf != nullptr;
+		}
+
+		ULONGLONG key() const
+		{
+			return this->pLeaf->pKeys[this->nIndex];
+		}
+
+		V& value() const
+		{
+			return this->pLeaf->pValues[this->nIndex];
+		}
+
+		void next()
+		{
+			this->nIndex++;
+			if (this->nIndex >= this->pLeaf->nCount)
+			{
+				this->pLeaf = static_cast<Leaf*>(this->pLeaf->pNext);
+				this->nIndex = 0;
+			}
+		}
+
+	private:
+		friend class BPlusTree;
+
+		Cursor(Leaf* pLeafIn, UINT32 nIndexIn)
+			: pLeaf(pLeafIn), nIndex(nIndexIn)
+		{
+		}
+
+		Leaf* pLeaf;
+		UINT32 nIndex;
+	};
+
+	BPlusTree()
+		: hNodes(NODE_CLASS, 1), pRoot(nullptr), pFirstLeaf(nullptr), nSize(0), nHeight(0), nLeaves(0), nInners(0)
+	{
+	}
+
+	~BPlusTree()
+	{
+		this->clear();
+	}
+
+	BPlusTree(const BPlusTree&) = delete;
+	BPlusTree& operator=(const BPlusTree&) = delete;
+
+	//false if the key is already present (its value is left as it was)
+	bool insert(ULONGLONG qwKey, const V& hValue)
+	{
+		if (!this->pRoot)
+		{
+			this->pRoot = this->NewLeaf();
+			this->pFirstLeaf = static_cast<Leaf*>(this->pRoot);
+		}
+
+		Inner* pPath[BTREE_MAX_DEPTH];
+		UINT32 pSlots[BTREE_MAX_DEPTH];
+		size_t nDepth = 0;
+
+		Node* pNode = this->pRoot;
+		while (!pNode->bLeaf)
+		{
+			Inner* pInner = static_cast<Inner*>(pNode);
+			const UINT32 nChild = ChildIndex(pInner, qwKey);
+
+			pPath[nDepth] = pInner;
+			pSlots[nDepth] = nChild;
+			nDepth++;
+			pNode = pInner->pChildren[nChild];
+		}
+
+		Leaf* pLeaf = static_cast<Leaf*>(pNode);
+		const UINT32 nIndex = BTreeCountLess<LEAF_SLOTS>(pLeaf->pKeys, qwKey);
+		if (nIndex < pLeaf->nCount && pLeaf->pKeys[nIndex] == qwKey)
+		{
+			return false;
+		}
+
+		this->nSize++;
+
+		if (pLeaf->nCount < LEAF_KEYS)
+		{
+			InsertInLeaf(pLeaf, nIndex, qwKey, hValue);
+			return true;
+		}
+
+		//Full: the upper half moves to a new leaf, or nothing does when appending past the last key
+		Leaf* pRight = this->NewLeaf();
+		const UINT32 nKeep = nIndex == LEAF_KEYS && !pLeaf->pNext ? static_cast<UINT32>(LEAF_KEYS) : static_cast<UINT32>(LEAF_KEYS / 2);
+		const UINT32 nMove = static_cast<UINT32>(LEAF_KEYS) - nKeep;
+
+		memcpy(pRight->pKeys, pLeaf->pKeys + nKeep, nMove * sizeof(ULONGLONG));
+		memcpy(static_cast<void*>(pRight->pValues), pLeaf->pValues + nKeep, nMove * sizeof(V));
+		std::fill(pLeaf->pKeys + nKeep, pLeaf->pKeys + LEAF_SLOTS, BTREE_EMPTY_KEY);
+		pLeaf->nCount = nKeep;
+		pRight->nCount = nMove;
+
+		pRight->pNext = pLeaf->pNext;
+		pLeaf->pNext = pRight;
+
+		if (nIndex <= nKeep && nKeep < LEAF_KEYS)
+		{
+			InsertInLeaf(pLeaf, nIndex, qwKey, hValue);
+		}
+		else
+		{
+			InsertInLeaf(pRight, nIndex - nKeep, qwKey, hValue);
+		}
+
+		this->InsertSeparator(pPath, pSlots, nDepth, pRight->pKeys[0], pRight);
+		return true;
+	}
+
+	V* find(ULONGLONG qwKey) const
+	{
+		if (!this->pRoot)
+		{
+			return nullptr;
+		}
+
+		Leaf* pLeaf = this->FindLeaf(qwKey);
+		const UINT32 nIndex = BTreeCountLess<LEAF_SLOTS>(pLeaf->pKeys, qwKey);
+		return nIndex < pLeaf->nCount && pLeaf->pKeys[nIndex] == qwKey ? &pLeaf->pValues[nIndex] : nullptr;
+	}
+
+	//First key >= qwKey
+	Cursor lower_bound(ULONGLONG qwKey) const
+	{
+		if (!this->pRoot)
+		{
+			return Cursor(nullptr, 0);
+		}
+
+		Leaf* pLeaf = this->FindLeaf(qwKey);
+		const UINT32 nIndex = BTreeCountLess<LEAF_SLOTS>(pLeaf->pKeys, qwKey);
+		if (nIndex < pLeaf->nCount)
+		{
+			return Cursor(pLeaf, nIndex);
+		}
+
+		return Cursor(static_cast<Leaf*>(pLeaf->pNext), 0);
+	}
+
+	Cursor begin() const
+	{
+		return Cursor(this->nSize ? this->pFirstLeaf : nullptr, 0);
+	}
+
+	/*
+	    Replaces the contents with nCount keys, strictly ascending, and their
+	    values. nLeafFill keys go in each leaf (clamped to 1..LEAF_KEYS): below
+	    LEAF_KEYS it leaves room for later inserts before leaves split. false,
+	    with the tree left empty, if the keys are not strictly ascending.
+	*/
+	bool bulk_load(const ULONGLONG* pKeys, const V* pValues, size_t nCount, size_t nLeafFill = LEAF_KEYS)
+	{
+		this->clear();
+
+		for (size_t i = 1; i < nCount; i++)
+		{
+			if (pKeys[i] <= pKeys[i - 1])
+			{
+				return false;
+			}
+		}
+
+		if (!nCount)
+		{
+			return true;
+		}
+
+		nLeafFill = min(max(nLeafFill, static_cast<size_t>(1)), LEAF_KEYS);
+
+		//Leaves: the keys spread evenly, so none ends up nearly empty
+		const size_t nLeafCount = (nCount + nLeafFill - 1) / nLeafFill;
+
+		std::vector<Node*> vLevel;
+		std::vector<ULONGLONG> vLowest;
+		vLevel.reserve(nLeafCount);
+		vLowest.reserve(nLeafCount);
+
+		Leaf* pPrevious = nullptr;
+		size_t nDone = 0;
+
+		for (size_t nLeaf = 0; nLeaf < nLeafCount; nLeaf++)
+		{
+			const size_t nTake = nCount / nLeafCount + (nLeaf < nCount % nLeafCount ? 1 : 0);
+
+			Leaf* pLeaf = this->NewLeaf();
+			memcpy(pLeaf->pKeys, pKeys + nDone, nTake * sizeof(ULONGLONG));
+			memcpy(static_cast<void*>(pLeaf->pValues), pValues + nDone, nTake * sizeof(V));
+			pLeaf->nCount = static_cast<UINT32>(nTake);
+
+			if (pPrevious)
+			{
+				pPrevious->pNext = pLeaf;
+			}
+			else
+			{
+				this->pFirstLeaf = pLeaf;
+			}
+
+			pPrevious = pLeaf;
+			vLevel.push_back(pLeaf);
+			vLowest.push_back(pKeys[nDone]);
+			nDone += nTake;
+		}
+
+		//Inner levels, bottom-up, until one node is left
+		while (vLevel.size() > 1)
+		{
+			const size_t nChildren = vLevel.size();
+			const size_t nGroups = (nChildren + INNER_KEYS) / (INNER_KEYS + 1);
+
+			std::vector<Node*> vParents;
+			std::vector<ULONGLONG> vParentLowest;
+			vParents.reserve(nGroups);
+			vParentLowest.reserve(nGroups);
+
+			size_t nFirst = 0;
+			for (size_t nGroup = 0; nGroup < nGroups; nGroup++)
+			{
+				const size_t nTake = nChildren / nGroups + (nGroup < nChildren % nGroups ? 1 : 0);
+
+				Inner* pInner = this->NewInner();
+				for (size_t i = 0; i < nTake; i++)
+				{
+					pInner->pChildren[i] = vLevel[nFirst + i];
+					if (i)
+					{
+						pInner->pKeys[i - 1] = vLowest[nFirst + i];
+					}
+				}
+
+				pInner->nCount = static_cast<UINT32>(nTake - 1);
+				vParents.push_back(pInner);
+				vParentLowest.push_back(vLowest[nFirst]);
+				nFirst += nTake;
+			}
+
+			vLevel.swap(vParents);
+			vLowest.swap(vParentLowest);
+			this->nHeight++;
+		}
+
+		this->pRoot = vLevel[0];
+		this->nSize = nCount;
+		return true;
+	}
+
+	void clear()
+	{
+		if (this->pRoot)
+		{
+			this->FreeSubtree(this->pRoot);
+		}
+
+		this->pRoot = nullptr;
+		this->pFirstLeaf = nullptr;
+		this->nSize = 0;
+		this->nHeight = 0;
+		this->nLeaves = 0;
+		this->nInners = 0;
+	}
+
+	size_t size() const
+	{
+		return this->nSize;
+	}
+
+	bool empty() const
+	{
+		return this->nSize == 0;
+	}
+
+	//Inner levels above the leaves: 0 while the root is a leaf
+	size_t height() const
+	{
+		return this->nHeight;
+	}
+
+	size_t node_count() const
+	{
+		return this->nLeaves + this->nInners;
+	}
+
+	//Share of the leaf slots holding a key
+	double leaf_fill() const
+	{
+		return this->nLeaves ? static_cast<double>(this->nSize) / static_cast<double>(this->nLeaves * LEAF_KEYS) : 0.0;
+	}
+
+	ULONGLONG bytes_reserved() const
+	{
+		SlabCacheStats hStats;
+		this->hNodes.get_stats(&hStats);
+		return hStats.qwBytesReserved;
+	}
+
+	//The keys and values themselves, what a perfect packing would need
+	ULONGLONG bytes_in_use() const
+	{
+		return static_cast<ULONGLONG>(this->nSize) * (sizeof(ULONGLONG) + sizeof(V));
+	}
+
+private:
+	static UINT32 ChildIndex(const Inner* pInner, ULONGLONG qwKey)
+	{
+		//Keys <= qwKey, i.e. keys < qwKey + 1; qwKey + 1 would wrap for the largest key
+		return qwKey == BTREE_EMPTY_KEY ? pInner->nCount : BTreeCountLess<INNER_SLOTS>(pInner->pKeys, qwKey + 1);
+	}
+
+	Leaf* FindLeaf(ULONGLONG qwKey) const
+	{
+		Node* pNode = this->pRoot;
+		while (!pNode->bLeaf)
+		{
+			const Inner* pInner = static_cast<const Inner*>(pNode);
+			pNode = pInner->pChildren[ChildIndex(pInner, qwKey)];
+		}
+
+		return static_cast<Leaf*>(pNode);
+	}
+
+	static void InsertInLeaf(Leaf* pLeaf, UINT32 nIndex, ULONGLONG qwKey, const V& hValue)
+	{
+		const UINT32 nTail = pLeaf->nCount - nIndex;
+		memmove(pLeaf->pKeys + nIndex + 1, pLeaf->pKeys + nIndex, nTail * sizeof(ULONGLONG));
+		memmove(static_cast<void*>(pLeaf->pValues + nIndex + 1), pLeaf->pValues + nIndex, nTail * sizeof(V));
+
+		pLeaf->pKeys[nIndex] = qwKey;
+		pLeaf->pValues[nIndex] = hValue;
+		pLeaf->nCount++;
+	}
+
+	//Walks back up the path: pChild goes right of qwSeparator in each parent, splitting the full ones
+	void InsertSeparator(Inner** pPath, const UINT32* pSlots, size_t nDepth, ULONGLONG qwSeparator, Node* pChild)
+	{
+		while (nDepth > 0)
+		{
+			nDepth--;
+			Inner* pInner = pPath[nDepth];
+			const UINT32 nSlot = pSlots[nDepth];
+
+			if (pInner->nCount < INNER_KEYS)
+			{
+				const UINT32 nTail = pInner->nCount - nSlot;
+				memmove(pInner->pKeys + nSlot + 1, pInner->pKeys + nSlot, nTail * sizeof(ULONGLONG));
+				memmove(pInner->pChildren + nSlot + 2, pInner->pChildren + nSlot + 1, nTail * sizeof(Node*));
+
+				pInner->pKeys[nSlot] = qwSeparator;
+				pInner->pChildren[nSlot + 1] = pChild;
+				pInner->nCount++;
+				return;
+			}
+
+			//Full: lay out the INNER_KEYS + 1 keys in order, keep the lower half, push the middle key up
+			ULONGLONG pKeys[INNER_KEYS + 1];
+			Node* pChildren[INNER_KEYS + 2];
+
+			memcpy(pKeys, pInner->pKeys, nSlot * sizeof(ULONGLONG));
+			pKeys[nSlot] = qwSeparator;
+			memcpy(pKeys + nSlot + 1, pInner->pKeys + nSlot, (INNER_KEYS - nSlot) * sizeof(ULONGLONG));
+
+			memcpy(pChildren, pInner->pChildren, (nSlot + 1) * sizeof(Node*));
+			pChildren[nSlot + 1] = pChild;
+			memcpy(pChildren + nSlot + 2, pInner->pChildren + nSlot + 1, (INNER_KEYS - nSlot) * sizeof(Node*));
+
+			const size_t nMiddle = (INNER_KEYS + 1) / 2;
+			Inner* pRight = this->NewInner();
+
+			memcpy(pInner->pKeys, pKeys, nMiddle * sizeof(ULONGLONG));
+			memcpy(pInner->pChildren, pChildren, (nMiddle + 1) * sizeof(Node*));
+			std::fill(pInner->pKeys + nMiddle, pInner->pKeys + INNER_SLOTS, BTREE_EMPTY_KEY);
+			pInner->nCount = static_cast<UINT32>(nMiddle);
+
+			const size_t nRight = INNER_KEYS - nMiddle;
+			memcpy(pRight->pKeys, pKeys + nMiddle + 1, nRight * sizeof(ULONGLONG));
+			memcpy(pRight->pChildren, pChildren + nMiddle + 1, (nRight + 1) * sizeof(Node*));
+			pRight->nCount = static_cast<UINT32>(nRight);
+
+			qwSeparator = pKeys[nMiddle];
+			pChild = pRight;
+		}
+
+		//The root split: the tree grows one level
+		Inner* pNewRoot = this->NewInner();
+		pNewRoot->pKeys[0] = qwSeparator;
+		pNewRoot->pChildren[0] = this->pRoot;
+		pNewRoot->pChildren[1] = pChild;
+		pNewRoot->nCount = 1;
+
+		this->pRoot = pNewRoot;
+		this->nHeight++;
+	}
+
+	//Like the std containers, running out of memory throws
+	void* AllocNode()
+	{
+		void* pNode = this->hNodes.alloc(NodeBytes);
+		if (!pNode)
+		{
+			throw std::bad_alloc();
+		}
+
+		return pNode;
+	}
+
+	Leaf* NewLeaf()
+	{
+		Leaf* pLeaf = static_cast<Leaf*>(this->AllocNode());
+		pLeaf->nCount = 0;
+		pLeaf->bLeaf = TRUE;
+		pLeaf->pNext = nullptr;
+		std::fill(pLeaf->pKeys, pLeaf->pKeys + LEAF_SLOTS, BTREE_EMPTY_KEY);
+		this->nLeaves++;
+		return pLeaf;
+	}
+
+	Inner* NewInner()
+	{
+		Inner* pInner = static_cast<Inner*>(this->AllocNode());
+		pInner->nCount = 0;
+		pInner->bLeaf = FALSE;
+		pInner->pNext = nullptr;
+		std::fill(pInner->pKeys, pInner->pKeys + INNER_SLOTS, BTREE_EMPTY_KEY);
+		this->nInners++;
+		return pInner;
+	}
+
+	void FreeSubtree(Node* pNode)
+	{
+		if (!pNode->bLeaf)
+		{
+			Inner* pInner = static_cast<Inner*>(pNode);
+			for (UINT32 i = 0; i <= pInner->nCount; i++)
+			{
+				this->FreeSubtree(pInner->pChildren[i]);
+			}
+		}
+
+		this->hNodes.free_block(pNode);
+	}
+
+	SlabCache hNodes;
+	Node* pRoot;
+	Leaf* pFirstLeaf;
+	size_t nSize;
+	size_t nHeight;
+	size_t nLeaves;
+	size_t nInners;
+};
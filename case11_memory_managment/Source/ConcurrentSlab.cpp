@@ -0,0 +1,231 @@
+#include "ConcurrentSlab.h"
+#include <intrin.h>
+
+struct ConcurrentSlabHeader
+{
+	void* pOwner;                       //Heap that carved the slab and takes its frees
+	ConcurrentSlabHeader* pNextSlab;    //All slabs of the allocator, for the destructor
+	size_t nNextUnused;                 //Owner only
+};
+
+//The first block starts on its own cache line
+constexpr size_t CONCURRENT_SLAB_HEADER_SIZE = 64;
+constexpr size_t CONCURRENT_SLAB_CARVE_BATCH = 64;
+static_assert(sizeof(ConcurrentSlabHeader) <= CONCURRENT_SLAB_HEADER_SIZE, "ConcurrentSlabHeader does not fit its cache line");
+static_assert(CONCURRENT_SLAB_MAX_THREADS <= 64, "Thread slots are one 64-bit mask");
+
+//------------------------------------------------------------
+// Thread slots
+//------------------------------------------------------------
+static std::atomic<ULONGLONG> gqwUsedSlots = 0;
+
+//Claimed on the first call of a thread, released at its exit; -1 when all are taken or already released
+struct ThreadSlot
+{
+	int nSlot = -1;
+	bool bReleased = false;
+
+	~ThreadSlot()
+	{
+		if (this->nSlot >= 0)
+		{
+			gqwUsedSlots.fetch_and(~(1ull << this->nSlot), std::memory_order_acq_rel);
+		}
+
+		//Another thread may claim the slot now: a later thread_local destructor calling in must not reach its heap
+		this->nSlot = -1;
+		this->bReleased = true;
+	}
+};
+
+static thread_local ThreadSlot ghThreadSlot;
+
+static int GetThreadSlot()
+{
+	if (ghThreadSlot.nSlot >= 0 || ghThreadSlot.bReleased)
+	{
+		return ghThreadSlot.nSlot;
+	}
+
+	ULONGLONG qwUsed = gqwUsedSlots.load(std::memory_order_relaxed);
+	while (qwUsed != ~0ull)
+	{
+		unsigned long nFree = 0;
+		_BitScanForward64(&nFree, ~qwUsed);
+
+		if (gqwUsedSlots.compare_exchange_weak(qwUsed, qwUsed | (1ull << nFree), std::memory_order_acq_rel))
+		{
+			ghThreadSlot.nSlot = static_cast<int>(nFree);
+			break;
+		}
+	}
+
+	return ghThreadSlot.nSlot;
+}
+
+static void*& NextOf(void* pBlock)
+{
+	return *reinterpret_cast<void**>(pBlock);
+}
+
+static ConcurrentSlabHeader* SlabOf(void* pPtr)
+{
+	return reinterpret_cast<ConcurrentSlabHeader*>(reinterpret_cast<ULONG_PTR>(pPtr) & ~static_cast<ULONG_PTR>(CONCURRENT_SLAB_SIZE - 1));
+}
+
+//------------------------------------------------------------
+// ConcurrentSlab
+//------------------------------------------------------------
+ConcurrentSlab::ConcurrentSlab(size_t nBlockSizeIn)
+{
+	//A block must hold the free-list link
+	this->nBlockSize = max(nBlockSizeIn, sizeof(void*));
+	this->nBlocksPerSlab = (CONCURRENT_SLAB_SIZE - CONCURRENT_SLAB_HEADER_SIZE) / this->nBlockSize;
+
+	for (Heap& hHeap : this->pHeaps)
+	{
+		hHeap.pLocalFree = nullptr;
+		hHeap.pCarving = nullptr;
+		hHeap.qwAllocs = 0;
+		hHeap.qwLocalFrees = 0;
+		hHeap.qwRemoteFrees = 0;
+		hHeap.qwDrains = 0;
+		hHeap.pRemoteFree.store(nullptr, std::memory_order_relaxed);
+	}
+
+	InitializeSRWLock(&this->hSlabsLock);
+	this->pSlabs = nullptr;
+	this->nSlabs = 0;
+}
+
+ConcurrentSlab::~ConcurrentSlab()
+{
+	while (this->pSlabs)
+	{
+		ConcurrentSlabHeader* pSlab = this->pSlabs;
+		this->pSlabs = pSlab->pNextSlab;
+		VirtualFree(pSlab, 0, MEM_RELEASE);
+	}
+}
+
+//Fills the local free list: remote frees first, then unused blocks, then a new slab
+bool ConcurrentSlab::Refill(Heap& hHeap)
+{
+	void* pDrained = hHeap.pRemoteFree.exchange(nullptr, std::memory_order_acquire);
+	if (pDrained)
+	{
+		hHeap.pLocalFree = pDrained;
+		hHeap.qwDrains++;
+		return true;
+	}
+
+	ConcurrentSlabHeader* pSlab = hHeap.pCarving;
+	if (!pSlab || pSlab->nNextUnused == this->nBlocksPerSlab)
+	{
+		pSlab = reinterpret_cast<ConcurrentSlabHeader*>(VirtualAlloc(nullptr, CONCURRENT_SLAB_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		if (!pSlab)
+		{
+			return false;
+		}
+
+		pSlab->pOwner = &hHeap;
+		pSlab->nNextUnused = 0;
+
+		AcquireSRWLockExclusive(&this->hSlabsLock);
+		pSlab->pNextSlab = this->pSlabs;
+		this->pSlabs = pSlab;
+		this->nSlabs++;
+		ReleaseSRWLockExclusive(&this->hSlabsLock);
+
+		hHeap.pCarving = pSlab;
+	}
+
+	//Carve a batch in reverse so the blocks come out in address order
+	const size_t nFirst = pSlab->nNextUnused;
+	const size_t nCount = min(CONCURRENT_SLAB_CARVE_BATCH, this->nBlocksPerSlab - nFirst);
+	char* pBlocks = reinterpret_cast<char*>(pSlab) + CONCURRENT_SLAB_HEADER_SIZE;
+
+	for (size_t i = nFirst + nCount; i-- > nFirst;)
+	{
+		void* pBlock = pBlocks + i * this->nBlockSize;
+		NextOf(pBlock) = hHeap.pLocalFree;
+		hHeap.pLocalFree = pBlock;
+	}
+
+	pSlab->nNextUnused = nFirst + nCount;
+	return true;
+}
+
+void* ConcurrentSlab::alloc()
+{
+	const int nSlot = GetThreadSlot();
+	if (nSlot < 0)
+	{
+		return nullptr;
+	}
+
+	Heap& hHeap = this->pHeaps[nSlot];
+	if (!hHeap.pLocalFree && !this->Refill(hHeap))
+	{
+		return nullptr;
+	}
+
+	void* pBlock = hHeap.pLocalFree;
+	hHeap.pLocalFree = NextOf(pBlock);
+	hHeap.qwAllocs++;
+	return pBlock;
+}
+
+void ConcurrentSlab::free_block(void* pPtr)
+{
+	if (!pPtr)
+	{
+		return;
+	}
+
+	Heap* pOwner = reinterpret_cast<Heap*>(SlabOf(pPtr)->pOwner);
+
+	const int nSlot = GetThreadSlot();
+	if (nSlot >= 0 && pOwner == &this->pHeaps[nSlot])
+	{
+		NextOf(pPtr) = pOwner->pLocalFree;
+		pOwner->pLocalFree = pPtr;
+		pOwner->qwLocalFrees++;
+		return;
+	}
+
+	//Release: the link written into the block is visible to the owner's acquire exchange
+	void* pHead = pOwner->pRemoteFree.load(std::memory_order_relaxed);
+	do
+	{
+		NextOf(pPtr) = pHead;
+	}
+	while (!pOwner->pRemoteFree.compare_exchange_weak(pHead, pPtr, std::memory_order_release, std::memory_order_relaxed));
+
+	//Counted by the freeing thread, so the owner's cache line only sees the CAS
+	if (nSlot >= 0)
+	{
+		this->pHeaps[nSlot].qwRemoteFrees++;
+	}
+}
+
+void ConcurrentSlab::get_stats(ConcurrentSlabStats* pStats) const
+{
+	ZeroMemory(pStats, sizeof(*pStats));
+
+	ULONGLONG qwAllocs = 0;
+	for (const Heap& hHeap : this->pHeaps)
+	{
+		qwAllocs += hHeap.qwAllocs;
+		pStats->qwLocalFrees += hHeap.qwLocalFrees;
+		pStats->qwRemoteFrees += hHeap.qwRemoteFrees;
+		pStats->qwDrains += hHeap.qwDrains;
+	}
+
+	pStats->nSlabs = this->nSlabs;
+	pStats->qwBytesReserved = static_cast<ULONGLONG>(this->nSlabs) * CONCURRENT_SLAB_SIZE;
+
+	//Remote frees by threads without a slot are not counted: in use is an upper bound then
+	const ULONGLONG qwFrees = pStats->qwLocalFrees + pStats->qwRemoteFrees;
+	pStats->qwBytesInUse = (qwAllocs > qwFrees ? qwAllocs - qwFrees : 0) * this->nBlockSize;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+
+/*
+    Thread-safe fixed-size block allocator for producer/consumer workloads
+    (one thread allocates, another frees).
+
+    - Every thread owns a heap inside the allocator: its slabs and a local free
+      list. alloc() and a free of a block of its own are a pop/push on that
+      list, with no lock and no atomic.
+    - A slab is aligned to CONCURRENT_SLAB_SIZE, so free_block() masks the
+      pointer to find the slab header and its owner heap. A block freed by
+      another thread is pushed onto the owner's remote-free list: a lock-free
+      stack, one CAS per free.
+    - The owner drains the whole remote list with one exchange when its local
+      list runs out (a batch, not one block at a time), before carving new
+      blocks or asking for a new slab.
+    - A heap belongs to a thread slot. Slots are claimed on a thread's first
+      call and released when the thread exits; a thread that claims a released
+      slot inherits that heap with its blocks. At most CONCURRENT_SLAB_MAX_THREADS
+      threads can use the allocators at once.
+    - Slabs are only returned to the OS by the destructor.
+
+    Both the push (many producers) and the drain (exchange with nullptr) are
+    ABA-free: no thread ever pops a single node from the remote stack.
+*/
+constexpr size_t CONCURRENT_SLAB_SIZE = 64 * 1024;
+constexpr size_t CONCURRENT_SLAB_MAX_THREADS = 64;
+
+struct ConcurrentSlabHeader;
+
+struct ConcurrentSlabStats
+{
+	size_t nSlabs;
+	ULONGLONG qwLocalFrees;
+	ULONGLONG qwRemoteFrees;
+	ULONGLONG qwDrains;         //Exchanges that found at least one block: remote frees / drains = average batch
+	ULONGLONG qwBytesReserved;  //Slabs held
+	ULONGLONG qwBytesInUse;     //Blocks allocated and not yet freed
+};
+
+class ConcurrentSlab
+{
+public:
+	ConcurrentSlab(size_t nBlockSizeIn);
+	~ConcurrentSlab();
+
+	ConcurrentSlab(const ConcurrentSlab&) = delete;
+	ConcurrentSlab& operator=(const ConcurrentSlab&) = delete;
+
+	//nullptr if VirtualAlloc fails or more than CONCURRENT_SLAB_MAX_THREADS threads are active
+	void* alloc();
+	void free_block(void* pPtr);
+
+	size_t block_size() const
+	{
+		return this->nBlockSize;
+	}
+
+	//Counters are summed without stopping the threads: exact only when they are idle
+	void get_stats(ConcurrentSlabStats* pStats) const;
+
+private:
+	struct alignas(64) Heap
+	{
+		//Owner only
+		void* pLocalFree;
+		ConcurrentSlabHeader* pCarving;     //Slab whose never-used blocks are handed out next
+		ULONGLONG qwAllocs;
+		ULONGLONG qwLocalFrees;
+		ULONGLONG qwRemoteFrees;            //Blocks this thread pushed to other heaps
+		ULONGLONG qwDrains;
+
+		//Written by the other threads, on its own cache line
+		alignas(64) std::atomic<void*> pRemoteFree;
+	};
+
+	bool Refill(Heap& hHeap);
+
+	size_t nBlockSize;
+	size_t nBlocksPerSlab;
+	Heap pHeaps[CONCURRENT_SLAB_MAX_THREADS];
+
+	SRWLOCK hSlabsLock;                     //Only taken to record a new slab
+	ConcurrentSlabHeader* pSlabs;
+	size_t nSlabs;
+};
@@ -0,0 +1,141 @@
+#include "HugePages.h"
+
+constexpr size_t HUGE_PAGE_BYTES = 1024 * 1024 * 1024;
+
+typedef PVOID (WINAPI* VirtualAlloc2Function)(HANDLE, PVOID, SIZE_T, ULONG, ULONG, MEM_EXTENDED_PARAMETER*, ULONG);
+
+//AdjustTokenPrivileges returns TRUE even if the privilege is not held, the last error tells
+static bool EnableLockMemoryPrivilege()
+{
+	HANDLE hToken = nullptr;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken))
+	{
+		return false;
+	}
+
+	TOKEN_PRIVILEGES hPrivileges = {};
+	hPrivileges.PrivilegeCount = 1;
+	hPrivileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+	if (!LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &hPrivileges.Privileges[0].Luid))
+	{
+		CloseHandle(hToken);
+		return false;
+	}
+
+	const BOOL bAdjusted = AdjustTokenPrivileges(hToken, FALSE, &hPrivileges, 0, nullptr, nullptr);
+	const bool bEnabled = bAdjusted && GetLastError() == ERROR_SUCCESS;
+
+	CloseHandle(hToken);
+	return bEnabled;
+}
+
+//Function-local statics: evaluated once, thread-safe
+static bool HasLockMemoryPrivilege()
+{
+	static const bool bEnabled = EnableLockMemoryPrivilege();
+	return bEnabled;
+}
+
+static VirtualAlloc2Function GetVirtualAlloc2()
+{
+	static const VirtualAlloc2Function pFunction = []
+	{
+		HMODULE hKernelBase = GetModuleHandleA("kernelbase.dll");
+		return hKernelBase ? reinterpret_cast<VirtualAlloc2Function>(reinterpret_cast<void*>(GetProcAddress(hKernelBase, "VirtualAlloc2"))) : nullptr;
+	}();
+
+	return pFunction;
+}
+
+size_t PageKindBytes(PageKind eKind)
+{
+	switch (eKind)
+	{
+	case PAGE_KIND_LARGE:
+		return GetLargePageMinimum();
+	case PAGE_KIND_HUGE:
+		return GetVirtualAlloc2() && GetLargePageMinimum() ? HUGE_PAGE_BYTES : 0;
+	default:
+		return 4096;
+	}
+}
+
+const char* PageKindName(PageKind eKind)
+{
+	switch (eKind)
+	{
+	case PAGE_KIND_LARGE:
+		return "2 MB";
+	case PAGE_KIND_HUGE:
+		return "1 GB";
+	default:
+		return "4 KB";
+	}
+}
+
+static void* TryAlloc(size_t nSize, PageKind eKind)
+{
+	if (eKind == PAGE_KIND_SMALL)
+	{
+		return VirtualAlloc(nullptr, nSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+
+	if (!HasLockMemoryPrivilege())
+	{
+		return nullptr;
+	}
+
+	if (eKind == PAGE_KIND_LARGE)
+	{
+		return VirtualAlloc(nullptr, nSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	}
+
+	MEM_EXTENDED_PARAMETER hParameter = {};
+	hParameter.Type = MemExtendedParameterAttributeFlags;
+	hParameter.ULong64 = MEM_EXTENDED_PARAMETER_NONPAGED_HUGE;
+
+	return GetVirtualAlloc2()(GetCurrentProcess(), nullptr, nSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, &hParameter, 1);
+}
+
+bool AllocPageRegion(size_t nSize, PageKind ePreferred, PageRegion* pRegion)
+{
+	pRegion->pBase = nullptr;
+	pRegion->nSize = 0;
+	pRegion->eKind = PAGE_KIND_SMALL;
+
+	for (int nKind = ePreferred; nKind >= PAGE_KIND_SMALL; nKind--)
+	{
+		const PageKind eKind = static_cast<PageKind>(nKind);
+
+		const size_t nPage = PageKindBytes(eKind);
+		if (!nPage)
+		{
+			continue;
+		}
+
+		const size_t nRounded = (nSize + nPage - 1) / nPage * nPage;
+
+		void* pBase = TryAlloc(nRounded, eKind);
+		if (pBase)
+		{
+			pRegion->pBase = reinterpret_cast<char*>(pBase);
+			pRegion->nSize = nRounded;
+			pRegion->eKind = eKind;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FreePageRegion(PageRegion* pRegion)
+{
+	if (pRegion->pBase)
+	{
+		VirtualFree(pRegion->pBase, 0, MEM_RELEASE);
+	}
+
+	pRegion->pBase = nullptr;
+	pRegion->nSize = 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Page-size backend for the allocators: 4 KB, 2 MB (large) or 1 GB (huge) pages.
+
+    - PAGE_KIND_LARGE is VirtualAlloc(MEM_LARGE_PAGES), PAGE_KIND_HUGE is
+      VirtualAlloc2 with MEM_EXTENDED_PARAMETER_NONPAGED_HUGE (Windows 10 1803+,
+      resolved at run time). Both need SeLockMemoryPrivilege granted to the
+      account; it is enabled in the token on first use.
+    - Windows has no transparent huge pages: large pages are locked, never paged
+      out, and must be physically contiguous, so they can fail on a fragmented
+      machine even with the privilege.
+    - AllocPageRegion falls back HUGE -> LARGE -> SMALL and reports the kind it
+      obtained; the size is rounded up to that page size.
+*/
+enum PageKind
+{
+	PAGE_KIND_SMALL,
+	PAGE_KIND_LARGE,
+	PAGE_KIND_HUGE,
+};
+
+struct PageRegion
+{
+	char* pBase;
+	size_t nSize;       //Rounded up to the page size of eKind
+	PageKind eKind;     //What was obtained, may be smaller than requested
+};
+
+bool AllocPageRegion(size_t nSize, PageKind ePreferred, PageRegion* pRegion);
+void FreePageRegion(PageRegion* pRegion);
+
+//0 when the kind is not supported by the machine
+size_t PageKindBytes(PageKind eKind);
+const char* PageKindName(PageKind eKind);
@@ -1,6 +1,28 @@
 #include <iostream>
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <iomanip>
 #include "Benchmark.h"
+#include "ThreadCache.h"
+#include "SlabCache.h"
+#include "Arena.h"
+#include "MemoryResources.h"
+#include "HugePages.h"
+#include "ConcurrentSlab.h"
+#include "ObjectPool.h"
+#include "AllocTrace.h"
+#include "MemoryCounters.h"
+#include "AllocProfiler.h"
+#include "Numa.h"
+#include "SmallVector.h"
+#include "BPlusTree.h"
 
 constexpr size_t N = 5'000'000;
 constexpr size_t BLOCK_SIZE = 64;
@@ -33,17 +55,36 @@ struct Pool
 	char* pMemory;
 	size_t nOffset;
 	size_t nCapacity;
+	PageRegion hRegion;     //Only used by the page-backed constructor
 
 	Pool(size_t nSize)
 	{
 		this->pMemory = reinterpret_cast<char*>(HeapAlloc(GetProcessHeap(), HEAP_NO_SERIALIZE, nSize));
 		this->nOffset = 0;
 		this->nCapacity = nSize;
+		this->hRegion = {};
+	}
+
+	//Backed by 4 KB, 2 MB or 1 GB pages (falls back to smaller ones, see hRegion.eKind)
+	Pool(size_t nSize, PageKind ePages)
+	{
+		AllocPageRegion(nSize, ePages, &this->hRegion);
+		this->pMemory = this->hRegion.pBase;
+		this->nOffset = 0;
+		this->nCapacity = this->pMemory ? nSize : 0;
 	}
 
 	~Pool()
 	{
-		HeapFree(GetProcessHeap(), HEAP_NO_SERIALIZE, this->pMemory);
+		if (this->hRegion.pBase)
+		{
+			FreePageRegion(&this->hRegion);
+		}
+		else
+		{
+			HeapFree(GetProcessHeap(), HEAP_NO_SERIALIZE, this->pMemory);
+		}
+
 		this->pMemory = nullptr;
 	}
 
@@ -63,12 +104,22 @@ struct Pool
 	{
 		this->nOffset = 0;
 	}
+
+	size_t bytes_reserved() const
+	{
+		return this->nCapacity;
+	}
+
+	size_t bytes_in_use() const
+	{
+		return this->nOffset;
+	}
 };
 
 //------------------------------------------------------------
 // Test 2 — Pool allocator
 //------------------------------------------------------------
-static void Test_PoolAlloc()
+static void Test_PoolAlloc(AllocatorFootprint* pFootprint)
 {
 	Pool hPool(N * BLOCK_SIZE);
 
@@ -82,6 +133,7 @@ static void Test_PoolAlloc()
 		}
 	}
 
+	*pFootprint = { hPool.bytes_reserved(), hPool.bytes_in_use() };
 	hPool.reset();
 }
 
@@ -94,19 +146,46 @@ struct Slab
 	void* pFreeList;
 	size_t nBlockSize;
 	size_t nCapacity;
+	size_t nInUse;
+	PageKind ePages;        //Pages obtained by the page-backed constructor
 
 	Slab(size_t nBlockSizeIn)
 	{
 		this->nBlockSize = nBlockSizeIn;
 		this->nCapacity = SLAB_SIZE / nBlockSizeIn;
+		this->ePages = PAGE_KIND_SMALL;
 
 		this->pMemory = reinterpret_cast<char*>(VirtualAlloc(nullptr, SLAB_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		this->BuildFreeList();
+	}
+
+	//nSlabSize bytes of 4 KB, 2 MB or 1 GB pages (falls back to smaller ones, see ePages); the rounding past nSlabSize stays unused
+	Slab(size_t nBlockSizeIn, size_t nSlabSize, PageKind ePagesIn)
+	{
+		PageRegion hRegion = {};
+		AllocPageRegion(nSlabSize, ePagesIn, &hRegion);
+
+		this->nBlockSize = nBlockSizeIn;
+		this->nCapacity = nSlabSize / nBlockSizeIn;
+		this->ePages = hRegion.eKind;
+		this->pMemory = hRegion.pBase;
+		this->BuildFreeList();
+	}
+
+	void BuildFreeList()
+	{
 		this->pFreeList = nullptr;
+		this->nInUse = 0;
+		if (!this->pMemory)
+		{
+			this->nCapacity = 0;
+			return;
+		}
 
 		// build free list
 		for (size_t i = 0; i < this->nCapacity; i++)
 		{
-			void* pPtr = this->pMemory + i * nBlockSizeIn;
+			void* pPtr = this->pMemory + i * this->nBlockSize;
 			*reinterpret_cast<void**>(pPtr) = this->pFreeList;
 			this->pFreeList = pPtr;
 		}
@@ -127,6 +206,7 @@ struct Slab
 
 		void* pPtr = this->pFreeList;
 		this->pFreeList = *reinterpret_cast<void**>(this->pFreeList);
+		this->nInUse++;
 		return pPtr;
 	}
 
@@ -134,17 +214,29 @@ struct Slab
 	{
 		*reinterpret_cast<void**>(pPtr) = this->pFreeList;
 		this->pFreeList = pPtr;
+		this->nInUse--;
+	}
+
+	size_t bytes_reserved() const
+	{
+		return this->nCapacity * this->nBlockSize;
+	}
+
+	size_t bytes_in_use() const
+	{
+		return this->nInUse * this->nBlockSize;
 	}
 };
 
 //------------------------------------------------------------
 // Test 3 — Slab allocator
 //------------------------------------------------------------
-static void Test_SlabAlloc()
+static void Test_SlabAlloc(AllocatorFootprint* pFootprint)
 {
 	Slab hSlab(BLOCK_SIZE);
 
-	std::vector<void*> vAllocated;
+	//At most SLAB_SIZE / BLOCK_SIZE blocks: the list lives inside the function's frame, no heap
+	SmallVector<void*, SLAB_SIZE / BLOCK_SIZE> vAllocated;
 	vAllocated.reserve(hSlab.nCapacity);
 
 	// allocate all
@@ -164,19 +256,1813 @@ static void Test_SlabAlloc()
 	{
 		hSlab.free_block(pPtr);
 	}
+
+	*pFootprint = { hSlab.bytes_reserved(), hSlab.bytes_in_use() };
 }
 
 //------------------------------------------------------------
-// MAIN
+// Test 4 — Thread-caching allocator vs malloc
 //------------------------------------------------------------
-int main()
+constexpr size_t TC_LIVE_SLOTS = 1024;
+constexpr size_t TC_MIXED_OPS = 4'000'000;
+constexpr size_t TC_MAX_THREADS = 8;
+
+typedef void* (*MallocFunction)(size_t);
+typedef void (*FreeFunction)(void*);
+
+static void* CrtMalloc(size_t nSize)
 {
-	std::cout << "Memory Case Benchmarks\n\n";
+	return malloc(nSize);
+}
 
-	std::cout << "malloc/free: "    << BenchmarkQPC(Test_malloc)    << " ms" << std::endl;
-	std::cout << "Pool Allocator: " << BenchmarkQPC(Test_PoolAlloc) << " ms" << std::endl;
-	std::cout << "Slab Allocator: " << BenchmarkQPC(Test_SlabAlloc) << " ms" << std::endl;
+static void CrtFree(void* pPtr)
+{
+	free(pPtr);
+}
 
-	system("pause");
-	return 0;
-}
\ No newline at end of file
+static void Test_FixedPairs(MallocFunction pMalloc, FreeFunction pFree)
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		char* pPtr = reinterpret_cast<char*>(pMalloc(BLOCK_SIZE));
+		if (pPtr)
+		{
+			pPtr[0] = static_cast<char>(i);
+			gnSink += pPtr[0];
+			pFree(pPtr);
+		}
+	}
+}
+
+//Random sizes in [16, 1024] with a window of TC_LIVE_SLOTS live blocks: each step frees a random slot and refills it
+static void Test_MixedSizes(MallocFunction pMalloc, FreeFunction pFree, const std::vector<UINT16>& vSizes, const std::vector<UINT16>& vSlots)
+{
+	std::vector<char*> vLive(TC_LIVE_SLOTS, nullptr);
+
+	//Local sum, published once: Test_MixedSizesThreaded runs this on every thread and a shared volatile would bounce between cores
+	int nSum = 0;
+	for (size_t i = 0; i < vSizes.size(); i++)
+	{
+		char*& pSlot = vLive[vSlots[i]];
+		pFree(pSlot);
+
+		pSlot = reinterpret_cast<char*>(pMalloc(vSizes[i]));
+		if (pSlot)
+		{
+			pSlot[0] = static_cast<char>(i);
+			nSum += pSlot[0];
+		}
+	}
+
+	for (char* pPtr : vLive)
+	{
+		pFree(pPtr);
+	}
+
+	gnSink += nSum;
+}
+
+//One thread per entry of vThreadSizes/vThreadSlots, each on its own pre-built sequence
+static void Test_MixedSizesThreaded(MallocFunction pMalloc, FreeFunction pFree, const std::vector<std::vector<UINT16>>& vThreadSizes, const std::vector<std::vector<UINT16>>& vThreadSlots)
+{
+	std::vector<std::thread> vThreads;
+
+	for (size_t t = 0; t < vThreadSizes.size(); t++)
+	{
+		vThreads.emplace_back([pMalloc, pFree, &vThreadSizes, &vThreadSlots, t]
+		{
+			Test_MixedSizes(pMalloc, pFree, vThreadSizes[t], vThreadSlots[t]);
+		});
+	}
+
+	for (std::thread& hThread : vThreads)
+	{
+		hThread.join();
+	}
+}
+
+static void Bench_ThreadCache()
+{
+	std::cout << "\n--- Thread-caching allocator (tc_malloc) vs CRT malloc ---\n";
+
+	//Both runs sampled; tc_malloc's footprint is read after its run, with the thread caches still full
+	auto Compare = [] (const char* pLabel, auto&& MallocRun, auto&& TcRun)
+	{
+		MemoryProfile hMallocProfile;
+		MemoryProfile hTcProfile;
+
+		const double dMalloc = BenchmarkQPCMemory(MallocRun, &hMallocProfile);
+		const double dTc = BenchmarkQPCMemory(TcRun, &hTcProfile);
+
+		TcStats hStats = {};
+		tc_get_stats(&hStats);
+
+		std::cout << pLabel << "malloc: " << dMalloc << " ms  tc_malloc: " << dTc << " ms" << std::endl;
+		PrintMemoryProfile("malloc", hMallocProfile);
+		PrintMemoryProfile("tc_malloc", hTcProfile, { hStats.qwCommittedBytes + hStats.qwDirectBytes, hStats.qwInUseBytes });
+	};
+
+	Compare("64 B alloc/free pairs   ", [] { Test_FixedPairs(CrtMalloc, CrtFree); }, [] { Test_FixedPairs(tc_malloc, tc_free); });
+
+	std::mt19937 hRandom(1234);
+	std::vector<UINT16> vSizes(TC_MIXED_OPS);
+	std::vector<UINT16> vSlots(TC_MIXED_OPS);
+
+	for (size_t i = 0; i < TC_MIXED_OPS; i++)
+	{
+		vSizes[i] = static_cast<UINT16>(16 + hRandom() % 1009);
+		vSlots[i] = static_cast<UINT16>(hRandom() % TC_LIVE_SLOTS);
+	}
+
+	Compare("16-1024 B mixed, 1 thr  ", [&] { Test_MixedSizes(CrtMalloc, CrtFree, vSizes, vSlots); }, [&] { Test_MixedSizes(tc_malloc, tc_free, vSizes, vSlots); });
+
+	//Same total work split between the threads: flat times mean linear scaling
+	for (size_t nThreads = 2; nThreads <= TC_MAX_THREADS; nThreads *= 2)
+	{
+		//Each thread does its share of the operations on its own sequence, generated outside the timing
+		std::vector<std::vector<UINT16>> vThreadSizes(nThreads, std::vector<UINT16>(TC_MIXED_OPS / nThreads));
+		std::vector<std::vector<UINT16>> vThreadSlots(nThreads, std::vector<UINT16>(TC_MIXED_OPS / nThreads));
+
+		for (size_t t = 0; t < nThreads; t++)
+		{
+			std::mt19937 hThreadRandom(static_cast<unsigned>(t + 1));
+			for (size_t i = 0; i < vThreadSizes[t].size(); i++)
+			{
+				vThreadSizes[t][i] = static_cast<UINT16>(16 + hThreadRandom() % 1009);
+				vThreadSlots[t][i] = static_cast<UINT16>(hThreadRandom() % TC_LIVE_SLOTS);
+			}
+		}
+
+		const std::string strLabel = "16-1024 B mixed, " + std::to_string(nThreads) + " thr  ";
+		Compare(strLabel.c_str(), [&] { Test_MixedSizesThreaded(CrtMalloc, CrtFree, vThreadSizes, vThreadSlots); }, [&] { Test_MixedSizesThreaded(tc_malloc, tc_free, vThreadSizes, vThreadSlots); });
+	}
+
+	tc_flush_thread_cache();
+
+	TcStats hStats = {};
+	tc_get_stats(&hStats);
+	std::cout << "tc_malloc arena: " << hStats.qwArenaBytes / 1024 << " KB, committed: " << hStats.qwCommittedBytes / 1024 << " KB, in use: " << hStats.qwInUseBytes / 1024 << " KB" << std::endl;
+}
+
+//------------------------------------------------------------
+// Test 5 — Growable slab cache
+//------------------------------------------------------------
+constexpr size_t SLAB_CACHE_OBJECTS = 200'000;
+constexpr size_t SLAB_CACHE_CHURN_OPS = 4'000'000;
+constexpr size_t SLAB_CACHE_ROUNDS = 20;
+
+static void PrintSlabCacheStats(const SlabCache& hCache)
+{
+	SlabCacheStats hStats;
+	hCache.get_stats(&hStats);
+
+	std::cout << "    slabs partial/full/empty: " << hStats.nSlabsPartial << "/" << hStats.nSlabsFull << "/" << hStats.nSlabsEmpty
+	          << ", created: " << hStats.nSlabsCreated << ", released: " << hStats.nSlabsReleased
+	          << ", reserved: " << hStats.qwBytesReserved / 1024 << " KB, in use: " << hStats.qwBytesInUse / 1024 << " KB\n";
+}
+
+//SLAB_CACHE_OBJECTS blocks of 64 bytes, far beyond the 64 of the single-page Slab, allocated then freed in rounds
+static void Test_SlabCacheFill(SlabCache& hCache, std::vector<void*>& vBlocks)
+{
+	for (size_t r = 0; r < SLAB_CACHE_ROUNDS; r++)
+	{
+		for (size_t i = 0; i < SLAB_CACHE_OBJECTS; i++)
+		{
+			char* pPtr = reinterpret_cast<char*>(hCache.alloc(BLOCK_SIZE));
+			pPtr[0] = static_cast<char>(i);
+			gnSink += pPtr[0];
+			vBlocks[i] = pPtr;
+		}
+
+		for (size_t i = 0; i < SLAB_CACHE_OBJECTS; i++)
+		{
+			hCache.free_block(vBlocks[i]);
+		}
+	}
+}
+
+static void Test_MallocFill(std::vector<void*>& vBlocks)
+{
+	for (size_t r = 0; r < SLAB_CACHE_ROUNDS; r++)
+	{
+		for (size_t i = 0; i < SLAB_CACHE_OBJECTS; i++)
+		{
+			char* pPtr = reinterpret_cast<char*>(malloc(BLOCK_SIZE));
+			pPtr[0] = static_cast<char>(i);
+			gnSink += pPtr[0];
+			vBlocks[i] = pPtr;
+		}
+
+		for (size_t i = 0; i < SLAB_CACHE_OBJECTS; i++)
+		{
+			free(vBlocks[i]);
+		}
+	}
+}
+
+/*
+    Churn: a window of SLAB_CACHE_OBJECTS live blocks of mixed classes. Every step
+    frees a random block and allocates one of a random size, so slabs keep moving
+    between the partial, full and empty lists.
+*/
+template<typename AllocFunction, typename FreeFunction>
+static void Test_Churn(AllocFunction&& Alloc, FreeFunction&& Free, const std::vector<UINT16>& vSizes, const std::vector<UINT32>& vSlots)
+{
+	std::vector<char*> vLive(SLAB_CACHE_OBJECTS, nullptr);
+
+	for (size_t i = 0; i < vSizes.size(); i++)
+	{
+		char*& pSlot = vLive[vSlots[i]];
+		Free(pSlot);
+
+		pSlot = reinterpret_cast<char*>(Alloc(vSizes[i]));
+		pSlot[0] = static_cast<char>(i);
+		gnSink += pSlot[0];
+	}
+
+	for (char* pPtr : vLive)
+	{
+		Free(pPtr);
+	}
+}
+
+//Grow to SLAB_CACHE_OBJECTS, free 90% at random, grow again: shows slab reuse and the watermark at work
+//vOrder holds one shuffled permutation of the objects per round; the first 90% of each is freed
+template<typename AllocFunction, typename FreeFunction>
+static void Test_GrowShrink(AllocFunction&& Alloc, FreeFunction&& Free, const std::vector<UINT16>& vSizes, const std::vector<UINT32>& vOrder)
+{
+	std::vector<char*> vLive(SLAB_CACHE_OBJECTS, nullptr);
+
+	for (size_t r = 0; r < SLAB_CACHE_ROUNDS; r++)
+	{
+		for (size_t i = 0; i < SLAB_CACHE_OBJECTS; i++)
+		{
+			if (!vLive[i])
+			{
+				vLive[i] = reinterpret_cast<char*>(Alloc(vSizes[i]));
+				vLive[i][0] = static_cast<char>(i);
+			}
+		}
+
+		const UINT32* pRound = vOrder.data() + r * SLAB_CACHE_OBJECTS;
+		for (size_t i = 0; i < SLAB_CACHE_OBJECTS * 9 / 10; i++)
+		{
+			char*& pSlot = vLive[pRound[i]];
+			Free(pSlot);
+			pSlot = nullptr;
+		}
+	}
+
+	for (char* pPtr : vLive)
+	{
+		Free(pPtr);
+	}
+}
+
+static void Bench_SlabCache()
+{
+	std::cout << "\n--- Growable slab cache vs malloc ---\n";
+
+	//The memory line of the cache carries its reserved/in-use bytes after the run: what a watermark keeps
+	auto Compare = [] (const char* pLabel, const SlabCache& hCache, auto&& MallocRun, auto&& CacheRun)
+	{
+		MemoryProfile hMallocProfile;
+		MemoryProfile hCacheProfile;
+
+		const double dMalloc = BenchmarkQPCMemory(MallocRun, &hMallocProfile);
+		const double dCache = BenchmarkQPCMemory(CacheRun, &hCacheProfile);
+
+		SlabCacheStats hStats;
+		hCache.get_stats(&hStats);
+
+		std::cout << pLabel << "malloc: " << dMalloc << " ms  SlabCache: " << dCache << " ms" << std::endl;
+		PrintSlabCacheStats(hCache);
+		PrintMemoryProfile("malloc", hMallocProfile);
+		PrintMemoryProfile("SlabCache", hCacheProfile, { hStats.qwBytesReserved, hStats.qwBytesInUse });
+	};
+
+	std::vector<void*> vBlocks(SLAB_CACHE_OBJECTS);
+
+	//Watermark 1 gives every slab back between rounds, 256 keeps all of them
+	for (size_t nWatermark : { static_cast<size_t>(1), static_cast<size_t>(256) })
+	{
+		SlabCache hFillCache(nWatermark);
+		const std::string strLabel = std::to_string(SLAB_CACHE_OBJECTS) + " x 64 B, " + std::to_string(SLAB_CACHE_ROUNDS) + " rounds, watermark " + std::to_string(nWatermark) + "  ";
+		Compare(strLabel.c_str(), hFillCache, [&] { Test_MallocFill(vBlocks); }, [&] { Test_SlabCacheFill(hFillCache, vBlocks); });
+	}
+
+	std::mt19937 hRandom(4321);
+	std::vector<UINT16> vSizes(SLAB_CACHE_CHURN_OPS);
+	std::vector<UINT32> vSlots(SLAB_CACHE_CHURN_OPS);
+
+	for (size_t i = 0; i < SLAB_CACHE_CHURN_OPS; i++)
+	{
+		vSizes[i] = static_cast<UINT16>(16 + hRandom() % 497);
+		vSlots[i] = static_cast<UINT32>(hRandom() % SLAB_CACHE_OBJECTS);
+	}
+
+	auto CrtAlloc = [] (size_t nSize) { return malloc(nSize); };
+	auto CrtRelease = [] (void* pPtr) { free(pPtr); };
+
+	SlabCache hChurnCache;
+	auto CacheAlloc = [&] (size_t nSize) { return hChurnCache.alloc(nSize); };
+	auto CacheRelease = [&] (void* pPtr) { hChurnCache.free_block(pPtr); };
+
+	Compare("Churn, 16-512 B        ", hChurnCache, [&] { Test_Churn(CrtAlloc, CrtRelease, vSizes, vSlots); }, [&] { Test_Churn(CacheAlloc, CacheRelease, vSizes, vSlots); });
+
+	//A fresh 90% subset every round, drawn before the timing starts
+	std::vector<UINT32> vShrinkOrder(SLAB_CACHE_ROUNDS * SLAB_CACHE_OBJECTS);
+	for (size_t r = 0; r < SLAB_CACHE_ROUNDS; r++)
+	{
+		const auto itRound = vShrinkOrder.begin() + r * SLAB_CACHE_OBJECTS;
+		for (size_t i = 0; i < SLAB_CACHE_OBJECTS; i++)
+		{
+			itRound[i] = static_cast<UINT32>(i);
+		}
+
+		std::shuffle(itRound, itRound + SLAB_CACHE_OBJECTS, hRandom);
+	}
+
+	//Watermark 0 releases every slab as soon as it empties, 4 keeps a few per class to absorb the next burst
+	for (size_t nWatermark : { static_cast<size_t>(0), static_cast<size_t>(4) })
+	{
+		SlabCache hGrowCache(nWatermark);
+		auto GrowAlloc = [&] (size_t nSize) { return hGrowCache.alloc(nSize); };
+		auto GrowRelease = [&] (void* pPtr) { hGrowCache.free_block(pPtr); };
+
+		const std::string strLabel = "Grow/shrink 90%, watermark " + std::to_string(nWatermark) + "  ";
+		Compare(strLabel.c_str(), hGrowCache, [&] { Test_GrowShrink(CrtAlloc, CrtRelease, vSizes, vShrinkOrder); }, [&] { Test_GrowShrink(GrowAlloc, GrowRelease, vSizes, vShrinkOrder); });
+	}
+}
+
+//------------------------------------------------------------
+// Test 6 — Arena and std::pmr containers
+//------------------------------------------------------------
+constexpr size_t PMR_ELEMENTS = 1'000'000;
+constexpr size_t PMR_REQUESTS = 20'000;
+constexpr size_t PMR_REQUEST_ELEMENTS = 200;
+
+static void Test_PmrVector(std::pmr::memory_resource* pResource)
+{
+	std::pmr::vector<int> vValues(pResource);
+
+	for (size_t i = 0; i < PMR_ELEMENTS; i++)
+	{
+		vValues.push_back(static_cast<int>(i));
+	}
+
+	gnSink += vValues.back();
+}
+
+static void Test_PmrMap(std::pmr::memory_resource* pResource, const std::vector<int>& vKeys)
+{
+	std::pmr::map<int, int> mValues(pResource);
+
+	for (int nKey : vKeys)
+	{
+		mValues[nKey] = nKey;
+	}
+
+	gnSink += static_cast<int>(mValues.size());
+}
+
+static void Test_PmrUnorderedMap(std::pmr::memory_resource* pResource, const std::vector<int>& vKeys)
+{
+	std::pmr::unordered_map<int, int> mValues(pResource);
+
+	for (int nKey : vKeys)
+	{
+		mValues[nKey] = nKey;
+	}
+
+	gnSink += static_cast<int>(mValues.size());
+}
+
+/*
+    Per-request pattern: every request builds a few short-lived containers and
+    throws them away. With the arena the containers never free anything, the
+    scope rolls the whole request back at once.
+*/
+static void HandleRequest(std::pmr::memory_resource* pResource, const std::vector<int>& vKeys, size_t nRequest)
+{
+	std::pmr::vector<int> vIds(pResource);
+	std::pmr::unordered_map<int, int> mIndex(pResource);
+	std::pmr::map<int, std::pmr::string> mNames(pResource);
+
+	for (size_t i = 0; i < PMR_REQUEST_ELEMENTS; i++)
+	{
+		const int nKey = vKeys[(nRequest * PMR_REQUEST_ELEMENTS + i) % vKeys.size()];
+
+		vIds.push_back(nKey);
+		mIndex[nKey] = static_cast<int>(i);
+		mNames.emplace(nKey, std::pmr::string("request field with a heap-sized value", pResource));
+	}
+
+	gnSink += static_cast<int>(vIds.size() + mIndex.size() + mNames.size());
+}
+
+static void Test_RequestsDefault(const std::vector<int>& vKeys)
+{
+	for (size_t r = 0; r < PMR_REQUESTS; r++)
+	{
+		HandleRequest(std::pmr::get_default_resource(), vKeys, r);
+	}
+}
+
+static void Test_RequestsArena(Arena& hArena, const std::vector<int>& vKeys)
+{
+	ArenaResource hResource(hArena);
+
+	for (size_t r = 0; r < PMR_REQUESTS; r++)
+	{
+		ArenaScope hScope(hArena);
+		HandleRequest(&hResource, vKeys, r);
+	}
+}
+
+static void Bench_PmrContainers()
+{
+	std::cout << "\n--- std::pmr containers: default resource vs Arena vs SlabCache ---\n";
+
+	std::mt19937 hRandom(777);
+	std::vector<int> vKeys(PMR_ELEMENTS);
+	for (int& nKey : vKeys)
+	{
+		nKey = static_cast<int>(hRandom());
+	}
+
+	std::pmr::memory_resource* pDefault = std::pmr::get_default_resource();
+
+	//A fresh arena and cache per test, so each one starts cold like the default resource's containers
+	auto RunCase = [&] (const char* pName, auto&& Test)
+	{
+		Arena hArena;
+		ArenaResource hArenaResource(hArena);
+		SlabCache hCache(16);
+		SlabCacheResource hCacheResource(hCache);
+
+		MemoryProfile hDefaultProfile;
+		MemoryProfile hArenaProfile;
+		MemoryProfile hCacheProfile;
+
+		const double dDefault = BenchmarkQPCMemory([&] { Test(pDefault); }, &hDefaultProfile);
+		const double dArena = BenchmarkQPCMemory([&] { Test(&hArenaResource); }, &hArenaProfile);
+		const double dCache = BenchmarkQPCMemory([&] { Test(&hCacheResource); }, &hCacheProfile);
+
+		SlabCacheStats hStats;
+		hCache.get_stats(&hStats);
+
+		std::cout << pName << "  default: " << dDefault << " ms  Arena: " << dArena << " ms  SlabCache: " << dCache << " ms"
+		          << "  (arena reserved " << hArena.bytes_reserved() / 1024 << " KB)" << std::endl;
+
+		//The containers are gone by now: whatever the arena still counts as used is memory only reset() gives back
+		PrintMemoryProfile("default", hDefaultProfile);
+		PrintMemoryProfile("Arena", hArenaProfile, { hArena.bytes_reserved(), hArena.bytes_used() });
+		PrintMemoryProfile("SlabCache", hCacheProfile, { hStats.qwBytesReserved, hStats.qwBytesInUse });
+	};
+
+	RunCase("vector<int> push_back x1M   ", [&] (std::pmr::memory_resource* pResource) { Test_PmrVector(pResource); });
+	RunCase("map<int,int> insert x1M     ", [&] (std::pmr::memory_resource* pResource) { Test_PmrMap(pResource, vKeys); });
+	RunCase("unordered_map insert x1M    ", [&] (std::pmr::memory_resource* pResource) { Test_PmrUnorderedMap(pResource, vKeys); });
+
+	Arena hRequestArena;
+	MemoryProfile hDefaultProfile;
+	MemoryProfile hArenaProfile;
+
+	const double dDefault = BenchmarkQPCMemory([&] { Test_RequestsDefault(vKeys); }, &hDefaultProfile);
+	const double dArena = BenchmarkQPCMemory([&] { Test_RequestsArena(hRequestArena, vKeys); }, &hArenaProfile);
+
+	std::cout << PMR_REQUESTS << " requests x " << PMR_REQUEST_ELEMENTS << " elements  default: " << dDefault << " ms"
+	          << "  Arena + ArenaScope: " << dArena << " ms  (blocks after the run: " << hRequestArena.block_count() << ")" << std::endl;
+	PrintMemoryProfile("default", hDefaultProfile);
+	PrintMemoryProfile("Arena", hArenaProfile, { hRequestArena.bytes_reserved(), hRequestArena.bytes_used() });
+}
+
+//------------------------------------------------------------
+// Test 7 — Page sizes: 4 KB vs 2 MB vs 1 GB
+//------------------------------------------------------------
+constexpr size_t TLB_BUFFER_BYTES = 1024 * 1024 * 1024;     //Power of two, the random walk masks with it
+constexpr size_t TLB_RANDOM_ACCESSES = 16 * 1024 * 1024;
+constexpr size_t TLB_SLAB_BYTES = 256 * 1024 * 1024;
+
+//One write per 4 KB: the page faults (4 KB pages) or nothing at all (large pages are committed up front)
+static void Test_FirstTouch(ULONGLONG* pWords, size_t nWords)
+{
+	for (size_t i = 0; i < nWords; i += 4096 / sizeof(ULONGLONG))
+	{
+		pWords[i] = i;
+	}
+}
+
+//One read per cache line: the hardware prefetcher and the page walker keep up, page size matters little
+static ULONGLONG Test_SequentialRead(const ULONGLONG* pWords, size_t nWords)
+{
+	ULONGLONG qwSum = 0;
+	for (size_t i = 0; i < nWords; i += 64 / sizeof(ULONGLONG))
+	{
+		qwSum += pWords[i];
+	}
+
+	return qwSum;
+}
+
+/*
+    Dependent random reads: each address depends on the previous load, so every
+    miss is paid in full. With 4 KB pages 1 GB spans 262144 pages, far beyond the
+    ~1.5-2K STLB entries, and nearly every access also walks the page tables;
+    with 2 MB pages it is 512 pages, with 1 GB pages a single one.
+*/
+static ULONGLONG Test_RandomRead(const ULONGLONG* pWords, size_t nWords)
+{
+	ULONGLONG qwState = 0x9E3779B97F4A7C15ull;
+	for (size_t i = 0; i < TLB_RANDOM_ACCESSES; i++)
+	{
+		qwState ^= qwState << 13;
+		qwState ^= qwState >> 7;
+		qwState ^= qwState << 17;
+		qwState += pWords[qwState & (nWords - 1)];
+	}
+
+	return qwState;
+}
+
+static void Test_PoolPages(PageKind ePages, PageKind* pObtained)
+{
+	Pool hPool(N * BLOCK_SIZE, ePages);
+	*pObtained = hPool.hRegion.eKind;
+
+	for (size_t i = 0; i < N; i++)
+	{
+		char* pPtr = reinterpret_cast<char*>(hPool.alloc(BLOCK_SIZE));
+		if (pPtr)
+		{
+			pPtr[0] = static_cast<char>(i);
+			gnSink += pPtr[0];
+		}
+	}
+}
+
+//Allocates every block, then touches them in a shuffled order (the order is the same for every page size)
+static void Test_SlabPages(PageKind ePages, const std::vector<UINT32>& vOrder, PageKind* pObtained)
+{
+	Slab hSlab(BLOCK_SIZE, TLB_SLAB_BYTES, ePages);
+	*pObtained = hSlab.ePages;
+
+	std::vector<char*> vBlocks;
+	vBlocks.reserve(hSlab.nCapacity);
+
+	for (void* pPtr = hSlab.alloc(); pPtr; pPtr = hSlab.alloc())
+	{
+		vBlocks.push_back(reinterpret_cast<char*>(pPtr));
+	}
+
+	for (UINT32 nIndex : vOrder)
+	{
+		if (nIndex < vBlocks.size())
+		{
+			vBlocks[nIndex][8]++;
+			gnSink += vBlocks[nIndex][8];
+		}
+	}
+
+	for (char* pPtr : vBlocks)
+	{
+		hSlab.free_block(pPtr);
+	}
+}
+
+static void Bench_PageSizes()
+{
+	std::cout << "\n--- Page sizes (large pages need \"Lock pages in memory\") ---\n";
+
+	const PageKind eKinds[] = { PAGE_KIND_SMALL, PAGE_KIND_LARGE, PAGE_KIND_HUGE };
+
+	for (PageKind eWanted : eKinds)
+	{
+		PageRegion hRegion = {};
+		if (!AllocPageRegion(TLB_BUFFER_BYTES, eWanted, &hRegion))
+		{
+			std::cout << PageKindName(eWanted) << " pages: allocation failed" << std::endl;
+			continue;
+		}
+
+		ULONGLONG* pWords = reinterpret_cast<ULONGLONG*>(hRegion.pBase);
+		const size_t nWords = TLB_BUFFER_BYTES / sizeof(ULONGLONG);
+		ULONGLONG qwSink = 0;
+
+		const double dTouch = BenchmarkQPC([&] { Test_FirstTouch(pWords, nWords); });
+		const double dSequential = BenchmarkQPC([&] { qwSink += Test_SequentialRead(pWords, nWords); });
+		const double dRandom = BenchmarkQPC([&] { qwSink += Test_RandomRead(pWords, nWords); });
+		gnSink += static_cast<int>(qwSink);
+
+		std::cout << PageKindName(eWanted) << " pages requested, " << PageKindName(hRegion.eKind) << " obtained"
+		          << " | first touch: " << dTouch << " ms"
+		          << " | sequential 1 GB: " << dSequential << " ms"
+		          << " | random: " << dRandom << " ms (" << dRandom * 1'000'000.0 / TLB_RANDOM_ACCESSES << " ns/access)" << std::endl;
+
+		FreePageRegion(&hRegion);
+	}
+
+	std::mt19937 hRandom(99);
+	std::vector<UINT32> vOrder(TLB_SLAB_BYTES / BLOCK_SIZE);
+	for (size_t i = 0; i < vOrder.size(); i++)
+	{
+		vOrder[i] = static_cast<UINT32>(i);
+	}
+
+	std::shuffle(vOrder.begin(), vOrder.end(), hRandom);
+
+	//The Slab (TLB_SLAB_BYTES) is the smaller of the two: a page larger than it would only lock memory neither test touches
+	static_assert(TLB_SLAB_BYTES <= N * BLOCK_SIZE);
+
+	for (PageKind eWanted : eKinds)
+	{
+		if (PageKindBytes(eWanted) > TLB_SLAB_BYTES)
+		{
+			std::cout << "Pool/Slab on " << PageKindName(eWanted) << " pages skipped: the Slab takes "
+			          << TLB_SLAB_BYTES / (1024 * 1024) << " MB, less than one page" << std::endl;
+			continue;
+		}
+
+		PageKind ePool = PAGE_KIND_SMALL;
+		PageKind eSlab = PAGE_KIND_SMALL;
+		const double dPool = BenchmarkQPC([&] { Test_PoolPages(eWanted, &ePool); });
+		const double dSlab = BenchmarkQPC([&] { Test_SlabPages(eWanted, vOrder, &eSlab); });
+
+		std::cout << "Pool/Slab on " << PageKindName(eWanted) << " pages requested"
+		          << " | Pool " << N << " x 64 B (" << PageKindName(ePool) << " obtained): " << dPool << " ms"
+		          << " | Slab 256 MB, shuffled touch (" << PageKindName(eSlab) << " obtained): " << dSlab << " ms" << std::endl;
+	}
+}
+
+//------------------------------------------------------------
+// Test 8 — Cross-thread frees: concurrent slab
+//------------------------------------------------------------
+constexpr size_t XFER_BLOCKS = 1'050'000;      //Per thread; divisible by 1, 3 and 7 so all-to-all splits evenly
+
+//Single-producer single-consumer ring of block pointers
+struct BlockRing
+{
+	static constexpr size_t CAPACITY = 1024;
+
+	alignas(64) std::atomic<size_t> nHead = 0;     //Consumer
+	alignas(64) std::atomic<size_t> nTail = 0;     //Producer
+	alignas(64) void* pSlots[CAPACITY] = {};
+
+	bool push(void* pPtr)
+	{
+		const size_t nTailNow = this->nTail.load(std::memory_order_relaxed);
+		if (nTailNow - this->nHead.load(std::memory_order_acquire) == CAPACITY)
+		{
+			return false;
+		}
+
+		this->pSlots[nTailNow % CAPACITY] = pPtr;
+		this->nTail.store(nTailNow + 1, std::memory_order_release);
+		return true;
+	}
+
+	void* pop()
+	{
+		const size_t nHeadNow = this->nHead.load(std::memory_order_relaxed);
+		if (nHeadNow == this->nTail.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+
+		void* pPtr = this->pSlots[nHeadNow % CAPACITY];
+		this->nHead.store(nHeadNow + 1, std::memory_order_release);
+		return pPtr;
+	}
+};
+
+//nPairs producers allocate, nPairs consumers free: every free is a cross-thread free
+template<typename AllocFunction, typename FreeFunction>
+static void Test_ProducerConsumer(AllocFunction&& Alloc, FreeFunction&& Free, size_t nPairs)
+{
+	std::vector<std::unique_ptr<BlockRing>> vRings;
+	for (size_t i = 0; i < nPairs; i++)
+	{
+		vRings.push_back(std::make_unique<BlockRing>());
+	}
+
+	std::vector<std::thread> vThreads;
+	for (size_t i = 0; i < nPairs; i++)
+	{
+		BlockRing& hRing = *vRings[i];
+
+		vThreads.emplace_back([&]
+		{
+			for (size_t k = 0; k < XFER_BLOCKS; k++)
+			{
+				char* pPtr = reinterpret_cast<char*>(Alloc());
+				pPtr[0] = static_cast<char>(k);
+
+				while (!hRing.push(pPtr))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+
+		vThreads.emplace_back([&]
+		{
+			//Local sum: consumers sharing the global volatile would measure its cache line, not the allocator
+			int nSum = 0;
+			for (size_t k = 0; k < XFER_BLOCKS;)
+			{
+				char* pPtr = reinterpret_cast<char*>(hRing.pop());
+				if (!pPtr)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				nSum += pPtr[0];
+				Free(pPtr);
+				k++;
+			}
+
+			gnSink += nSum;
+		});
+	}
+
+	for (std::thread& hThread : vThreads)
+	{
+		hThread.join();
+	}
+}
+
+/*
+    All-to-all: every thread allocates blocks, sends them round-robin to the
+    other threads and frees whatever it receives, so each thread is producer
+    and consumer at once and every heap gets remote frees from all the others.
+*/
+template<typename AllocFunction, typename FreeFunction>
+static void Test_AllToAll(AllocFunction&& Alloc, FreeFunction&& Free, size_t nThreads)
+{
+	//vRings[nFrom * nThreads + nTo]
+	std::vector<std::unique_ptr<BlockRing>> vRings;
+	for (size_t i = 0; i < nThreads * nThreads; i++)
+	{
+		vRings.push_back(std::make_unique<BlockRing>());
+	}
+
+	std::vector<std::thread> vThreads;
+	for (size_t nSelf = 0; nSelf < nThreads; nSelf++)
+	{
+		vThreads.emplace_back([&, nSelf]
+		{
+			size_t nSent = 0;
+			size_t nReceived = 0;
+			char* pPending = nullptr;
+			int nSum = 0;
+
+			while (nSent < XFER_BLOCKS || nReceived < XFER_BLOCKS)
+			{
+				bool bProgress = false;
+
+				if (nSent < XFER_BLOCKS)
+				{
+					if (!pPending)
+					{
+						pPending = reinterpret_cast<char*>(Alloc());
+						pPending[0] = static_cast<char>(nSent);
+					}
+
+					const size_t nTo = (nSelf + 1 + nSent % (nThreads - 1)) % nThreads;
+					if (vRings[nSelf * nThreads + nTo]->push(pPending))
+					{
+						pPending = nullptr;
+						nSent++;
+						bProgress = true;
+					}
+				}
+
+				for (size_t nFrom = 0; nFrom < nThreads; nFrom++)
+				{
+					if (nFrom == nSelf)
+					{
+						continue;
+					}
+
+					while (char* pPtr = reinterpret_cast<char*>(vRings[nFrom * nThreads + nSelf]->pop()))
+					{
+						nSum += pPtr[0];
+						Free(pPtr);
+						nReceived++;
+						bProgress = true;
+					}
+				}
+
+				if (!bProgress)
+				{
+					std::this_thread::yield();
+				}
+			}
+
+			gnSink += nSum;
+		});
+	}
+
+	for (std::thread& hThread : vThreads)
+	{
+		hThread.join();
+	}
+}
+
+static void Bench_ConcurrentSlab()
+{
+	std::cout << "\n--- Cross-thread frees, 64 B blocks ---\n";
+
+	auto RunAll = [] (const char* pPattern, size_t nParameter, auto&& Test)
+	{
+		SlabCache hLockedCache;
+		SRWLOCK hLock = SRWLOCK_INIT;
+		ConcurrentSlab hSlab(BLOCK_SIZE);
+
+		MemoryProfile hMallocProfile;
+		MemoryProfile hLockedProfile;
+		MemoryProfile hThreadCacheProfile;
+		MemoryProfile hConcurrentProfile;
+
+		const double dMalloc = BenchmarkQPCMemory([&] { Test([] { return malloc(BLOCK_SIZE); }, [] (void* pPtr) { free(pPtr); }, nParameter); }, &hMallocProfile);
+		const double dLocked = BenchmarkQPCMemory([&]
+		{
+			Test([&]
+			{
+				AcquireSRWLockExclusive(&hLock);
+				void* pPtr = hLockedCache.alloc(BLOCK_SIZE);
+				ReleaseSRWLockExclusive(&hLock);
+				return pPtr;
+			},
+			[&] (void* pPtr)
+			{
+				AcquireSRWLockExclusive(&hLock);
+				hLockedCache.free_block(pPtr);
+				ReleaseSRWLockExclusive(&hLock);
+			}, nParameter);
+		}, &hLockedProfile);
+		const double dThreadCache = BenchmarkQPCMemory([&] { Test([] { return tc_malloc(BLOCK_SIZE); }, [] (void* pPtr) { tc_free(pPtr); }, nParameter); }, &hThreadCacheProfile);
+		const double dConcurrent = BenchmarkQPCMemory([&] { Test([&] { return hSlab.alloc(); }, [&] (void* pPtr) { hSlab.free_block(pPtr); }, nParameter); }, &hConcurrentProfile);
+
+		ConcurrentSlabStats hStats;
+		hSlab.get_stats(&hStats);
+		SlabCacheStats hLockedStats;
+		hLockedCache.get_stats(&hLockedStats);
+		TcStats hTcStats = {};
+		tc_get_stats(&hTcStats);
+
+		std::cout << pPattern << nParameter << ": malloc " << dMalloc << " ms | SlabCache + SRWLock " << dLocked << " ms | tc_malloc " << dThreadCache
+		          << " ms | ConcurrentSlab " << dConcurrent << " ms (remote frees " << hStats.qwRemoteFrees << ", drains " << hStats.qwDrains
+		          << ", " << hStats.nSlabs << " slabs)" << std::endl;
+		PrintMemoryProfile("malloc", hMallocProfile);
+		PrintMemoryProfile("SlabCache + SRWLock", hLockedProfile, { hLockedStats.qwBytesReserved, hLockedStats.qwBytesInUse });
+		PrintMemoryProfile("tc_malloc", hThreadCacheProfile, { hTcStats.qwCommittedBytes + hTcStats.qwDirectBytes, hTcStats.qwInUseBytes });
+		PrintMemoryProfile("ConcurrentSlab", hConcurrentProfile, { hStats.qwBytesReserved, hStats.qwBytesInUse });
+	};
+
+	for (size_t nPairs = 1; nPairs <= 4; nPairs *= 2)
+	{
+		RunAll("Producer/consumer pairs ", nPairs, [] (auto&& Alloc, auto&& Free, size_t nParameter) { Test_ProducerConsumer(Alloc, Free, nParameter); });
+	}
+
+	for (size_t nThreads = 2; nThreads <= TC_MAX_THREADS; nThreads *= 2)
+	{
+		RunAll("All-to-all threads ", nThreads, [] (auto&& Alloc, auto&& Free, size_t nParameter) { Test_AllToAll(Alloc, Free, nParameter); });
+	}
+}
+
+//------------------------------------------------------------
+// Test 9 — Object pool with generational handles vs unordered_map
+//------------------------------------------------------------
+constexpr size_t OBJECT_COUNT = 1'000'000;
+constexpr size_t OBJECT_LOOKUPS = 10'000'000;
+constexpr size_t OBJECT_CHURN_OPS = 4'000'000;
+constexpr size_t OBJECT_ITERATIONS = 20;
+
+struct Entity
+{
+	float pPosition[3];
+	float pVelocity[3];
+	UINT32 nId;
+	UINT32 nFlags;
+	char pPayload[32];
+};
+
+static_assert(sizeof(Entity) == 64, "Entity should fill one cache line");
+
+typedef std::unordered_map<ULONGLONG, std::unique_ptr<Entity>> EntityMap;
+
+static Entity MakeEntity(size_t nId)
+{
+	Entity hEntity = {};
+	hEntity.pVelocity[0] = 1.0f;
+	hEntity.pVelocity[1] = 0.5f;
+	hEntity.pVelocity[2] = 0.25f;
+	hEntity.nId = static_cast<UINT32>(nId);
+	return hEntity;
+}
+
+static void Test_PoolFill(ObjectPool<Entity>& hPool, std::vector<ObjectHandle>& vHandles)
+{
+	for (size_t i = 0; i < OBJECT_COUNT; i++)
+	{
+		vHandles[i] = hPool.insert(MakeEntity(i));
+	}
+}
+
+static void Test_MapFill(EntityMap& hMap, std::vector<ULONGLONG>& vIds)
+{
+	for (size_t i = 0; i < OBJECT_COUNT; i++)
+	{
+		vIds[i] = i;
+		hMap.emplace(i, std::make_unique<Entity>(MakeEntity(i)));
+	}
+}
+
+static void Test_PoolLookup(ObjectPool<Entity>& hPool, const std::vector<ObjectHandle>& vHandles, const std::vector<UINT32>& vOrder)
+{
+	UINT32 nSum = 0;
+	for (UINT32 nSlot : vOrder)
+	{
+		nSum += hPool.get(vHandles[nSlot])->nId;
+	}
+
+	gnSink += static_cast<int>(nSum);
+}
+
+static void Test_MapLookup(EntityMap& hMap, const std::vector<ULONGLONG>& vIds, const std::vector<UINT32>& vOrder)
+{
+	UINT32 nSum = 0;
+	for (UINT32 nSlot : vOrder)
+	{
+		nSum += hMap.find(vIds[nSlot])->second->nId;
+	}
+
+	gnSink += static_cast<int>(nSum);
+}
+
+static void Integrate(Entity& hEntity)
+{
+	hEntity.pPosition[0] += hEntity.pVelocity[0];
+	hEntity.pPosition[1] += hEntity.pVelocity[1];
+	hEntity.pPosition[2] += hEntity.pVelocity[2];
+}
+
+static void Test_PoolIterate(ObjectPool<Entity>& hPool)
+{
+	for (size_t k = 0; k < OBJECT_ITERATIONS; k++)
+	{
+		for (Entity& hEntity : hPool)
+		{
+			Integrate(hEntity);
+		}
+	}
+}
+
+static void Test_MapIterate(EntityMap& hMap)
+{
+	for (size_t k = 0; k < OBJECT_ITERATIONS; k++)
+	{
+		for (auto& hPair : hMap)
+		{
+			Integrate(*hPair.second);
+		}
+	}
+}
+
+//Each op erases a random live object and creates a new one in its place; the population stays at OBJECT_COUNT
+static size_t Test_PoolChurn(ObjectPool<Entity>& hPool, std::vector<ObjectHandle>& vHandles, const std::vector<UINT32>& vOrder)
+{
+	size_t nStaleHits = 0;
+	for (size_t i = 0; i < OBJECT_CHURN_OPS; i++)
+	{
+		const UINT32 nSlot = vOrder[i];
+		const ObjectHandle hOld = vHandles[nSlot];
+
+		hPool.erase(hOld);
+		vHandles[nSlot] = hPool.insert(MakeEntity(OBJECT_COUNT + i));
+
+		//The new object usually reuses the slot just freed: the old handle must not resolve to it
+		nStaleHits += hPool.get(hOld) != nullptr;
+	}
+
+	return nStaleHits;
+}
+
+static size_t Test_MapChurn(EntityMap& hMap, std::vector<ULONGLONG>& vIds, const std::vector<UINT32>& vOrder)
+{
+	size_t nStaleHits = 0;
+	for (size_t i = 0; i < OBJECT_CHURN_OPS; i++)
+	{
+		const UINT32 nSlot = vOrder[i];
+		const ULONGLONG qwOld = vIds[nSlot];
+
+		hMap.erase(qwOld);
+		vIds[nSlot] = OBJECT_COUNT + i;
+		hMap.emplace(vIds[nSlot], std::make_unique<Entity>(MakeEntity(OBJECT_COUNT + i)));
+
+		nStaleHits += hMap.find(qwOld) != hMap.end();
+	}
+
+	return nStaleHits;
+}
+
+static void Bench_ObjectPool()
+{
+	std::cout << "\n--- ObjectPool<Entity> vs unordered_map<id, unique_ptr<Entity>>, " << OBJECT_COUNT << " x 64 B ---\n";
+
+	std::mt19937 hRandom(777);
+	std::vector<UINT32> vLookupOrder(OBJECT_LOOKUPS);
+	std::vector<UINT32> vChurnOrder(OBJECT_CHURN_OPS);
+
+	for (UINT32& nSlot : vLookupOrder)
+	{
+		nSlot = static_cast<UINT32>(hRandom() % OBJECT_COUNT);
+	}
+
+	for (UINT32& nSlot : vChurnOrder)
+	{
+		nSlot = static_cast<UINT32>(hRandom() % OBJECT_COUNT);
+	}
+
+	ObjectPool<Entity> hPool;
+	std::vector<ObjectHandle> vHandles(OBJECT_COUNT);
+	EntityMap hMap;
+	std::vector<ULONGLONG> vIds(OBJECT_COUNT);
+
+	std::cout << "Insert:              ObjectPool " << BenchmarkQPC([&] { Test_PoolFill(hPool, vHandles); }) << " ms"
+	          << "  unordered_map " << BenchmarkQPC([&] { Test_MapFill(hMap, vIds); }) << " ms" << std::endl;
+
+	std::cout << "Random lookup:       ObjectPool " << BenchmarkQPC([&] { Test_PoolLookup(hPool, vHandles, vLookupOrder); }) << " ms"
+	          << "  unordered_map " << BenchmarkQPC([&] { Test_MapLookup(hMap, vIds, vLookupOrder); }) << " ms  (" << OBJECT_LOOKUPS << " lookups)" << std::endl;
+
+	std::cout << "Iterate:             ObjectPool " << BenchmarkQPC([&] { Test_PoolIterate(hPool); }) << " ms"
+	          << "  unordered_map " << BenchmarkQPC([&] { Test_MapIterate(hMap); }) << " ms  (" << OBJECT_ITERATIONS << " passes)" << std::endl;
+
+	size_t nPoolStale = 0;
+	size_t nMapStale = 0;
+	MemoryProfile hPoolProfile;
+	MemoryProfile hMapProfile;
+
+	const double dPoolChurn = BenchmarkQPCMemory([&] { nPoolStale = Test_PoolChurn(hPool, vHandles, vChurnOrder); }, &hPoolProfile);
+	const double dMapChurn = BenchmarkQPCMemory([&] { nMapStale = Test_MapChurn(hMap, vIds, vChurnOrder); }, &hMapProfile);
+
+	std::cout << "Churn erase+insert:  ObjectPool " << dPoolChurn << " ms  unordered_map " << dMapChurn << " ms  (" << OBJECT_CHURN_OPS << " ops)" << std::endl;
+	PrintMemoryProfile("ObjectPool", hPoolProfile, { hPool.bytes_reserved(), hPool.bytes_in_use() });
+	PrintMemoryProfile("unordered_map", hMapProfile);
+
+	//After churn the pool is still dense, the map's nodes are scattered over the heap
+	std::cout << "Lookup after churn:  ObjectPool " << BenchmarkQPC([&] { Test_PoolLookup(hPool, vHandles, vLookupOrder); }) << " ms"
+	          << "  unordered_map " << BenchmarkQPC([&] { Test_MapLookup(hMap, vIds, vLookupOrder); }) << " ms" << std::endl;
+
+	std::cout << "Iterate after churn: ObjectPool " << BenchmarkQPC([&] { Test_PoolIterate(hPool); }) << " ms"
+	          << "  unordered_map " << BenchmarkQPC([&] { Test_MapIterate(hMap); }) << " ms" << std::endl;
+
+	std::cout << "Stale handles resolved: ObjectPool " << nPoolStale << "  unordered_map " << nMapStale
+	          << "  (live: " << hPool.size() << " / " << hMap.size() << ")" << std::endl;
+}
+
+//------------------------------------------------------------
+// Test 10 — Allocation trace replay
+//------------------------------------------------------------
+constexpr size_t TRACE_MAX_EVENTS = 32 * 1024 * 1024;      //1 GB of events; Test 6 records about 29M
+constexpr size_t TRACE_SYNTHETIC_ALLOCS = 2'000'000;
+constexpr const char* TRACE_PATH = "alloc_trace.bin";
+
+static void PrintReplayResult(const char* pName, const AllocReplayResult& hResult)
+{
+	constexpr double MB = 1024.0 * 1024.0;
+
+	std::cout << std::left << std::setw(24) << (std::string(pName) + ":") << std::right << hResult.dMilliseconds << " ms | peak live " << static_cast<double>(hResult.nPeakLiveBytes) / MB
+	          << " MB | peak working set +" << static_cast<double>(hResult.nPeakWorkingSet) / MB
+	          << " MB | peak private +" << static_cast<double>(hResult.nPeakPrivate) / MB
+	          << " MB | fragmentation " << hResult.dFragmentation * 100.0 << " %";
+
+	if (hResult.nFailed)
+	{
+		std::cout << " | " << hResult.nFailed << " failed";
+	}
+
+	std::cout << std::endl;
+}
+
+static void* AlignedFallbackAlloc(size_t nSize, size_t nAlignment)
+{
+	return nAlignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? malloc(nSize) : _aligned_malloc(nSize, nAlignment);
+}
+
+static void AlignedFallbackFree(void* pPtr, size_t nAlignment)
+{
+	if (nAlignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+	{
+		free(pPtr);
+	}
+	else
+	{
+		_aligned_free(pPtr);
+	}
+}
+
+static void Bench_TraceReplay()
+{
+	std::cout << "\n--- Allocation trace replay ---\n";
+
+	AllocReplayTrace hTrace;
+	if (LoadAllocTrace(TRACE_PATH, &hTrace))
+	{
+		std::cout << "Trace " << TRACE_PATH << ": " << hTrace.vOps.size() << " ops from " << hTrace.nThreads << " threads, recorded over "
+		          << hTrace.dRecordedMs << " ms (" << hTrace.qwSkippedFrees << " frees of older blocks skipped)" << std::endl;
+	}
+	else
+	{
+		MakeSyntheticTrace(TRACE_SYNTHETIC_ALLOCS, 2024, &hTrace);
+		std::cout << "No " << TRACE_PATH << " (build with ALLOC_PROFILER=1 to record one), synthetic trace: " << hTrace.vOps.size() << " ops" << std::endl;
+	}
+
+	//Exact sizes for the two fixed-capacity allocators, so they commit no more than the trace needs
+	size_t nPoolBytes = 0;
+	size_t nSmallLive = 0;
+	size_t nSmallPeak = 0;
+	for (const ReplayOp& hOp : hTrace.vOps)
+	{
+		const bool bSmall = hOp.nSize <= BLOCK_SIZE && AlignmentOf(hOp) <= BLOCK_SIZE;
+		if (hOp.eKind == ALLOC_TRACE_ALLOC)
+		{
+			nPoolBytes += ((hOp.nSize + 15) & ~static_cast<size_t>(15)) + (AlignmentOf(hOp) > 16 ? AlignmentOf(hOp) : 0);
+			nSmallLive += bSmall;
+			nSmallPeak = max(nSmallPeak, nSmallLive);
+		}
+		else
+		{
+			nSmallLive -= bSmall;
+		}
+	}
+
+	//The replay samples working set and commit in its loop; the sampler around it adds private WS and page faults
+	auto Replay = [&] (const char* pName, auto&& Alloc, auto&& Free)
+	{
+		AllocReplayResult hResult;
+		MemoryProfile hProfile;
+		MemorySampler hSampler;
+
+		hSampler.start();
+		ReplayAllocTrace(hTrace, Alloc, Free, &hResult);
+		hSampler.stop(&hProfile);
+
+		PrintReplayResult(pName, hResult);
+		PrintMemoryProfile(pName, hProfile);
+	};
+
+	Replay("malloc", AlignedFallbackAlloc, [] (void* pPtr, size_t, size_t nAlignment) { AlignedFallbackFree(pPtr, nAlignment); });
+
+	Replay("tc_malloc",
+		[] (size_t nSize, size_t nAlignment) { return nAlignment <= 16 ? tc_malloc(nSize) : AlignedFallbackAlloc(nSize, nAlignment); },
+		[] (void* pPtr, size_t, size_t nAlignment) { nAlignment <= 16 ? tc_free(pPtr) : AlignedFallbackFree(pPtr, nAlignment); });
+
+	{
+		SlabCache hCache;
+		auto InCache = [] (size_t nSize, size_t nAlignment) { return nSize <= SLAB_CACHE_MAX_BLOCK && nAlignment <= SLAB_CACHE_ALIGNMENT; };
+
+		Replay("SlabCache + malloc",
+			[&] (size_t nSize, size_t nAlignment) { return InCache(nSize, nAlignment) ? hCache.alloc(nSize) : AlignedFallbackAlloc(nSize, nAlignment); },
+			[&] (void* pPtr, size_t nSize, size_t nAlignment) { InCache(nSize, nAlignment) ? hCache.free_block(pPtr) : AlignedFallbackFree(pPtr, nAlignment); });
+	}
+
+	{
+		Slab hSlab(BLOCK_SIZE, max(nSmallPeak, static_cast<size_t>(1)) * BLOCK_SIZE, PAGE_KIND_SMALL);
+		auto InSlab = [] (size_t nSize, size_t nAlignment) { return nSize <= BLOCK_SIZE && nAlignment <= BLOCK_SIZE; };
+
+		Replay("Slab 64 B + malloc",
+			[&] (size_t nSize, size_t nAlignment) { return InSlab(nSize, nAlignment) ? hSlab.alloc() : AlignedFallbackAlloc(nSize, nAlignment); },
+			[&] (void* pPtr, size_t nSize, size_t nAlignment) { InSlab(nSize, nAlignment) ? hSlab.free_block(pPtr) : AlignedFallbackFree(pPtr, nAlignment); });
+	}
+
+	//The bump allocators never reuse memory: their peak is everything the trace ever allocated
+	{
+		Arena hArena;
+		Replay("Arena (no frees)", [&] (size_t nSize, size_t nAlignment) { return hArena.alloc(nSize, nAlignment); }, [] (void*, size_t, size_t) {});
+	}
+
+	{
+		Pool hPool(max(nPoolBytes, static_cast<size_t>(16)));
+		auto PoolAlloc = [&] (size_t nSize, size_t nAlignment) -> void*
+		{
+			const size_t nPadding = nAlignment > 16 ? nAlignment : 0;
+			char* pPtr = reinterpret_cast<char*>(hPool.alloc(((nSize + 15) & ~static_cast<size_t>(15)) + nPadding));
+			if (pPtr && nPadding)
+			{
+				pPtr = reinterpret_cast<char*>((reinterpret_cast<ULONG_PTR>(pPtr) + nAlignment - 1) & ~static_cast<ULONG_PTR>(nAlignment - 1));
+			}
+
+			return pPtr;
+		};
+
+		Replay("Pool (no frees)", PoolAlloc, [] (void*, size_t, size_t) {});
+	}
+}
+
+//------------------------------------------------------------
+// Test 11 — NUMA placement: local vs remote, interleave, parallel first touch
+//------------------------------------------------------------
+constexpr size_t NUMA_BUFFER_BYTES = 512 * 1024 * 1024;    //Far beyond any last-level cache
+constexpr size_t NUMA_BANDWIDTH_PASSES = 4;
+constexpr size_t NUMA_CHASE_STEPS = 16 * 1024 * 1024;
+constexpr size_t NUMA_ARENA_NODES = 4'000'000;              //64-byte list nodes per thread
+
+struct alignas(64) NumaChaseLine
+{
+	NumaChaseLine* pNext;
+	char pPad[64 - sizeof(NumaChaseLine*)];
+};
+
+struct NumaListNode
+{
+	NumaListNode* pNext;
+	ULONGLONG qwValue;
+	char pPad[48];
+};
+
+//One read per 8 bytes; a single thread, so this is what one core can pull from the node, not the node's peak
+static ULONGLONG Test_NumaRead(const char* pBegin, const char* pEnd)
+{
+	const ULONGLONG* pWords = reinterpret_cast<const ULONGLONG*>(pBegin);
+	const size_t nWords = static_cast<size_t>(pEnd - pBegin) / sizeof(ULONGLONG);
+
+	ULONGLONG qwSum = 0;
+	for (size_t nPass = 0; nPass < NUMA_BANDWIDTH_PASSES; nPass++)
+	{
+		for (size_t i = 0; i < nWords; i++)
+		{
+			qwSum += pWords[i];
+		}
+	}
+
+	return qwSum;
+}
+
+//One random cycle through every cache line of the region: each load waits for the previous one
+static NumaChaseLine* BuildNumaChase(const NumaRegion& hRegion, std::mt19937& hRandom)
+{
+	NumaChaseLine* pLines = reinterpret_cast<NumaChaseLine*>(hRegion.pBase);
+	const size_t nLines = hRegion.nSize / sizeof(NumaChaseLine);
+
+	std::vector<UINT32> vOrder(nLines);
+	for (size_t i = 0; i < nLines; i++)
+	{
+		vOrder[i] = static_cast<UINT32>(i);
+	}
+
+	std::shuffle(vOrder.begin(), vOrder.end(), hRandom);
+
+	for (size_t i = 0; i < nLines; i++)
+	{
+		pLines[vOrder[i]].pNext = &pLines[vOrder[(i + 1) % nLines]];
+	}
+
+	return &pLines[vOrder[0]];
+}
+
+static const NumaChaseLine* Test_NumaChase(const NumaChaseLine* pLine)
+{
+	for (size_t i = 0; i < NUMA_CHASE_STEPS; i++)
+	{
+		pLine = pLine->pNext;
+	}
+
+	return pLine;
+}
+
+//Bandwidth and latency of a region, read from the calling thread
+static void MeasureNumaRegion(const char* pName, const NumaRegion& hRegion, std::mt19937& hRandom)
+{
+	ULONGLONG qwSink = 0;
+	const double dRead = BenchmarkQPC([&] { qwSink += Test_NumaRead(hRegion.pBase, hRegion.pBase + hRegion.nSize); });
+
+	const NumaChaseLine* pStart = BuildNumaChase(hRegion, hRandom);
+	const NumaChaseLine* pLast = nullptr;
+	const double dChase = BenchmarkQPC([&] { pLast = Test_NumaChase(pStart); });
+	gnSink += static_cast<int>(qwSink) + static_cast<int>(pLast == nullptr);
+
+	const double dBytes = static_cast<double>(hRegion.nSize) * NUMA_BANDWIDTH_PASSES;
+	std::cout << std::left << std::setw(28) << (std::string(pName) + ":") << std::right
+	          << "read " << dBytes / dRead / 1'000'000.0 << " GB/s"
+	          << " | latency " << dChase * 1'000'000.0 / NUMA_CHASE_STEPS << " ns/load" << std::endl;
+}
+
+//Every node's thread reads its own slice at once; where the slices live is all that differs
+static double Test_NumaParallelRead(const NumaRegion& hRegion)
+{
+	std::atomic<ULONGLONG> qwSum = 0;
+	const double dMilliseconds = BenchmarkQPC([&]
+	{
+		RunOnEachNumaNode([&] (size_t nIndex)
+		{
+			qwSum += Test_NumaRead(NumaSliceBegin(hRegion, nIndex), NumaSliceEnd(hRegion, nIndex));
+		});
+	});
+
+	gnSink += static_cast<int>(qwSum.load());
+	return dMilliseconds;
+}
+
+//Each node's thread builds a list in an arena on node ArenaNodeOf(nIndex), then walks it
+template<typename NodeFunction>
+static void Test_NumaArenas(NodeFunction&& ArenaNodeOf)
+{
+	RunOnEachNumaNode([&] (size_t nIndex)
+	{
+		Arena hArena(ARENA_DEFAULT_BLOCK_SIZE, ARENA_DEFAULT_MAX_BLOCK_SIZE, GetNumaTopology().vNodes[ArenaNodeOf(nIndex)].nNode);
+
+		NumaListNode* pHead = nullptr;
+		for (size_t i = 0; i < NUMA_ARENA_NODES; i++)
+		{
+			NumaListNode* pNode = reinterpret_cast<NumaListNode*>(hArena.alloc(sizeof(NumaListNode), 64));
+			pNode->pNext = pHead;
+			pNode->qwValue = i;
+			pHead = pNode;
+		}
+
+		ULONGLONG qwSum = 0;
+		for (size_t nPass = 0; nPass < NUMA_BANDWIDTH_PASSES; nPass++)
+		{
+			for (const NumaListNode* pNode = pHead; pNode; pNode = pNode->pNext)
+			{
+				qwSum += pNode->qwValue;
+			}
+		}
+
+		gnSink += static_cast<int>(qwSum);
+	});
+}
+
+static void Bench_Numa()
+{
+	const NumaTopology& hTopology = GetNumaTopology();
+	const size_t nNodes = hTopology.vNodes.size();
+
+	std::cout << "\n--- NUMA placement (" << nNodes << " node" << (nNodes == 1 ? "" : "s") << ") ---\n";
+
+	for (const NumaNode& hNode : hTopology.vNodes)
+	{
+		std::cout << "node " << hNode.nNode << ": group " << hNode.hAffinity.Group << ", " << hNode.nProcessors << " processors, "
+		          << hNode.qwAvailableBytes / (1024 * 1024) << " MB free" << std::endl;
+	}
+
+	if (nNodes < 2)
+	{
+		std::cout << "Single node: every page is local, the NUMA policies are plain VirtualAlloc" << std::endl;
+		return;
+	}
+
+	std::mt19937 hRandom(11);
+
+	//Local vs remote: this thread stays on the first node, the memory moves
+	GROUP_AFFINITY hPrevious = {};
+	PinThreadToNumaNode(0, &hPrevious);
+
+	for (size_t nIndex = 0; nIndex < nNodes; nIndex++)
+	{
+		NumaRegion hRegion = {};
+		if (!AllocNumaRegion(NUMA_BUFFER_BYTES, NUMA_POLICY_BIND, nIndex, &hRegion))
+		{
+			std::cout << "bind to node " << hTopology.vNodes[nIndex].nNode << ": allocation failed" << std::endl;
+			continue;
+		}
+
+		const std::string strName = "node " + std::to_string(hTopology.vNodes[0].nNode) + " -> node " + std::to_string(hTopology.vNodes[nIndex].nNode) + (nIndex == 0 ? " (local)" : " (remote)");
+		MeasureNumaRegion(strName.c_str(), hRegion, hRandom);
+		FreeNumaRegion(&hRegion);
+	}
+
+	NumaRegion hInterleaved = {};
+	if (AllocNumaRegion(NUMA_BUFFER_BYTES, NUMA_POLICY_INTERLEAVE, 0, &hInterleaved))
+	{
+		MeasureNumaRegion("interleaved", hInterleaved, hRandom);
+		FreeNumaRegion(&hInterleaved);
+	}
+
+	//Parallel reads of a region initialized by one thread (every page on the first node) vs by one thread per node
+	NumaRegion hSerial = {};
+	NumaRegion hBlocked = {};
+	if (AllocNumaRegion(NUMA_BUFFER_BYTES, NUMA_POLICY_FIRST_TOUCH, 0, &hSerial) && AllocNumaRegion(NUMA_BUFFER_BYTES, NUMA_POLICY_BLOCKED, 0, &hBlocked))
+	{
+		memset(hSerial.pBase, 1, hSerial.nSize);
+		memset(hBlocked.pBase, 1, hBlocked.nSize);
+
+		const double dBytes = static_cast<double>(NUMA_BUFFER_BYTES) * NUMA_BANDWIDTH_PASSES;
+		const double dSerial = Test_NumaParallelRead(hSerial);
+		const double dBlocked = Test_NumaParallelRead(hBlocked);
+
+		std::cout << "Parallel read, " << nNodes << " threads | serial init: " << dBytes / dSerial / 1'000'000.0 << " GB/s"
+		          << " | parallel first touch: " << dBytes / dBlocked / 1'000'000.0 << " GB/s" << std::endl;
+	}
+
+	FreeNumaRegion(&hSerial);
+	FreeNumaRegion(&hBlocked);
+	RestoreThreadAffinity(hPrevious);
+
+	//Node-local arenas: the same per-thread lists, with the blocks on the thread's node or on the next one
+	const double dLocal = BenchmarkQPC([] { Test_NumaArenas([] (size_t nIndex) { return nIndex; }); });
+	const double dRemote = BenchmarkQPC([=] { Test_NumaArenas([=] (size_t nIndex) { return (nIndex + 1) % nNodes; }); });
+
+	std::cout << "Arena per thread, " << NUMA_ARENA_NODES << " x 64 B list | node-local: " << dLocal << " ms"
+	          << " | next node: " << dRemote << " ms" << std::endl;
+}
+
+//------------------------------------------------------------
+// Test 12 — Small-buffer containers vs std::vector / std::string
+//------------------------------------------------------------
+constexpr size_t SBO_LIST_ROUNDS = 2'000'000;
+constexpr size_t SBO_INLINE_POINTERS = SLAB_SIZE / BLOCK_SIZE;     //What Test_SlabAlloc collects
+constexpr size_t SBO_MESSAGE_ROUNDS = 4'000'000;
+constexpr size_t SBO_MESSAGE_BYTES = 128;                           //Receive-sized: the IOCP worker's reads are mostly this short
+constexpr size_t SBO_RELOCATION_ELEMENTS = 1024;             //32 KB of strings: relocation cost, not page faults
+constexpr size_t SBO_RELOCATION_ROUNDS = 10'000;
+
+typedef SmallVector<void*, SBO_INLINE_POINTERS> PointerList;
+typedef InlineString<SBO_MESSAGE_BYTES> MessageString;
+
+//Test_SlabAlloc's pattern: collect the blocks a function allocated, walk them, drop the list
+template<typename List>
+static void Test_PointerLists(const std::vector<UINT32>& vCounts)
+{
+	static char pBlocks[SBO_INLINE_POINTERS * 4];
+	size_t nSum = 0;
+
+	for (UINT32 nCount : vCounts)
+	{
+		List vList;
+		for (UINT32 i = 0; i < nCount; i++)
+		{
+			vList.push_back(pBlocks + i);
+		}
+
+		for (void* pPtr : vList)
+		{
+			nSum += reinterpret_cast<size_t>(pPtr);
+		}
+	}
+
+	gnSink += static_cast<int>(nSum);
+}
+
+//The IOCP worker's pattern: copy the bytes of one receive into a string, look at it, drop it
+template<typename String>
+static void Test_Messages(const char* pBuffer, const std::vector<UINT16>& vLengths)
+{
+	size_t nSum = 0;
+
+	for (size_t i = 0; i < vLengths.size(); i++)
+	{
+		const String strMessage(pBuffer + (i & 255), vLengths[i]);
+		nSum += strMessage.size() + static_cast<size_t>(strMessage.data()[0]);
+	}
+
+	gnSink += static_cast<int>(nSum);
+}
+
+//Short keys (inline in both string types); only the reallocation that doubles the capacity is timed
+template<typename Vector>
+static double Test_Relocation(const std::vector<std::string>& vKeys)
+{
+	double dMilliseconds = 0.0;
+
+	for (size_t nRound = 0; nRound < SBO_RELOCATION_ROUNDS; nRound++)
+	{
+		Vector vStrings;
+		for (const std::string& strKey : vKeys)
+		{
+			vStrings.emplace_back(strKey.data(), strKey.size());
+		}
+
+		dMilliseconds += BenchmarkQPC([&] { vStrings.reserve(vStrings.capacity() * 2); });
+		gnSink += static_cast<int>(vStrings.size());
+	}
+
+	return dMilliseconds;
+}
+
+static void Bench_SmallContainers()
+{
+	std::cout << "\n--- Small-buffer containers ---\n";
+
+	std::mt19937 hRandom(12);
+
+	//Up to the inline size, and a mix where about three quarters spill
+	std::vector<UINT32> vFitting(SBO_LIST_ROUNDS);
+	std::vector<UINT32> vSpilling(SBO_LIST_ROUNDS);
+	for (size_t i = 0; i < SBO_LIST_ROUNDS; i++)
+	{
+		vFitting[i] = 1 + static_cast<UINT32>(hRandom() % SBO_INLINE_POINTERS);
+		vSpilling[i] = 1 + static_cast<UINT32>(hRandom() % (SBO_INLINE_POINTERS * 4));
+	}
+
+	std::cout << "Pointer lists, 1-" << SBO_INLINE_POINTERS << " entries"
+	          << " | std::vector: " << BenchmarkQPC([&] { Test_PointerLists<std::vector<void*>>(vFitting); }) << " ms"
+	          << " | SmallVector: " << BenchmarkQPC([&] { Test_PointerLists<PointerList>(vFitting); }) << " ms" << std::endl;
+	std::cout << "Pointer lists, 1-" << SBO_INLINE_POINTERS * 4 << " entries"
+	          << " | std::vector: " << BenchmarkQPC([&] { Test_PointerLists<std::vector<void*>>(vSpilling); }) << " ms"
+	          << " | SmallVector: " << BenchmarkQPC([&] { Test_PointerLists<PointerList>(vSpilling); }) << " ms" << std::endl;
+
+	std::vector<char> vBuffer(256 + SBO_MESSAGE_BYTES, 'x');
+	std::vector<UINT16> vLengths(SBO_MESSAGE_ROUNDS);
+	for (size_t i = 0; i < SBO_MESSAGE_ROUNDS; i++)
+	{
+		vLengths[i] = static_cast<UINT16>(1 + hRandom() % SBO_MESSAGE_BYTES);
+	}
+
+	std::cout << "Messages, 1-" << SBO_MESSAGE_BYTES << " bytes"
+	          << " | std::string: " << BenchmarkQPC([&] { Test_Messages<std::string>(vBuffer.data(), vLengths); }) << " ms"
+	          << " | InlineString: " << BenchmarkQPC([&] { Test_Messages<MessageString>(vBuffer.data(), vLengths); }) << " ms" << std::endl;
+
+	std::vector<std::string> vKeys(SBO_RELOCATION_ELEMENTS);
+	for (size_t i = 0; i < SBO_RELOCATION_ELEMENTS; i++)
+	{
+		vKeys[i] = "key-" + std::to_string(i);
+	}
+
+	std::cout << "Relocating " << SBO_RELOCATION_ELEMENTS << " short strings x " << SBO_RELOCATION_ROUNDS
+	          << " | std::vector<std::string>: " << Test_Relocation<std::vector<std::string>>(vKeys) << " ms"
+	          << " | SmallVector<std::string> (move each): " << Test_Relocation<SmallVector<std::string, 16>>(vKeys) << " ms"
+	          << " | SmallVector<InlineString> (memcpy): " << Test_Relocation<SmallVector<InlineString<15>, 16>>(vKeys) << " ms" << std::endl;
+}
+
+//------------------------------------------------------------
+// Test 13 — B+tree vs std::map
+//------------------------------------------------------------
+constexpr size_t BTREE_KEY_COUNTS[] = { 1'000, 10'000, 100'000, 1'000'000, 10'000'000, 100'000'000 };
+constexpr size_t BTREE_LOOKUPS = 4'000'000;
+constexpr size_t BTREE_SCANS = 200'000;
+constexpr size_t BTREE_SCAN_LENGTH = 100;
+constexpr size_t BTREE_BYTES_PER_KEY = 112;     //std::map node with its heap header, plus the key arrays of the test
+
+typedef std::map<ULONGLONG, ULONGLONG> KeyMap;
+typedef BPlusTree<ULONGLONG> KeyTree;
+
+//Invertible mix of the index: distinct keys in random order, regenerated instead of stored
+static ULONGLONG BTreeKey(ULONGLONG qwIndex)
+{
+	qwIndex *= 0x9E3779B97F4A7C15ull;
+	qwIndex ^= qwIndex >> 29;
+	return qwIndex * 0xBF58476D1CE4E5B9ull;
+}
+
+static ULONGLONG Test_MapLookups(const KeyMap& hMap, const std::vector<ULONGLONG>& vProbes)
+{
+	ULONGLONG qwSum = 0;
+	for (ULONGLONG qwKey : vProbes)
+	{
+		auto hFound = hMap.find(qwKey);
+		qwSum += hFound != hMap.end() ? hFound->second : 0;
+	}
+
+	return qwSum;
+}
+
+static ULONGLONG Test_TreeLookups(const KeyTree& hTree, const std::vector<ULONGLONG>& vProbes)
+{
+	ULONGLONG qwSum = 0;
+	for (ULONGLONG qwKey : vProbes)
+	{
+		const ULONGLONG* pValue = hTree.find(qwKey);
+		qwSum += pValue ? *pValue : 0;
+	}
+
+	return qwSum;
+}
+
+static ULONGLONG Test_MapScans(const KeyMap& hMap, const std::vector<ULONGLONG>& vStarts)
+{
+	ULONGLONG qwSum = 0;
+	for (ULONGLONG qwStart : vStarts)
+	{
+		auto hIt = hMap.lower_bound(qwStart);
+		for (size_t i = 0; i < BTREE_SCAN_LENGTH && hIt != hMap.end(); i++, ++hIt)
+		{
+			qwSum += hIt->second;
+		}
+	}
+
+	return qwSum;
+}
+
+static ULONGLONG Test_TreeScans(const KeyTree& hTree, const std::vector<ULONGLONG>& vStarts)
+{
+	ULONGLONG qwSum = 0;
+	for (ULONGLONG qwStart : vStarts)
+	{
+		auto hCursor = hTree.lower_bound(qwStart);
+		for (size_t i = 0; i < BTREE_SCAN_LENGTH && hCursor.valid(); i++, hCursor.next())
+		{
+			qwSum += hCursor.value();
+		}
+	}
+
+	return qwSum;
+}
+
+static void Bench_BPlusTree()
+{
+	std::cout << "\n--- B+tree (" << BTREE_DEFAULT_NODE_BYTES << " B nodes, " << KeyTree::LEAF_KEYS << " keys per leaf, "
+	          << KeyTree::INNER_KEYS + 1 << " children per inner node) vs std::map ---\n";
+
+	for (size_t nKeys : BTREE_KEY_COUNTS)
+	{
+		MEMORYSTATUSEX hStatus = {};
+		hStatus.dwLength = sizeof(hStatus);
+		GlobalMemoryStatusEx(&hStatus);
+
+		if (static_cast<ULONGLONG>(nKeys) * BTREE_BYTES_PER_KEY > hStatus.ullAvailPhys)
+		{
+			std::cout << nKeys << " keys: skipped, needs about " << static_cast<ULONGLONG>(nKeys) * BTREE_BYTES_PER_KEY / (1024 * 1024)
+			          << " MB and " << hStatus.ullAvailPhys / (1024 * 1024) << " MB are free" << std::endl;
+			continue;
+		}
+
+		std::mt19937_64 hRandom(nKeys);
+
+		std::vector<ULONGLONG> vProbes(BTREE_LOOKUPS);
+		for (ULONGLONG& qwProbe : vProbes)
+		{
+			qwProbe = BTreeKey(hRandom() % nKeys);
+		}
+
+		//Scans start at random points of the key space, hits or not
+		std::vector<ULONGLONG> vStarts(BTREE_SCANS);
+		for (ULONGLONG& qwStart : vStarts)
+		{
+			qwStart = hRandom();
+		}
+
+		std::cout << nKeys << " keys:" << std::endl;
+
+		ULONGLONG qwSink = 0;
+		MemoryProfile hProfile;
+
+		//std::map, random then ascending (hinted) inserts
+		double dMapInsert = 0.0;
+		double dMapLookup = 0.0;
+		double dMapScan = 0.0;
+		{
+			KeyMap hMap;
+			dMapInsert = BenchmarkQPCMemory([&]
+			{
+				for (size_t i = 0; i < nKeys; i++)
+				{
+					hMap.emplace(BTreeKey(i), i);
+				}
+			}, &hProfile);
+
+			PrintMemoryProfile("std::map", hProfile);
+
+			dMapLookup = BenchmarkQPC([&] { qwSink += Test_MapLookups(hMap, vProbes); });
+			dMapScan = BenchmarkQPC([&] { qwSink += Test_MapScans(hMap, vStarts); });
+		}
+
+		std::vector<ULONGLONG> vSorted(nKeys);
+		for (size_t i = 0; i < nKeys; i++)
+		{
+			vSorted[i] = BTreeKey(i);
+		}
+
+		std::sort(vSorted.begin(), vSorted.end());
+
+		double dMapSorted = 0.0;
+		{
+			KeyMap hMap;
+			dMapSorted = BenchmarkQPC([&]
+			{
+				for (ULONGLONG qwKey : vSorted)
+				{
+					hMap.emplace_hint(hMap.end(), qwKey, qwKey);
+				}
+			});
+		}
+
+		//B+tree, random inserts then bulk load; the values are the keys, bulk_load takes them from the same array
+		double dTreeInsert = 0.0;
+		double dTreeLookup = 0.0;
+		double dTreeScan = 0.0;
+		{
+			KeyTree hTree;
+			dTreeInsert = BenchmarkQPCMemory([&]
+			{
+				for (size_t i = 0; i < nKeys; i++)
+				{
+					hTree.insert(BTreeKey(i), i);
+				}
+			}, &hProfile);
+
+			PrintMemoryProfile("B+tree", hProfile, { hTree.bytes_reserved(), hTree.bytes_in_use() });
+
+			dTreeLookup = BenchmarkQPC([&] { qwSink += Test_TreeLookups(hTree, vProbes); });
+			dTreeScan = BenchmarkQPC([&] { qwSink += Test_TreeScans(hTree, vStarts); });
+
+			std::cout << "    B+tree after random inserts: height " << hTree.height() << ", " << hTree.node_count() << " nodes, leaves " << hTree.leaf_fill() * 100.0 << " % full" << std::endl;
+		}
+
+		double dBulkLoad = 0.0;
+		double dBulkLookup = 0.0;
+		{
+			KeyTree hTree;
+			dBulkLoad = BenchmarkQPC([&] { hTree.bulk_load(vSorted.data(), vSorted.data(), vSorted.size()); });
+			dBulkLookup = BenchmarkQPC([&] { qwSink += Test_TreeLookups(hTree, vProbes); });
+		}
+
+		gnSink += static_cast<int>(qwSink);
+
+		const double dLookupNs = 1'000'000.0 / BTREE_LOOKUPS;
+		const double dScanNs = 1'000'000.0 / (BTREE_SCANS * BTREE_SCAN_LENGTH);
+
+		std::cout << "  insert random:     std::map " << dMapInsert << " ms | B+tree " << dTreeInsert << " ms" << std::endl;
+		std::cout << "  insert ascending:  std::map (hint) " << dMapSorted << " ms | B+tree bulk load " << dBulkLoad << " ms" << std::endl;
+		std::cout << "  lookup:            std::map " << dMapLookup * dLookupNs << " ns | B+tree " << dTreeLookup * dLookupNs
+		          << " ns | bulk-loaded B+tree " << dBulkLookup * dLookupNs << " ns" << std::endl;
+		std::cout << "  scan " << BTREE_SCAN_LENGTH << " keys:     std::map " << dMapScan * dScanNs << " ns/key | B+tree " << dTreeScan * dScanNs << " ns/key" << std::endl;
+	}
+}
+
+//------------------------------------------------------------
+// MAIN
+//------------------------------------------------------------
+int main()
+{
+	std::cout << "Memory Case Benchmarks\n\n";
+
+	//Every test is a profiler region; with ALLOC_PROFILER=0 the scopes compile to nothing
+	{
+		AllocProfilerScope hScope("Test 1-3 malloc/Pool/Slab");
+		MemoryProfile hProfile;
+		AllocatorFootprint hFootprint;
+
+		std::cout << "malloc/free: "    << BenchmarkQPCMemory(Test_malloc, &hProfile) << " ms" << std::endl;
+		PrintMemoryProfile("malloc", hProfile);
+		std::cout << "Pool Allocator: " << BenchmarkQPCMemory([&] { Test_PoolAlloc(&hFootprint); }, &hProfile) << " ms" << std::endl;
+		PrintMemoryProfile("Pool", hProfile, hFootprint);
+		std::cout << "Slab Allocator: " << BenchmarkQPCMemory([&] { Test_SlabAlloc(&hFootprint); }, &hProfile) << " ms" << std::endl;
+		PrintMemoryProfile("Slab", hProfile, hFootprint);
+	}
+
+	{
+		AllocProfilerScope hScope("Test 4 ThreadCache");
+		Bench_ThreadCache();
+	}
+
+	{
+		AllocProfilerScope hScope("Test 5 SlabCache");
+		Bench_SlabCache();
+	}
+
+	//With the profiler on, Test 6 is also recorded as the trace Test 10 replays
+	{
+		AllocProfilerScope hScope("Test 6 PmrContainers");
+		AllocTraceStart(TRACE_MAX_EVENTS);
+		Bench_PmrContainers();
+		AllocTraceStop(TRACE_PATH);
+	}
+
+	{
+		AllocProfilerScope hScope("Test 7 PageSizes");
+		Bench_PageSizes();
+	}
+
+	{
+		AllocProfilerScope hScope("Test 8 ConcurrentSlab");
+		Bench_ConcurrentSlab();
+	}
+
+	{
+		AllocProfilerScope hScope("Test 9 ObjectPool");
+		Bench_ObjectPool();
+	}
+
+	{
+		AllocProfilerScope hScope("Test 10 TraceReplay");
+		Bench_TraceReplay();
+	}
+
+	{
+		AllocProfilerScope hScope("Test 11 Numa");
+		Bench_Numa();
+	}
+
+	{
+		AllocProfilerScope hScope("Test 12 SmallContainers");
+		Bench_SmallContainers();
+	}
+
+	{
+		AllocProfilerScope hScope("Test 13 BPlusTree");
+		Bench_BPlusTree();
+	}
+
+	if (ALLOC_PROFILER && AllocProfilerWriteReport("alloc_profile.txt"))
+	{
+		std::cout << "\nAllocation profile written to alloc_profile.txt" << std::endl;
+	}
+
+	system("pause");
+	return 0;
+}
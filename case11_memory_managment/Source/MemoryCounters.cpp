@@ -0,0 +1,173 @@
+#include "MemoryCounters.h"
+#include <winternl.h>
+#include <psapi.h>
+#include <iostream>
+#include <vector>
+
+#pragma comment(lib, "ntdll.lib")
+
+//Fields winternl.h hides in SYSTEM_PROCESS_INFORMATION::Reserved1 (see case10 FaultCounters.h)
+constexpr size_t PRIVATE_WORKING_SET_OFFSET = 0;
+constexpr size_t HARD_FAULT_COUNT_OFFSET = 8;
+
+static void QueryPrivateCounters(size_t* pPrivateWorkingSet, ULONGLONG* pHardFaults, std::vector<BYTE>* pQueryBuffer)
+{
+	constexpr NTSTATUS STATUS_INFO_LENGTH_MISMATCH_VALUE = static_cast<NTSTATUS>(0xC0000004L);
+
+	std::vector<BYTE>& vBuffer = *pQueryBuffer;
+
+	*pPrivateWorkingSet = 0;
+	*pHardFaults = 0;
+
+	ULONG ulNeeded = 0;
+	NTSTATUS nStatus = NtQuerySystemInformation(SystemProcessInformation, vBuffer.data(), static_cast<ULONG>(vBuffer.size()), &ulNeeded);
+	while (nStatus == STATUS_INFO_LENGTH_MISMATCH_VALUE)
+	{
+		vBuffer.resize(static_cast<size_t>(ulNeeded) + 64 * 1024);
+		nStatus = NtQuerySystemInformation(SystemProcessInformation, vBuffer.data(), static_cast<ULONG>(vBuffer.size()), &ulNeeded);
+	}
+
+	if (!NT_SUCCESS(nStatus))
+	{
+		return;
+	}
+
+	const HANDLE hSelf = reinterpret_cast<HANDLE>(static_cast<ULONG_PTR>(GetCurrentProcessId()));
+
+	const BYTE* pEntry = vBuffer.data();
+	while (true)
+	{
+		const SYSTEM_PROCESS_INFORMATION* pInfo = reinterpret_cast<const SYSTEM_PROCESS_INFORMATION*>(pEntry);
+		if (pInfo->UniqueProcessId == hSelf)
+		{
+			LONGLONG llPrivateWorkingSet = 0;
+			ULONG ulHardFaults = 0;
+			memcpy(&llPrivateWorkingSet, pInfo->Reserved1 + PRIVATE_WORKING_SET_OFFSET, sizeof(llPrivateWorkingSet));
+			memcpy(&ulHardFaults, pInfo->Reserved1 + HARD_FAULT_COUNT_OFFSET, sizeof(ulHardFaults));
+
+			*pPrivateWorkingSet = static_cast<size_t>(llPrivateWorkingSet);
+			*pHardFaults = ulHardFaults;
+			return;
+		}
+
+		if (!pInfo->NextEntryOffset)
+		{
+			return;
+		}
+
+		pEntry += pInfo->NextEntryOffset;
+	}
+}
+
+void SampleWorkingSet(size_t* pWorkingSet, size_t* pCommit)
+{
+	PROCESS_MEMORY_COUNTERS_EX hCounters = {};
+	hCounters.cb = sizeof(hCounters);
+	GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&hCounters), sizeof(hCounters));
+
+	*pWorkingSet = hCounters.WorkingSetSize;
+	*pCommit = hCounters.PrivateUsage;
+}
+
+void TakeMemorySnapshot(MemorySnapshot* pSnapshot, std::vector<BYTE>* pQueryBuffer)
+{
+	PROCESS_MEMORY_COUNTERS_EX hCounters = {};
+	hCounters.cb = sizeof(hCounters);
+	GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&hCounters), sizeof(hCounters));
+
+	pSnapshot->nWorkingSet = hCounters.WorkingSetSize;
+	pSnapshot->nCommit = hCounters.PrivateUsage;
+	pSnapshot->qwPageFaults = hCounters.PageFaultCount;
+	QueryPrivateCounters(&pSnapshot->nPrivateWorkingSet, &pSnapshot->qwHardFaults, pQueryBuffer);
+}
+
+//------------------------------------------------------------
+// MemorySampler
+//------------------------------------------------------------
+MemorySampler::MemorySampler(DWORD nIntervalMsIn)
+	: nIntervalMs(nIntervalMsIn), hProfile(), vQueryBuffer(256 * 1024), bRunning(false)
+{
+}
+
+MemorySampler::~MemorySampler()
+{
+	if (this->hThread.joinable())
+	{
+		this->bRunning.store(false, std::memory_order_release);
+		this->hThread.join();
+	}
+}
+
+void MemorySampler::Sample(const MemorySnapshot& hSnapshot)
+{
+	MemorySnapshot& hPeak = this->hProfile.hPeak;
+	hPeak.nWorkingSet = max(hPeak.nWorkingSet, hSnapshot.nWorkingSet);
+	hPeak.nPrivateWorkingSet = max(hPeak.nPrivateWorkingSet, hSnapshot.nPrivateWorkingSet);
+	hPeak.nCommit = max(hPeak.nCommit, hSnapshot.nCommit);
+	hPeak.qwPageFaults = hSnapshot.qwPageFaults;
+	hPeak.qwHardFaults = hSnapshot.qwHardFaults;
+	this->hProfile.nSamples++;
+}
+
+void MemorySampler::start()
+{
+	this->hProfile = {};
+	TakeMemorySnapshot(&this->hProfile.hBefore, &this->vQueryBuffer);
+	this->Sample(this->hProfile.hBefore);
+
+	this->bRunning.store(true, std::memory_order_release);
+	this->hThread = std::thread([this]
+	{
+		while (this->bRunning.load(std::memory_order_acquire))
+		{
+			Sleep(this->nIntervalMs);
+
+			MemorySnapshot hSnapshot;
+			TakeMemorySnapshot(&hSnapshot, &this->vQueryBuffer);
+			this->Sample(hSnapshot);
+		}
+	});
+}
+
+//The after snapshot is also a sample, so a run shorter than the interval still gets a peak
+void MemorySampler::stop(MemoryProfile* pProfile)
+{
+	this->bRunning.store(false, std::memory_order_release);
+	this->hThread.join();
+
+	TakeMemorySnapshot(&this->hProfile.hAfter, &this->vQueryBuffer);
+	this->Sample(this->hProfile.hAfter);
+
+	*pProfile = this->hProfile;
+}
+
+//------------------------------------------------------------
+// Report
+//------------------------------------------------------------
+static void PrintTransition(const char* pLabel, size_t nBefore, size_t nPeak, size_t nAfter)
+{
+	std::cout << pLabel << nBefore / 1024 << " -> " << nPeak / 1024 << " -> " << nAfter / 1024 << " KB";
+}
+
+void PrintMemoryProfile(const char* pName, const MemoryProfile& hProfile, const AllocatorFootprint& hFootprint)
+{
+	const MemorySnapshot& hBefore = hProfile.hBefore;
+	const MemorySnapshot& hPeak = hProfile.hPeak;
+	const MemorySnapshot& hAfter = hProfile.hAfter;
+
+	std::cout << "    " << pName << " memory: ";
+	PrintTransition("working set ", hBefore.nWorkingSet, hPeak.nWorkingSet, hAfter.nWorkingSet);
+	PrintTransition(", private WS ", hBefore.nPrivateWorkingSet, hPeak.nPrivateWorkingSet, hAfter.nPrivateWorkingSet);
+	PrintTransition(", commit ", hBefore.nCommit, hPeak.nCommit, hAfter.nCommit);
+	std::cout << ", faults +" << hAfter.qwPageFaults - hBefore.qwPageFaults << " (hard +" << hAfter.qwHardFaults - hBefore.qwHardFaults << ")";
+
+	//External fragmentation: memory the allocator holds that no caller is using
+	if (hFootprint.qwReserved)
+	{
+		std::cout << ", allocator reserved " << hFootprint.qwReserved / 1024 << " KB / in use " << hFootprint.qwInUse / 1024
+		          << " KB (" << 100.0 * static_cast<double>(hFootprint.qwReserved - min(hFootprint.qwInUse, hFootprint.qwReserved)) / static_cast<double>(hFootprint.qwReserved)
+		          << " % free)";
+	}
+
+	std::cout << std::endl;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+
+/*
+    Process memory sampling for the allocator benchmarks.
+
+    The Linux trio maps to Windows as:
+    - RSS             -> working set (GetProcessMemoryInfo)
+    - PSS             -> private working set: the resident pages no other
+                         process shares. Windows has no proportional count
+                         short of walking every page with QueryWorkingSet; for
+                         an allocator benchmark the difference is the shared
+                         DLL pages, which do not move during a run.
+    - page faults     -> PageFaultCount (soft + hard) and the hard fault count
+                         (same NtQuerySystemInformation fields as case10's
+                         FaultCounters.h)
+    Commit (private bytes) is sampled too: it is what VirtualAlloc charges,
+    resident or not.
+
+    A MemorySampler takes a snapshot before the run, polls from a background
+    thread while it runs (keeping the peaks) and takes one after it. The poll
+    costs one NtQuerySystemInformation every MEMORY_SAMPLE_INTERVAL_MS on
+    another core, which the timings absorb equally for every allocator.
+*/
+constexpr DWORD MEMORY_SAMPLE_INTERVAL_MS = 5;
+
+struct MemorySnapshot
+{
+	size_t nWorkingSet;
+	size_t nPrivateWorkingSet;
+	size_t nCommit;
+	ULONGLONG qwPageFaults;
+	ULONGLONG qwHardFaults;
+};
+
+struct MemoryProfile
+{
+	MemorySnapshot hBefore;
+	MemorySnapshot hPeak;       //Highest working set, private working set and commit seen, each on its own
+	MemorySnapshot hAfter;
+	size_t nSamples;
+};
+
+//What an allocator holds from the OS vs what its callers hold; 0/0 when the allocator cannot tell (CRT malloc)
+struct AllocatorFootprint
+{
+	ULONGLONG qwReserved;
+	ULONGLONG qwInUse;
+};
+
+//pQueryBuffer: scratch for NtQuerySystemInformation, grown as needed; allocate it before a measured run
+void TakeMemorySnapshot(MemorySnapshot* pSnapshot, std::vector<BYTE>* pQueryBuffer);
+
+//Working set and commit only: cheap enough to call inside a timed loop
+void SampleWorkingSet(size_t* pWorkingSet, size_t* pCommit);
+
+class MemorySampler
+{
+public:
+	MemorySampler(DWORD nIntervalMsIn = MEMORY_SAMPLE_INTERVAL_MS);
+	~MemorySampler();
+
+	MemorySampler(const MemorySampler&) = delete;
+	MemorySampler& operator=(const MemorySampler&) = delete;
+
+	void start();
+	void stop(MemoryProfile* pProfile);
+
+private:
+	void Sample(const MemorySnapshot& hSnapshot);
+
+	DWORD nIntervalMs;
+	MemoryProfile hProfile;
+	std::vector<BYTE> vQueryBuffer;     //Allocated before the run; the before, polled and after snapshots never overlap, so they share it
+	std::atomic<bool> bRunning;
+	std::thread hThread;
+};
+
+//BenchmarkQPC with a MemorySampler around the run
+template<typename CallBack>
+double BenchmarkQPCMemory(CallBack&& Function, MemoryProfile* pProfile)
+{
+	MemorySampler hSampler;
+	hSampler.start();
+	const double dMilliseconds = BenchmarkQPC(Function);
+	hSampler.stop(pProfile);
+	return dMilliseconds;
+}
+
+//One line: before -> peak -> after for each counter, the fault deltas and the footprint if there is one
+void PrintMemoryProfile(const char* pName, const MemoryProfile& hProfile, const AllocatorFootprint& hFootprint = {});
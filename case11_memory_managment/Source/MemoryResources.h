@@ -0,0 +1,102 @@
+#pragma once
+#include <memory_resource>
+#include "Arena.h"
+#include "SlabCache.h"
+
+/*
+    std::pmr::memory_resource adapters, so the standard containers can run on
+    the custom allocators:
+
+        Arena hArena;
+        ArenaResource hResource(hArena);
+        std::pmr::vector<int> vValues(&hResource);
+
+    Both adapters only reference their allocator: it must outlive every
+    container using the resource, and two adapters are equal only when they
+    are the same object.
+*/
+
+//Deallocation is a no-op: memory comes back with Arena::restore() / reset()
+class ArenaResource : public std::pmr::memory_resource
+{
+public:
+	explicit ArenaResource(Arena& hArenaIn)
+		: hArena(hArenaIn)
+	{
+	}
+
+private:
+	void* do_allocate(size_t nBytes, size_t nAlignment) override
+	{
+		void* pPtr = this->hArena.alloc(nBytes, nAlignment);
+		if (!pPtr)
+		{
+			throw std::bad_alloc();
+		}
+
+		return pPtr;
+	}
+
+	void do_deallocate(void*, size_t, size_t) override
+	{
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& hOther) const noexcept override
+	{
+		return this == &hOther;
+	}
+
+	Arena& hArena;
+};
+
+//Blocks up to SLAB_CACHE_MAX_BLOCK come from the slab cache, anything larger or over-aligned from pUpstream
+class SlabCacheResource : public std::pmr::memory_resource
+{
+public:
+	explicit SlabCacheResource(SlabCache& hCacheIn, std::pmr::memory_resource* pUpstreamIn = std::pmr::new_delete_resource())
+		: hCache(hCacheIn), pUpstream(pUpstreamIn)
+	{
+	}
+
+private:
+	//pmr passes the same size and alignment to deallocate, so both sides take the same branch
+	bool Fits(size_t nBytes, size_t nAlignment) const
+	{
+		return nBytes <= this->hCache.class_size(this->hCache.class_count() - 1) && nAlignment <= SLAB_CACHE_ALIGNMENT;
+	}
+
+	void* do_allocate(size_t nBytes, size_t nAlignment) override
+	{
+		if (!this->Fits(nBytes, nAlignment))
+		{
+			return this->pUpstream->allocate(nBytes, nAlignment);
+		}
+
+		void* pPtr = this->hCache.alloc(nBytes);
+		if (!pPtr)
+		{
+			throw std::bad_alloc();
+		}
+
+		return pPtr;
+	}
+
+	void do_deallocate(void* pPtr, size_t nBytes, size_t nAlignment) override
+	{
+		if (!this->Fits(nBytes, nAlignment))
+		{
+			this->pUpstream->deallocate(pPtr, nBytes, nAlignment);
+			return;
+		}
+
+		this->hCache.free_block(pPtr);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& hOther) const noexcept override
+	{
+		return this == &hOther;
+	}
+
+	SlabCache& hCache;
+	std::pmr::memory_resource* pUpstream;
+};
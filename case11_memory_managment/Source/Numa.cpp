@@ -0,0 +1,197 @@
+#include "Numa.h"
+#include <bit>
+#include <thread>
+
+static NumaTopology ReadNumaTopology()
+{
+	NumaTopology hTopology;
+
+	ULONG ulHighest = 0;
+	if (GetNumaHighestNodeNumber(&ulHighest))
+	{
+		for (ULONG nNode = 0; nNode <= ulHighest; nNode++)
+		{
+			GROUP_AFFINITY hAffinity = {};
+			if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(nNode), &hAffinity) || !hAffinity.Mask)
+			{
+				continue;
+			}
+
+			ULONGLONG qwAvailable = 0;
+			GetNumaAvailableMemoryNodeEx(static_cast<USHORT>(nNode), &qwAvailable);
+
+			hTopology.vNodes.push_back({ nNode, hAffinity, static_cast<ULONG>(std::popcount(static_cast<ULONGLONG>(hAffinity.Mask))), qwAvailable });
+		}
+	}
+
+	//No NUMA information at all: one node with every processor the thread may run on
+	if (hTopology.vNodes.empty())
+	{
+		NumaNode hNode = {};
+		hNode.nProcessors = std::thread::hardware_concurrency();
+		hTopology.vNodes.push_back(hNode);
+	}
+
+	return hTopology;
+}
+
+const NumaTopology& GetNumaTopology()
+{
+	static const NumaTopology hTopology = ReadNumaTopology();
+	return hTopology;
+}
+
+bool PinThreadToNumaNode(size_t nIndex, GROUP_AFFINITY* pPrevious)
+{
+	const NumaTopology& hTopology = GetNumaTopology();
+	if (nIndex >= hTopology.vNodes.size() || !hTopology.vNodes[nIndex].hAffinity.Mask)
+	{
+		return false;
+	}
+
+	return SetThreadGroupAffinity(GetCurrentThread(), &hTopology.vNodes[nIndex].hAffinity, pPrevious) != FALSE;
+}
+
+void RestoreThreadAffinity(const GROUP_AFFINITY& hPrevious)
+{
+	SetThreadGroupAffinity(GetCurrentThread(), &hPrevious, nullptr);
+}
+
+void RunOnEachNumaNode(const std::function<void(size_t)>& Function)
+{
+	const size_t nNodes = NumaNodeCount();
+
+	std::vector<std::thread> vThreads;
+	vThreads.reserve(nNodes);
+
+	for (size_t nIndex = 0; nIndex < nNodes; nIndex++)
+	{
+		vThreads.emplace_back([&Function, nIndex]
+		{
+			PinThreadToNumaNode(nIndex);
+			Function(nIndex);
+		});
+	}
+
+	for (std::thread& hThread : vThreads)
+	{
+		hThread.join();
+	}
+}
+
+//------------------------------------------------------------
+// Regions
+//------------------------------------------------------------
+//One write per page decides where the page lives
+static void TouchPages(char* pBegin, char* pEnd, size_t nStride)
+{
+	for (char* pPage = pBegin; pPage < pEnd; pPage += nStride)
+	{
+		*reinterpret_cast<volatile char*>(pPage) = 0;
+	}
+}
+
+bool AllocNumaRegion(size_t nSize, NumaPolicy ePolicy, size_t nNode, NumaRegion* pRegion)
+{
+	const NumaTopology& hTopology = GetNumaTopology();
+	const size_t nNodes = hTopology.vNodes.size();
+	const size_t nRounded = (nSize + NUMA_PAGE_SIZE - 1) & ~(NUMA_PAGE_SIZE - 1);
+
+	pRegion->pBase = nullptr;
+	pRegion->nSize = 0;
+	pRegion->nSliceBytes = 0;
+	pRegion->ePolicy = ePolicy;
+	pRegion->nNode = static_cast<ULONG>(nNode);
+
+	if (ePolicy == NUMA_POLICY_BIND && nNode >= nNodes)
+	{
+		return false;
+	}
+
+	void* pBase = nullptr;
+	if (ePolicy == NUMA_POLICY_BIND && nNodes > 1)
+	{
+		pBase = VirtualAllocExNuma(GetCurrentProcess(), nullptr, nRounded, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, hTopology.vNodes[nNode].nNode);
+	}
+	else
+	{
+		pBase = VirtualAlloc(nullptr, nRounded, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+
+	if (!pBase)
+	{
+		return false;
+	}
+
+	char* pBytes = reinterpret_cast<char*>(pBase);
+
+	pRegion->pBase = pBytes;
+	pRegion->nSize = nRounded;
+	pRegion->nSliceBytes = (nRounded / nNodes + NUMA_PAGE_SIZE - 1) & ~(NUMA_PAGE_SIZE - 1);
+
+	if (nNodes == 1)
+	{
+		return true;
+	}
+
+	switch (ePolicy)
+	{
+	case NUMA_POLICY_BIND:
+		//The node is already fixed by the allocation; touching now keeps the faults out of the caller's loops
+		TouchPages(pBytes, pBytes + nRounded, NUMA_PAGE_SIZE);
+		break;
+	case NUMA_POLICY_INTERLEAVE:
+		RunOnEachNumaNode([&] (size_t nIndex)
+		{
+			TouchPages(pBytes + nIndex * NUMA_PAGE_SIZE, pBytes + nRounded, nNodes * NUMA_PAGE_SIZE);
+		});
+		break;
+	case NUMA_POLICY_BLOCKED:
+		RunOnEachNumaNode([&] (size_t nIndex)
+		{
+			TouchPages(NumaSliceBegin(*pRegion, nIndex), NumaSliceEnd(*pRegion, nIndex), NUMA_PAGE_SIZE);
+		});
+		break;
+	default:
+		break;
+	}
+
+	return true;
+}
+
+void FreeNumaRegion(NumaRegion* pRegion)
+{
+	if (pRegion->pBase)
+	{
+		VirtualFree(pRegion->pBase, 0, MEM_RELEASE);
+	}
+
+	pRegion->pBase = nullptr;
+	pRegion->nSize = 0;
+	pRegion->nSliceBytes = 0;
+}
+
+char* NumaSliceBegin(const NumaRegion& hRegion, size_t nIndex)
+{
+	return hRegion.pBase + min(nIndex * hRegion.nSliceBytes, hRegion.nSize);
+}
+
+char* NumaSliceEnd(const NumaRegion& hRegion, size_t nIndex)
+{
+	return hRegion.pBase + min((nIndex + 1) * hRegion.nSliceBytes, hRegion.nSize);
+}
+
+const char* NumaPolicyName(NumaPolicy ePolicy)
+{
+	switch (ePolicy)
+	{
+	case NUMA_POLICY_BIND:
+		return "bind";
+	case NUMA_POLICY_INTERLEAVE:
+		return "interleave";
+	case NUMA_POLICY_BLOCKED:
+		return "blocked";
+	default:
+		return "first touch";
+	}
+}
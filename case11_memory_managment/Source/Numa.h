@@ -0,0 +1,78 @@
+#pragma once
+#include <Windows.h>
+#include <functional>
+#include <vector>
+
+/*
+    NUMA topology and placement for the allocators.
+
+    - The topology comes from GetNumaHighestNodeNumber and
+      GetNumaNodeProcessorMaskEx; nodes without processors (memory-only or
+      absent numbers) are left out. A node that spans processor groups is
+      seen through its first group only, which is enough to pin a thread.
+    - Windows places a committed page on the node of the thread that first
+      touches it, like Linux's default policy. VirtualAllocExNuma overrides
+      that for a whole allocation (the bind policy); there is no interleave
+      policy, so interleaving is done by touching the pages round-robin from
+      one thread per node.
+    - Arena takes a node too (Arena.h): its blocks come from VirtualAllocExNuma.
+
+    On a single-node machine every policy is a plain VirtualAlloc and nothing
+    is touched up front: there is no placement to make.
+*/
+constexpr size_t NUMA_PAGE_SIZE = 4096;
+
+enum NumaPolicy
+{
+	NUMA_POLICY_FIRST_TOUCH,    //Pages land on the node of whoever writes them first; nothing is touched here
+	NUMA_POLICY_BIND,           //All pages on one node (VirtualAllocExNuma), touched up front
+	NUMA_POLICY_INTERLEAVE,     //Page i on node i % nodes, touched in parallel
+	NUMA_POLICY_BLOCKED,        //One contiguous slice per node, touched in parallel: the parallel first-touch init
+};
+
+struct NumaNode
+{
+	ULONG nNode;                //Windows node number; the index in vNodes is what the policies count with
+	GROUP_AFFINITY hAffinity;
+	ULONG nProcessors;
+	ULONGLONG qwAvailableBytes;     //Free memory on the node when the topology was read
+};
+
+struct NumaTopology
+{
+	std::vector<NumaNode> vNodes;
+};
+
+struct NumaRegion
+{
+	char* pBase;
+	size_t nSize;               //Rounded up to NUMA_PAGE_SIZE
+	size_t nSliceBytes;         //Even split per node (the last slice may be shorter): what NUMA_POLICY_BLOCKED places
+	NumaPolicy ePolicy;
+	ULONG nNode;                //NUMA_POLICY_BIND: the node index
+};
+
+//Read once, on first use
+const NumaTopology& GetNumaTopology();
+
+inline size_t NumaNodeCount()
+{
+	return GetNumaTopology().vNodes.size();
+}
+
+//Pins the calling thread to the processors of node index nIndex; pPrevious receives the old affinity
+bool PinThreadToNumaNode(size_t nIndex, GROUP_AFFINITY* pPrevious = nullptr);
+void RestoreThreadAffinity(const GROUP_AFFINITY& hPrevious);
+
+//Runs Function(nIndex) on one thread per node, each pinned to its node, and waits for all of them
+void RunOnEachNumaNode(const std::function<void(size_t)>& Function);
+
+//nNode is a node index and only used by NUMA_POLICY_BIND
+bool AllocNumaRegion(size_t nSize, NumaPolicy ePolicy, size_t nNode, NumaRegion* pRegion);
+void FreeNumaRegion(NumaRegion* pRegion);
+
+//Node index nIndex's slice; a parallel loop split this way reads local memory from a NUMA_POLICY_BLOCKED region
+char* NumaSliceBegin(const NumaRegion& hRegion, size_t nIndex);
+char* NumaSliceEnd(const NumaRegion& hRegion, size_t nIndex);
+
+const char* NumaPolicyName(NumaPolicy ePolicy);
@@ -0,0 +1,209 @@
+#pragma once
+#include <Windows.h>
+#include <vector>
+#include <utility>
+
+/*
+    Typed object pool with stable handles (a "slot map").
+
+    Pool, Slab and SlabCache hand out raw blocks: once a block is freed and
+    reused, an old pointer to it silently aliases the new object. ObjectPool<T>
+    hands out ObjectHandle instead, a 32-bit slot index plus a 32-bit
+    generation:
+
+        ObjectPool<Entity> hPool;
+        ObjectHandle hHandle = hPool.insert(Entity{});
+        Entity* pEntity = hPool.get(hHandle);   //nullptr once erased
+        hPool.erase(hHandle);
+
+    - The objects live packed in one dense array, so iterating begin()..end()
+      walks contiguous memory with no holes.
+    - Slots map a handle to its dense index. erase() moves the last object into
+      the hole (swap-and-pop) and updates the slot of the moved object: O(1),
+      and the dense array stays compact. Order is not preserved.
+    - Erasing bumps the slot's generation, so every handle to the old object
+      stops resolving. Free slots form a LIFO list threaded through the slot
+      array; insert() reuses one before growing.
+    - A slot whose generation would wrap is retired instead of reused, so a
+      stale handle can never match again.
+
+    Pointers from get() or begin() are invalidated by any insert/erase (the
+    dense array moves and compacts); handles are not. Not thread-safe.
+*/
+struct ObjectHandle
+{
+	UINT32 nIndex;
+	UINT32 nGeneration;         //0 is never issued: a zero handle is the null handle
+
+	bool operator==(const ObjectHandle&) const = default;
+};
+
+static_assert(sizeof(ObjectHandle) == sizeof(ULONGLONG), "ObjectHandle must stay 32+32 bits");
+
+template<typename T>
+class ObjectPool
+{
+public:
+	ObjectPool()
+		: nFreeHead(NO_SLOT)
+	{
+	}
+
+	void reserve(size_t nCount)
+	{
+		this->vDense.reserve(nCount);
+		this->vDenseToSlot.reserve(nCount);
+		this->vSlots.reserve(nCount);
+	}
+
+	template<typename... Args>
+	ObjectHandle emplace(Args&&... args)
+	{
+		UINT32 nSlot = this->nFreeHead;
+		if (nSlot != NO_SLOT)
+		{
+			this->nFreeHead = this->vSlots[nSlot].nLink;
+		}
+		else
+		{
+			nSlot = static_cast<UINT32>(this->vSlots.size());
+			this->vSlots.push_back({ 0, 1 });
+		}
+
+		Slot& hSlot = this->vSlots[nSlot];
+		hSlot.nLink = static_cast<UINT32>(this->vDense.size());
+
+		this->vDense.emplace_back(std::forward<Args>(args)...);
+		this->vDenseToSlot.push_back(nSlot);
+
+		return { nSlot, hSlot.nGeneration };
+	}
+
+	ObjectHandle insert(const T& hObject)
+	{
+		return this->emplace(hObject);
+	}
+
+	ObjectHandle insert(T&& hObject)
+	{
+		return this->emplace(std::move(hObject));
+	}
+
+	//false if the handle is stale or null
+	bool erase(ObjectHandle hHandle)
+	{
+		if (!this->contains(hHandle))
+		{
+			return false;
+		}
+
+		Slot& hSlot = this->vSlots[hHandle.nIndex];
+		const UINT32 nDense = hSlot.nLink;
+		const UINT32 nLast = static_cast<UINT32>(this->vDense.size() - 1);
+
+		if (nDense != nLast)
+		{
+			this->vDense[nDense] = std::move(this->vDense[nLast]);
+			this->vDenseToSlot[nDense] = this->vDenseToSlot[nLast];
+			this->vSlots[this->vDenseToSlot[nDense]].nLink = nDense;
+		}
+
+		this->vDense.pop_back();
+		this->vDenseToSlot.pop_back();
+
+		hSlot.nGeneration++;
+		if (hSlot.nGeneration != 0)
+		{
+			hSlot.nLink = this->nFreeHead;
+			this->nFreeHead = hHandle.nIndex;
+		}
+
+		return true;
+	}
+
+	bool contains(ObjectHandle hHandle) const
+	{
+		return hHandle.nIndex < this->vSlots.size() && hHandle.nGeneration != 0 && this->vSlots[hHandle.nIndex].nGeneration == hHandle.nGeneration;
+	}
+
+	T* get(ObjectHandle hHandle)
+	{
+		return this->contains(hHandle) ? &this->vDense[this->vSlots[hHandle.nIndex].nLink] : nullptr;
+	}
+
+	const T* get(ObjectHandle hHandle) const
+	{
+		return this->contains(hHandle) ? &this->vDense[this->vSlots[hHandle.nIndex].nLink] : nullptr;
+	}
+
+	//Handle of the object at a dense position, for erasing while iterating
+	ObjectHandle handle_at(size_t nDense) const
+	{
+		const UINT32 nSlot = this->vDenseToSlot[nDense];
+		return { nSlot, this->vSlots[nSlot].nGeneration };
+	}
+
+	//Every live handle becomes stale; slots are kept for reuse
+	void clear()
+	{
+		while (!this->vDense.empty())
+		{
+			this->erase(this->handle_at(this->vDense.size() - 1));
+		}
+	}
+
+	size_t size() const
+	{
+		return this->vDense.size();
+	}
+
+	bool empty() const
+	{
+		return this->vDense.empty();
+	}
+
+	//Capacity of the three arrays vs the part live objects use
+	size_t bytes_reserved() const
+	{
+		return this->vDense.capacity() * sizeof(T) + this->vDenseToSlot.capacity() * sizeof(UINT32) + this->vSlots.capacity() * sizeof(Slot);
+	}
+
+	size_t bytes_in_use() const
+	{
+		return this->vDense.size() * (sizeof(T) + sizeof(UINT32) + sizeof(Slot));
+	}
+
+	T* begin()
+	{
+		return this->vDense.data();
+	}
+
+	T* end()
+	{
+		return this->vDense.data() + this->vDense.size();
+	}
+
+	const T* begin() const
+	{
+		return this->vDense.data();
+	}
+
+	const T* end() const
+	{
+		return this->vDense.data() + this->vDense.size();
+	}
+
+private:
+	static constexpr UINT32 NO_SLOT = 0xFFFFFFFF;
+
+	struct Slot
+	{
+		UINT32 nLink;           //Live: index in vDense. Free: next free slot
+		UINT32 nGeneration;     //Bumped by erase() to invalidate the handles of the old object
+	};
+
+	std::vector<T> vDense;
+	std::vector<UINT32> vDenseToSlot;
+	std::vector<Slot> vSlots;
+	UINT32 nFreeHead;
+};
@@ -0,0 +1,291 @@
+#include "SlabCache.h"
+
+struct SlabHeader
+{
+	SlabHeader* pPrev;
+	SlabHeader* pNext;
+	void* pFreeList;            //Blocks freed back to this slab
+	UINT32 nNextUnused;         //Blocks never handed out start here
+	UINT32 nInUse;
+	UINT32 nCapacity;
+	UINT32 nClass;
+	size_t nBlockSize;
+};
+
+//The header takes a full cache line so the first block does not share it
+constexpr size_t SLAB_HEADER_SIZE = 64;
+static_assert(sizeof(SlabHeader) <= SLAB_HEADER_SIZE, "SlabHeader does not fit its cache line");
+
+static const size_t gpDefaultClassSizes[] =
+{
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192
+};
+
+static char* BlocksOf(SlabHeader* pSlab)
+{
+	return reinterpret_cast<char*>(pSlab) + SLAB_HEADER_SIZE;
+}
+
+static SlabHeader* SlabOf(void* pPtr)
+{
+	return reinterpret_cast<SlabHeader*>(reinterpret_cast<ULONG_PTR>(pPtr) & ~static_cast<ULONG_PTR>(SLAB_CACHE_SLAB_SIZE - 1));
+}
+
+static void PushSlab(SlabList& hList, SlabHeader* pSlab)
+{
+	pSlab->pPrev = nullptr;
+	pSlab->pNext = hList.pHead;
+	if (hList.pHead)
+	{
+		hList.pHead->pPrev = pSlab;
+	}
+
+	hList.pHead = pSlab;
+	hList.nCount++;
+}
+
+static void RemoveSlab(SlabList& hList, SlabHeader* pSlab)
+{
+	if (pSlab->pPrev)
+	{
+		pSlab->pPrev->pNext = pSlab->pNext;
+	}
+	else
+	{
+		hList.pHead = pSlab->pNext;
+	}
+
+	if (pSlab->pNext)
+	{
+		pSlab->pNext->pPrev = pSlab->pPrev;
+	}
+
+	hList.nCount--;
+}
+
+//------------------------------------------------------------
+// Construction
+//------------------------------------------------------------
+SlabCache::SlabCache(const size_t* pClassSizesIn, size_t nClassesIn, size_t nEmptyWatermarkIn)
+{
+	this->Init(pClassSizesIn, nClassesIn, nEmptyWatermarkIn);
+}
+
+SlabCache::SlabCache(size_t nEmptyWatermarkIn)
+{
+	this->Init(gpDefaultClassSizes, sizeof(gpDefaultClassSizes) / sizeof(gpDefaultClassSizes[0]), nEmptyWatermarkIn);
+}
+
+void SlabCache::Init(const size_t* pClassSizesIn, size_t nClassesIn, size_t nEmptyWatermarkIn)
+{
+	this->nClasses = min(nClassesIn, SLAB_CACHE_MAX_CLASSES);
+	this->nEmptyWatermark = nEmptyWatermarkIn;
+	this->nSlabsCreated = 0;
+	this->nSlabsReleased = 0;
+
+	ZeroMemory(this->pClasses, sizeof(this->pClasses));
+
+	for (size_t i = 0; i < this->nClasses; i++)
+	{
+		this->pClassSizes[i] = pClassSizesIn[i];
+	}
+
+	//Sizes above the largest class map to nClasses, which alloc() rejects
+	size_t nClass = 0;
+	for (size_t i = 0; i <= SLAB_CACHE_MAX_BLOCK / SLAB_CACHE_ALIGNMENT; i++)
+	{
+		while (nClass < this->nClasses && this->pClassSizes[nClass] < i * SLAB_CACHE_ALIGNMENT)
+		{
+			nClass++;
+		}
+
+		this->pSizeToClass[i] = static_cast<UINT8>(nClass);
+	}
+}
+
+SlabCache::~SlabCache()
+{
+	for (size_t i = 0; i < this->nClasses; i++)
+	{
+		SlabList* pLists[] = { &this->pClasses[i].hPartial, &this->pClasses[i].hFull, &this->pClasses[i].hEmpty };
+
+		for (SlabList* pList : pLists)
+		{
+			while (pList->pHead)
+			{
+				SlabHeader* pSlab = pList->pHead;
+				RemoveSlab(*pList, pSlab);
+				VirtualFree(pSlab, 0, MEM_RELEASE);
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------
+// Slabs
+//------------------------------------------------------------
+SlabHeader* SlabCache::NewSlab(size_t nClass)
+{
+	SlabHeader* pSlab = reinterpret_cast<SlabHeader*>(VirtualAlloc(nullptr, SLAB_CACHE_SLAB_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+	if (!pSlab)
+	{
+		return nullptr;
+	}
+
+	pSlab->pPrev = nullptr;
+	pSlab->pNext = nullptr;
+	pSlab->pFreeList = nullptr;
+	pSlab->nNextUnused = 0;
+	pSlab->nInUse = 0;
+	pSlab->nBlockSize = this->pClassSizes[nClass];
+	pSlab->nCapacity = static_cast<UINT32>((SLAB_CACHE_SLAB_SIZE - SLAB_HEADER_SIZE) / pSlab->nBlockSize);
+	pSlab->nClass = static_cast<UINT32>(nClass);
+
+	this->nSlabsCreated++;
+	return pSlab;
+}
+
+void SlabCache::ReleaseSlab(SlabHeader* pSlab)
+{
+	VirtualFree(pSlab, 0, MEM_RELEASE);
+	this->nSlabsReleased++;
+}
+
+void SlabCache::trim()
+{
+	for (size_t i = 0; i < this->nClasses; i++)
+	{
+		SlabList& hEmpty = this->pClasses[i].hEmpty;
+
+		while (hEmpty.pHead)
+		{
+			SlabHeader* pSlab = hEmpty.pHead;
+			RemoveSlab(hEmpty, pSlab);
+			this->ReleaseSlab(pSlab);
+		}
+	}
+}
+
+//------------------------------------------------------------
+// Blocks
+//------------------------------------------------------------
+void* SlabCache::alloc(size_t nSize)
+{
+	if (nSize > SLAB_CACHE_MAX_BLOCK)
+	{
+		return nullptr;
+	}
+
+	const size_t nClass = this->pSizeToClass[(nSize + SLAB_CACHE_ALIGNMENT - 1) / SLAB_CACHE_ALIGNMENT];
+	if (nClass >= this->nClasses)
+	{
+		return nullptr;
+	}
+
+	SizeClass& hClass = this->pClasses[nClass];
+
+	SlabHeader* pSlab = hClass.hPartial.pHead;
+	if (!pSlab)
+	{
+		//Reuse an empty slab before asking the OS for a new one
+		pSlab = hClass.hEmpty.pHead;
+		if (pSlab)
+		{
+			RemoveSlab(hClass.hEmpty, pSlab);
+		}
+		else
+		{
+			pSlab = this->NewSlab(nClass);
+			if (!pSlab)
+			{
+				return nullptr;
+			}
+		}
+
+		PushSlab(hClass.hPartial, pSlab);
+	}
+
+	void* pPtr;
+	if (pSlab->pFreeList)
+	{
+		pPtr = pSlab->pFreeList;
+		pSlab->pFreeList = *reinterpret_cast<void**>(pPtr);
+	}
+	else
+	{
+		pPtr = BlocksOf(pSlab) + pSlab->nNextUnused * pSlab->nBlockSize;
+		pSlab->nNextUnused++;
+	}
+
+	if (++pSlab->nInUse == pSlab->nCapacity)
+	{
+		RemoveSlab(hClass.hPartial, pSlab);
+		PushSlab(hClass.hFull, pSlab);
+	}
+
+	return pPtr;
+}
+
+void SlabCache::free_block(void* pPtr)
+{
+	if (!pPtr)
+	{
+		return;
+	}
+
+	SlabHeader* pSlab = SlabOf(pPtr);
+	SizeClass& hClass = this->pClasses[pSlab->nClass];
+
+	*reinterpret_cast<void**>(pPtr) = pSlab->pFreeList;
+	pSlab->pFreeList = pPtr;
+
+	if (pSlab->nInUse-- == pSlab->nCapacity)
+	{
+		RemoveSlab(hClass.hFull, pSlab);
+		PushSlab(hClass.hPartial, pSlab);
+	}
+
+	if (pSlab->nInUse == 0)
+	{
+		RemoveSlab(hClass.hPartial, pSlab);
+
+		if (hClass.hEmpty.nCount >= this->nEmptyWatermark)
+		{
+			this->ReleaseSlab(pSlab);
+			return;
+		}
+
+		//Reset the carving so a reused slab hands out blocks in address order again
+		pSlab->pFreeList = nullptr;
+		pSlab->nNextUnused = 0;
+		PushSlab(hClass.hEmpty, pSlab);
+	}
+}
+
+void SlabCache::get_stats(SlabCacheStats* pStats) const
+{
+	ZeroMemory(pStats, sizeof(*pStats));
+
+	for (size_t i = 0; i < this->nClasses; i++)
+	{
+		const SizeClass& hClass = this->pClasses[i];
+
+		pStats->nSlabsPartial += hClass.hPartial.nCount;
+		pStats->nSlabsFull += hClass.hFull.nCount;
+		pStats->nSlabsEmpty += hClass.hEmpty.nCount;
+
+		for (const SlabHeader* pSlab = hClass.hPartial.pHead; pSlab; pSlab = pSlab->pNext)
+		{
+			pStats->qwBytesInUse += static_cast<ULONGLONG>(pSlab->nInUse) * pSlab->nBlockSize;
+		}
+
+		for (const SlabHeader* pSlab = hClass.hFull.pHead; pSlab; pSlab = pSlab->pNext)
+		{
+			pStats->qwBytesInUse += static_cast<ULONGLONG>(pSlab->nInUse) * pSlab->nBlockSize;
+		}
+	}
+
+	pStats->nSlabsCreated = this->nSlabsCreated;
+	pStats->nSlabsReleased = this->nSlabsReleased;
+	pStats->qwBytesReserved = static_cast<ULONGLONG>(pStats->nSlabsPartial + pStats->nSlabsFull + pStats->nSlabsEmpty) * SLAB_CACHE_SLAB_SIZE;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Growable slab cache with size classes (the Slab of Main.cpp, without its
+    64-object limit).
+
+    - Every size class owns a chain of slabs of SLAB_CACHE_SLAB_SIZE bytes,
+      split in three lists: partial (some blocks free), full and empty.
+      alloc() takes from the first partial slab, then an empty one, and only
+      then asks VirtualAlloc for a new slab.
+    - A slab starts with its header. Slabs come straight from VirtualAlloc,
+      which aligns them to the 64 KB allocation granularity, so free_block()
+      finds the header by masking the pointer: no per-block header.
+    - Blocks are carved lazily (bump index first, free list afterwards), so a
+      new slab costs one VirtualAlloc and no initialization loop.
+    - Each class keeps at most nEmptyWatermark empty slabs; the ones past it go
+      back to VirtualFree, which bounds the memory a burst leaves behind.
+
+    Not thread-safe, like Slab and Pool: one cache per thread or an external lock.
+*/
+constexpr size_t SLAB_CACHE_SLAB_SIZE = 64 * 1024;
+constexpr size_t SLAB_CACHE_MAX_CLASSES = 32;
+constexpr size_t SLAB_CACHE_MAX_BLOCK = SLAB_CACHE_SLAB_SIZE / 8;
+constexpr size_t SLAB_CACHE_ALIGNMENT = 16;
+
+struct SlabHeader;
+
+struct SlabList
+{
+	SlabHeader* pHead;
+	size_t nCount;
+};
+
+struct SlabCacheStats
+{
+	size_t nSlabsPartial;
+	size_t nSlabsFull;
+	size_t nSlabsEmpty;
+	size_t nSlabsCreated;       //VirtualAlloc calls since construction
+	size_t nSlabsReleased;      //VirtualFree calls past the watermark
+	ULONGLONG qwBytesReserved;  //Slabs currently held
+	ULONGLONG qwBytesInUse;     //Blocks handed out, rounded to their class
+};
+
+class SlabCache
+{
+public:
+	//pClassSizes: ascending block sizes, multiples of SLAB_CACHE_ALIGNMENT, <= SLAB_CACHE_MAX_BLOCK
+	SlabCache(const size_t* pClassSizes, size_t nClasses, size_t nEmptyWatermarkIn = 1);
+	explicit SlabCache(size_t nEmptyWatermarkIn = 1);
+	~SlabCache();
+
+	SlabCache(const SlabCache&) = delete;
+	SlabCache& operator=(const SlabCache&) = delete;
+
+	//nullptr if nSize is above the largest class or VirtualAlloc fails
+	void* alloc(size_t nSize);
+	void free_block(void* pPtr);
+
+	//Releases every empty slab, regardless of the watermark
+	void trim();
+
+	size_t class_size(size_t nClass) const
+	{
+		return this->pClassSizes[nClass];
+	}
+
+	size_t class_count() const
+	{
+		return this->nClasses;
+	}
+
+	void get_stats(SlabCacheStats* pStats) const;
+
+private:
+	struct SizeClass
+	{
+		SlabList hPartial;
+		SlabList hFull;
+		SlabList hEmpty;
+	};
+
+	void Init(const size_t* pClassSizesIn, size_t nClassesIn, size_t nEmptyWatermarkIn);
+	SlabHeader* NewSlab(size_t nClass);
+	void ReleaseSlab(SlabHeader* pSlab);
+
+	size_t pClassSizes[SLAB_CACHE_MAX_CLASSES];
+	SizeClass pClasses[SLAB_CACHE_MAX_CLASSES];
+	UINT8 pSizeToClass[SLAB_CACHE_MAX_BLOCK / SLAB_CACHE_ALIGNMENT + 1];   //Indexed by ceil(size / 16)
+	size_t nClasses;
+	size_t nEmptyWatermark;
+	size_t nSlabsCreated;
+	size_t nSlabsReleased;
+};
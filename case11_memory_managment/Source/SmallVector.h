@@ -0,0 +1,535 @@
+#pragma once
+#include <Windows.h>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/*
+    Containers with in-object storage: SmallVector<T, N> and InlineString<N>.
+
+    Most vectors and strings a request handler builds are short and die
+    within the function: a list of the blocks it allocated, a copy of the
+    bytes it received. std::vector always goes to the heap, and std::string
+    only avoids it up to its SSO size (15 chars with MSVC). These keep up to
+    N elements inside the object and spill to the heap past that:
+
+        SmallVector<void*, 64> vBlocks;     //No allocation for 64 pointers or less
+        InlineString<128> strMessage(pBuffer, nBytes);
+
+    - Growing past N (or past the heap capacity) doubles the capacity and
+      relocates the elements. For trivially relocatable types (see below) that
+      is one memcpy; otherwise each element is move-constructed and destroyed.
+    - Moving a spilled SmallVector steals its heap buffer. Moving an inline one
+      relocates its elements, so the moved-from vector is left empty either way.
+    - Pointers and iterators are invalidated by any growth, and by moving an
+      inline container. Not thread-safe.
+
+    Trivially relocatable: moving the object's bytes elsewhere and forgetting
+    the original is equivalent to move-construct + destroy. Every trivially
+    copyable type is; so is a type that owns a heap pointer but never points
+    into itself (unique_ptr, InlineString). A type that does point into
+    itself (SmallVector while inline, libstdc++'s std::string) is not. Opt a
+    type in by specializing IsTriviallyRelocatable.
+*/
+template<typename T>
+struct IsTriviallyRelocatable : std::bool_constant<std::is_trivially_copyable_v<T>>
+{
+};
+
+//The default deleter is empty, so a unique_ptr is its pointer and nothing else
+template<typename T>
+struct IsTriviallyRelocatable<std::unique_ptr<T>> : std::true_type
+{
+};
+
+//Moves nCount elements from pSource into uninitialized pTarget and ends their lifetime in pSource
+template<typename T>
+void RelocateElements(T* pSource, size_t nCount, T* pTarget)
+{
+	if constexpr (IsTriviallyRelocatable<T>::value)
+	{
+		if (nCount)
+		{
+			memcpy(static_cast<void*>(pTarget), static_cast<const void*>(pSource), nCount * sizeof(T));
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < nCount; i++)
+		{
+			::new (static_cast<void*>(pTarget + i)) T(std::move(pSource[i]));
+			pSource[i].~T();
+		}
+	}
+}
+
+//------------------------------------------------------------
+// SmallVector
+//------------------------------------------------------------
+template<typename T, size_t N>
+class SmallVector
+{
+	static_assert(N > 0, "SmallVector needs room for at least one element; use std::vector for N = 0");
+
+public:
+	SmallVector()
+		: pData(this->InlineData()), nSize(0), nCapacity(N)
+	{
+	}
+
+	SmallVector(const SmallVector& hOther)
+		: SmallVector()
+	{
+		this->reserve(hOther.nSize);
+		std::uninitialized_copy(hOther.begin(), hOther.end(), this->pData);
+		this->nSize = hOther.nSize;
+	}
+
+	SmallVector(SmallVector&& hOther) noexcept
+		: SmallVector()
+	{
+		this->TakeFrom(hOther);
+	}
+
+	~SmallVector()
+	{
+		this->clear();
+		this->ReleaseHeap();
+	}
+
+	SmallVector& operator=(const SmallVector& hOther)
+	{
+		if (this != &hOther)
+		{
+			this->clear();
+			this->reserve(hOther.nSize);
+			std::uninitialized_copy(hOther.begin(), hOther.end(), this->pData);
+			this->nSize = hOther.nSize;
+		}
+
+		return *this;
+	}
+
+	SmallVector& operator=(SmallVector&& hOther) noexcept
+	{
+		if (this != &hOther)
+		{
+			this->clear();
+			this->ReleaseHeap();
+			this->pData = this->InlineData();
+			this->nCapacity = N;
+			this->TakeFrom(hOther);
+		}
+
+		return *this;
+	}
+
+	template<typename... Args>
+	T& emplace_back(Args&&... args)
+	{
+		if (this->nSize == this->nCapacity)
+		{
+			return this->GrowAndEmplace(std::forward<Args>(args)...);
+		}
+
+		T* pElement = ::new (static_cast<void*>(this->pData + this->nSize)) T(std::forward<Args>(args)...);
+		this->nSize++;
+		return *pElement;
+	}
+
+	void push_back(const T& hValue)
+	{
+		this->emplace_back(hValue);
+	}
+
+	void push_back(T&& hValue)
+	{
+		this->emplace_back(std::move(hValue));
+	}
+
+	void pop_back()
+	{
+		this->nSize--;
+		this->pData[this->nSize].~T();
+	}
+
+	//Keeps the capacity, heap or inline
+	void clear()
+	{
+		std::destroy_n(this->pData, this->nSize);
+		this->nSize = 0;
+	}
+
+	void reserve(size_t nCount)
+	{
+		if (nCount > this->nCapacity)
+		{
+			T* pNew = Allocate(nCount);
+			RelocateElements(this->pData, this->nSize, pNew);
+			this->ReleaseHeap();
+			this->pData = pNew;
+			this->nCapacity = nCount;
+		}
+	}
+
+	void resize(size_t nCount)
+	{
+		if (nCount < this->nSize)
+		{
+			std::destroy(this->pData + nCount, this->pData + this->nSize);
+		}
+		else
+		{
+			this->reserve(nCount);
+			std::uninitialized_value_construct(this->pData + this->nSize, this->pData + nCount);
+		}
+
+		this->nSize = nCount;
+	}
+
+	T& operator[](size_t nIndex)
+	{
+		return this->pData[nIndex];
+	}
+
+	const T& operator[](size_t nIndex) const
+	{
+		return this->pData[nIndex];
+	}
+
+	T& back()
+	{
+		return this->pData[this->nSize - 1];
+	}
+
+	T* data()
+	{
+		return this->pData;
+	}
+
+	const T* data() const
+	{
+		return this->pData;
+	}
+
+	T* begin()
+	{
+		return this->pData;
+	}
+
+	T* end()
+	{
+		return this->pData + this->nSize;
+	}
+
+	const T* begin() const
+	{
+		return this->pData;
+	}
+
+	const T* end() const
+	{
+		return this->pData + this->nSize;
+	}
+
+	size_t size() const
+	{
+		return this->nSize;
+	}
+
+	size_t capacity() const
+	{
+		return this->nCapacity;
+	}
+
+	bool empty() const
+	{
+		return this->nSize == 0;
+	}
+
+	//false once the elements have spilled to the heap (clear() does not bring them back)
+	bool is_inline() const
+	{
+		return this->pData == this->InlineData();
+	}
+
+private:
+	static T* Allocate(size_t nCount)
+	{
+		if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		{
+			return static_cast<T*>(::operator new(nCount * sizeof(T), std::align_val_t(alignof(T))));
+		}
+		else
+		{
+			return static_cast<T*>(::operator new(nCount * sizeof(T)));
+		}
+	}
+
+	T* InlineData()
+	{
+		return reinterpret_cast<T*>(this->pInline);
+	}
+
+	const T* InlineData() const
+	{
+		return reinterpret_cast<const T*>(this->pInline);
+	}
+
+	void ReleaseHeap()
+	{
+		if (this->is_inline())
+		{
+			return;
+		}
+
+		if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		{
+			::operator delete(this->pData, std::align_val_t(alignof(T)));
+		}
+		else
+		{
+			::operator delete(this->pData);
+		}
+	}
+
+	//The new element is built before the old ones move: args may refer to one of them
+	template<typename... Args>
+	T& GrowAndEmplace(Args&&... args)
+	{
+		const size_t nNewCapacity = this->nCapacity * 2;
+		T* pNew = Allocate(nNewCapacity);
+
+		T* pElement = ::new (static_cast<void*>(pNew + this->nSize)) T(std::forward<Args>(args)...);
+		RelocateElements(this->pData, this->nSize, pNew);
+
+		this->ReleaseHeap();
+		this->pData = pNew;
+		this->nCapacity = nNewCapacity;
+		this->nSize++;
+		return *pElement;
+	}
+
+	//this is empty and inline; hOther is left empty
+	void TakeFrom(SmallVector& hOther)
+	{
+		if (hOther.is_inline())
+		{
+			RelocateElements(hOther.pData, hOther.nSize, this->pData);
+		}
+		else
+		{
+			this->pData = hOther.pData;
+			this->nCapacity = hOther.nCapacity;
+			hOther.pData = hOther.InlineData();
+			hOther.nCapacity = N;
+		}
+
+		this->nSize = hOther.nSize;
+		hOther.nSize = 0;
+	}
+
+	T* pData;                   //pInline until the first spill
+	size_t nSize;
+	size_t nCapacity;
+	alignas(T) unsigned char pInline[N * sizeof(T)];
+};
+
+//------------------------------------------------------------
+// InlineString
+//------------------------------------------------------------
+//Up to N chars inline, always NUL-terminated; the inline bytes and the heap pointer share storage
+template<size_t N>
+class InlineString
+{
+	static_assert(N >= sizeof(char*), "the inline buffer doubles as the heap pointer");
+
+public:
+	InlineString()
+		: nSize(0), nCapacity(N)
+	{
+		this->pInline[0] = '\0';
+	}
+
+	InlineString(const char* pText, size_t nLength)
+		: InlineString()
+	{
+		this->append(pText, nLength);
+	}
+
+	explicit InlineString(std::string_view strText)
+		: InlineString(strText.data(), strText.size())
+	{
+	}
+
+	InlineString(const InlineString& hOther)
+		: InlineString(hOther.data(), hOther.nSize)
+	{
+	}
+
+	//Relocating is a byte copy: there is no pointer into the object to fix
+	InlineString(InlineString&& hOther) noexcept
+	{
+		memcpy(static_cast<void*>(this), static_cast<const void*>(&hOther), sizeof(InlineString));
+		hOther.nSize = 0;
+		hOther.nCapacity = N;
+		hOther.pInline[0] = '\0';
+	}
+
+	~InlineString()
+	{
+		this->ReleaseHeap();
+	}
+
+	InlineString& operator=(const InlineString& hOther)
+	{
+		if (this != &hOther)
+		{
+			this->assign(hOther.data(), hOther.nSize);
+		}
+
+		return *this;
+	}
+
+	InlineString& operator=(InlineString&& hOther) noexcept
+	{
+		if (this != &hOther)
+		{
+			this->ReleaseHeap();
+			memcpy(static_cast<void*>(this), static_cast<const void*>(&hOther), sizeof(InlineString));
+			hOther.nSize = 0;
+			hOther.nCapacity = N;
+			hOther.pInline[0] = '\0';
+		}
+
+		return *this;
+	}
+
+	void assign(const char* pText, size_t nLength)
+	{
+		this->nSize = 0;
+		this->append(pText, nLength);
+	}
+
+	void append(const char* pText, size_t nLength)
+	{
+		//Appending part of itself: the source moves if the buffer does
+		const char* pOld = this->data();
+		if (std::less_equal<const char*>()(pOld, pText) && std::less<const char*>()(pText, pOld + this->nSize))
+		{
+			const size_t nOffset = static_cast<size_t>(pText - pOld);
+			this->reserve(this->nSize + nLength);
+			pText = this->data() + nOffset;
+		}
+		else
+		{
+			this->reserve(this->nSize + nLength);
+		}
+
+		char* pData = this->data();
+		memmove(pData + this->nSize, pText, nLength);
+		this->nSize += nLength;
+		pData[this->nSize] = '\0';
+	}
+
+	void push_back(char cChar)
+	{
+		this->append(&cChar, 1);
+	}
+
+	void clear()
+	{
+		this->nSize = 0;
+		this->data()[0] = '\0';
+	}
+
+	void reserve(size_t nCount)
+	{
+		if (nCount <= this->nCapacity)
+		{
+			return;
+		}
+
+		const size_t nNewCapacity = max(nCount, this->nCapacity * 2);
+		char* pNew = static_cast<char*>(::operator new(nNewCapacity + 1));
+		memcpy(pNew, this->data(), this->nSize + 1);
+
+		this->ReleaseHeap();
+		memcpy(this->pInline, &pNew, sizeof(pNew));
+		this->nCapacity = nNewCapacity;
+	}
+
+	char* data()
+	{
+		return this->is_inline() ? this->pInline : this->HeapData();
+	}
+
+	const char* data() const
+	{
+		return this->is_inline() ? this->pInline : this->HeapData();
+	}
+
+	const char* c_str() const
+	{
+		return this->data();
+	}
+
+	size_t size() const
+	{
+		return this->nSize;
+	}
+
+	size_t capacity() const
+	{
+		return this->nCapacity;
+	}
+
+	bool empty() const
+	{
+		return this->nSize == 0;
+	}
+
+	bool is_inline() const
+	{
+		return this->nCapacity == N;
+	}
+
+	operator std::string_view() const
+	{
+		return std::string_view(this->data(), this->nSize);
+	}
+
+	bool operator==(std::string_view strOther) const
+	{
+		return std::string_view(*this) == strOther;
+	}
+
+private:
+	char* HeapData() const
+	{
+		char* pHeap = nullptr;
+		memcpy(&pHeap, this->pInline, sizeof(pHeap));
+		return pHeap;
+	}
+
+	void ReleaseHeap()
+	{
+		if (!this->is_inline())
+		{
+			::operator delete(this->HeapData());
+		}
+	}
+
+	size_t nSize;
+	size_t nCapacity;           //N while inline, the heap capacity after a spill
+	char pInline[N + 1];        //The chars, or the heap pointer in the first bytes after a spill
+};
+
+template<size_t N>
+struct IsTriviallyRelocatable<InlineString<N>> : std::true_type
+{
+};
@@ -0,0 +1,768 @@
+#include "ThreadCache.h"
+#include <atomic>
+#include <bit>
+#include <cstring>
+
+constexpr size_t TC_PAGE_SHIFT = 13;
+constexpr size_t TC_ARENA_BYTES = size_t(1) << 36;                 //Reserved once, committed as it grows
+constexpr size_t TC_ARENA_PAGES = TC_ARENA_BYTES >> TC_PAGE_SHIFT;
+constexpr size_t TC_GROW_PAGES = 128;                              //The arena grows at least 1 MB at a time
+constexpr size_t TC_MAX_LIST_PAGES = 128;                          //Exact-size free lists up to 1 MB, one list above
+constexpr size_t TC_RELEASE_PAGES = 128;                           //Free runs this long are decommitted
+constexpr size_t TC_MAX_BATCH = 32;
+constexpr size_t TC_SPAN_META_CHUNK = 64 * 1024;
+
+constexpr UINT8 TC_CLASS_LARGE = 0xFF;
+constexpr UINT8 TC_CLASS_FREE = 0xFE;
+
+static_assert(TC_PAGE_SIZE == size_t(1) << TC_PAGE_SHIFT, "TC_PAGE_SIZE and TC_PAGE_SHIFT disagree");
+
+//------------------------------------------------------------
+// Size classes
+//------------------------------------------------------------
+static size_t SizeToClass(size_t nSize)
+{
+	if (nSize <= 128)
+	{
+		return nSize ? (nSize - 1) >> 4 : 0;
+	}
+
+	//2^(nBits-1) < nSize <= 2^nBits, split in 4 steps of 2^(nBits-3)
+	const size_t nBits = static_cast<size_t>(std::bit_width(nSize - 1));
+	const size_t nBase = size_t(1) << (nBits - 1);
+
+	return 8 + (nBits - 8) * 4 + ((nSize - nBase - 1) >> (nBits - 3));
+}
+
+static size_t ClassToSize(size_t nClass)
+{
+	if (nClass < 8)
+	{
+		return (nClass + 1) * 16;
+	}
+
+	const size_t nStep = nClass - 8;
+	const size_t nBase = size_t(1) << (7 + nStep / 4);
+
+	return nBase + (nBase / 4) * (nStep % 4 + 1);
+}
+
+//At least 8 objects per span, so the tail waste stays under 1/8 of the span
+static size_t ClassToPages(size_t nClass)
+{
+	return (ClassToSize(nClass) * 8 + TC_PAGE_SIZE - 1) / TC_PAGE_SIZE;
+}
+
+//Objects moved between a thread cache and the central list at once (~64 KB)
+static size_t ClassToBatch(size_t nClass)
+{
+	return min(max(static_cast<size_t>(64 * 1024) / ClassToSize(nClass), static_cast<size_t>(2)), TC_MAX_BATCH);
+}
+
+static void*& NextOf(void* pObject)
+{
+	return *reinterpret_cast<void**>(pObject);
+}
+
+//------------------------------------------------------------
+// Page heap
+//------------------------------------------------------------
+struct Span
+{
+	size_t nStartPage;          //Page index inside the arena
+	size_t nPages;
+	Span* pPrev;                //Page heap free list or central non-empty list
+	Span* pNext;
+	void* pFreeObjects;
+	UINT32 nAllocated;
+	UINT8 nClass;               //Size class, TC_CLASS_LARGE or TC_CLASS_FREE
+	bool bDecommitted;
+};
+
+/*
+    All state is zero-initialized (a zero SRWLOCK is an unlocked one), so the
+    allocator works before and during static initialization. The arena is
+    reserved on the first allocation.
+*/
+struct PageHeap
+{
+	SRWLOCK hLock;
+	Span** ppPageMap;                           //One entry per arena page
+	size_t nTopPage;                            //Pages carved out of the arena so far
+	Span* pFreeLists[TC_MAX_LIST_PAGES + 1];    //[n]: free spans of exactly n pages, [0]: longer ones
+
+	Span* pSpanRecycle;                         //Span records are never returned to the OS
+	char* pSpanChunk;
+	size_t nSpanChunkLeft;
+
+	ULONGLONG qwCommittedBytes;
+};
+
+static PageHeap ghPageHeap;
+static std::atomic<char*> gpArena = nullptr;
+static std::atomic<ULONGLONG> gqwDirectBytes = 0;
+static std::atomic<ULONGLONG> gqwHandedOutBytes = 0;      //Small objects out of the central lists, plus large spans
+
+static char* PageAddress(size_t nPage)
+{
+	return gpArena.load(std::memory_order_relaxed) + (nPage << TC_PAGE_SHIFT);
+}
+
+static Span* NewSpanRecord()
+{
+	PageHeap& hHeap = ghPageHeap;
+
+	if (hHeap.pSpanRecycle)
+	{
+		Span* pSpan = hHeap.pSpanRecycle;
+		hHeap.pSpanRecycle = pSpan->pNext;
+		return pSpan;
+	}
+
+	if (hHeap.nSpanChunkLeft < sizeof(Span))
+	{
+		hHeap.pSpanChunk = reinterpret_cast<char*>(VirtualAlloc(nullptr, TC_SPAN_META_CHUNK, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		if (!hHeap.pSpanChunk)
+		{
+			hHeap.nSpanChunkLeft = 0;
+			return nullptr;
+		}
+
+		hHeap.nSpanChunkLeft = TC_SPAN_META_CHUNK;
+	}
+
+	Span* pSpan = reinterpret_cast<Span*>(hHeap.pSpanChunk);
+	hHeap.pSpanChunk += sizeof(Span);
+	hHeap.nSpanChunkLeft -= sizeof(Span);
+	return pSpan;
+}
+
+static void DeleteSpanRecord(Span* pSpan)
+{
+	pSpan->pNext = ghPageHeap.pSpanRecycle;
+	ghPageHeap.pSpanRecycle = pSpan;
+}
+
+//Free spans only map their first and last page: that is all coalescing looks at
+static void MapEnds(Span* pSpan)
+{
+	ghPageHeap.ppPageMap[pSpan->nStartPage] = pSpan;
+	ghPageHeap.ppPageMap[pSpan->nStartPage + pSpan->nPages - 1] = pSpan;
+}
+
+//Spans in use map every page: free() may get a pointer to any of them
+static void MapAll(Span* pSpan)
+{
+	for (size_t i = 0; i < pSpan->nPages; ++i)
+	{
+		ghPageHeap.ppPageMap[pSpan->nStartPage + i] = pSpan;
+	}
+}
+
+static Span*& FreeListFor(size_t nPages)
+{
+	return ghPageHeap.pFreeLists[nPages <= TC_MAX_LIST_PAGES ? nPages : 0];
+}
+
+static void LinkSpan(Span*& pHead, Span* pSpan)
+{
+	pSpan->pPrev = nullptr;
+	pSpan->pNext = pHead;
+	if (pHead)
+	{
+		pHead->pPrev = pSpan;
+	}
+
+	pHead = pSpan;
+}
+
+static void UnlinkSpan(Span*& pHead, Span* pSpan)
+{
+	if (pSpan->pPrev)
+	{
+		pSpan->pPrev->pNext = pSpan->pNext;
+	}
+	else
+	{
+		pHead = pSpan->pNext;
+	}
+
+	if (pSpan->pNext)
+	{
+		pSpan->pNext->pPrev = pSpan->pPrev;
+	}
+
+	pSpan->pPrev = nullptr;
+	pSpan->pNext = nullptr;
+}
+
+static void Decommit(Span* pSpan)
+{
+	VirtualFree(PageAddress(pSpan->nStartPage), pSpan->nPages << TC_PAGE_SHIFT, MEM_DECOMMIT);
+	ghPageHeap.qwCommittedBytes -= pSpan->nPages << TC_PAGE_SHIFT;
+	pSpan->bDecommitted = true;
+}
+
+//Called with the page heap lock held
+static void FreeSpanLocked(Span* pSpan)
+{
+	PageHeap& hHeap = ghPageHeap;
+
+	pSpan->nClass = TC_CLASS_FREE;
+	pSpan->pFreeObjects = nullptr;
+	pSpan->nAllocated = 0;
+
+	//Coalesce with free neighbours in the same commit state; mixing them would mean
+	//decommitting live-looking memory on every free next to the arena frontier
+	auto Absorb = [&] (Span* pOther)
+	{
+		UnlinkSpan(FreeListFor(pOther->nPages), pOther);
+		pSpan->nStartPage = min(pSpan->nStartPage, pOther->nStartPage);
+		pSpan->nPages += pOther->nPages;
+		DeleteSpanRecord(pOther);
+	};
+
+	if (pSpan->nStartPage > 0)
+	{
+		Span* pPrev = hHeap.ppPageMap[pSpan->nStartPage - 1];
+		if (pPrev->nClass == TC_CLASS_FREE && pPrev->bDecommitted == pSpan->bDecommitted)
+		{
+			Absorb(pPrev);
+		}
+	}
+
+	const size_t nEnd = pSpan->nStartPage + pSpan->nPages;
+	if (nEnd < hHeap.nTopPage)
+	{
+		Span* pNext = hHeap.ppPageMap[nEnd];
+		if (pNext->nClass == TC_CLASS_FREE && pNext->bDecommitted == pSpan->bDecommitted)
+		{
+			Absorb(pNext);
+		}
+	}
+
+	if (pSpan->nPages >= TC_RELEASE_PAGES && !pSpan->bDecommitted)
+	{
+		Decommit(pSpan);
+	}
+
+	MapEnds(pSpan);
+	LinkSpan(FreeListFor(pSpan->nPages), pSpan);
+}
+
+static bool GrowArenaLocked(size_t nPages)
+{
+	PageHeap& hHeap = ghPageHeap;
+
+	if (!gpArena.load(std::memory_order_relaxed))
+	{
+		char* pArena = reinterpret_cast<char*>(VirtualAlloc(nullptr, TC_ARENA_BYTES, MEM_RESERVE, PAGE_READWRITE));
+		hHeap.ppPageMap = reinterpret_cast<Span**>(VirtualAlloc(nullptr, TC_ARENA_PAGES * sizeof(Span*), MEM_RESERVE, PAGE_READWRITE));
+		if (!pArena || !hHeap.ppPageMap)
+		{
+			return false;
+		}
+
+		gpArena.store(pArena, std::memory_order_release);
+	}
+
+	const size_t nGrow = max(nPages, TC_GROW_PAGES);
+	if (hHeap.nTopPage + nGrow > TC_ARENA_PAGES)
+	{
+		return false;
+	}
+
+	//New pages arrive decommitted, only the page map entries are committed here
+	if (!VirtualAlloc(hHeap.ppPageMap + hHeap.nTopPage, nGrow * sizeof(Span*), MEM_COMMIT, PAGE_READWRITE))
+	{
+		return false;
+	}
+
+	Span* pSpan = NewSpanRecord();
+	if (!pSpan)
+	{
+		return false;
+	}
+
+	pSpan->nStartPage = hHeap.nTopPage;
+	pSpan->nPages = nGrow;
+	pSpan->bDecommitted = true;
+	MapEnds(pSpan);
+
+	hHeap.nTopPage += nGrow;
+	FreeSpanLocked(pSpan);
+
+	return true;
+}
+
+static Span* FindFreeSpanLocked(size_t nPages)
+{
+	for (size_t i = nPages; i <= TC_MAX_LIST_PAGES; ++i)
+	{
+		if (ghPageHeap.pFreeLists[i])
+		{
+			return ghPageHeap.pFreeLists[i];
+		}
+	}
+
+	//Best fit among the long runs, lowest address on ties to keep the heap compact
+	Span* pBest = nullptr;
+	for (Span* pSpan = ghPageHeap.pFreeLists[0]; pSpan; pSpan = pSpan->pNext)
+	{
+		if (pSpan->nPages >= nPages && (!pBest || pSpan->nPages < pBest->nPages || (pSpan->nPages == pBest->nPages && pSpan->nStartPage < pBest->nStartPage)))
+		{
+			pBest = pSpan;
+		}
+	}
+
+	return pBest;
+}
+
+static Span* AllocateSpan(size_t nPages, UINT8 nClass)
+{
+	PageHeap& hHeap = ghPageHeap;
+
+	AcquireSRWLockExclusive(&hHeap.hLock);
+
+	Span* pSpan = FindFreeSpanLocked(nPages);
+	if (!pSpan && GrowArenaLocked(nPages))
+	{
+		pSpan = FindFreeSpanLocked(nPages);
+	}
+
+	if (!pSpan)
+	{
+		ReleaseSRWLockExclusive(&hHeap.hLock);
+		return nullptr;
+	}
+
+	UnlinkSpan(FreeListFor(pSpan->nPages), pSpan);
+
+	if (pSpan->nPages > nPages)
+	{
+		Span* pRest = NewSpanRecord();
+		if (pRest)
+		{
+			pRest->nStartPage = pSpan->nStartPage + nPages;
+			pRest->nPages = pSpan->nPages - nPages;
+			pRest->nClass = TC_CLASS_FREE;
+			pRest->bDecommitted = pSpan->bDecommitted;
+			pSpan->nPages = nPages;
+
+			MapEnds(pRest);
+			LinkSpan(FreeListFor(pRest->nPages), pRest);
+		}
+	}
+
+	if (pSpan->bDecommitted)
+	{
+		if (!VirtualAlloc(PageAddress(pSpan->nStartPage), pSpan->nPages << TC_PAGE_SHIFT, MEM_COMMIT, PAGE_READWRITE))
+		{
+			FreeSpanLocked(pSpan);
+			ReleaseSRWLockExclusive(&hHeap.hLock);
+			return nullptr;
+		}
+
+		pSpan->bDecommitted = false;
+		hHeap.qwCommittedBytes += pSpan->nPages << TC_PAGE_SHIFT;
+	}
+
+	pSpan->nClass = nClass;
+	pSpan->pFreeObjects = nullptr;
+	pSpan->nAllocated = 0;
+	MapAll(pSpan);
+
+	ReleaseSRWLockExclusive(&hHeap.hLock);
+	return pSpan;
+}
+
+static void FreeSpan(Span* pSpan)
+{
+	AcquireSRWLockExclusive(&ghPageHeap.hLock);
+	FreeSpanLocked(pSpan);
+	ReleaseSRWLockExclusive(&ghPageHeap.hLock);
+}
+
+//nullptr for pointers that are not in the arena (direct allocations)
+static Span* LookupSpan(const void* pPtr)
+{
+	const char* pArena = gpArena.load(std::memory_order_acquire);
+	const char* pByte = reinterpret_cast<const char*>(pPtr);
+
+	if (!pArena || pByte < pArena || pByte >= pArena + TC_ARENA_BYTES)
+	{
+		return nullptr;
+	}
+
+	return ghPageHeap.ppPageMap[static_cast<size_t>(pByte - pArena) >> TC_PAGE_SHIFT];
+}
+
+//------------------------------------------------------------
+// Central free lists
+//------------------------------------------------------------
+struct CentralList
+{
+	SRWLOCK hLock;
+	Span* pNonEmpty;        //Spans of this class with free objects
+};
+
+static CentralList ghCentral[TC_CLASS_COUNT];
+
+//Links up to nWanted objects into a null-terminated list, returns how many
+static size_t FetchFromCentral(size_t nClass, size_t nWanted, void** ppHead)
+{
+	CentralList& hCentral = ghCentral[nClass];
+	void* pHead = nullptr;
+	size_t nCount = 0;
+
+	AcquireSRWLockExclusive(&hCentral.hLock);
+
+	while (nCount < nWanted)
+	{
+		if (!hCentral.pNonEmpty)
+		{
+			Span* pSpan = AllocateSpan(ClassToPages(nClass), static_cast<UINT8>(nClass));
+			if (!pSpan)
+			{
+				break;
+			}
+
+			//Carved in reverse so the objects come out in address order
+			const size_t nSize = ClassToSize(nClass);
+			const size_t nObjects = (pSpan->nPages << TC_PAGE_SHIFT) / nSize;
+			char* pBase = PageAddress(pSpan->nStartPage);
+
+			for (size_t i = nObjects; i-- > 0;)
+			{
+				NextOf(pBase + i * nSize) = pSpan->pFreeObjects;
+				pSpan->pFreeObjects = pBase + i * nSize;
+			}
+
+			LinkSpan(hCentral.pNonEmpty, pSpan);
+		}
+
+		Span* pSpan = hCentral.pNonEmpty;
+		while (nCount < nWanted && pSpan->pFreeObjects)
+		{
+			void* pObject = pSpan->pFreeObjects;
+			pSpan->pFreeObjects = NextOf(pObject);
+			pSpan->nAllocated++;
+
+			NextOf(pObject) = pHead;
+			pHead = pObject;
+			++nCount;
+		}
+
+		if (!pSpan->pFreeObjects)
+		{
+			UnlinkSpan(hCentral.pNonEmpty, pSpan);
+		}
+	}
+
+	ReleaseSRWLockExclusive(&hCentral.hLock);
+
+	gqwHandedOutBytes.fetch_add(nCount * ClassToSize(nClass), std::memory_order_relaxed);
+
+	*ppHead = pHead;
+	return nCount;
+}
+
+static void ReleaseToCentral(size_t nClass, void* pHead)
+{
+	CentralList& hCentral = ghCentral[nClass];
+	size_t nCount = 0;
+
+	AcquireSRWLockExclusive(&hCentral.hLock);
+
+	while (pHead)
+	{
+		void* pObject = pHead;
+		pHead = NextOf(pObject);
+		++nCount;
+
+		Span* pSpan = LookupSpan(pObject);
+		const bool bWasFull = !pSpan->pFreeObjects;
+
+		NextOf(pObject) = pSpan->pFreeObjects;
+		pSpan->pFreeObjects = pObject;
+
+		if (--pSpan->nAllocated == 0)
+		{
+			if (!bWasFull)
+			{
+				UnlinkSpan(hCentral.pNonEmpty, pSpan);
+			}
+
+			FreeSpan(pSpan);
+		}
+		else if (bWasFull)
+		{
+			LinkSpan(hCentral.pNonEmpty, pSpan);
+		}
+	}
+
+	ReleaseSRWLockExclusive(&hCentral.hLock);
+
+	gqwHandedOutBytes.fetch_sub(nCount * ClassToSize(nClass), std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------
+// Thread caches
+//------------------------------------------------------------
+struct ThreadFreeList
+{
+	void* pHead;
+	size_t nLength;
+};
+
+struct ThreadCache
+{
+	ThreadFreeList pLists[TC_CLASS_COUNT];
+
+	void Flush()
+	{
+		for (size_t i = 0; i < TC_CLASS_COUNT; ++i)
+		{
+			if (this->pLists[i].pHead)
+			{
+				ReleaseToCentral(i, this->pLists[i].pHead);
+				this->pLists[i].pHead = nullptr;
+				this->pLists[i].nLength = 0;
+			}
+		}
+	}
+};
+
+static thread_local ThreadCache* gpThreadCache = nullptr;
+static thread_local bool gbThreadCacheGone = false;
+
+//Flushes the cache at thread exit; frees that run after it go to the central lists directly
+struct ThreadCacheOwner
+{
+	ThreadCache hCache = {};
+
+	~ThreadCacheOwner()
+	{
+		this->hCache.Flush();
+		gpThreadCache = nullptr;
+		gbThreadCacheGone = true;
+	}
+};
+
+static ThreadCache* GetThreadCache()
+{
+	if (gpThreadCache || gbThreadCacheGone)
+	{
+		return gpThreadCache;
+	}
+
+	static thread_local ThreadCacheOwner hOwner;
+	gpThreadCache = &hOwner.hCache;
+	return gpThreadCache;
+}
+
+static void* AllocSmall(size_t nClass)
+{
+	ThreadCache* pCache = GetThreadCache();
+	if (!pCache)
+	{
+		void* pObject = nullptr;
+		return FetchFromCentral(nClass, 1, &pObject) ? pObject : nullptr;
+	}
+
+	ThreadFreeList& hList = pCache->pLists[nClass];
+	if (!hList.pHead)
+	{
+		const size_t nFetched = FetchFromCentral(nClass, ClassToBatch(nClass), &hList.pHead);
+		if (!nFetched)
+		{
+			return nullptr;
+		}
+
+		hList.nLength = nFetched;
+	}
+
+	void* pObject = hList.pHead;
+	hList.pHead = NextOf(pObject);
+	hList.nLength--;
+	return pObject;
+}
+
+static void FreeSmall(size_t nClass, void* pObject)
+{
+	ThreadCache* pCache = GetThreadCache();
+	if (!pCache)
+	{
+		NextOf(pObject) = nullptr;
+		ReleaseToCentral(nClass, pObject);
+		return;
+	}
+
+	ThreadFreeList& hList = pCache->pLists[nClass];
+	NextOf(pObject) = hList.pHead;
+	hList.pHead = pObject;
+
+	const size_t nBatch = ClassToBatch(nClass);
+	if (++hList.nLength <= 2 * nBatch)
+	{
+		return;
+	}
+
+	//Hand the most recently freed batch back, the rest stays cached
+	void* pBatch = hList.pHead;
+	void* pLast = pBatch;
+	for (size_t i = 1; i < nBatch; ++i)
+	{
+		pLast = NextOf(pLast);
+	}
+
+	hList.pHead = NextOf(pLast);
+	hList.nLength -= nBatch;
+	NextOf(pLast) = nullptr;
+
+	ReleaseToCentral(nClass, pBatch);
+}
+
+//------------------------------------------------------------
+// Entry points
+//------------------------------------------------------------
+void* tc_malloc(size_t nSize)
+{
+	if (nSize <= TC_MAX_SMALL)
+	{
+		return AllocSmall(SizeToClass(nSize));
+	}
+
+	if (nSize <= TC_DIRECT_THRESHOLD)
+	{
+		Span* pSpan = AllocateSpan((nSize + TC_PAGE_SIZE - 1) >> TC_PAGE_SHIFT, TC_CLASS_LARGE);
+		if (!pSpan)
+		{
+			return nullptr;
+		}
+
+		gqwHandedOutBytes.fetch_add(pSpan->nPages << TC_PAGE_SHIFT, std::memory_order_relaxed);
+		return PageAddress(pSpan->nStartPage);
+	}
+
+	void* pPtr = VirtualAlloc(nullptr, nSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (pPtr)
+	{
+		//Counted as the page-rounded region size, which is what tc_free subtracts
+		MEMORY_BASIC_INFORMATION hInfo = {};
+		VirtualQuery(pPtr, &hInfo, sizeof(hInfo));
+		gqwDirectBytes += hInfo.RegionSize;
+	}
+
+	return pPtr;
+}
+
+void tc_free(void* pPtr)
+{
+	if (!pPtr)
+	{
+		return;
+	}
+
+	Span* pSpan = LookupSpan(pPtr);
+	if (!pSpan)
+	{
+		MEMORY_BASIC_INFORMATION hInfo = {};
+		VirtualQuery(pPtr, &hInfo, sizeof(hInfo));
+		gqwDirectBytes -= hInfo.RegionSize;
+
+		VirtualFree(pPtr, 0, MEM_RELEASE);
+		return;
+	}
+
+	if (pSpan->nClass == TC_CLASS_LARGE)
+	{
+		gqwHandedOutBytes.fetch_sub(pSpan->nPages << TC_PAGE_SHIFT, std::memory_order_relaxed);
+		FreeSpan(pSpan);
+		return;
+	}
+
+	FreeSmall(pSpan->nClass, pPtr);
+}
+
+void* tc_calloc(size_t nCount, size_t nSize)
+{
+	if (nSize && nCount > ~size_t(0) / nSize)
+	{
+		return nullptr;
+	}
+
+	void* pPtr = tc_malloc(nCount * nSize);
+	if (pPtr)
+	{
+		memset(pPtr, 0, nCount * nSize);
+	}
+
+	return pPtr;
+}
+
+size_t tc_malloc_usable_size(void* pPtr)
+{
+	if (!pPtr)
+	{
+		return 0;
+	}
+
+	Span* pSpan = LookupSpan(pPtr);
+	if (!pSpan)
+	{
+		MEMORY_BASIC_INFORMATION hInfo = {};
+		VirtualQuery(pPtr, &hInfo, sizeof(hInfo));
+		return hInfo.RegionSize;
+	}
+
+	return pSpan->nClass == TC_CLASS_LARGE ? pSpan->nPages << TC_PAGE_SHIFT : ClassToSize(pSpan->nClass);
+}
+
+void* tc_realloc(void* pPtr, size_t nSize)
+{
+	if (!pPtr)
+	{
+		return tc_malloc(nSize);
+	}
+
+	if (!nSize)
+	{
+		tc_free(pPtr);
+		return nullptr;
+	}
+
+	const size_t nUsable = tc_malloc_usable_size(pPtr);
+	if (nSize <= nUsable)
+	{
+		return pPtr;
+	}
+
+	void* pNew = tc_malloc(nSize);
+	if (pNew)
+	{
+		memcpy(pNew, pPtr, nUsable);
+		tc_free(pPtr);
+	}
+
+	return pNew;
+}
+
+void tc_flush_thread_cache()
+{
+	if (gpThreadCache)
+	{
+		gpThreadCache->Flush();
+	}
+}
+
+void tc_get_stats(TcStats* pStats)
+{
+	AcquireSRWLockShared(&ghPageHeap.hLock);
+	pStats->qwArenaBytes = static_cast<ULONGLONG>(ghPageHeap.nTopPage) << TC_PAGE_SHIFT;
+	pStats->qwCommittedBytes = ghPageHeap.qwCommittedBytes;
+	ReleaseSRWLockShared(&ghPageHeap.hLock);
+
+	pStats->qwDirectBytes = gqwDirectBytes;
+	pStats->qwInUseBytes = gqwHandedOutBytes.load(std::memory_order_relaxed) + pStats->qwDirectBytes;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <Windows.h>
+
+/*
+    Thread-caching size-class allocator (tcmalloc design).
+
+    - Small requests (<= TC_MAX_SMALL) are rounded up to one of TC_CLASS_COUNT
+      size classes: 16-byte steps up to 128, then 4 classes per power of two up
+      to 32 KB (at most 25% internal waste above 128 bytes).
+    - Every thread owns a free list per class. alloc/free are a pop/push on it,
+      without locks. An empty list fetches a batch of objects from the class's
+      central free list; a list that grows past twice the batch returns one
+      batch to it.
+    - Central lists carve spans (runs of TC_PAGE_SIZE pages) into objects. A span
+      whose objects are all free goes back to the page heap.
+    - The page heap hands out spans from one reserved address range, splits
+      and coalesces them and keeps a page -> span map, which is how free()
+      finds the size class of a pointer without any header. Free runs of 1 MB
+      or more are decommitted.
+    - Requests above TC_MAX_SMALL take whole spans; above TC_DIRECT_THRESHOLD they
+      go straight to VirtualAlloc (the mmap fallback) and back to VirtualFree.
+*/
+constexpr size_t TC_PAGE_SIZE = 8192;
+constexpr size_t TC_MAX_SMALL = 32 * 1024;
+constexpr size_t TC_CLASS_COUNT = 40;
+constexpr size_t TC_DIRECT_THRESHOLD = 1024 * 1024;
+
+struct TcStats
+{
+	ULONGLONG qwArenaBytes;         //Address space handed to spans so far
+	ULONGLONG qwCommittedBytes;     //Arena bytes backed by memory (spans in use + free spans not yet decommitted)
+	ULONGLONG qwDirectBytes;        //Live requests above TC_DIRECT_THRESHOLD
+	ULONGLONG qwInUseBytes;         //Rounded to class or page size; counts objects parked in thread caches as in use
+};
+
+void* tc_malloc(size_t nSize);
+void tc_free(void* pPtr);
+void* tc_calloc(size_t nCount, size_t nSize);
+void* tc_realloc(void* pPtr, size_t nSize);
+size_t tc_malloc_usable_size(void* pPtr);
+
+//Returns the calling thread's cached objects to the central lists (also done at thread exit)
+void tc_flush_thread_cache();
+
+void tc_get_stats(TcStats* pStats);
@@ -0,0 +1,168 @@
+#include "FileTransfer.h"
+#include <mswsock.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Mswsock.lib")
+
+const char* TransferModeName(TransferMode eMode)
+{
+    switch (eMode)
+    {
+    case TRANSFER_ZERO_COPY:
+        return "TransmitFile";
+    case TRANSFER_COPY:
+        return "ReadFile + send";
+    }
+
+    return "Unknown";
+}
+
+static bool SendAll(SOCKET hSocket, const char* pData, int nSize)
+{
+    while (nSize > 0)
+    {
+        const int nSent = send(hSocket, pData, nSize, 0);
+        if (nSent == SOCKET_ERROR)
+        {
+            return false;
+        }
+
+        pData += nSent;
+        nSize -= nSent;
+    }
+
+    return true;
+}
+
+static bool CopyFileRange(SOCKET hSocket, HANDLE hFile, ULONGLONG qwOffset, ULONGLONG qwLength, ULONGLONG* pqwSent)
+{
+    char* pBuffer = reinterpret_cast<char*>(VirtualAlloc(nullptr, TRANSFER_COPY_BUFFER_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!pBuffer)
+    {
+        return false;
+    }
+
+    HANDLE hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    bool bResult = true;
+    ULONGLONG qwSent = 0;
+
+    while (qwSent < qwLength)
+    {
+        const DWORD dwToRead = static_cast<DWORD>(min(qwLength - qwSent, static_cast<ULONGLONG>(TRANSFER_COPY_BUFFER_SIZE)));
+        const ULONGLONG qwPosition = qwOffset + qwSent;
+
+        //Explicit offset (pread): works on both synchronous and overlapped file handles
+        OVERLAPPED hOverlapped = {};
+        hOverlapped.Offset = static_cast<DWORD>(qwPosition);
+        hOverlapped.OffsetHigh = static_cast<DWORD>(qwPosition >> 32);
+        hOverlapped.hEvent = hEvent;
+
+        DWORD dwRead = 0;
+        if (!ReadFile(hFile, pBuffer, dwToRead, nullptr, &hOverlapped) && GetLastError() != ERROR_IO_PENDING)
+        {
+            bResult = false;
+            break;
+        }
+
+        if (!GetOverlappedResult(hFile, &hOverlapped, &dwRead, TRUE) || !dwRead)
+        {
+            bResult = false;
+            break;
+        }
+
+        if (!SendAll(hSocket, pBuffer, static_cast<int>(dwRead)))
+        {
+            bResult = false;
+            break;
+        }
+
+        qwSent += dwRead;
+    }
+
+    CloseHandle(hEvent);
+    VirtualFree(pBuffer, 0, MEM_RELEASE);
+
+    if (pqwSent)
+    {
+        *pqwSent += qwSent;
+    }
+
+    return bResult;
+}
+
+static bool TransmitFileRange(SOCKET hSocket, HANDLE hFile, ULONGLONG qwOffset, ULONGLONG qwLength, ULONGLONG* pqwSent, bool* pbUnsupported)
+{
+    HANDLE hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    bool bResult = true;
+    ULONGLONG qwSent = 0;
+
+    while (qwSent < qwLength)
+    {
+        const DWORD dwToSend = static_cast<DWORD>(min(qwLength - qwSent, TRANSFER_MAX_CALL_BYTES));
+        const ULONGLONG qwPosition = qwOffset + qwSent;
+
+        //The file offset travels in the OVERLAPPED, the file pointer is never touched
+        OVERLAPPED hOverlapped = {};
+        hOverlapped.Offset = static_cast<DWORD>(qwPosition);
+        hOverlapped.OffsetHigh = static_cast<DWORD>(qwPosition >> 32);
+        hOverlapped.hEvent = hEvent;
+
+        //0 bytes per send: let the stack pick the chunk size
+        if (!TransmitFile(hSocket, hFile, dwToSend, 0, &hOverlapped, nullptr, 0))
+        {
+            const int nError = WSAGetLastError();
+            if (nError != WSA_IO_PENDING && nError != ERROR_IO_PENDING)
+            {
+                *pbUnsupported = qwSent == 0 && (nError == WSAEOPNOTSUPP || nError == WSAEINVAL);
+                bResult = false;
+                break;
+            }
+        }
+
+        DWORD dwSent = 0;
+        DWORD dwFlags = 0;
+        if (!WSAGetOverlappedResult(hSocket, &hOverlapped, &dwSent, TRUE, &dwFlags) || dwSent != dwToSend)
+        {
+            bResult = false;
+            break;
+        }
+
+        qwSent += dwSent;
+    }
+
+    CloseHandle(hEvent);
+
+    if (pqwSent)
+    {
+        *pqwSent += qwSent;
+    }
+
+    return bResult;
+}
+
+bool SendFileRange(SOCKET hSocket, HANDLE hFile, ULONGLONG qwOffset, ULONGLONG qwLength, TransferMode eMode, ULONGLONG* pqwSent)
+{
+    if (pqwSent)
+    {
+        *pqwSent = 0;
+    }
+
+    if (eMode == TRANSFER_ZERO_COPY)
+    {
+        bool bUnsupported = false;
+        if (TransmitFileRange(hSocket, hFile, qwOffset, qwLength, pqwSent, &bUnsupported))
+        {
+            return true;
+        }
+
+        //Nothing has been sent yet, so the copy path can take over the whole range
+        if (!bUnsupported)
+        {
+            return false;
+        }
+    }
+
+    return CopyFileRange(hSocket, hFile, qwOffset, qwLength, pqwSent);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <winsock2.h>
+#include <windows.h>
+
+/*
+    File range -> socket transfer.
+
+    TRANSFER_ZERO_COPY streams the range with TransmitFile (sendfile/splice on
+    Linux): the kernel reads the file cache pages and hands them to the TCP
+    stack, the data never crosses into a user buffer. TRANSFER_COPY is the
+    classic ReadFile -> buffer -> send loop, used as the fallback when
+    TransmitFile is not available for the socket (non-TCP providers, LSPs) and
+    as the baseline.
+
+    The socket may be blocking or overlapped. Every call carries its own file
+    offset and never moves the file pointer, so one handle can serve several
+    transfers at once.
+*/
+enum TransferMode
+{
+    TRANSFER_ZERO_COPY,
+    TRANSFER_COPY,
+};
+
+//TransmitFile sends at most 2^31 - 2 bytes per call, longer ranges are split
+constexpr ULONGLONG TRANSFER_MAX_CALL_BYTES = 0x7FFFFFFEull;
+constexpr DWORD TRANSFER_COPY_BUFFER_SIZE = 64 * 1024;
+
+//Sends qwLength bytes of hFile starting at qwOffset. pqwSent receives the bytes actually sent (optional).
+bool SendFileRange(SOCKET hSocket, HANDLE hFile, ULONGLONG qwOffset, ULONGLONG qwLength, TransferMode eMode, ULONGLONG* pqwSent);
+
+const char* TransferModeName(TransferMode eMode);
@@ -5,6 +5,7 @@
 #include <ws2tcpip.h>
 #include <windows.h>
 #include <iostream>
+#include <string_view>
 #include <vector>
 
 #pragma comment(lib, "Ws2_32.lib")
@@ -170,7 +171,8 @@ static DWORD WINAPI WorkerThread(LPVOID lpParam)
         //In a real - world scenario, you would verify what type of operation it was(read / write)
         //Here we assume it's a completed read on clientCtx->buffer
 
-        std::cout << "Data received: " << std::string(clientCtx->buffer, bytesTransferred) << std::endl;
+        //A view over the receive buffer: no copy and no heap allocation per receive
+        std::cout << "Data received: " << std::string_view(clientCtx->buffer, bytesTransferred) << std::endl;
 
         //Restart the reading to continue receiving data
         ZeroMemory(&clientCtx->overlapped, sizeof(OVERLAPPED));
@@ -215,7 +217,7 @@ void StartClient()
     int recvLen = recv(clientSocket, buffer, 4096, 0);
     if (recvLen > 0)
     {
-        std::cout << "Response: " << std::string(buffer, recvLen) << std::endl;
+        std::cout << "Response: " << std::string_view(buffer, recvLen) << std::endl;
     }
 
     closesocket(clientSocket);
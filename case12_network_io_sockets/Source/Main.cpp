@@ -2,8 +2,12 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <iostream>
+#include <string>
 #include <thread>
 #include <vector>
+#include "FileTransfer.h"
+#include "ReactorServer.h"
+#include "RioServer.h"
 
 #pragma comment(lib, "ws2_32.lib")
 
@@ -14,13 +18,22 @@ constexpr int ITERATIONS = 10000;
 
 volatile int g_sink = 0;
 
+constexpr int TRANSFER_PORT = 54001;
+constexpr ULONGLONG TRANSFER_FILE_SIZE = 256ull * 1024 * 1024;
+constexpr int TRANSFER_ROUNDS = 4;
+constexpr int TRANSFER_RECV_SIZE = 256 * 1024;
+
+constexpr int REACTOR_PORT = 54002;
+constexpr int RIO_PORT = 54003;
+constexpr int ECHO_LOADS[] = { CLIENTS, 64 };
+
 extern bool InitializeServer();
 extern void StartClient();
 
 //------------------------------------------------------------
 // Server (blocking)
 //------------------------------------------------------------
-static void server_thread()
+static void server_thread(int clients)
 {
     SOCKET listenSock = socket(AF_INET, SOCK_STREAM, 0);
 
@@ -32,14 +45,15 @@ static void server_thread()
     bind(listenSock, (sockaddr*)&hint, sizeof(hint));
     listen(listenSock, SOMAXCONN);
 
-    for (int i = 0; i < CLIENTS; i++)
+    for (int i = 0; i < clients; i++)
     {
         SOCKET client = accept(listenSock, nullptr, nullptr);
         std::thread([client] ()
         {
             char buffer[BUFFER_SIZE];
 
-            for (int i = 0; i < ITERATIONS; i++)
+            //Echo until the client closes, like EchoHandler on the reactor server
+            while (true)
             {
                 int bytes = recv(client, buffer, BUFFER_SIZE, 0);
                 if (bytes <= 0) break;
@@ -51,18 +65,20 @@ static void server_thread()
 
         }).detach();
     }
+
+    closesocket(listenSock);
 }
 
 //------------------------------------------------------------
 // Client
 //------------------------------------------------------------
-static void client_thread()
+static void client_thread(int port)
 {
     SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
 
     sockaddr_in hint{};
     hint.sin_family = AF_INET;
-    hint.sin_port = htons(PORT);
+    hint.sin_port = htons(port);
     inet_pton(AF_INET, "127.0.0.1", &hint.sin_addr);
 
     connect(sock, (sockaddr*)&hint, sizeof(hint));
@@ -73,8 +89,17 @@ static void client_thread()
     {
         send(sock, buffer, BUFFER_SIZE, 0);
 
-        int bytes = recv(sock, buffer, BUFFER_SIZE, 0);
-        if (bytes > 0)
+        //TCP may split the echo: wait for the whole message before the next round trip
+        int received = 0;
+        while (received < BUFFER_SIZE)
+        {
+            int bytes = recv(sock, buffer + received, BUFFER_SIZE - received, 0);
+            if (bytes <= 0) break;
+
+            received += bytes;
+        }
+
+        if (received > 0)
         {
             g_sink += buffer[0];
         }
@@ -84,22 +109,183 @@ static void client_thread()
 }
 
 //------------------------------------------------------------
-// MAIN
+// File -> socket transfer (loopback)
 //------------------------------------------------------------
+static bool GenerateTransferFile(const char* path)
+{
+    HANDLE hFile = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
 
-int main()
+    std::vector<char> vBuffer(TRANSFER_RECV_SIZE, 1);
+
+    DWORD dwWritten = 0;
+    for (ULONGLONG qwOffset = 0; qwOffset < TRANSFER_FILE_SIZE; qwOffset += vBuffer.size())
+    {
+        WriteFile(hFile, vBuffer.data(), static_cast<DWORD>(vBuffer.size()), &dwWritten, nullptr);
+    }
+
+    CloseHandle(hFile);
+    return true;
+}
+
+static double FileTimeToMilliseconds(const FILETIME& hTime)
 {
-    WSADATA wsa;
-    WSAStartup(MAKEWORD(2, 2), &wsa);
+    ULARGE_INTEGER uliTime = {};
+    uliTime.LowPart = hTime.dwLowDateTime;
+    uliTime.HighPart = hTime.dwHighDateTime;
+
+    //FILETIME counts 100 ns units
+    return static_cast<double>(uliTime.QuadPart) / 10'000.0;
+}
+
+//User + kernel time of the process (hThread == nullptr) or of one thread
+static double CpuMilliseconds(HANDLE hThread)
+{
+    FILETIME hCreation, hExit, hKernel, hUser;
+
+    const BOOL bOk = hThread ? GetThreadTimes(hThread, &hCreation, &hExit, &hKernel, &hUser) : GetProcessTimes(GetCurrentProcess(), &hCreation, &hExit, &hKernel, &hUser);
+
+    return bOk ? FileTimeToMilliseconds(hKernel) + FileTimeToMilliseconds(hUser) : 0.0;
+}
+
+/*
+    One loopback connection per mode: the main thread sends the whole file
+    TRANSFER_ROUNDS times, a receiver thread drains it into a discard buffer.
+    Both sides run in this process, so the process CPU includes the receive copy
+    (identical for both modes); the sender thread CPU isolates the send path,
+    which is where the zero-copy path saves its read copy and the user/kernel
+    transitions per chunk.
+*/
+static void Bench_FileTransfer(const char* path)
+{
+    if (!GenerateTransferFile(path))
+    {
+        std::cout << "Cannot create " << path << "\n";
+        return;
+    }
+
+    SOCKET hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+    sockaddr_in hAddress{};
+    hAddress.sin_family = AF_INET;
+    hAddress.sin_port = htons(TRANSFER_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &hAddress.sin_addr);
+
+    if (bind(hListen, reinterpret_cast<sockaddr*>(&hAddress), sizeof(hAddress)) == SOCKET_ERROR || listen(hListen, 1) == SOCKET_ERROR)
+    {
+        std::cout << "Transfer listen failed: " << WSAGetLastError() << "\n";
+        closesocket(hListen);
+        DeleteFileA(path);
+        return;
+    }
+
+    const ULONGLONG qwTotal = TRANSFER_FILE_SIZE * TRANSFER_ROUNDS;
+    const double dGigabytes = static_cast<double>(qwTotal) / (1024.0 * 1024.0 * 1024.0);
+
+    const TransferMode eModes[] = { TRANSFER_COPY, TRANSFER_ZERO_COPY };
+    for (const TransferMode eMode : eModes)
+    {
+        ULONGLONG qwReceived = 0;
+
+        std::thread hReceiver([&hAddress, &qwReceived] ()
+        {
+            SOCKET hSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (connect(hSocket, reinterpret_cast<const sockaddr*>(&hAddress), sizeof(hAddress)) == SOCKET_ERROR)
+            {
+                closesocket(hSocket);
+                return;
+            }
+
+            std::vector<char> vBuffer(TRANSFER_RECV_SIZE);
+            while (true)
+            {
+                const int nBytes = recv(hSocket, vBuffer.data(), TRANSFER_RECV_SIZE, 0);
+                if (nBytes <= 0)
+                {
+                    break;
+                }
+
+                qwReceived += static_cast<ULONGLONG>(nBytes);
+            }
+
+            closesocket(hSocket);
+        });
+
+        SOCKET hClient = accept(hListen, nullptr, nullptr);
+        HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        LARGE_INTEGER liFrequency, liStart, liEnd;
+        QueryPerformanceFrequency(&liFrequency);
+
+        const double dProcessStart = CpuMilliseconds(nullptr);
+        const double dSenderStart = CpuMilliseconds(GetCurrentThread());
+        QueryPerformanceCounter(&liStart);
+
+        bool bOk = hClient != INVALID_SOCKET && hFile != INVALID_HANDLE_VALUE;
+        for (int i = 0; i < TRANSFER_ROUNDS && bOk; i++)
+        {
+            bOk = SendFileRange(hClient, hFile, 0, TRANSFER_FILE_SIZE, eMode, nullptr);
+        }
+
+        const double dSenderCpu = CpuMilliseconds(GetCurrentThread()) - dSenderStart;
+
+        //The receiver sees the end of the stream once everything has been drained
+        shutdown(hClient, SD_SEND);
+        hReceiver.join();
+
+        QueryPerformanceCounter(&liEnd);
+        const double dProcessCpu = CpuMilliseconds(nullptr) - dProcessStart;
+
+        if (hFile != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(hFile);
+        }
 
-    std::thread(server_thread).detach();
+        closesocket(hClient);
 
-    Sleep(100);
+        const double dTime = static_cast<double>(liEnd.QuadPart - liStart.QuadPart) * 1000.0 / static_cast<double>(liFrequency.QuadPart);
+
+        if (!bOk || qwReceived != qwTotal)
+        {
+            std::cout << TransferModeName(eMode) << ": failed (" << WSAGetLastError() << ")\n";
+            continue;
+        }
+
+        std::cout << TransferModeName(eMode) << ": " << dTime << " ms"
+            << " | " << dGigabytes / (dTime / 1000.0) << " GB/s"
+            << " | CPU/GB: process " << dProcessCpu / dGigabytes << " ms"
+            << ", sender " << dSenderCpu / dGigabytes << " ms\n";
+    }
+
+    closesocket(hListen);
+    DeleteFileA(path);
+}
+
+//------------------------------------------------------------
+// Echo servers: thread per connection vs multi-reactor
+//------------------------------------------------------------
+struct EchoLoadResult
+{
+    double dTime;
+    double dProcessCpu;
+};
+
+//nClients connections doing ITERATIONS round trips each against the server on port
+static EchoLoadResult RunEchoLoad(int port, int nClients)
+{
+    LARGE_INTEGER liFrequency, liStart, liEnd;
+    QueryPerformanceFrequency(&liFrequency);
+
+    const double dProcessStart = CpuMilliseconds(nullptr);
+    QueryPerformanceCounter(&liStart);
 
     std::vector<std::thread> clients;
-    for (int i = 0; i < CLIENTS; i++)
+    for (int i = 0; i < nClients; i++)
     {
-        clients.emplace_back(client_thread);
+        clients.emplace_back(client_thread, port);
     }
 
     for (auto& t : clients)
@@ -107,6 +293,106 @@ int main()
         t.join();
     }
 
+    QueryPerformanceCounter(&liEnd);
+
+    EchoLoadResult hResult = {};
+    hResult.dTime = static_cast<double>(liEnd.QuadPart - liStart.QuadPart) * 1000.0 / static_cast<double>(liFrequency.QuadPart);
+    hResult.dProcessCpu = CpuMilliseconds(nullptr) - dProcessStart;
+    return hResult;
+}
+
+static void PrintEchoLoad(const std::string& name, int nClients, const EchoLoadResult& hResult)
+{
+    const double dRoundTrips = static_cast<double>(nClients) * ITERATIONS;
+
+    std::cout << name << " (" << nClients << " connections): " << hResult.dTime << " ms"
+        << " | " << dRoundTrips / (hResult.dTime / 1000.0) << " round trips/s"
+        << " | CPU/round trip " << hResult.dProcessCpu * 1000.0 / dRoundTrips << " us\n";
+}
+
+static void PrintServerStats(const ServerStats& hStats, int nClients)
+{
+    const double dRoundTrips = static_cast<double>(nClients) * ITERATIONS;
+
+    std::cout << "    completions/wait " << static_cast<double>(hStats.qwCompletions) / static_cast<double>(max(hStats.qwWaits, 1ull))
+        << " | inline " << hStats.qwInlineCompletions
+        << " | system calls/round trip " << static_cast<double>(hStats.qwSystemCalls) / dRoundTrips << "\n";
+}
+
+//Runs the load against a backend already listening on port, then stops it for its counters
+template <typename Server>
+static void BenchEchoServer(const std::string& name, Server& hServer, int port, int nClients)
+{
+    const EchoLoadResult hResult = RunEchoLoad(port, nClients);
+    hServer.Stop();
+
+    PrintEchoLoad(name, nClients, hResult);
+    PrintServerStats(hServer.GetStats(), nClients);
+}
+
+/*
+    The same load against every server: the clients are the blocking
+    client_thread in all runs, so the difference is the server side. The
+    process CPU includes the clients (identical for all); the backends' own
+    counters show how many completions each wait returned and how many system
+    calls one round trip cost. The polling RIO run gets half the processors,
+    since each of its reactors keeps a core busy.
+*/
+static void Bench_EchoServers()
+{
+    EchoHandler hEcho;
+
+    const DWORD nPollReactors = max(1u, std::thread::hardware_concurrency() / 2);
+
+    for (const int nClients : ECHO_LOADS)
+    {
+        std::thread(server_thread, nClients).detach();
+        Sleep(100);
+
+        PrintEchoLoad("Thread per connection", nClients, RunEchoLoad(PORT, nClients));
+
+        ReactorServer hReactor(&hEcho);
+        if (hReactor.Start(REACTOR_PORT))
+        {
+            BenchEchoServer("Reactors x " + std::to_string(hReactor.reactors()), hReactor, REACTOR_PORT, nClients);
+        }
+        else
+        {
+            std::cout << "Reactor server failed to start: " << WSAGetLastError() << "\n";
+        }
+
+        RioServer hRio(&hEcho);
+        if (hRio.Start(RIO_PORT))
+        {
+            BenchEchoServer("RIO x " + std::to_string(hRio.reactors()), hRio, RIO_PORT, nClients);
+        }
+        else
+        {
+            std::cout << "RIO server failed to start: " << WSAGetLastError() << "\n";
+        }
+
+        if (hRio.Start(RIO_PORT, nPollReactors, RIO_WAIT_POLL))
+        {
+            BenchEchoServer("RIO polling x " + std::to_string(hRio.reactors()), hRio, RIO_PORT, nClients);
+        }
+    }
+}
+
+//------------------------------------------------------------
+// MAIN
+//------------------------------------------------------------
+
+int main()
+{
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+
+    std::cout << "--- Echo: thread per connection vs multi-reactor vs RIO (" << ITERATIONS << " round trips x " << BUFFER_SIZE << " bytes per connection) ---\n";
+    Bench_EchoServers();
+
+    std::cout << "\n--- File -> socket transfer (" << TRANSFER_ROUNDS << " x " << TRANSFER_FILE_SIZE / (1024 * 1024) << " MB) ---\n";
+    Bench_FileTransfer("transfer_file.bin");
+
     WSACleanup();
 
     std::cout << "Done\n";
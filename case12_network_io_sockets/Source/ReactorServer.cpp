@@ -0,0 +1,487 @@
+#include "ReactorServer.h"
+#include <mswsock.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Mswsock.lib")
+
+//Completion keys: socket I/O, a connection handed over by reactor 0, the stop request
+static constexpr ULONG_PTR REACTOR_KEY_IO = 0;
+static constexpr ULONG_PTR REACTOR_KEY_HANDOFF = 1;
+static constexpr ULONG_PTR REACTOR_KEY_STOP = 2;
+
+static constexpr DWORD ACCEPT_ADDRESS_SIZE = sizeof(sockaddr_storage) + 16;
+
+ReactorServer::ReactorServer(ServerHandler* pHandlerIn) :
+    pHandler(pHandlerIn),
+    hListen(INVALID_SOCKET),
+    bSkipOnSuccess(false),
+    nNextReactor(0),
+    nAcceptsPending(0),
+    nNextId(0),
+    hStats()
+{
+}
+
+ReactorServer::~ReactorServer()
+{
+    this->Stop();
+}
+
+bool ReactorServer::Start(USHORT nPort, DWORD nReactors)
+{
+    if (!this->vReactors.empty())
+    {
+        return false;
+    }
+
+    if (nReactors == 0)
+    {
+        nReactors = max(1u, std::thread::hardware_concurrency());
+    }
+
+    this->hStats = {};
+
+    this->hListen = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+    if (this->hListen == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    sockaddr_in hAddress{};
+    hAddress.sin_family = AF_INET;
+    hAddress.sin_port = htons(nPort);
+    hAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(this->hListen, reinterpret_cast<sockaddr*>(&hAddress), sizeof(hAddress)) == SOCKET_ERROR || listen(this->hListen, SOMAXCONN) == SOCKET_ERROR)
+    {
+        this->Stop();
+        return false;
+    }
+
+    //Skipping the port is only safe on real kernel socket handles: a layered provider in between may lose the completion
+    WSAPROTOCOL_INFOW hProtocol = {};
+    int nLength = sizeof(hProtocol);
+    this->bSkipOnSuccess = getsockopt(this->hListen, SOL_SOCKET, SO_PROTOCOL_INFOW, reinterpret_cast<char*>(&hProtocol), &nLength) == 0 && (hProtocol.dwServiceFlags1 & XP1_IFS_HANDLES) != 0;
+
+    for (DWORD i = 0; i < nReactors; i++)
+    {
+        Reactor* pReactor = new Reactor();
+        pReactor->nIndex = i;
+
+        //One thread per port: completions never wake a second thread
+        pReactor->hPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+        this->vReactors.push_back(pReactor);
+
+        if (!pReactor->hPort)
+        {
+            this->Stop();
+            return false;
+        }
+    }
+
+    Reactor* pAcceptor = this->vReactors[0];
+    if (!CreateIoCompletionPort(reinterpret_cast<HANDLE>(this->hListen), pAcceptor->hPort, REACTOR_KEY_IO, 0))
+    {
+        this->Stop();
+        return false;
+    }
+
+    for (DWORD i = 0; i < REACTOR_ACCEPTS_PENDING; i++)
+    {
+        AcceptOperation* pAccept = new AcceptOperation();
+        pAccept->hSocket = INVALID_SOCKET;
+        this->vAccepts.push_back(pAccept);
+
+        this->PostAccept(pAcceptor, pAccept);
+    }
+
+    if (this->nAcceptsPending == 0)
+    {
+        this->Stop();
+        return false;
+    }
+
+    for (Reactor* pReactor : this->vReactors)
+    {
+        pReactor->hThread = std::thread(&ReactorServer::Run, this, pReactor);
+    }
+
+    return true;
+}
+
+void ReactorServer::Stop()
+{
+    //Reactor 0 first: it closes the listener, and once it is gone nothing can be handed to the others.
+    //Its handoffs are already queued ahead of their stop packet (ports are FIFO).
+    for (Reactor* pReactor : this->vReactors)
+    {
+        if (pReactor->hThread.joinable())
+        {
+            PostQueuedCompletionStatus(pReactor->hPort, 0, REACTOR_KEY_STOP, nullptr);
+            pReactor->hThread.join();
+        }
+    }
+
+    //Start() failed before the threads ran
+    if (this->hListen != INVALID_SOCKET)
+    {
+        closesocket(this->hListen);
+        this->hListen = INVALID_SOCKET;
+    }
+
+    for (AcceptOperation* pAccept : this->vAccepts)
+    {
+        if (pAccept->hSocket != INVALID_SOCKET)
+        {
+            closesocket(pAccept->hSocket);
+        }
+
+        delete pAccept;
+    }
+
+    for (Reactor* pReactor : this->vReactors)
+    {
+        AddServerStats(&this->hStats, pReactor->hStats);
+
+        if (pReactor->hPort)
+        {
+            CloseHandle(pReactor->hPort);
+        }
+
+        delete pReactor;
+    }
+
+    this->vAccepts.clear();
+    this->vReactors.clear();
+    this->nNextReactor = 0;
+    this->nAcceptsPending = 0;
+}
+
+//------------------------------------------------------------
+// Reactor loop
+//------------------------------------------------------------
+void ReactorServer::Run(Reactor* pReactor)
+{
+    //Pinned: the connections this reactor owns stay in one core's caches
+    if (pReactor->nIndex < sizeof(DWORD_PTR) * 8)
+    {
+        SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << pReactor->nIndex);
+    }
+
+    OVERLAPPED_ENTRY pEntries[REACTOR_BATCH];
+
+    while (!pReactor->bStopping || !pReactor->vConnections.empty() || (pReactor->nIndex == 0 && this->nAcceptsPending > 0))
+    {
+        ULONG nRemoved = 0;
+        const BOOL bOk = GetQueuedCompletionStatusEx(pReactor->hPort, pEntries, REACTOR_BATCH, &nRemoved, INFINITE, FALSE);
+
+        pReactor->hStats.qwWaits++;
+        pReactor->hStats.qwSystemCalls++;
+
+        if (!bOk)
+        {
+            break;
+        }
+
+        pReactor->hStats.qwCompletions += nRemoved;
+
+        for (ULONG i = 0; i < nRemoved; i++)
+        {
+            this->OnCompletion(pReactor, pEntries[i]);
+        }
+    }
+}
+
+void ReactorServer::OnCompletion(Reactor* pReactor, const OVERLAPPED_ENTRY& hEntry)
+{
+    switch (hEntry.lpCompletionKey)
+    {
+    case REACTOR_KEY_STOP:
+        this->BeginStop(pReactor);
+        return;
+    case REACTOR_KEY_HANDOFF:
+        this->Adopt(pReactor, static_cast<Connection*>(reinterpret_cast<Operation*>(hEntry.lpOverlapped)));
+        return;
+    default:
+        break;
+    }
+
+    Operation* pOperation = reinterpret_cast<Operation*>(hEntry.lpOverlapped);
+
+    //Internal holds the NTSTATUS of the finished operation: 0 is success
+    const bool bOk = pOperation->hOverlapped.Internal == 0;
+
+    if (pOperation->eOp == REACTOR_OP_ACCEPT)
+    {
+        this->OnAccept(pReactor, static_cast<AcceptOperation*>(pOperation), bOk);
+    }
+    else
+    {
+        this->Advance(pReactor, static_cast<Connection*>(pOperation), bOk, hEntry.dwNumberOfBytesTransferred);
+    }
+}
+
+//Closing the sockets cancels their operations; the reactor keeps draining until each one has come back
+void ReactorServer::BeginStop(Reactor* pReactor)
+{
+    pReactor->bStopping = true;
+
+    if (pReactor->nIndex == 0 && this->hListen != INVALID_SOCKET)
+    {
+        closesocket(this->hListen);
+        this->hListen = INVALID_SOCKET;
+        pReactor->hStats.qwSystemCalls++;
+    }
+
+    for (Connection* pConnection : pReactor->vConnections)
+    {
+        closesocket(pConnection->hSocket);
+        pConnection->hSocket = INVALID_SOCKET;
+        pReactor->hStats.qwSystemCalls++;
+    }
+}
+
+//------------------------------------------------------------
+// Accept and handoff
+//------------------------------------------------------------
+bool ReactorServer::PostAccept(Reactor* pReactor, AcceptOperation* pAccept)
+{
+    pAccept->hSocket = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+    pReactor->hStats.qwSystemCalls++;
+
+    if (pAccept->hSocket == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    ZeroMemory(&pAccept->hOverlapped, sizeof(OVERLAPPED));
+    pAccept->eOp = REACTOR_OP_ACCEPT;
+
+    DWORD dwBytes = 0;
+    const BOOL bOk = AcceptEx(this->hListen, pAccept->hSocket, pAccept->pAddresses, 0, ACCEPT_ADDRESS_SIZE, ACCEPT_ADDRESS_SIZE, &dwBytes, &pAccept->hOverlapped);
+    pReactor->hStats.qwSystemCalls++;
+
+    //The listener does not skip the port: even an immediate accept arrives as a completion
+    if (!bOk && WSAGetLastError() != WSA_IO_PENDING)
+    {
+        closesocket(pAccept->hSocket);
+        pAccept->hSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    this->nAcceptsPending++;
+    return true;
+}
+
+void ReactorServer::OnAccept(Reactor* pReactor, AcceptOperation* pAccept, bool bOk)
+{
+    this->nAcceptsPending--;
+
+    const SOCKET hSocket = pAccept->hSocket;
+    pAccept->hSocket = INVALID_SOCKET;
+
+    if (!bOk || pReactor->bStopping)
+    {
+        closesocket(hSocket);
+        pReactor->hStats.qwSystemCalls++;
+    }
+    else
+    {
+        //The accepted socket inherits the listener's properties (getpeername, shutdown...)
+        setsockopt(hSocket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT, reinterpret_cast<const char*>(&this->hListen), sizeof(this->hListen));
+
+        Reactor* pTarget = this->vReactors[this->nNextReactor];
+        this->nNextReactor = (this->nNextReactor + 1) % static_cast<DWORD>(this->vReactors.size());
+
+        Connection* pConnection = new Connection();
+        pConnection->hSocket = hSocket;
+        pConnection->nId = this->nNextId++;
+
+        //Any thread may bind a socket to a port; from here on its completions only reach pTarget
+        bool bAssociated = CreateIoCompletionPort(reinterpret_cast<HANDLE>(hSocket), pTarget->hPort, REACTOR_KEY_IO, 0) != nullptr;
+        pReactor->hStats.qwSystemCalls += 2;
+
+        if (bAssociated && this->bSkipOnSuccess)
+        {
+            bAssociated = SetFileCompletionNotificationModes(reinterpret_cast<HANDLE>(hSocket), FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE) != FALSE;
+            pReactor->hStats.qwSystemCalls++;
+        }
+
+        if (!bAssociated)
+        {
+            closesocket(hSocket);
+            delete pConnection;
+        }
+        else if (pTarget == pReactor)
+        {
+            //A packet to its own port could land behind a stop request and never be read
+            this->Adopt(pReactor, pConnection);
+        }
+        else
+        {
+            PostQueuedCompletionStatus(pTarget->hPort, 0, REACTOR_KEY_HANDOFF, &pConnection->hOverlapped);
+            pReactor->hStats.qwSystemCalls++;
+        }
+    }
+
+    if (!pReactor->bStopping)
+    {
+        this->PostAccept(pReactor, pAccept);
+    }
+}
+
+void ReactorServer::Adopt(Reactor* pReactor, Connection* pConnection)
+{
+    if (pReactor->bStopping)
+    {
+        closesocket(pConnection->hSocket);
+        pReactor->hStats.qwSystemCalls++;
+
+        delete pConnection;
+        return;
+    }
+
+    pConnection->nIndex = pReactor->vConnections.size();
+    pReactor->vConnections.push_back(pConnection);
+    pReactor->hStats.qwConnections++;
+
+    this->pHandler->OnConnect(pConnection->nId);
+
+    pConnection->eOp = REACTOR_OP_RECV;
+
+    DWORD dwBytes = 0;
+    switch (this->Issue(pReactor, pConnection, &dwBytes))
+    {
+    case IO_DONE:
+        this->Advance(pReactor, pConnection, true, dwBytes);
+        break;
+    case IO_FAILED:
+        this->Close(pReactor, pConnection);
+        break;
+    default:
+        break;
+    }
+}
+
+//------------------------------------------------------------
+// Connection I/O
+//------------------------------------------------------------
+ReactorServer::IoResult ReactorServer::Issue(Reactor* pReactor, Connection* pConnection, DWORD* pdwBytes)
+{
+    ZeroMemory(&pConnection->hOverlapped, sizeof(OVERLAPPED));
+
+    WSABUF hBuffer = {};
+    int nResult = 0;
+
+    if (pConnection->eOp == REACTOR_OP_RECV)
+    {
+        hBuffer.buf = pConnection->pBuffer;
+        hBuffer.len = REACTOR_BUFFER_SIZE;
+
+        DWORD dwFlags = 0;
+        nResult = WSARecv(pConnection->hSocket, &hBuffer, 1, pdwBytes, &dwFlags, &pConnection->hOverlapped, nullptr);
+    }
+    else
+    {
+        hBuffer.buf = pConnection->pBuffer + pConnection->nReplySent;
+        hBuffer.len = static_cast<ULONG>(pConnection->nReplyBytes - pConnection->nReplySent);
+
+        nResult = WSASend(pConnection->hSocket, &hBuffer, 1, pdwBytes, 0, &pConnection->hOverlapped, nullptr);
+    }
+
+    pReactor->hStats.qwSystemCalls++;
+
+    if (nResult == 0)
+    {
+        //Without skip-on-success the completion is queued anyway and handled from there
+        if (!this->bSkipOnSuccess)
+        {
+            return IO_PENDING;
+        }
+
+        pReactor->hStats.qwInlineCompletions++;
+        return IO_DONE;
+    }
+
+    return WSAGetLastError() == WSA_IO_PENDING ? IO_PENDING : IO_FAILED;
+}
+
+//Takes the result of the connection's operation and issues the next one, looping while they finish inline
+void ReactorServer::Advance(Reactor* pReactor, Connection* pConnection, bool bOk, DWORD dwBytes)
+{
+    while (true)
+    {
+        if (!bOk)
+        {
+            this->Close(pReactor, pConnection);
+            return;
+        }
+
+        if (pConnection->eOp == REACTOR_OP_RECV)
+        {
+            //0 bytes: the peer closed its side
+            if (dwBytes == 0)
+            {
+                this->Close(pReactor, pConnection);
+                return;
+            }
+
+            pReactor->hStats.qwBytesReceived += dwBytes;
+
+            const int nReply = this->pHandler->OnData(pConnection->nId, pConnection->pBuffer, static_cast<int>(dwBytes), static_cast<int>(REACTOR_BUFFER_SIZE));
+            if (nReply < 0)
+            {
+                this->Close(pReactor, pConnection);
+                return;
+            }
+
+            if (nReply > 0)
+            {
+                pConnection->eOp = REACTOR_OP_SEND;
+                pConnection->nReplyBytes = min(nReply, static_cast<int>(REACTOR_BUFFER_SIZE));
+                pConnection->nReplySent = 0;
+            }
+        }
+        else
+        {
+            pReactor->hStats.qwBytesSent += dwBytes;
+            pConnection->nReplySent += static_cast<int>(dwBytes);
+
+            if (pConnection->nReplySent >= pConnection->nReplyBytes)
+            {
+                pConnection->eOp = REACTOR_OP_RECV;
+            }
+        }
+
+        switch (this->Issue(pReactor, pConnection, &dwBytes))
+        {
+        case IO_PENDING:
+            return;
+        case IO_FAILED:
+            this->Close(pReactor, pConnection);
+            return;
+        default:
+            bOk = true;
+            break;
+        }
+    }
+}
+
+void ReactorServer::Close(Reactor* pReactor, Connection* pConnection)
+{
+    this->pHandler->OnClose(pConnection->nId);
+
+    if (pConnection->hSocket != INVALID_SOCKET)
+    {
+        closesocket(pConnection->hSocket);
+        pReactor->hStats.qwSystemCalls++;
+    }
+
+    //Swap with the last one: no search, no shifting
+    Connection* pLast = pReactor->vConnections.back();
+    pReactor->vConnections[pConnection->nIndex] = pLast;
+    pLast->nIndex = pConnection->nIndex;
+    pReactor->vConnections.pop_back();
+
+    delete pConnection;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <winsock2.h>
+#include <windows.h>
+#include <thread>
+#include <vector>
+#include "ServerHandler.h"
+
+/*
+    Multi-reactor TCP server: one reactor thread per core, each with its own
+    completion port, instead of IOCP.cpp's single port shared by
+    MAX_WORKER_THREADS workers.
+
+    This is the Windows shape of the Linux "one epoll per core" design:
+    - A connection belongs to one reactor for its whole life. Only that thread
+      touches it, so the connection state needs no lock and stays in that
+      core's cache (each reactor is pinned to one processor).
+    - Each port is drained in batches with GetQueuedCompletionStatusEx, the
+      epoll_wait counterpart.
+    - Linux shards accepts across per-reactor listeners with SO_REUSEPORT.
+      Windows has no load-balancing equivalent (SO_REUSEADDR lets a second
+      socket steal the port, it does not share it), so there is one listener.
+      Accepts are never blocking: REACTOR_ACCEPTS_PENDING AcceptEx calls stay
+      posted on reactor 0's port, and every accepted socket is handed to the
+      next reactor round-robin through that reactor's own port.
+    - When the provider allows it, sockets skip the port when an operation
+      finishes inside the call (FILE_SKIP_COMPLETION_PORT_ON_SUCCESS), so a
+      connection with data already buffered is served without a wait. This is
+      what edge-triggered reading until EAGAIN buys on Linux.
+
+    A connection has at most one operation in flight: receive, hand the bytes
+    to the handler, send its reply, receive again.
+*/
+constexpr DWORD REACTOR_BUFFER_SIZE = 4096;
+constexpr DWORD REACTOR_BATCH = 64;
+constexpr DWORD REACTOR_ACCEPTS_PENDING = 16;
+
+class ReactorServer
+{
+public:
+    explicit ReactorServer(ServerHandler* pHandlerIn);
+    ~ReactorServer();
+
+    ReactorServer(const ReactorServer&) = delete;
+    ReactorServer& operator=(const ReactorServer&) = delete;
+
+    //Listens on nPort (any address) with nReactors threads, 0: one per processor
+    bool Start(USHORT nPort, DWORD nReactors = 0);
+
+    //Stops accepting, closes every connection and joins the reactor threads
+    void Stop();
+
+    //Valid after Stop()
+    ServerStats GetStats() const { return this->hStats; }
+
+    DWORD reactors() const { return static_cast<DWORD>(this->vReactors.size()); }
+
+private:
+    enum ReactorOp
+    {
+        REACTOR_OP_ACCEPT,
+        REACTOR_OP_RECV,
+        REACTOR_OP_SEND,
+    };
+
+    struct Reactor;
+
+    //OVERLAPPED first: a completion's LPOVERLAPPED is the operation itself
+    struct Operation
+    {
+        OVERLAPPED hOverlapped;
+        ReactorOp eOp;
+    };
+
+    struct Connection : Operation
+    {
+        SOCKET hSocket;
+        ConnectionId nId;
+        size_t nIndex;                  //Position in the owning reactor's vConnections
+        int nReplyBytes;
+        int nReplySent;
+        char pBuffer[REACTOR_BUFFER_SIZE];
+    };
+
+    struct AcceptOperation : Operation
+    {
+        SOCKET hSocket;
+        char pAddresses[2 * (sizeof(sockaddr_storage) + 16)];
+    };
+
+    struct Reactor
+    {
+        DWORD nIndex;
+        HANDLE hPort;
+        std::thread hThread;
+        std::vector<Connection*> vConnections;
+        bool bStopping;
+        ServerStats hStats;
+    };
+
+    enum IoResult
+    {
+        IO_PENDING,
+        IO_DONE,
+        IO_FAILED,
+    };
+
+    void Run(Reactor* pReactor);
+    void OnCompletion(Reactor* pReactor, const OVERLAPPED_ENTRY& hEntry);
+    void BeginStop(Reactor* pReactor);
+
+    bool PostAccept(Reactor* pReactor, AcceptOperation* pAccept);
+    void OnAccept(Reactor* pReactor, AcceptOperation* pAccept, bool bOk);
+    void Adopt(Reactor* pReactor, Connection* pConnection);
+
+    IoResult Issue(Reactor* pReactor, Connection* pConnection, DWORD* pdwBytes);
+    void Advance(Reactor* pReactor, Connection* pConnection, bool bOk, DWORD dwBytes);
+    void Close(Reactor* pReactor, Connection* pConnection);
+
+    ServerHandler* pHandler;
+    SOCKET hListen;
+    bool bSkipOnSuccess;
+    DWORD nNextReactor;
+    DWORD nAcceptsPending;
+    ConnectionId nNextId;
+    std::vector<Reactor*> vReactors;
+    std::vector<AcceptOperation*> vAccepts;
+    ServerStats hStats;                 //Totals of the reactors, collected by Stop()
+};
@@ -0,0 +1,696 @@
+#include "RioServer.h"
+
+#pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Mswsock.lib")
+
+//Completion keys: AcceptEx on the acceptor's port or RIONotify on a reactor's port, a handed over socket, the stop request
+static constexpr ULONG_PTR RIO_KEY_IO = 0;
+static constexpr ULONG_PTR RIO_KEY_HANDOFF = 1;
+static constexpr ULONG_PTR RIO_KEY_STOP = 2;
+
+//RequestContext: the slice index, plus this bit for sends
+static constexpr ULONGLONG RIO_REQUEST_SEND = 2;
+
+static constexpr DWORD ACCEPT_ADDRESS_SIZE = sizeof(sockaddr_storage) + 16;
+
+RioServer::RioServer(ServerHandler* pHandlerIn) :
+    pHandler(pHandlerIn),
+    hRio(),
+    eMode(RIO_WAIT_NOTIFY),
+    hListen(INVALID_SOCKET),
+    hAcceptPort(nullptr),
+    nNextReactor(0),
+    nAcceptsPending(0),
+    nNextId(0),
+    hAcceptStats(),
+    hStats()
+{
+}
+
+RioServer::~RioServer()
+{
+    this->Stop();
+}
+
+bool RioServer::Start(USHORT nPort, DWORD nReactors, RioWaitMode eModeIn)
+{
+    if (!this->vReactors.empty())
+    {
+        return false;
+    }
+
+    if (nReactors == 0)
+    {
+        nReactors = max(1u, std::thread::hardware_concurrency());
+    }
+
+    this->eMode = eModeIn;
+    this->hStats = {};
+    this->hAcceptStats = {};
+
+    this->hListen = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, WSA_FLAG_OVERLAPPED | WSA_FLAG_REGISTERED_IO);
+    if (this->hListen == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    //The RIO entry points come from the provider, like the other extension functions
+    GUID hRioId = WSAID_MULTIPLE_RIO;
+    DWORD dwBytes = 0;
+
+    this->hRio = {};
+    this->hRio.cbSize = sizeof(this->hRio);
+
+    if (WSAIoctl(this->hListen, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &hRioId, sizeof(hRioId), &this->hRio, sizeof(this->hRio), &dwBytes, nullptr, nullptr) == SOCKET_ERROR)
+    {
+        this->Stop();
+        return false;
+    }
+
+    sockaddr_in hAddress{};
+    hAddress.sin_family = AF_INET;
+    hAddress.sin_port = htons(nPort);
+    hAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(this->hListen, reinterpret_cast<sockaddr*>(&hAddress), sizeof(hAddress)) == SOCKET_ERROR || listen(this->hListen, SOMAXCONN) == SOCKET_ERROR)
+    {
+        this->Stop();
+        return false;
+    }
+
+    this->hAcceptPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    if (!this->hAcceptPort || !CreateIoCompletionPort(reinterpret_cast<HANDLE>(this->hListen), this->hAcceptPort, RIO_KEY_IO, 0))
+    {
+        this->Stop();
+        return false;
+    }
+
+    for (DWORD i = 0; i < nReactors; i++)
+    {
+        if (!this->CreateReactor(i))
+        {
+            this->Stop();
+            return false;
+        }
+    }
+
+    for (DWORD i = 0; i < RIO_ACCEPTS_PENDING; i++)
+    {
+        AcceptOperation* pAccept = new AcceptOperation();
+        pAccept->hSocket = INVALID_SOCKET;
+        this->vAccepts.push_back(pAccept);
+
+        this->PostAccept(pAccept);
+    }
+
+    if (this->nAcceptsPending == 0)
+    {
+        this->Stop();
+        return false;
+    }
+
+    for (Reactor* pReactor : this->vReactors)
+    {
+        pReactor->hThread = std::thread(&RioServer::Run, this, pReactor);
+    }
+
+    this->hAcceptor = std::thread(&RioServer::RunAcceptor, this);
+    return true;
+}
+
+void RioServer::Stop()
+{
+    //The acceptor first: once it is gone nothing new reaches the reactors' inboxes
+    if (this->hAcceptor.joinable())
+    {
+        PostQueuedCompletionStatus(this->hAcceptPort, 0, RIO_KEY_STOP, nullptr);
+        this->hAcceptor.join();
+    }
+
+    for (Reactor* pReactor : this->vReactors)
+    {
+        if (pReactor->hThread.joinable())
+        {
+            //The flag reaches a polling reactor, the packet wakes a sleeping one
+            pReactor->bStopRequested.store(true);
+            PostQueuedCompletionStatus(pReactor->hPort, 0, RIO_KEY_STOP, nullptr);
+            pReactor->hThread.join();
+        }
+    }
+
+    //Start() failed before the threads ran
+    if (this->hListen != INVALID_SOCKET)
+    {
+        closesocket(this->hListen);
+        this->hListen = INVALID_SOCKET;
+    }
+
+    for (AcceptOperation* pAccept : this->vAccepts)
+    {
+        if (pAccept->hSocket != INVALID_SOCKET)
+        {
+            closesocket(pAccept->hSocket);
+        }
+
+        delete pAccept;
+    }
+
+    if (this->hAcceptPort)
+    {
+        CloseHandle(this->hAcceptPort);
+        this->hAcceptPort = nullptr;
+    }
+
+    AddServerStats(&this->hStats, this->hAcceptStats);
+
+    for (Reactor* pReactor : this->vReactors)
+    {
+        AddServerStats(&this->hStats, pReactor->hStats);
+        this->DestroyReactor(pReactor);
+    }
+
+    this->vAccepts.clear();
+    this->vReactors.clear();
+    this->nNextReactor = 0;
+    this->nAcceptsPending = 0;
+}
+
+bool RioServer::CreateReactor(DWORD nIndex)
+{
+    Reactor* pReactor = new Reactor();
+    pReactor->nIndex = nIndex;
+    pReactor->hQueue = RIO_INVALID_CQ;
+    pReactor->hBufferId = RIO_INVALID_BUFFERID;
+    this->vReactors.push_back(pReactor);
+
+    pReactor->hPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    if (!pReactor->hPort)
+    {
+        return false;
+    }
+
+    const DWORD nRegionSize = 2 * RIO_MAX_CONNECTIONS * RIO_SLICE_SIZE;
+
+    pReactor->pBuffers = reinterpret_cast<char*>(VirtualAlloc(nullptr, nRegionSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!pReactor->pBuffers)
+    {
+        return false;
+    }
+
+    //Registered once: the pages stay locked, no request has to probe and lock its buffer again
+    pReactor->hBufferId = this->hRio.RIORegisterBuffer(pReactor->pBuffers, nRegionSize);
+    if (pReactor->hBufferId == RIO_INVALID_BUFFERID)
+    {
+        return false;
+    }
+
+    RIO_NOTIFICATION_COMPLETION hNotify = {};
+    hNotify.Type = RIO_IOCP_COMPLETION;
+    hNotify.Iocp.IocpHandle = pReactor->hPort;
+    hNotify.Iocp.CompletionKey = reinterpret_cast<PVOID>(RIO_KEY_IO);
+    hNotify.Iocp.Overlapped = &pReactor->hNotifyOverlapped;
+
+    //Room for everything the connections can have in flight: one receive and two sends each
+    pReactor->hQueue = this->hRio.RIOCreateCompletionQueue(RIO_MAX_CONNECTIONS * 3, &hNotify);
+    if (pReactor->hQueue == RIO_INVALID_CQ)
+    {
+        return false;
+    }
+
+    //Popped from the back: slot 0 first
+    pReactor->vFreeSlots.reserve(RIO_MAX_CONNECTIONS);
+    for (DWORD nSlot = RIO_MAX_CONNECTIONS; nSlot-- > 0;)
+    {
+        pReactor->vFreeSlots.push_back(nSlot);
+    }
+
+    return true;
+}
+
+void RioServer::DestroyReactor(Reactor* pReactor)
+{
+    if (pReactor->hQueue != RIO_INVALID_CQ)
+    {
+        this->hRio.RIOCloseCompletionQueue(pReactor->hQueue);
+    }
+
+    if (pReactor->hBufferId != RIO_INVALID_BUFFERID)
+    {
+        this->hRio.RIODeregisterBuffer(pReactor->hBufferId);
+    }
+
+    if (pReactor->pBuffers)
+    {
+        VirtualFree(pReactor->pBuffers, 0, MEM_RELEASE);
+    }
+
+    if (pReactor->hPort)
+    {
+        CloseHandle(pReactor->hPort);
+    }
+
+    delete pReactor;
+}
+
+//------------------------------------------------------------
+// Acceptor
+//------------------------------------------------------------
+void RioServer::RunAcceptor()
+{
+    OVERLAPPED_ENTRY pEntries[RIO_ACCEPTS_PENDING];
+    bool bStopping = false;
+
+    while (!bStopping || this->nAcceptsPending > 0)
+    {
+        ULONG nRemoved = 0;
+        const BOOL bOk = GetQueuedCompletionStatusEx(this->hAcceptPort, pEntries, RIO_ACCEPTS_PENDING, &nRemoved, INFINITE, FALSE);
+        this->hAcceptStats.qwSystemCalls++;
+
+        if (!bOk)
+        {
+            break;
+        }
+
+        for (ULONG i = 0; i < nRemoved; i++)
+        {
+            if (pEntries[i].lpCompletionKey == RIO_KEY_STOP)
+            {
+                //Closing the listener cancels the pending accepts; they still come back here
+                bStopping = true;
+                closesocket(this->hListen);
+                this->hListen = INVALID_SOCKET;
+                this->hAcceptStats.qwSystemCalls++;
+                continue;
+            }
+
+            AcceptOperation* pAccept = reinterpret_cast<AcceptOperation*>(pEntries[i].lpOverlapped);
+            this->nAcceptsPending--;
+
+            const SOCKET hSocket = pAccept->hSocket;
+            pAccept->hSocket = INVALID_SOCKET;
+
+            if (pAccept->hOverlapped.Internal != 0 || bStopping)
+            {
+                closesocket(hSocket);
+                this->hAcceptStats.qwSystemCalls++;
+            }
+            else
+            {
+                setsockopt(hSocket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT, reinterpret_cast<const char*>(&this->hListen), sizeof(this->hListen));
+
+                Reactor* pTarget = this->vReactors[this->nNextReactor];
+                this->nNextReactor = (this->nNextReactor + 1) % static_cast<DWORD>(this->vReactors.size());
+
+                {
+                    std::lock_guard<std::mutex> hLock(pTarget->hInboxLock);
+                    pTarget->vInbox.push_back({ hSocket, this->nNextId++ });
+                    pTarget->nInbox.store(pTarget->vInbox.size());
+                }
+
+                //Wakes the reactor if it sleeps; a polling one sees nInbox first
+                PostQueuedCompletionStatus(pTarget->hPort, 0, RIO_KEY_HANDOFF, nullptr);
+                this->hAcceptStats.qwSystemCalls += 2;
+            }
+
+            if (!bStopping)
+            {
+                this->PostAccept(pAccept);
+            }
+        }
+    }
+}
+
+bool RioServer::PostAccept(AcceptOperation* pAccept)
+{
+    pAccept->hSocket = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, WSA_FLAG_OVERLAPPED | WSA_FLAG_REGISTERED_IO);
+    this->hAcceptStats.qwSystemCalls++;
+
+    if (pAccept->hSocket == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    ZeroMemory(&pAccept->hOverlapped, sizeof(OVERLAPPED));
+
+    DWORD dwBytes = 0;
+    const BOOL bOk = AcceptEx(this->hListen, pAccept->hSocket, pAccept->pAddresses, 0, ACCEPT_ADDRESS_SIZE, ACCEPT_ADDRESS_SIZE, &dwBytes, &pAccept->hOverlapped);
+    this->hAcceptStats.qwSystemCalls++;
+
+    if (!bOk && WSAGetLastError() != WSA_IO_PENDING)
+    {
+        closesocket(pAccept->hSocket);
+        pAccept->hSocket = INVALID_SOCKET;
+        return false;
+    }
+
+    this->nAcceptsPending++;
+    return true;
+}
+
+//------------------------------------------------------------
+// Reactor loop
+//------------------------------------------------------------
+void RioServer::Run(Reactor* pReactor)
+{
+    //Pinned: the connections and the registered slices this reactor owns stay in one core's caches
+    if (pReactor->nIndex < sizeof(DWORD_PTR) * 8)
+    {
+        SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << pReactor->nIndex);
+    }
+
+    RIORESULT pResults[RIO_BATCH];
+    DWORD nIdle = 0;
+
+    while (!pReactor->bStopping || !pReactor->vConnections.empty())
+    {
+        if (!pReactor->bStopping && pReactor->bStopRequested.load(std::memory_order_relaxed))
+        {
+            this->BeginStop(pReactor);
+            continue;
+        }
+
+        if (pReactor->nInbox.load(std::memory_order_acquire) > 0)
+        {
+            this->DrainInbox(pReactor);
+        }
+
+        const ULONG nResults = this->hRio.RIODequeueCompletion(pReactor->hQueue, pResults, RIO_BATCH);
+        if (nResults == RIO_CORRUPT_CQ)
+        {
+            break;
+        }
+
+        if (nResults > 0)
+        {
+            pReactor->hStats.qwWaits++;
+            pReactor->hStats.qwCompletions += nResults;
+
+            for (ULONG i = 0; i < nResults; i++)
+            {
+                this->OnResult(pReactor, pResults[i]);
+            }
+
+            nIdle = 0;
+            continue;
+        }
+
+        if (this->eMode == RIO_WAIT_POLL && ++nIdle < RIO_POLL_SPINS)
+        {
+            YieldProcessor();
+            continue;
+        }
+
+        nIdle = 0;
+        this->Wait(pReactor);
+    }
+
+    //Sockets handed over after the last look at the inbox are closed here
+    this->DrainInbox(pReactor);
+}
+
+void RioServer::Wait(Reactor* pReactor)
+{
+    //RIONotify fires once per call: it is armed again only after its notification has been taken
+    if (!pReactor->bNotifyArmed)
+    {
+        pReactor->bNotifyArmed = this->hRio.RIONotify(pReactor->hQueue) == ERROR_SUCCESS;
+        pReactor->hStats.qwSystemCalls++;
+    }
+
+    OVERLAPPED_ENTRY pEntries[8];
+    ULONG nRemoved = 0;
+
+    if (GetQueuedCompletionStatusEx(pReactor->hPort, pEntries, 8, &nRemoved, INFINITE, FALSE))
+    {
+        //Handoff and stop packets only wake the loop: it reads the inbox and the stop flag itself
+        for (ULONG i = 0; i < nRemoved; i++)
+        {
+            if (pEntries[i].lpCompletionKey == RIO_KEY_IO)
+            {
+                pReactor->bNotifyArmed = false;
+            }
+        }
+    }
+
+    pReactor->hStats.qwSystemCalls++;
+}
+
+//Closing the sockets fails their requests; the reactor keeps dequeuing until each one has come back
+void RioServer::BeginStop(Reactor* pReactor)
+{
+    pReactor->bStopping = true;
+
+    //Backwards: Close() may release the connection, which moves the last one into its place
+    for (size_t i = pReactor->vConnections.size(); i-- > 0;)
+    {
+        this->Close(pReactor, pReactor->vConnections[i]);
+    }
+}
+
+void RioServer::DrainInbox(Reactor* pReactor)
+{
+    std::vector<Handoff> vHandoffs;
+    {
+        std::lock_guard<std::mutex> hLock(pReactor->hInboxLock);
+        vHandoffs.swap(pReactor->vInbox);
+        pReactor->nInbox.store(0, std::memory_order_relaxed);
+    }
+
+    for (const Handoff& hHandoff : vHandoffs)
+    {
+        this->Adopt(pReactor, hHandoff);
+    }
+}
+
+void RioServer::Adopt(Reactor* pReactor, const Handoff& hHandoff)
+{
+    //Every slot in use: the registered region has no room for another connection
+    if (pReactor->bStopping || pReactor->vFreeSlots.empty())
+    {
+        closesocket(hHandoff.hSocket);
+        pReactor->hStats.qwSystemCalls++;
+        return;
+    }
+
+    Connection* pConnection = new Connection();
+    pConnection->hSocket = hHandoff.hSocket;
+    pConnection->nId = hHandoff.nId;
+
+    //One receive and up to two sends in flight (a reply and the one before it), one buffer each
+    pConnection->hRequests = this->hRio.RIOCreateRequestQueue(pConnection->hSocket, 1, 1, 2, 1, pReactor->hQueue, pReactor->hQueue, pConnection);
+    pReactor->hStats.qwSystemCalls++;
+
+    if (pConnection->hRequests == RIO_INVALID_RQ)
+    {
+        closesocket(pConnection->hSocket);
+        pReactor->hStats.qwSystemCalls++;
+
+        delete pConnection;
+        return;
+    }
+
+    pConnection->nSlot = pReactor->vFreeSlots.back();
+    pReactor->vFreeSlots.pop_back();
+
+    pConnection->nIndex = pReactor->vConnections.size();
+    pReactor->vConnections.push_back(pConnection);
+    pReactor->hStats.qwConnections++;
+
+    this->pHandler->OnConnect(pConnection->nId);
+
+    if (!this->PostReceive(pReactor, pConnection, 0))
+    {
+        this->Close(pReactor, pConnection);
+    }
+}
+
+//------------------------------------------------------------
+// Connection I/O
+//------------------------------------------------------------
+bool RioServer::PostReceive(Reactor* pReactor, Connection* pConnection, DWORD nSlice)
+{
+    RIO_BUF hBuffer = {};
+    hBuffer.BufferId = pReactor->hBufferId;
+    hBuffer.Offset = (2 * pConnection->nSlot + nSlice) * RIO_SLICE_SIZE;
+    hBuffer.Length = RIO_SLICE_SIZE;
+
+    //Not deferred: also commits a reply queued just before it
+    const BOOL bOk = this->hRio.RIOReceive(pConnection->hRequests, &hBuffer, 1, 0, reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(nSlice)));
+    pReactor->hStats.qwSystemCalls++;
+
+    if (!bOk)
+    {
+        return false;
+    }
+
+    pConnection->nOutstanding++;
+    return true;
+}
+
+bool RioServer::PostSend(Reactor* pReactor, Connection* pConnection, DWORD nSlice, bool bDefer)
+{
+    const Slice& hSlice = pConnection->hSlices[nSlice];
+
+    RIO_BUF hBuffer = {};
+    hBuffer.BufferId = pReactor->hBufferId;
+    hBuffer.Offset = (2 * pConnection->nSlot + nSlice) * RIO_SLICE_SIZE + static_cast<ULONG>(hSlice.nReplySent);
+    hBuffer.Length = static_cast<ULONG>(hSlice.nReplyBytes - hSlice.nReplySent);
+
+    const BOOL bOk = this->hRio.RIOSend(pConnection->hRequests, &hBuffer, 1, bDefer ? RIO_MSG_DEFER : 0, reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(nSlice | RIO_REQUEST_SEND)));
+    if (!bDefer)
+    {
+        pReactor->hStats.qwSystemCalls++;
+    }
+
+    if (!bOk)
+    {
+        return false;
+    }
+
+    pConnection->nOutstanding++;
+    return true;
+}
+
+void RioServer::OnResult(Reactor* pReactor, const RIORESULT& hResult)
+{
+    Connection* pConnection = reinterpret_cast<Connection*>(hResult.SocketContext);
+    const DWORD nSlice = static_cast<DWORD>(hResult.RequestContext & 1);
+
+    pConnection->nOutstanding--;
+
+    if (pConnection->bClosed)
+    {
+        if (pConnection->nOutstanding == 0)
+        {
+            this->Release(pReactor, pConnection);
+        }
+
+        return;
+    }
+
+    if (hResult.Status != 0)
+    {
+        this->Close(pReactor, pConnection);
+        return;
+    }
+
+    if (hResult.RequestContext & RIO_REQUEST_SEND)
+    {
+        pReactor->hStats.qwBytesSent += hResult.BytesTransferred;
+
+        Slice& hSlice = pConnection->hSlices[nSlice];
+        hSlice.nReplySent += static_cast<int>(hResult.BytesTransferred);
+
+        //RIO sends normally complete in full. The other slice's reply may already be queued behind
+        //this one, so resending the rest would put it after those bytes: close rather than reorder the echo
+        if (hSlice.nReplySent < hSlice.nReplyBytes)
+        {
+            this->Close(pReactor, pConnection);
+            return;
+        }
+
+        hSlice.bSending = false;
+
+        if (pConnection->bReceiveWanted)
+        {
+            pConnection->bReceiveWanted = false;
+
+            if (!this->PostReceive(pReactor, pConnection, nSlice))
+            {
+                this->Close(pReactor, pConnection);
+            }
+        }
+
+        return;
+    }
+
+    //0 bytes: the peer closed its side
+    if (hResult.BytesTransferred == 0)
+    {
+        this->Close(pReactor, pConnection);
+        return;
+    }
+
+    pReactor->hStats.qwBytesReceived += hResult.BytesTransferred;
+
+    const int nReply = this->pHandler->OnData(pConnection->nId, this->SliceData(pReactor, pConnection, nSlice), static_cast<int>(hResult.BytesTransferred), static_cast<int>(RIO_SLICE_SIZE));
+    if (nReply < 0)
+    {
+        this->Close(pReactor, pConnection);
+        return;
+    }
+
+    if (nReply == 0)
+    {
+        if (!this->PostReceive(pReactor, pConnection, nSlice))
+        {
+            this->Close(pReactor, pConnection);
+        }
+
+        return;
+    }
+
+    Slice& hSlice = pConnection->hSlices[nSlice];
+    hSlice.bSending = true;
+    hSlice.nReplyBytes = min(nReply, static_cast<int>(RIO_SLICE_SIZE));
+    hSlice.nReplySent = 0;
+
+    const DWORD nOther = 1 - nSlice;
+    bool bOk = true;
+
+    if (pConnection->hSlices[nOther].bSending)
+    {
+        //The previous reply still owns the other slice: receive once it has been sent
+        pConnection->bReceiveWanted = true;
+        bOk = this->PostSend(pReactor, pConnection, nSlice, false);
+    }
+    else if (!this->PostSend(pReactor, pConnection, nSlice, true))
+    {
+        bOk = false;
+    }
+    else if (!this->PostReceive(pReactor, pConnection, nOther))
+    {
+        //Push the deferred reply out anyway, so its completion (and the connection's release) still arrives
+        this->hRio.RIOSend(pConnection->hRequests, nullptr, 0, RIO_MSG_COMMIT_ONLY, nullptr);
+        pReactor->hStats.qwSystemCalls++;
+        bOk = false;
+    }
+
+    if (!bOk)
+    {
+        this->Close(pReactor, pConnection);
+    }
+}
+
+void RioServer::Close(Reactor* pReactor, Connection* pConnection)
+{
+    if (pConnection->bClosed)
+    {
+        return;
+    }
+
+    pConnection->bClosed = true;
+    this->pHandler->OnClose(pConnection->nId);
+
+    //Closing also frees the request queue; whatever was still in flight completes with an error
+    closesocket(pConnection->hSocket);
+    pReactor->hStats.qwSystemCalls++;
+
+    if (pConnection->nOutstanding == 0)
+    {
+        this->Release(pReactor, pConnection);
+    }
+}
+
+void RioServer::Release(Reactor* pReactor, Connection* pConnection)
+{
+    pReactor->vFreeSlots.push_back(pConnection->nSlot);
+
+    //Swap with the last one: no search, no shifting
+    Connection* pLast = pReactor->vConnections.back();
+    pReactor->vConnections[pConnection->nIndex] = pLast;
+    pLast->nIndex = pConnection->nIndex;
+    pReactor->vConnections.pop_back();
+
+    delete pConnection;
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include <winsock2.h>
+#include <mswsock.h>
+#include <windows.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ServerHandler.h"
+
+/*
+    Registered I/O (RIO) server backend, with the same ServerHandler interface
+    and reactor-per-core layout as ReactorServer.
+
+    RIO is the Windows counterpart of io_uring: requests and completions go
+    through queues shared with the kernel, and the data buffers are registered
+    (locked and mapped) once instead of on every call.
+    - Each reactor owns one RIO completion queue and one registered buffer
+      region. Every connection gets two slices of that region, and the
+      receives land there, the way io_uring's provided buffer ring hands out
+      registered buffers. RIO has no kernel-chosen buffers, so the reactor
+      picks the slice itself.
+    - A reply and the next receive are submitted together. The send is queued
+      with RIO_MSG_DEFER and the receive commits both with one kernel call,
+      the nearest thing to io_uring's linked send. The receive goes to the
+      connection's other slice, so the handler's reply stays untouched until it
+      has been sent.
+    - RIODequeueCompletion reads the completion queue from user mode and is
+      not a system call. RIO_WAIT_NOTIFY arms RIONotify and sleeps on the
+      reactor's completion port only when the queue is empty. RIO_WAIT_POLL
+      spins on the queue for RIO_POLL_SPINS empty reads before it sleeps,
+      like io_uring's SQPOLL thread with its idle timeout. Each reactor in poll
+      mode keeps a core busy.
+    - RIO has no accept and no multishot operations. An acceptor thread keeps
+      RIO_ACCEPTS_PENDING AcceptEx calls posted and passes the sockets to the
+      reactors round-robin.
+
+    ServerStats::qwSystemCalls counts what enters the kernel: committing
+    sends/receives, RIONotify, completion port waits and socket setup.
+    Deferred requests and completion queue reads are free.
+*/
+constexpr DWORD RIO_SLICE_SIZE = 4096;
+constexpr DWORD RIO_MAX_CONNECTIONS = 256;      //Per reactor: fixes the registered region and the completion queue size
+constexpr DWORD RIO_BATCH = 64;
+constexpr DWORD RIO_ACCEPTS_PENDING = 16;
+constexpr DWORD RIO_POLL_SPINS = 20000;
+
+enum RioWaitMode
+{
+    RIO_WAIT_NOTIFY,
+    RIO_WAIT_POLL,
+};
+
+class RioServer
+{
+public:
+    explicit RioServer(ServerHandler* pHandlerIn);
+    ~RioServer();
+
+    RioServer(const RioServer&) = delete;
+    RioServer& operator=(const RioServer&) = delete;
+
+    //Listens on nPort (any address) with nReactors threads, 0: one per processor
+    bool Start(USHORT nPort, DWORD nReactors = 0, RioWaitMode eModeIn = RIO_WAIT_NOTIFY);
+
+    //Stops accepting, closes every connection and joins the threads
+    void Stop();
+
+    //Valid after Stop()
+    ServerStats GetStats() const { return this->hStats; }
+
+    DWORD reactors() const { return static_cast<DWORD>(this->vReactors.size()); }
+    RioWaitMode mode() const { return this->eMode; }
+
+private:
+    struct Slice
+    {
+        bool bSending;
+        int nReplyBytes;
+        int nReplySent;
+    };
+
+    struct Connection
+    {
+        SOCKET hSocket;
+        RIO_RQ hRequests;
+        ConnectionId nId;
+        size_t nIndex;                  //Position in the owning reactor's vConnections
+        DWORD nSlot;                    //Slices 2 * nSlot and 2 * nSlot + 1 of the reactor's region
+        int nOutstanding;               //Requests not completed yet: the connection is freed only at 0
+        bool bReceiveWanted;            //Both slices were busy sending; receive once one is free
+        bool bClosed;
+        Slice hSlices[2];
+    };
+
+    struct Handoff
+    {
+        SOCKET hSocket;
+        ConnectionId nId;
+    };
+
+    struct Reactor
+    {
+        DWORD nIndex;
+        HANDLE hPort;
+        OVERLAPPED hNotifyOverlapped;
+        RIO_CQ hQueue;
+        RIO_BUFFERID hBufferId;
+        char* pBuffers;
+        std::vector<DWORD> vFreeSlots;
+        std::vector<Connection*> vConnections;
+        std::mutex hInboxLock;
+        std::vector<Handoff> vInbox;    //Accepted sockets not adopted yet
+        std::atomic<size_t> nInbox;
+        std::atomic<bool> bStopRequested;
+        bool bStopping;
+        bool bNotifyArmed;
+        std::thread hThread;
+        ServerStats hStats;
+    };
+
+    struct AcceptOperation
+    {
+        OVERLAPPED hOverlapped;
+        SOCKET hSocket;
+        char pAddresses[2 * (sizeof(sockaddr_storage) + 16)];
+    };
+
+    bool CreateReactor(DWORD nIndex);
+    void DestroyReactor(Reactor* pReactor);
+
+    void RunAcceptor();
+    bool PostAccept(AcceptOperation* pAccept);
+
+    void Run(Reactor* pReactor);
+    void Wait(Reactor* pReactor);
+    void BeginStop(Reactor* pReactor);
+    void DrainInbox(Reactor* pReactor);
+    void Adopt(Reactor* pReactor, const Handoff& hHandoff);
+
+    void OnResult(Reactor* pReactor, const RIORESULT& hResult);
+    bool PostReceive(Reactor* pReactor, Connection* pConnection, DWORD nSlice);
+    bool PostSend(Reactor* pReactor, Connection* pConnection, DWORD nSlice, bool bDefer);
+    void Close(Reactor* pReactor, Connection* pConnection);
+    void Release(Reactor* pReactor, Connection* pConnection);
+
+    char* SliceData(Reactor* pReactor, Connection* pConnection, DWORD nSlice) const
+    {
+        return pReactor->pBuffers + (2 * pConnection->nSlot + nSlice) * RIO_SLICE_SIZE;
+    }
+
+    ServerHandler* pHandler;
+    RIO_EXTENSION_FUNCTION_TABLE hRio;
+    RioWaitMode eMode;
+    SOCKET hListen;
+    HANDLE hAcceptPort;
+    std::thread hAcceptor;
+    DWORD nNextReactor;
+    DWORD nAcceptsPending;
+    ConnectionId nNextId;
+    std::vector<Reactor*> vReactors;
+    std::vector<AcceptOperation*> vAccepts;
+    ServerStats hAcceptStats;
+    ServerStats hStats;                 //Totals of the acceptor and the reactors, collected by Stop()
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <windows.h>
+
+/*
+    What a server backend calls into. The backend owns the sockets, the buffers
+    and the I/O; the handler only sees connections and bytes.
+
+    - Callbacks for one connection always run on the same backend thread, in
+      order. Different connections run on different threads at the same time,
+      so anything the handler shares between connections must be thread safe.
+    - OnData gets the receive buffer itself. It may rewrite it in place, up to
+      nCapacity bytes, and returns how many bytes from its start to send back
+      (0: nothing, keep receiving; < 0: close the connection). No receive
+      lands in that buffer again before the reply has been sent.
+*/
+typedef ULONGLONG ConnectionId;
+
+class ServerHandler
+{
+public:
+    virtual ~ServerHandler() = default;
+
+    virtual void OnConnect(ConnectionId nConnection) { }
+    virtual int OnData(ConnectionId nConnection, char* pData, int nBytes, int nCapacity) = 0;
+    virtual void OnClose(ConnectionId nConnection) { }
+};
+
+//The echo protocol of server_thread in Main.cpp: every byte goes straight back
+class EchoHandler : public ServerHandler
+{
+public:
+    int OnData(ConnectionId nConnection, char* pData, int nBytes, int nCapacity) override
+    {
+        return nBytes;
+    }
+};
+
+//Counters summed over every backend thread; read them after Stop()
+struct ServerStats
+{
+    ULONGLONG qwConnections;
+    ULONGLONG qwBytesReceived;
+    ULONGLONG qwBytesSent;
+    ULONGLONG qwWaits;              //Dequeue calls that returned completions (GetQueuedCompletionStatusEx, RIODequeueCompletion)
+    ULONGLONG qwCompletions;        //Completions taken from the queue
+    ULONGLONG qwInlineCompletions;  //Operations that finished inside the call that started them and never reached the queue
+    ULONGLONG qwSystemCalls;        //Every socket or completion call made by the backend threads, waits included
+};
+
+inline void AddServerStats(ServerStats* pTotal, const ServerStats& hPart)
+{
+    pTotal->qwConnections += hPart.qwConnections;
+    pTotal->qwBytesReceived += hPart.qwBytesReceived;
+    pTotal->qwBytesSent += hPart.qwBytesSent;
+    pTotal->qwWaits += hPart.qwWaits;
+    pTotal->qwCompletions += hPart.qwCompletions;
+    pTotal->qwInlineCompletions += hPart.qwInlineCompletions;
+    pTotal->qwSystemCalls += hPart.qwSystemCalls;
+}